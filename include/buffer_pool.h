@@ -0,0 +1,26 @@
+#ifndef BUFFER_POOL_H
+#define BUFFER_POOL_H
+
+#include <stddef.h>
+#include "protocol.h"
+
+// Payload capacities of the pooled frame buffers; larger frames get a full Message
+#define FRAME_BUFFER_SMALL 64
+#define FRAME_BUFFER_MEDIUM 512
+
+// Free buffers kept per size class, extra buffers are returned to the allocator
+#define FRAME_BUFFER_MAX_FREE 1024
+
+// Get a buffer for a frame with payload_length bytes. Only the header and
+// payload[0..payload_length] (including the terminating '\0') may be used,
+// except for frames larger than FRAME_BUFFER_MEDIUM which get a full Message.
+// Returns NULL if out of memory.
+Message *frame_buffer_acquire(size_t payload_length);
+
+// Return a buffer from frame_buffer_acquire() to its pool (NULL is ignored)
+void frame_buffer_release(Message *frame);
+
+// Free every pooled buffer (call after the worker threads have stopped)
+void frame_buffer_pool_cleanup(void);
+
+#endif // BUFFER_POOL_H
@@ -13,6 +13,9 @@ int get_definition_id_from_instance(int instance_id, int *out_definition_id);
 int get_price_trend(int definition_id, PriceTrend *out_trend);
 int get_price_history(int definition_id, PriceHistoryEntry *out_history, int *count);
 int load_skin_details(int instance_id, Skin *out_skin);
+int load_skin_details_many(const int *instance_ids, int count, Skin *out_skins, int *out_loaded);
+int load_usernames_many(const int *user_ids, int count, char (*out_names)[32]);
+int load_inventory_full(int user_id, Skin *out_skins, int *out_count);
 float get_user_balance(void);
 float calculate_inventory_value(void);
 void display_balance_info(void);
@@ -0,0 +1,42 @@
+#ifndef CONNECTION_H
+#define CONNECTION_H
+
+#include <stddef.h>
+#include "protocol.h"
+
+// Input buffer holds at most one full frame; pipelined frames beyond it stay in the kernel buffer
+#define CONN_INPUT_BUFFER_SIZE (sizeof(MessageHeader) + MAX_PAYLOAD_SIZE)
+
+// Framing state of a non-blocking connection
+typedef enum
+{
+    FRAME_READ_HEADER = 0, // Waiting for a full MessageHeader
+    FRAME_READ_PAYLOAD     // Header validated, waiting for msg_length payload bytes
+} FrameState;
+
+typedef struct Connection
+{
+    int fd;
+    FrameState state;
+    MessageHeader header; // Header of the frame being assembled
+    char *in_buf;         // Allocated on first read so idle connections stay small
+    size_t in_len;
+    struct Connection *prev, *next; // Owner's list of open connections (the reactor's)
+} Connection;
+
+// Called for each complete, checksum-verified frame. The frame is a pooled buffer from
+// frame_buffer_acquire() and the handler takes ownership of it, also on error.
+// Return non-zero to drop the connection.
+typedef int (*FrameHandler)(Connection *conn, Message *frame, void *ctx);
+
+// Create connection state for an accepted socket (socket must be non-blocking)
+Connection *connection_create(int fd);
+
+// Free connection state (does not close the socket)
+void connection_destroy(Connection *conn);
+
+// Read all available bytes and dispatch every complete frame.
+// Returns 0 when the socket would block, -1 on disconnect or protocol error.
+int connection_read_frames(Connection *conn, FrameHandler on_frame, void *ctx);
+
+#endif // CONNECTION_H
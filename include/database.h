@@ -7,10 +7,41 @@
 #define TRADE_LOCK_DURATION_DAYS 7  // Items are locked for 7 days after trade/market purchase/listing
 #define TRADE_LOCK_DURATION_SECONDS (TRADE_LOCK_DURATION_DAYS * 24 * 60 * 60)
 
+#define DB_PATH "data/database.db"
+#define DB_BUSY_TIMEOUT_MS 5000 // Wait this long for another connection's write lock
+#define DB_POOL_MAX_IDLE 64     // Idle connections kept per kind, extra ones are closed
+#define DB_STMT_CACHE_SLOTS 128 // Prepared statements cached per connection (power of two)
+#define DB_BATCH_MAX_IDS 64     // Ids bound per query in a fixed-width IN list
+
+// Skin instance joined with its definition, filled by db_load_skin_instances
+typedef struct
+{
+    int instance_id; // 0 if the requested instance does not exist
+    int definition_id;
+    SkinRarity rarity;
+    WearCondition wear;
+    int pattern_seed;
+    int is_stattrak;
+    int owner_id;
+    time_t acquired_at;
+    int is_tradable;
+    char name[MAX_ITEM_NAME_LEN]; // Definition name ("" if the definition is missing)
+    float base_price;             // Definition base price (before rarity multiplier)
+    SkinRarity definition_rarity; // Rarity of the definition (the instance's rarity if missing)
+} SkinInstanceRecord;
+
 // Initialize database files
 int db_init();
 void db_close();
 
+// Bind the calling thread to its own pooled connection (call after db_init, once per thread).
+// Read-only connections are used by reader workers; WAL lets them run next to the writer.
+// Returns -1 if no connection could be opened, the thread then shares the main connection.
+int db_thread_attach(int read_only);
+
+// Return the connection from db_thread_attach to the pool (call before the thread exits)
+void db_thread_detach(void);
+
 // User operations
 int db_save_user(User *user);
 int db_load_user(int user_id, User *out_user);
@@ -42,6 +73,8 @@ int db_update_listing(MarketListing *listing);
 
 // Transaction log
 int db_log_transaction(TransactionLog *log);
+// Log plus its ledger row, both or neither; sets log->log_id (entry uses log's user_id and timestamp)
+int db_log_ledger(TransactionLog *log, const LedgerEntry *entry);
 
 // Session operations
 int db_save_session(Session *session);
@@ -52,7 +85,20 @@ int db_delete_session(const char *token);
 int db_load_skin_definition(int definition_id, char *name, float *base_price);
 int db_load_skin_definition_with_rarity(int definition_id, char *name, float *base_price, SkinRarity *rarity);
 int db_load_skin_instance(int instance_id, int *definition_id, SkinRarity *rarity, WearCondition *wear, int *pattern_seed, int *is_stattrak, int *owner_id, time_t *acquired_at, int *is_tradable);
+
+// Load many skin instances with their definitions in one query.
+// out_records[i] describes instance_ids[i]; its instance_id is 0 if that instance was not found.
+// out_found (optional) receives the number of instances found. Returns 0 on success, -1 on error.
+int db_load_skin_instances(const int *instance_ids, int count, SkinInstanceRecord *out_records, int *out_found);
+
+// Load a user's inventory with every instance and definition resolved, in one query.
+// out_records must hold MAX_INVENTORY_SIZE entries.
+int db_load_inventory_instances(int user_id, SkinInstanceRecord *out_records, int *count);
 int db_create_skin_instance(int definition_id, SkinRarity rarity, WearCondition wear, int pattern_seed, int is_stattrak, int owner_id, int *out_instance_id);
+
+// Create count instances (definition_id, rarity, wear, pattern_seed, is_stattrak of each record)
+// owned by owner_id and add them to the owner's inventory. Call inside a transaction.
+int db_create_owned_instances(int owner_id, const SkinInstanceRecord *items, int count, int *out_instance_ids);
 int db_update_skin_instance_owner(int instance_id, int new_owner_id);
 int db_get_wear_multiplier(WearCondition wear, float *multiplier);
 int db_get_rarity_multiplier(SkinRarity rarity, float *multiplier);
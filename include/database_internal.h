@@ -3,14 +3,27 @@
 
 #include <sqlite3.h>
 
-// Shared database connection (defined in database_sqlite.c)
-extern sqlite3 *db;
-
-// Get database connection (for internal use)
+// Get the calling thread's database connection (for internal use).
+// On reader workers this is a read-only connection.
 sqlite3 *db_get_connection();
 
-// Helper functions for JSON parsing (used in database_cases.c)
-int parse_int_array(const char *json, int *out_array, int *out_count, int max_count);
-int parse_float_array(const char *json, float *out_array, int *out_count, int max_count);
+// Pooled connection with its own prepared statement cache
+typedef struct DbConnection DbConnection;
+
+// Take a connection from the pool, opening a new one if none is idle (NULL on failure).
+// Only one thread may use it until it is checked back in.
+DbConnection *db_checkout(int read_only);
+
+// Return a connection from db_checkout (an open transaction is rolled back)
+void db_checkin(DbConnection *conn);
+
+// SQLite handle of a pooled connection
+sqlite3 *db_connection_handle(DbConnection *conn);
+
+// Prepare sql on the calling thread's connection, reusing the statement cached for the same
+// text if there is one. Every statement must be given back with db_finalize(), which resets it
+// and clears its bindings (statements not in the cache are really finalized).
+int db_prepare(const char *sql, sqlite3_stmt **out_stmt);
+int db_finalize(sqlite3_stmt *stmt);
 
 #endif // DATABASE_INTERNAL_H
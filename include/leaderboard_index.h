@@ -0,0 +1,35 @@
+#ifndef LEADERBOARD_INDEX_H
+#define LEADERBOARD_INDEX_H
+
+#include "types.h"
+
+// Net-worth ranking (balance + inventory value) kept in memory as an indexable skip list,
+// highest first, ties broken by lower user_id. Seeded from the database once, then kept current
+// by leaderboard_index_refresh_user() after every committed change to a user's balance or
+// inventory. Rebuilt when the pricing catalog changes, since that reprices every inventory;
+// queries keep getting the old ranking until the rebuilt one is swapped in.
+#define LEADERBOARD_MAX_LEVEL 16
+
+// Seed from the calling thread's connection (after db_init)
+int leaderboard_index_init(void);
+void leaderboard_index_cleanup(void);
+
+// Re-read one user's balance and inventory and move them to their new place.
+// Call after the transaction that changed them has committed.
+void leaderboard_index_refresh_user(int user_id);
+
+// Entries ranked first_rank .. first_rank + limit - 1 (ranks start at 1)
+int leaderboard_index_range(int first_rank, int limit, LeaderboardEntry *out_entries, int *count);
+
+// The user's rank and up to radius entries on either side of it; *out_first_rank is the
+// rank of out_entries[0]. -1 if the user is not ranked
+int leaderboard_index_around(int user_id, int radius, LeaderboardEntry *out_entries, int *count,
+                             int *out_first_rank, int *out_rank);
+
+// A user's rank (1 = richest) and net worth; -1 if the user is not ranked
+int leaderboard_index_rank(int user_id, int *out_rank, float *out_net_worth);
+
+// Number of ranked users
+int leaderboard_index_size(void);
+
+#endif // LEADERBOARD_INDEX_H
@@ -0,0 +1,31 @@
+#ifndef LEADERBOARD_WINDOWS_H
+#define LEADERBOARD_WINDOWS_H
+
+#include "types.h"
+#include "leaderboards.h"
+#include <time.h>
+
+// Daily, weekly and monthly leaderboards from per-user day buckets kept in memory.
+// Each user has a ring of LEADERBOARD_WINDOW_DAYS buckets tagged with their UTC day number;
+// a bucket from an older day is cleared the next time its slot is written, so a new day
+// needs no work and no rescan of the ledger. Windows end today and cover 1, 7 or 30 days.
+// Rankings are cached and may trail recorded activity by up to a second.
+//   Top traders:   market and trade volume (price of everything bought, sold or traded)
+//   Luckiest:      best single unbox value
+//   Most profit:   market sale proceeds, as on the all-time board
+#define LEADERBOARD_WINDOW_DAYS 30
+
+// Fill the buckets from the last LEADERBOARD_WINDOW_DAYS days of the ledger (after db_init)
+int leaderboard_windows_init(void);
+void leaderboard_windows_cleanup(void);
+
+// Record committed activity (when = time of the event)
+void leaderboard_windows_record_sale(int seller_id, int buyer_id, float price, time_t when);
+void leaderboard_windows_record_trade(int user_id, float gave_value, float received_value, time_t when);
+void leaderboard_windows_record_unbox(int user_id, int definition_id, float value, time_t when);
+
+// Top entries of one board over one window (window must not be LEADERBOARD_ALL_TIME)
+int leaderboard_windows_top(LeaderboardType type, LeaderboardWindow window, LeaderboardEntry *out_entries,
+                            int *count, int limit);
+
+#endif // LEADERBOARD_WINDOWS_H
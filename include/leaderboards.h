@@ -10,9 +10,34 @@ typedef enum {
     LEADERBOARD_MOST_PROFITABLE     // By total profit
 } LeaderboardType;
 
+// Period a board covers
+typedef enum {
+    LEADERBOARD_ALL_TIME = 0,
+    LEADERBOARD_DAILY,              // Today (UTC)
+    LEADERBOARD_WEEKLY,             // Last 7 days including today
+    LEADERBOARD_MONTHLY             // Last 30 days including today
+} LeaderboardWindow;
+
+// Largest slices served by the rank queries
+#define LEADERBOARD_MAX_RADIUS 25     // Entries on each side of a user
+#define LEADERBOARD_MAX_PAGE_SIZE 100
+
 // Get top traders by net worth
 int get_top_traders(LeaderboardEntry *out_entries, int *count, int limit);
 
+// A user's rank by net worth; -1 if the user is not ranked
+int get_trader_rank(int user_id, LeaderboardRank *out_rank);
+
+// The user's entry and up to radius entries either side of it
+int get_traders_around(int user_id, int radius, LeaderboardSlice *out_slice, LeaderboardEntry *out_entries);
+
+// Page of the net-worth leaderboard (page starts at 1); an empty slice past the end
+int get_traders_page(int page, int page_size, LeaderboardSlice *out_slice, LeaderboardEntry *out_entries);
+
+// Get a board over a daily, weekly or monthly window; LEADERBOARD_ALL_TIME gives the boards above
+int get_windowed_leaderboard(LeaderboardType type, LeaderboardWindow window, LeaderboardEntry *out_entries,
+                             int *count, int limit);
+
 // Get luckiest unboxers (best unbox value)
 int get_luckiest_unboxers(LeaderboardEntry *out_entries, int *count, int limit);
 
@@ -1,6 +1,7 @@
 #ifndef NETWORK_CLIENT_H
 #define NETWORK_CLIENT_H
 
+#include <stddef.h>
 #include "protocol.h"
 
 // Connect to server
@@ -15,6 +16,22 @@ int send_message_to_server(Message *message);
 // Receive message from server
 int receive_message_from_server(Message *message);
 
+// Receive a response that may be split into chunks (MSG_FLAG_MORE_CHUNKS) and reassemble its payload
+// into buffer. response holds the first frame (for msg_type / MSG_ERROR checks), *out_length the
+// reassembled size. Data beyond buffer_size is discarded.
+int receive_chunked_from_server(Message *response, void *buffer, size_t buffer_size, uint32_t *out_length);
+
+// Pipelined requests: several requests may be in flight, responses are matched by sequence_num.
+// Callers keep at most MAX_PIPELINED_REQUESTS outstanding.
+#define MAX_PIPELINED_REQUESTS 64
+
+// Assigns a sequence number, sends the request and returns the sequence number (0 on failure).
+uint32_t send_message_pipelined(Message *message);
+
+// Wait for the response to a pipelined request. Responses to other in-flight requests that
+// arrive first are buffered until asked for.
+int receive_response_for(uint32_t sequence_num, Message *response);
+
 // Check if connected
 int is_connected();
 
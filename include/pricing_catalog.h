@@ -0,0 +1,85 @@
+#ifndef PRICING_CATALOG_H
+#define PRICING_CATALOG_H
+
+#include "types.h"
+
+// In-memory copy of skin_definitions, rarity_multipliers and wear_multipliers so
+// pricing is plain arithmetic, plus cases and case_skins compiled into roll tables so
+// unboxing is a constant-time draw. Triggers bump catalog_version whenever one of the tables
+// changes; the version is re-read at most every CATALOG_CHECK_INTERVAL_SEC seconds.
+#define CATALOG_CHECK_INTERVAL_SEC 5
+#define CATALOG_RARITY_COUNT (RARITY_CONTRABAND + 1)
+#define CATALOG_WEAR_BUCKETS 1024 // Wear lookup resolution, must be finer than the narrowest wear range
+#define CATALOG_MAX_WEAR_RANGES 16
+
+typedef struct
+{
+    char name[MAX_ITEM_NAME_LEN];
+    float base_price;
+    SkinRarity rarity;
+    int exists;
+} CatalogDefinition;
+
+// A case with its drop table. Each skin's weight is the drop rate of its rarity divided by
+// the number of skins of that rarity in the case; rolls use Vose's alias method.
+typedef struct
+{
+    char name[32];
+    float price;
+    int exists;
+    int skin_count;         // Skins that can drop (rarities with a zero drop rate are left out)
+    int *definition_ids;    // skin_count entries
+    double *accept;         // Probability of keeping column i rather than taking alias[i]
+    int *alias;
+    double rarity_weight[CATALOG_RARITY_COUNT]; // Chance of each rarity in this case (sums to 1)
+} CatalogCase;
+
+typedef struct PricingCatalog
+{
+    long long version;
+    int max_definition_id;
+    CatalogDefinition *definitions; // Indexed by definition_id (max_definition_id + 1 entries)
+
+    float rarity_multipliers[CATALOG_RARITY_COUNT];
+    unsigned char rarity_known[CATALOG_RARITY_COUNT];
+
+    // Wear ranges sorted by wear_min; bucket b holds the first range whose wear_max >= b / CATALOG_WEAR_BUCKETS
+    int wear_range_count;
+    double wear_min[CATALOG_MAX_WEAR_RANGES + 1];
+    double wear_max[CATALOG_MAX_WEAR_RANGES + 1];
+    float wear_multiplier[CATALOG_MAX_WEAR_RANGES + 1];
+    unsigned char wear_bucket[CATALOG_WEAR_BUCKETS + 1];
+
+    int max_case_id;
+    CatalogCase *cases; // Indexed by case_id (max_case_id + 1 entries)
+
+    struct PricingCatalog *retired_next; // Older catalogs are kept until shutdown
+} PricingCatalog;
+
+// Load the catalog from the calling thread's connection (call after the schema exists)
+int pricing_catalog_init(void);
+
+// Current catalog, reloaded first if the tables changed (NULL if it was never loaded)
+const PricingCatalog *pricing_catalog_get(void);
+
+// Reload now, e.g. right after changing one of the tables
+int pricing_catalog_reload(void);
+
+// Free every catalog (no thread may use one any more)
+void pricing_catalog_cleanup(void);
+
+// Lookups on a catalog (return -1 when the definition, rarity or wear range is unknown)
+int pricing_catalog_definition(const PricingCatalog *catalog, int definition_id, const CatalogDefinition **out_def);
+int pricing_catalog_rarity_multiplier(const PricingCatalog *catalog, SkinRarity rarity, float *multiplier);
+int pricing_catalog_wear_multiplier(const PricingCatalog *catalog, WearCondition wear, float *multiplier);
+
+int pricing_catalog_case(const PricingCatalog *catalog, int case_id, const CatalogCase **out_case);
+
+// Draw a skin from a case with two independent uniform numbers in [0, 1).
+// Returns the definition_id, or -1 if the case is unknown or has nothing to drop.
+int pricing_catalog_roll_case(const CatalogCase *case_data, double u1, double u2);
+
+// base_price * rarity multiplier * wear multiplier, 0 if anything is unknown
+float pricing_catalog_price(const PricingCatalog *catalog, int definition_id, SkinRarity rarity, WearCondition wear);
+
+#endif // PRICING_CATALOG_H
@@ -13,10 +13,18 @@ typedef struct
     uint32_t msg_length;   // Độ dài payload
     uint32_t sequence_num; // Số thứ tự
     uint32_t checksum;     // CRC32
+    uint32_t total_length; // Tổng độ dài response khi gửi thành nhiều chunk
+    uint16_t flags;        // MSG_FLAG_*
+    uint16_t reserved;
 } MessageHeader;
 
 #define MAX_PAYLOAD_SIZE 4096
 
+// Chunked responses: results larger than MAX_PAYLOAD_SIZE are sent as consecutive frames with the
+// same msg_type and sequence_num. Every frame carries total_length; all but the last set MORE_CHUNKS.
+#define MSG_FLAG_MORE_CHUNKS 0x0001
+#define MAX_CHUNKED_RESPONSE_SIZE (1024 * 1024)
+
 typedef struct
 {
     MessageHeader header;
@@ -68,8 +76,11 @@ typedef struct
 #define MSG_SEARCH_USER_RESPONSE 0x0037
 #define MSG_GET_DEFINITION_ID 0x0038
 #define MSG_DEFINITION_ID_DATA 0x0039
+#define MSG_GET_INVENTORY_FULL 0x003A  // Payload: user_id
+#define MSG_INVENTORY_FULL_DATA 0x003B // Skin[] with details and prices resolved (chunked)
 
-// Leaderboards
+// Leaderboards. Requests take "limit[:window]", window a LeaderboardWindow (0 = all time,
+// 1 = daily, 2 = weekly, 3 = monthly); windowed top traders rank by traded volume
 #define MSG_GET_TOP_TRADERS 0x0040
 #define MSG_TOP_TRADERS_DATA 0x0041
 #define MSG_GET_LUCKIEST_UNBOXERS 0x0042
@@ -99,11 +110,21 @@ typedef struct
 #define MSG_CANCEL_CHALLENGE 0x0056
 #define MSG_CANCEL_CHALLENGE_RESPONSE 0x0057
 
+// Net-worth leaderboard positions
+#define MSG_GET_LEADERBOARD_RANK 0x0058    // Payload: user_id
+#define MSG_LEADERBOARD_RANK_DATA 0x0059   // LeaderboardRank
+#define MSG_GET_LEADERBOARD_AROUND 0x005A  // "user_id:radius", radius <= LEADERBOARD_MAX_RADIUS
+#define MSG_LEADERBOARD_AROUND_DATA 0x005B // LeaderboardSlice + LeaderboardEntry[count], chunked
+#define MSG_GET_LEADERBOARD_PAGE 0x005C    // "page:page_size", page from 1, page_size <= LEADERBOARD_MAX_PAGE_SIZE
+#define MSG_LEADERBOARD_PAGE_DATA 0x005D   // LeaderboardSlice + LeaderboardEntry[count], chunked
+
 // UNBOXING
 #define MSG_UNBOX_CASE 0x0080
 #define MSG_UNBOX_RESULT 0x0081
 #define MSG_GET_CASES 0x0082
 #define MSG_CASES_DATA 0x0083
+#define MSG_UNBOX_CASE_BATCH 0x0084   // "user_id:case_id:count", count <= MAX_UNBOX_BATCH
+#define MSG_UNBOX_BATCH_RESULT 0x0085 // UnboxBatchResult + Skin[count], chunked
 
 // CHAT
 #define MSG_CHAT_GLOBAL 0x0060
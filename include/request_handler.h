@@ -11,6 +11,9 @@ int handle_client_request(int client_fd, Message *request);
 // Send response to client
 int send_response(int client_fd, Message *response);
 
+// Reject a request with ERR_SERVER_FULL (sent by a worker, in the connection's request order)
+int send_server_full_response(int client_fd, const MessageHeader *request_header);
+
 // Receive message from client
 int receive_message(int client_fd, Message *message);
 
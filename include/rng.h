@@ -0,0 +1,43 @@
+#ifndef RNG_H
+#define RNG_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+// Per-thread xoshiro256** generators for game rolls. Every thread draws from its own stream
+// of one base seed: stream k is the base state advanced k * 2^128 steps, so streams never
+// overlap. The base seed comes from the OS unless CS2_RNG_SEED is set, and is logged either
+// way so a run can be replayed. Not for secrets; use rng_os_bytes() for those.
+//
+// Pool workers bind to a fixed stream (rng_bind_stream), so a replay does not depend on which
+// thread happened to roll first. Threads that never bind get streams in order of first use,
+// from a range 2^192 steps away from the bound ones.
+#define RNG_SEED_ENV "CS2_RNG_SEED"
+
+#define RNG_BOUND_STREAMS 512
+
+// Pick the base seed (from CS2_RNG_SEED or the OS) and log it; call once at startup.
+// Threads that roll before this get an OS seed.
+int rng_init(void);
+
+// Restart from a fixed base seed; threads that already rolled pick up a new stream on their next call
+void rng_seed(uint64_t seed);
+
+uint64_t rng_base_seed(void);
+
+// Tie the calling thread to stream index (< RNG_BOUND_STREAMS). A thread that takes over the
+// index later, e.g. a respawned worker in the same slot, continues where the last one stopped.
+void rng_bind_stream(unsigned int index);
+
+uint64_t rng_next(void);
+
+// Uniform double in [0, 1) with 53 random bits
+double rng_uniform(void);
+
+// Uniform integer in [0, bound), bound > 0, without modulo bias
+uint32_t rng_below(uint32_t bound);
+
+// Bytes from the kernel CSPRNG (getrandom), for session tokens and seeds
+int rng_os_bytes(void *buf, size_t len);
+
+#endif // RNG_H
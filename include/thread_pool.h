@@ -2,43 +2,215 @@
 #define THREAD_POOL_H
 
 #include <pthread.h>
+#include <stdatomic.h>
 #include "types.h"
 #include "protocol.h"
 
 #define MAX_QUEUE_SIZE 1000
-#define NUM_WORKER_THREADS 8
 
+// Read-only requests run on the reader lane, where every worker has a read-only SQLite connection.
+// Mutations run on a small writer lane, so they never queue behind slow scans
+// and SQLite (WAL) lets the readers proceed while one writer commits.
+typedef enum
+{
+    LANE_READ = 0,
+    LANE_WRITE,
+    LANE_COUNT
+} JobLane;
+
+#define WRITER_LANE_WORKERS 1
+
+// Reader lane size: starts with one worker per CPU and scales between min and max at runtime
+#define MIN_WORKER_THREADS 2
+#define WORKERS_PER_CPU_MAX 4 // Default max = CPUs * WORKERS_PER_CPU_MAX (handlers block on SQLite)
+#define MAX_WORKER_THREADS 256
+
+// Scaling policy, evaluated every SCALE_INTERVAL_MS
+#define SCALE_INTERVAL_MS 500
+#define SCALE_GROW_QUEUE_PER_WORKER 2 // Grow when more jobs than this are queued per active worker
+#define SCALE_SHRINK_BUSY_PERCENT 25  // Shrink when fewer than this % of workers are busy...
+#define SCALE_SHRINK_INTERVALS 10     // ...for this many samples in a row
+
+// Admission control: a job is rejected once queued + parked jobs reach the limit of its cost class,
+// so expensive scans are shed first and cheap calls keep working until the queue is really full
+typedef enum
+{
+    JOB_COST_CHEAP = 0, // Heartbeat, single-row lookups
+    JOB_COST_NORMAL,    // Everything else
+    JOB_COST_EXPENSIVE  // Leaderboards, history and search scans
+} JobCost;
+
+#define ADMIT_LIMIT_CHEAP MAX_QUEUE_SIZE
+#define ADMIT_LIMIT_NORMAL (MAX_QUEUE_SIZE * 3 / 4)
+#define ADMIT_LIMIT_EXPENSIVE (MAX_QUEUE_SIZE / 2)
+
+// thread_pool_add_job() result when the job was shed by admission control
+// (an ERR_SERVER_FULL reply is queued on the connection instead)
+#define THREAD_POOL_REJECTED -2
+
+// Mailboxes are allocated in chunks as fds show up, so the table never moves
+#define MAILBOX_CHUNK_SIZE 256
+#define MAILBOX_MAX_CHUNKS 4096 // Supports fds up to 1M
+
+// Busy replies and broadcasts a connection may have waiting (behind its queued requests or a
+// full socket); past this a client that keeps pipelining is disconnected and broadcasts to it are dropped
+#define MAILBOX_MAX_OUTPUT 1024
+
+// A job owns its request: a pooled buffer from frame_buffer_acquire(), released after handling
 typedef struct
 {
     int client_fd;
-    Message request;
+    Message *request;
 } Job;
 
+// Frame sent unchanged to many connections (broadcasts), freed by the last reference
+typedef struct
+{
+    atomic_int refs;
+    Message message;
+} SharedMessage;
+
+typedef enum
+{
+    PENDING_REQUEST = 0, // A request to handle (job)
+    PENDING_BUSY_REPLY,  // ERR_SERVER_FULL for a shed request (request_header)
+    PENDING_BROADCAST    // Frame pushed to the client (shared)
+} PendingKind;
+
+// Job or outgoing frame waiting behind another job from the same connection
+typedef struct PendingJob
+{
+    PendingKind kind;
+    Job job;
+    MessageHeader request_header;
+    SharedMessage *shared;
+    struct PendingJob *next;
+} PendingJob;
+
+// Per-connection mailbox: at most one job per client_fd is queued or running at a time,
+// later requests from the same client, busy replies to its shed requests and broadcasts wait
+// here in arrival order, so responses go out in request order
+typedef struct Mailbox
+{
+    pthread_mutex_t lock;
+    int fd;
+    int in_flight;     // A job for this fd is in a worker deque or being handled
+    int close_pending; // Connection closed while in flight, worker closes the fd when done
+    int output_count;  // Busy replies and broadcasts among the pending entries
+    PendingJob *head;
+    PendingJob *tail;
+    struct Mailbox *next_output; // Link in the pool's output queue
+} Mailbox;
+
+// Per-worker job deque. The owner takes the oldest job (FIFO keeps request latency fair),
+// idle workers of the same lane steal the newest one from the other end.
 typedef struct
 {
-    Job queue[MAX_QUEUE_SIZE];
+    pthread_mutex_t lock;
+    Job jobs[MAX_QUEUE_SIZE]; // Admission control keeps the pool-wide total below this
     int head;
-    int tail;
-    int count;
-    pthread_mutex_t mutex;
-    pthread_cond_t not_empty;
-    pthread_cond_t not_full;
-    int shutdown;
-} JobQueue;
+    atomic_int count; // Read without the lock by thieves to skip empty deques
+} WorkerDeque;
+
+struct ThreadPool;
+struct Lane;
 
 typedef struct
 {
-    pthread_t threads[NUM_WORKER_THREADS];
-    JobQueue job_queue;
+    struct Lane *lane;
+    int index;
+    pthread_t thread;
+    int started;       // Thread is running (changed by init, the scaler and shutdown only)
+    atomic_int retire; // Set by the scaler: exit once there is no work left to take
+    WorkerDeque deque;
+} Worker;
+
+// A set of workers with its own deques and sleep/wake state
+typedef struct Lane
+{
+    struct ThreadPool *pool;
+    JobLane id;
+    Worker *workers;          // max_workers slots, the first active_count receive new jobs
+    int min_workers;
+    int max_workers;
+    atomic_int active_count;  // Workers receiving new jobs
+    atomic_int spawned_count; // Highest slot ever started + 1, thieves scan this many deques
+    atomic_int busy_count;    // Workers inside handle_client_request
+    atomic_uint next_worker;  // Round-robin target for new jobs
+
+    atomic_int queued_count;    // Jobs sitting in this lane's deques
+    atomic_int idle_count;      // Workers sleeping on work_available
+    atomic_int searching_count; // Workers scanning other deques for a job to steal
+
+    pthread_mutex_t idle_mutex;
+    pthread_cond_t work_available;
+} Lane;
+
+typedef struct ThreadPool
+{
+    Lane lanes[LANE_COUNT];
+
+    atomic_int job_count; // Queued + parked jobs, counted against the admission limits
+    atomic_int shutdown;
+    atomic_long rejected_count; // Jobs shed by admission control
+
+    pthread_t scaler_thread; // Only runs when the reader lane has room to scale
+    int scaler_started;
+    pthread_mutex_t scaler_mutex;
+    pthread_cond_t scaler_wakeup; // Signalled on shutdown
+
+    _Atomic(Mailbox *) *mailbox_chunks; // MAILBOX_MAX_CHUNKS entries, indexed by client_fd / MAILBOX_CHUNK_SIZE
+
+    // Mailboxes with busy replies or broadcasts to send and no job in flight, served by the reader lane
+    pthread_mutex_t output_lock;
+    Mailbox *output_head;
+    Mailbox *output_tail;
+    atomic_int output_queued;
 } ThreadPool;
 
-// Initialize thread pool
+// Initialize thread pool: one reader per CPU, scaling between MIN_WORKER_THREADS and CPUs * WORKERS_PER_CPU_MAX
 int thread_pool_init(ThreadPool *pool);
 
-// Add job to queue
+// Initialize thread pool with the reader lane scaling between min_workers and max_workers (0 = default bound).
+// It starts with one reader per CPU, clamped to the bounds.
+int thread_pool_init_scaled(ThreadPool *pool, int min_workers, int max_workers);
+
+// Initialize thread pool with a fixed number of readers (no scaling)
+int thread_pool_init_workers(ThreadPool *pool, int worker_count);
+
+// Number of workers in a lane currently receiving jobs
+int thread_pool_worker_count(ThreadPool *pool, JobLane lane);
+
+// Cost class used by admission control for a request type
+JobCost thread_pool_job_cost(uint16_t msg_type);
+
+// Lane a request type runs on (LANE_READ only for requests that never modify the database)
+JobLane thread_pool_job_lane(uint16_t msg_type);
+
+// Add job to queue (jobs from the same client_fd run one at a time, in order).
+// Never blocks: returns THREAD_POOL_REJECTED when the queue is too full for the request's cost class;
+// a worker then answers it with ERR_SERVER_FULL after the connection's earlier responses.
+// Returns -1 (drop the connection) on shutdown, out of memory or MAILBOX_MAX_OUTPUT unsent replies.
+// Takes ownership of request (from frame_buffer_acquire()) even when it fails.
 int thread_pool_add_job(ThreadPool *pool, int client_fd, Message *request);
 
-// Worker thread function
+// Copy message into a new shared frame holding one reference for the caller (NULL if out of memory)
+SharedMessage *shared_message_create(const Message *message);
+
+// Drop one reference, freeing the frame with the last one
+void shared_message_release(SharedMessage *shared);
+
+// Queue a broadcast frame for a connection, sent by a reader lane worker after the responses
+// queued before it. Never blocks or writes to the socket; takes its own reference.
+// Returns -1 if the frame was dropped (connection too far behind or out of memory).
+int thread_pool_queue_broadcast(ThreadPool *pool, int client_fd, SharedMessage *shared);
+
+// Drop queued jobs for a closed connection and close the socket.
+// If a job is still running for it, the worker closes the socket when it finishes.
+// After thread_pool_shutdown() the socket is simply closed.
+void thread_pool_close_connection(ThreadPool *pool, int client_fd);
+
+// Worker thread function (arg is the Worker)
 void *worker_thread(void *arg);
 
 // Shutdown thread pool
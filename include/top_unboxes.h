@@ -0,0 +1,23 @@
+#ifndef TOP_UNBOXES_H
+#define TOP_UNBOXES_H
+
+#include "types.h"
+#include <time.h>
+
+// The most valuable unboxes ever, for the luckiest-unboxers board: a bounded min-heap in
+// memory (cheapest kept unbox at the root) mirrored to the top_unboxes table, which only ever
+// holds these LEADERBOARD_TOP_UNBOXES rows. Values are the skin's price when it was unboxed.
+#define LEADERBOARD_TOP_UNBOXES 100
+
+// Load the table (after db_init). If it is empty the heap is seeded once from every owned
+// skin instance at current prices, the source the board used before.
+int top_unboxes_init(void);
+void top_unboxes_cleanup(void);
+
+// Offer a committed unbox; kept if it beats the cheapest kept one
+void top_unboxes_record(int user_id, int instance_id, int definition_id, float value, time_t when);
+
+// Kept unboxes, most valuable first (ties: earlier unbox first)
+int top_unboxes_get(LeaderboardEntry *out_entries, int *count, int limit);
+
+#endif // TOP_UNBOXES_H
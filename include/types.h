@@ -10,6 +10,8 @@
 #define MAX_PASSWORD_HASH_LEN 65
 #define MAX_ITEM_NAME_LEN 64
 #define MAX_CHAT_HISTORY 50
+#define MAX_UNBOX_BATCH 50 // Cases per MSG_UNBOX_CASE_BATCH
+#define TRADE_MAX_ITEMS 10 // Items per side of a trade offer
 
 // ==================== ENUMS ====================
 
@@ -106,10 +108,10 @@ typedef struct
     int trade_id;
     int from_user_id;
     int to_user_id;
-    int offered_skins[10];
+    int offered_skins[TRADE_MAX_ITEMS];
     int offered_count;
     float offered_cash;
-    int requested_skins[10];
+    int requested_skins[TRADE_MAX_ITEMS];
     int requested_count;
     float requested_cash;
     TradeStatus status;
@@ -137,6 +139,17 @@ typedef struct
     int skin_count;
 } Case;
 
+// Header of a MSG_UNBOX_BATCH_RESULT payload, followed by count Skin records
+typedef struct
+{
+    int case_id;
+    int count;
+    float total_cost;  // count * (case price + key)
+    float total_value; // Sum of the unboxed skins' current prices
+    float new_balance;
+    int best_index;    // Most valuable skin in the batch
+} UnboxBatchResult;
+
 typedef struct
 {
     int log_id;
@@ -146,6 +159,29 @@ typedef struct
     time_t timestamp;
 } TransactionLog;
 
+// Typed ledger row written with the TransactionLog of every event that moves money or value,
+// so analytics sum columns instead of parsing details. kind is the LogType of the log.
+//   LOG_MARKET_BUY   amount = cost = price paid; counterparty = seller
+//   LOG_MARKET_SELL  amount = sale price, fee = market fee net of the listing fee refund
+//                    (the seller is credited amount - fee); counterparty = buyer
+//   LOG_TRADE        accepted trades only: amount = value received, cost = value given
+//                    (items + cash); counterparty = the other user
+//   LOG_UNBOX        amount = value of the skin, cost = price of the case
+typedef struct
+{
+    int entry_id;
+    int log_id; // transaction_logs row with the readable description
+    LogType kind;
+    int user_id;
+    float amount;
+    float cost;
+    float fee;
+    int instance_id;
+    int counterparty_id;
+    int definition_id;
+    time_t timestamp;
+} LedgerEntry;
+
 // Price history entry for tracking price changes
 typedef struct
 {
@@ -256,6 +292,25 @@ typedef struct
     char details[128]; // Additional info (e.g., "Unboxed: AK-47 Redline")
 } LeaderboardEntry;
 
+// One user's place on the net-worth leaderboard
+typedef struct
+{
+    int user_id;
+    int rank;         // 1 = richest
+    int total_ranked; // Users on the leaderboard
+    float value;      // Net worth
+} LeaderboardRank;
+
+// Header of a slice of the net-worth leaderboard; followed by LeaderboardEntry[count],
+// entry i being rank first_rank + i
+typedef struct
+{
+    int first_rank;
+    int count;
+    int total_ranked;
+    int user_rank; // Rank of the requesting user for "around me" slices, 0 for pages
+} LeaderboardSlice;
+
 // Trade Statistics
 typedef struct
 {
@@ -12,6 +12,10 @@ int get_available_cases(Case *out_cases, int *count);
 // Unbox a case (deducts balance, creates skin instance, adds to inventory)
 int unbox_case(int user_id, int case_id, Skin *out_skin);
 
+// Unbox count (1..MAX_UNBOX_BATCH) cases of one kind in a single transaction.
+// out_skins receives count skins; out_result the totals and the most valuable one.
+int unbox_case_batch(int user_id, int case_id, int count, Skin *out_skins, UnboxBatchResult *out_result);
+
 // Calculate drop rates
 void calculate_drop_rates(Case *case_data);
 
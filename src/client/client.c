@@ -6,6 +6,7 @@
 #include "../include/types.h"
 #include "../include/utils.h"
 #include "../include/trading_challenges.h"
+#include "../include/leaderboards.h"
 #include "../include/logger.h"
 #include "../include/client_auth.h"
 #include "../include/client_common.h"
@@ -60,36 +61,15 @@ void show_inventory()
         display_balance_info();
 
         Message request, response;
-        memset(&request, 0, sizeof(Message));
-        memset(&response, 0, sizeof(Message));
 
-        request.header.magic = 0xABCD;
-        request.header.msg_type = MSG_GET_INVENTORY;
-        snprintf(request.payload, MAX_PAYLOAD_SIZE, "%d", g_user_id);
-        request.header.msg_length = strlen(request.payload);
-
-        if (send_message_to_server(&request) != 0)
+        // Items arrive with details and prices resolved (one request for the whole inventory)
+        Skin skins[MAX_INVENTORY_SIZE];
+        int item_count = 0;
+        if (load_inventory_full(g_user_id, skins, &item_count) == 0)
         {
-            print_error("Failed to request inventory");
-            wait_for_key();
-            return;
-        }
+            printf("\nYour Inventory (%d items):\n\n", item_count);
 
-        if (receive_message_from_server(&response) != 0)
-        {
-            print_error("Failed to receive inventory");
-            wait_for_key();
-            return;
-        }
-
-        if (response.header.msg_type == MSG_INVENTORY_DATA)
-        {
-            Inventory inv;
-            memcpy(&inv, response.payload, sizeof(Inventory));
-
-            printf("\nYour Inventory (%d items):\n\n", inv.count);
-
-            if (inv.count == 0)
+            if (item_count == 0)
             {
                 print_info("Your inventory is empty");
                 printf("\nPress Enter to return...");
@@ -99,29 +79,23 @@ void show_inventory()
             else
             {
                 printf("\n");
-                Skin skins[MAX_INVENTORY_SIZE];
                 int instance_ids[MAX_INVENTORY_SIZE];
-                int valid_count = 0;
+                int valid_count = item_count;
 
-                for (int i = 0; i < inv.count && i < MAX_INVENTORY_SIZE; i++)
+                for (int i = 0; i < item_count; i++)
                 {
-                    int instance_id = inv.skin_ids[i];
-                    if (load_skin_details(instance_id, &skins[valid_count]) == 0)
-                    {
-                        instance_ids[valid_count] = instance_id; // Store mapping
-                        const char *rarity_color = get_rarity_color(skins[valid_count].rarity);
-                        const char *stattrak = skins[valid_count].is_stattrak ? "StatTrak™ " : "";
-                        const char *wear = wear_to_string(skins[valid_count].wear);
-                        const char *tradable = skins[valid_count].is_tradable ? "" : " [Trade Locked]";
-
-                        printf("%d. %s[%s]%s %s%s%s%s (%s, Pattern #%d) - $%.2f%s\n",
-                               valid_count + 1,
-                               rarity_color, rarity_to_string(skins[valid_count].rarity), COLOR_RESET,
-                               skins[valid_count].is_stattrak ? COLOR_BRIGHT_GREEN : "", stattrak, COLOR_RESET,
-                               skins[valid_count].name, wear, skins[valid_count].pattern_seed, skins[valid_count].current_price,
-                               tradable);
-                        valid_count++;
-                    }
+                    instance_ids[i] = skins[i].skin_id; // Store mapping
+                    const char *rarity_color = get_rarity_color(skins[i].rarity);
+                    const char *stattrak = skins[i].is_stattrak ? "StatTrak™ " : "";
+                    const char *wear = wear_to_string(skins[i].wear);
+                    const char *tradable = skins[i].is_tradable ? "" : " [Trade Locked]";
+
+                    printf("%d. %s[%s]%s %s%s%s%s (%s, Pattern #%d) - $%.2f%s\n",
+                           i + 1,
+                           rarity_color, rarity_to_string(skins[i].rarity), COLOR_RESET,
+                           skins[i].is_stattrak ? COLOR_BRIGHT_GREEN : "", stattrak, COLOR_RESET,
+                           skins[i].name, wear, skins[i].pattern_seed, skins[i].current_price,
+                           tradable);
                 }
 
                 printf("\n");
@@ -300,15 +274,18 @@ void show_market()
             {
                 // Load skin details for each listing
                 Skin skins[100];
+                int skin_ids[100];
+                int loaded[100];
                 int valid_count = 0;
 
                 printf("Loading item details...\n");
+                for (int i = 0; i < count; i++)
+                    skin_ids[i] = listings[i].skin_id;
+                load_skin_details_many(skin_ids, count, skins, loaded);
                 for (int i = 0; i < count; i++)
                 {
-                    if (load_skin_details(listings[i].skin_id, &skins[valid_count]) == 0)
-                    {
-                        valid_count++;
-                    }
+                    if (loaded[i])
+                        skins[valid_count++] = skins[i];
                 }
 
                 printf("\n");
@@ -703,6 +680,86 @@ void show_market()
     }
 }
 
+// Open several cases of one kind with MSG_UNBOX_CASE_BATCH and list what came out
+static void unbox_case_batch_ui(const Case *case_data, int quantity)
+{
+    if (quantity > MAX_UNBOX_BATCH)
+    {
+        char msg[64];
+        snprintf(msg, sizeof(msg), "At most %d cases can be opened at once", MAX_UNBOX_BATCH);
+        print_error(msg);
+        wait_for_key();
+        return;
+    }
+
+    Message request, response;
+    memset(&request, 0, sizeof(Message));
+    memset(&response, 0, sizeof(Message));
+    request.header.magic = 0xABCD;
+    request.header.msg_type = MSG_UNBOX_CASE_BATCH;
+    snprintf(request.payload, MAX_PAYLOAD_SIZE, "%d:%d:%d", g_user_id, case_data->case_id, quantity);
+    request.header.msg_length = strlen(request.payload);
+
+    struct
+    {
+        UnboxBatchResult summary;
+        Skin skins[MAX_UNBOX_BATCH];
+    } batch;
+    memset(&batch, 0, sizeof(batch));
+    uint32_t length = 0;
+
+    if (send_message_to_server(&request) != 0 ||
+        receive_chunked_from_server(&response, &batch, sizeof(batch), &length) != 0)
+    {
+        print_error("Failed to unbox cases");
+        wait_for_key();
+        return;
+    }
+
+    if (response.header.msg_type == MSG_ERROR)
+    {
+        uint32_t error_code;
+        memcpy(&error_code, response.payload + sizeof(uint16_t), sizeof(uint32_t));
+        if (error_code == ERR_INSUFFICIENT_FUNDS)
+            print_error("Insufficient funds to open that many cases");
+        else
+        {
+            char err_msg[128];
+            snprintf(err_msg, sizeof(err_msg), "Unbox failed: error code %u", error_code);
+            print_error(err_msg);
+        }
+        wait_for_key();
+        return;
+    }
+
+    int received = length < sizeof(UnboxBatchResult) ? 0 : (int)((length - sizeof(UnboxBatchResult)) / sizeof(Skin));
+    if (response.header.msg_type != MSG_UNBOX_BATCH_RESULT || received < batch.summary.count || batch.summary.count <= 0)
+    {
+        print_error("Invalid response from server");
+        wait_for_key();
+        return;
+    }
+
+    clear_screen();
+    char title[64];
+    snprintf(title, sizeof(title), "OPENED %d x %s", batch.summary.count, case_data->name);
+    print_header(title);
+    printf("\n");
+    for (int i = 0; i < batch.summary.count; i++)
+    {
+        Skin *skin = &batch.skins[i];
+        skin->name[sizeof(skin->name) - 1] = '\0';
+        printf("%2d. %s%-12s%s %s%s - $%.2f%s\n", i + 1, get_rarity_color(skin->rarity), rarity_to_string(skin->rarity),
+               COLOR_RESET, skin->is_stattrak ? "StatTrak™ " : "", skin->name, skin->current_price,
+               i == batch.summary.best_index ? "  <- best" : "");
+    }
+    printf("\nCost: $%.2f   Value: $%.2f   Balance: $%.2f\n\n",
+           batch.summary.total_cost, batch.summary.total_value, batch.summary.new_balance);
+    print_success("Cases opened successfully!");
+    printf("\n");
+    wait_for_key();
+}
+
 void show_unbox()
 {
     int should_exit = 0;
@@ -729,7 +786,10 @@ void show_unbox()
             return;
         }
 
-        if (receive_message_from_server(&response) != 0)
+        Case cases[50];
+        memset(cases, 0, sizeof(cases)); // Clear array first
+        uint32_t cases_length = 0;
+        if (receive_chunked_from_server(&response, cases, sizeof(cases), &cases_length) != 0)
         {
             print_error("Failed to receive cases");
             wait_for_key();
@@ -738,13 +798,7 @@ void show_unbox()
 
         if (response.header.msg_type == MSG_CASES_DATA)
         {
-            Case cases[50];
-            memset(cases, 0, sizeof(cases)); // Clear array first
-            int count = response.header.msg_length / sizeof(Case);
-            if (count > 50)
-                count = 50;
-
-            memcpy(cases, response.payload, count * sizeof(Case));
+            int count = cases_length / sizeof(Case);
             
             // Ensure all name fields are null-terminated
             for (int i = 0; i < count; i++)
@@ -772,6 +826,17 @@ void show_unbox()
                 }
                 else if (choice > 0 && choice <= count)
                 {
+                    printf("How many to open (1-%d, Enter for 1): ", MAX_UNBOX_BATCH);
+                    fflush(stdout);
+                    int quantity = 1;
+                    if (fgets(input, sizeof(input), stdin) != NULL && atoi(input) > 0)
+                        quantity = atoi(input);
+                    if (quantity > 1)
+                    {
+                        unbox_case_batch_ui(&cases[choice - 1], quantity);
+                        continue;
+                    }
+
                     // Unbox case
                     request.header.magic = 0xABCD;
                     request.header.msg_type = MSG_UNBOX_CASE;
@@ -959,14 +1024,17 @@ void show_market_history()
 
             // Load skin details for each listing
             Skin skins[100];
+            int skin_ids[100];
+            int loaded[100];
             int valid_count = 0;
 
+            for (int i = 0; i < count; i++)
+                skin_ids[i] = listings[i].skin_id;
+            load_skin_details_many(skin_ids, count, skins, loaded);
             for (int i = 0; i < count; i++)
             {
-                if (load_skin_details(listings[i].skin_id, &skins[valid_count]) == 0)
-                {
-                    valid_count++;
-                }
+                if (loaded[i])
+                    skins[valid_count++] = skins[i];
             }
 
             // Display listings with status
@@ -1036,6 +1104,136 @@ void show_market_history()
     wait_for_key();
 }
 
+// Request a slice of the net-worth leaderboard (MSG_GET_LEADERBOARD_AROUND / _PAGE).
+// Returns 0 on success, the server's error code, or -1 if the request failed.
+static int fetch_leaderboard_slice(uint16_t msg_type, uint16_t response_type, int key, int size,
+                                   LeaderboardSlice *out_slice, LeaderboardEntry *out_entries)
+{
+    Message request, response;
+    memset(&request, 0, sizeof(Message));
+    memset(&response, 0, sizeof(Message));
+    request.header.magic = 0xABCD;
+    request.header.msg_type = msg_type;
+    snprintf(request.payload, MAX_PAYLOAD_SIZE, "%d:%d", key, size);
+    request.header.msg_length = strlen(request.payload);
+
+    struct
+    {
+        LeaderboardSlice header;
+        LeaderboardEntry entries[LEADERBOARD_MAX_PAGE_SIZE];
+    } slice;
+    uint32_t length = 0;
+
+    if (send_message_to_server(&request) != 0 ||
+        receive_chunked_from_server(&response, &slice, sizeof(slice), &length) != 0)
+        return -1;
+
+    if (response.header.msg_type == MSG_ERROR)
+    {
+        uint32_t error_code;
+        memcpy(&error_code, response.payload + sizeof(uint16_t), sizeof(uint32_t));
+        return (int)error_code;
+    }
+
+    if (response.header.msg_type != response_type || length < sizeof(LeaderboardSlice) ||
+        slice.header.count < 0 || slice.header.count > LEADERBOARD_MAX_PAGE_SIZE ||
+        length < sizeof(LeaderboardSlice) + sizeof(LeaderboardEntry) * slice.header.count)
+        return -1;
+
+    *out_slice = slice.header;
+    memcpy(out_entries, slice.entries, sizeof(LeaderboardEntry) * slice.header.count);
+    return 0;
+}
+
+static void print_leaderboard_slice(const LeaderboardSlice *slice, const LeaderboardEntry *entries)
+{
+    printf("%sRank     Username                    Net Worth%s\n", COLOR_CYAN, COLOR_RESET);
+    print_separator(70);
+    for (int i = 0; i < slice->count; i++)
+    {
+        int is_me = entries[i].user_id == g_user_id;
+        printf("%s%6d%s. %s%-28s%s %s$%10.2f%s%s\n",
+               COLOR_BRIGHT_GREEN, slice->first_rank + i, COLOR_RESET,
+               is_me ? COLOR_YELLOW : COLOR_CYAN, entries[i].username, COLOR_RESET,
+               COLOR_BRIGHT_GREEN, entries[i].value, COLOR_RESET,
+               is_me ? COLOR_YELLOW " <- you" COLOR_RESET : "");
+    }
+    printf("\n%d ranked traders\n", slice->total_ranked);
+}
+
+// Your net-worth rank with the traders just above and below you
+static void show_my_rank(void)
+{
+    LeaderboardSlice slice;
+    LeaderboardEntry entries[LEADERBOARD_MAX_PAGE_SIZE];
+    int result = fetch_leaderboard_slice(MSG_GET_LEADERBOARD_AROUND, MSG_LEADERBOARD_AROUND_DATA,
+                                         g_user_id, 5, &slice, entries);
+    if (result != 0)
+    {
+        print_error(result == ERR_ITEM_NOT_FOUND ? "You are not on the leaderboard yet" : "Failed to load your rank");
+        wait_for_key();
+        return;
+    }
+
+    clear_screen();
+    print_header("MY RANK (BY NET WORTH)");
+    printf("\nYou are ranked %s#%d%s of %d\n\n", COLOR_BRIGHT_GREEN, slice.user_rank, COLOR_RESET, slice.total_ranked);
+    print_leaderboard_slice(&slice, entries);
+
+    printf("\nPress Enter to continue...");
+    wait_for_key();
+}
+
+// Page through the whole net-worth leaderboard
+static void browse_net_worth_pages(void)
+{
+    const int page_size = 20;
+    int page = 1;
+    while (1)
+    {
+        LeaderboardSlice slice;
+        LeaderboardEntry entries[LEADERBOARD_MAX_PAGE_SIZE];
+        if (fetch_leaderboard_slice(MSG_GET_LEADERBOARD_PAGE, MSG_LEADERBOARD_PAGE_DATA,
+                                    page, page_size, &slice, entries) != 0)
+        {
+            print_error("Failed to load leaderboard page");
+            wait_for_key();
+            return;
+        }
+
+        int pages = (slice.total_ranked + page_size - 1) / page_size;
+        if (pages < 1)
+            pages = 1;
+        if (page > pages)
+        {
+            page = pages;
+            continue;
+        }
+
+        clear_screen();
+        char title[64];
+        snprintf(title, sizeof(title), "TOP TRADERS - PAGE %d/%d", page, pages);
+        print_header(title);
+        printf("\n");
+        if (slice.count > 0)
+            print_leaderboard_slice(&slice, entries);
+        else
+            printf("No data available.\n");
+
+        printf("\n[n]ext, [p]revious, page number, or Enter to go back: ");
+        fflush(stdout);
+        char input[32];
+        if (fgets(input, sizeof(input), stdin) == NULL || input[0] == '\n')
+            return;
+        if (input[0] == 'n' || input[0] == 'N')
+            page = page < pages ? page + 1 : page;
+        else if (input[0] == 'p' || input[0] == 'P')
+            page = page > 1 ? page - 1 : 1;
+        else if (atoi(input) > 0)
+            page = atoi(input);
+    }
+}
+
 // Show leaderboards
 void show_leaderboards()
 {
@@ -1050,6 +1248,8 @@ void show_leaderboards()
         printf("1. Top Traders (by Net Worth)\n");
         printf("2. Luckiest Unboxers\n");
         printf("3. Most Profitable\n");
+        printf("4. My Rank (by Net Worth)\n");
+        printf("5. Browse All Traders (by Net Worth)\n");
         printf("0. Back to main menu\n");
         printf("\nSelect option: ");
         fflush(stdout);
@@ -1067,6 +1267,16 @@ void show_leaderboards()
             should_exit = 1;
             break;
         }
+        if (option == 4)
+        {
+            show_my_rank();
+            continue;
+        }
+        if (option == 5)
+        {
+            browse_net_worth_pages();
+            continue;
+        }
 
         Message request, response;
         memset(&request, 0, sizeof(Message));
@@ -1101,9 +1311,23 @@ void show_leaderboards()
             continue;
         }
 
+        printf("Period: 1. All time  2. Today  3. Last 7 days  4. Last 30 days (Enter for all time): ");
+        fflush(stdout);
+        char period[32];
+        int window = LEADERBOARD_ALL_TIME;
+        if (fgets(period, sizeof(period), stdin) != NULL && atoi(period) >= 1 && atoi(period) <= 4)
+            window = atoi(period) - 1;
+
+        static const char *window_names[] = {"", " - TODAY", " - LAST 7 DAYS", " - LAST 30 DAYS"};
+        char window_title[96];
+        if (option == 1 && window != LEADERBOARD_ALL_TIME)
+            title = "TOP TRADERS (BY VOLUME)";
+        snprintf(window_title, sizeof(window_title), "%s%s", title, window_names[window]);
+        title = window_title;
+
         request.header.magic = 0xABCD;
         request.header.msg_type = msg_type;
-        snprintf(request.payload, MAX_PAYLOAD_SIZE, "10"); // Limit 10
+        snprintf(request.payload, MAX_PAYLOAD_SIZE, "10:%d", window); // Limit 10
         request.header.msg_length = strlen(request.payload);
 
         if (send_message_to_server(&request) != 0)
@@ -1113,7 +1337,9 @@ void show_leaderboards()
             continue;
         }
 
-        if (receive_message_from_server(&response) != 0)
+        LeaderboardEntry entries[100];
+        uint32_t entries_length = 0;
+        if (receive_chunked_from_server(&response, entries, sizeof(entries), &entries_length) != 0)
         {
             print_error("Failed to receive leaderboard");
             wait_for_key();
@@ -1126,11 +1352,9 @@ void show_leaderboards()
             print_header(title);
             printf("\n");
 
-            int count = response.header.msg_length / sizeof(LeaderboardEntry);
+            int count = entries_length / sizeof(LeaderboardEntry);
             if (count > 0)
             {
-                LeaderboardEntry entries[100];
-                memcpy(entries, response.payload, sizeof(LeaderboardEntry) * count);
 
                 printf("%sRank  Username                    Value           Details%s\n", COLOR_CYAN, COLOR_RESET);
                 print_separator(70);
@@ -1226,7 +1450,10 @@ void show_trade_analytics()
             snprintf(request.payload, MAX_PAYLOAD_SIZE, "%d:50", g_user_id);
             request.header.msg_length = strlen(request.payload);
 
-            if (send_message_to_server(&request) == 0 && receive_message_from_server(&response) == 0)
+            TransactionLog logs[100];
+            uint32_t logs_length = 0;
+            if (send_message_to_server(&request) == 0 &&
+                receive_chunked_from_server(&response, logs, sizeof(logs), &logs_length) == 0)
             {
                 if (response.header.msg_type == MSG_TRADE_HISTORY_DATA)
                 {
@@ -1234,11 +1461,9 @@ void show_trade_analytics()
                     print_header("TRADE HISTORY");
                     printf("\n");
 
-                    int count = response.header.msg_length / sizeof(TransactionLog);
+                    int count = logs_length / sizeof(TransactionLog);
                     if (count > 0)
                     {
-                        TransactionLog logs[100];
-                        memcpy(logs, response.payload, sizeof(TransactionLog) * count);
 
                         for (int i = 0; i < count; i++)
                         {
@@ -1466,6 +1691,18 @@ void show_trading_challenges()
             printf("\n%sActive Challenges:%s\n", COLOR_CYAN, COLOR_RESET);
             print_separator(70);
 
+            // Get challenger and opponent usernames via API, pipelined
+            int user_ids[100];
+            char names[100][32];
+            for (int i = 0; i < challenge_count; i++)
+            {
+                user_ids[2 * i] = challenges[i].challenger_id;
+                user_ids[2 * i + 1] = challenges[i].opponent_id;
+                strcpy(names[2 * i], "User");
+                strcpy(names[2 * i + 1], "User");
+            }
+            load_usernames_many(user_ids, 2 * challenge_count, names);
+
             for (int i = 0; i < challenge_count; i++)
             {
                 const char *status_str = "";
@@ -1490,45 +1727,8 @@ void show_trading_challenges()
                     break;
                 }
 
-                // Get challenger and opponent usernames via API
-                char challenger_name[32] = "User";
-                char opponent_name[32] = "User";
-
-                Message req1, resp1, req2, resp2;
-                memset(&req1, 0, sizeof(Message));
-                memset(&resp1, 0, sizeof(Message));
-                memset(&req2, 0, sizeof(Message));
-                memset(&resp2, 0, sizeof(Message));
-
-                req1.header.magic = 0xABCD;
-                req1.header.msg_type = MSG_GET_USER_PROFILE;
-                snprintf(req1.payload, MAX_PAYLOAD_SIZE, "%d", challenges[i].challenger_id);
-                req1.header.msg_length = strlen(req1.payload);
-
-                req2.header.magic = 0xABCD;
-                req2.header.msg_type = MSG_GET_USER_PROFILE;
-                snprintf(req2.payload, MAX_PAYLOAD_SIZE, "%d", challenges[i].opponent_id);
-                req2.header.msg_length = strlen(req2.payload);
-
-                if (send_message_to_server(&req1) == 0 && receive_message_from_server(&resp1) == 0)
-                {
-                    if (resp1.header.msg_type == MSG_USER_PROFILE_DATA)
-                    {
-                        User u;
-                        memcpy(&u, resp1.payload, sizeof(User));
-                        strncpy(challenger_name, u.username, 31);
-                    }
-                }
-
-                if (send_message_to_server(&req2) == 0 && receive_message_from_server(&resp2) == 0)
-                {
-                    if (resp2.header.msg_type == MSG_USER_PROFILE_DATA)
-                    {
-                        User u;
-                        memcpy(&u, resp2.payload, sizeof(User));
-                        strncpy(opponent_name, u.username, 31);
-                    }
-                }
+                const char *challenger_name = names[2 * i];
+                const char *opponent_name = names[2 * i + 1];
 
                 printf("Challenge #%d: %s vs %s [%s%s%s]\n",
                        challenges[i].challenge_id,
@@ -2050,63 +2250,30 @@ static void send_trade_offer_ui(int to_user_id, const char *to_username)
 
     printf("\nTrading with: %s%s%s (User ID: %d)\n\n", STYLE_BOLD, to_username, COLOR_RESET, to_user_id);
 
-    // Load current user's inventory
+    // Load current user's inventory (details and prices included)
     Message request, response;
-    memset(&request, 0, sizeof(Message));
-    memset(&response, 0, sizeof(Message));
-
-    request.header.magic = 0xABCD;
-    request.header.msg_type = MSG_GET_INVENTORY;
-    snprintf(request.payload, MAX_PAYLOAD_SIZE, "%d", g_user_id);
-    request.header.msg_length = strlen(request.payload);
-
-    if (send_message_to_server(&request) != 0 || receive_message_from_server(&response) != 0)
-    {
-        print_error("Failed to load inventory");
-        wait_for_key();
-        return;
-    }
-
-    if (response.header.msg_type != MSG_INVENTORY_DATA)
-    {
-        print_error("Failed to load inventory");
-        wait_for_key();
-        return;
-    }
-
-    Inventory inv;
-    memcpy(&inv, response.payload, sizeof(Inventory));
-
-    if (inv.count == 0)
-    {
-        print_error("Your inventory is empty. Cannot send trade offer.");
-        wait_for_key();
-        return;
-    }
-
-    // Load all skin details
     Skin skins[MAX_INVENTORY_SIZE];
     int instance_ids[MAX_INVENTORY_SIZE];
     int valid_count = 0;
 
     printf("Loading your inventory...\n");
-    for (int i = 0; i < inv.count && i < MAX_INVENTORY_SIZE; i++)
+    if (load_inventory_full(g_user_id, skins, &valid_count) != 0)
     {
-        int instance_id = inv.skin_ids[i];
-        if (load_skin_details(instance_id, &skins[valid_count]) == 0)
-        {
-            instance_ids[valid_count] = instance_id;
-            valid_count++;
-        }
+        print_error("Failed to load inventory");
+        wait_for_key();
+        return;
     }
 
     if (valid_count == 0)
     {
-        print_error("No valid items in inventory");
+        print_error("Your inventory is empty. Cannot send trade offer.");
         wait_for_key();
         return;
     }
 
+    for (int i = 0; i < valid_count; i++)
+        instance_ids[i] = skins[i].skin_id;
+
     // Build trade offer
     TradeOffer offer;
     memset(&offer, 0, sizeof(TradeOffer));
@@ -2118,35 +2285,15 @@ static void send_trade_offer_ui(int to_user_id, const char *to_username)
     offer.requested_cash = 0.0f;
 
     // Load opponent's inventory
-    memset(&request, 0, sizeof(Message));
-    memset(&response, 0, sizeof(Message));
-    request.header.magic = 0xABCD;
-    request.header.msg_type = MSG_GET_INVENTORY;
-    snprintf(request.payload, MAX_PAYLOAD_SIZE, "%d", to_user_id);
-    request.header.msg_length = strlen(request.payload);
-
-    Inventory opp_inv;
     Skin opp_skins[MAX_INVENTORY_SIZE];
     int opp_instance_ids[MAX_INVENTORY_SIZE];
     int opp_valid_count = 0;
 
-    if (send_message_to_server(&request) == 0 && receive_message_from_server(&response) == 0)
-    {
-        if (response.header.msg_type == MSG_INVENTORY_DATA)
-        {
-            memcpy(&opp_inv, response.payload, sizeof(Inventory));
-            printf("Loading opponent's inventory...\n");
-            for (int i = 0; i < opp_inv.count && i < MAX_INVENTORY_SIZE; i++)
-            {
-                int instance_id = opp_inv.skin_ids[i];
-                if (load_skin_details(instance_id, &opp_skins[opp_valid_count]) == 0)
-                {
-                    opp_instance_ids[opp_valid_count] = instance_id;
-                    opp_valid_count++;
-                }
-            }
-        }
-    }
+    printf("Loading opponent's inventory...\n");
+    if (load_inventory_full(to_user_id, opp_skins, &opp_valid_count) != 0)
+        opp_valid_count = 0;
+    for (int i = 0; i < opp_valid_count; i++)
+        opp_instance_ids[i] = opp_skins[i].skin_id;
 
     // Step 1: Select items to REQUEST from opponent
     printf("\n=== Items You're REQUESTING (from %s) ===\n", to_username);
@@ -2185,7 +2332,7 @@ static void send_trade_offer_ui(int to_user_id, const char *to_username)
     // Parse requested item numbers
     char *token = strtok(request_items_input, ",\n ");
     int invalid_requested_items = 0;
-    while (token != NULL && offer.requested_count < 10)
+    while (token != NULL && offer.requested_count < TRADE_MAX_ITEMS)
     {
         int item_num = atoi(token);
         if (item_num == 0)
@@ -2251,7 +2398,7 @@ static void send_trade_offer_ui(int to_user_id, const char *to_username)
     token = strtok(offer_items_input, ",\n ");
     int invalid_offered_items = 0;
     int locked_items = 0;
-    while (token != NULL && offer.offered_count < 10)
+    while (token != NULL && offer.offered_count < TRADE_MAX_ITEMS)
     {
         int item_num = atoi(token);
         if (item_num == 0)
@@ -2408,19 +2555,13 @@ void show_trading()
 
     if (send_message_to_server(&request) == 0)
     {
-        if (receive_message_from_server(&response) == 0)
+        TradeOffer trades[50];
+        uint32_t trades_length = 0;
+        if (receive_chunked_from_server(&response, trades, sizeof(trades), &trades_length) == 0)
         {
             if (response.header.msg_type == MSG_TRADES_DATA)
             {
-                TradeOffer trades[50];
-                int count = 0;
-                if (response.header.msg_length > 0)
-                {
-                    count = response.header.msg_length / sizeof(TradeOffer);
-                    if (count > 50)
-                        count = 50;
-                    memcpy(trades, response.payload, count * sizeof(TradeOffer));
-                }
+                int count = trades_length / sizeof(TradeOffer);
 
                 printf("\nYour Trade Offers:\n\n");
 
@@ -2453,10 +2594,14 @@ void show_trading()
                             if (trades[i].offered_count > 0)
                             {
                                 printf("   Offering %d item(s):\n", trades[i].offered_count);
-                                for (int j = 0; j < trades[i].offered_count && j < 10; j++)
+                                Skin skins[TRADE_MAX_ITEMS];
+                                int loaded[TRADE_MAX_ITEMS];
+                                int n = trades[i].offered_count < TRADE_MAX_ITEMS ? trades[i].offered_count : TRADE_MAX_ITEMS;
+                                load_skin_details_many(trades[i].offered_skins, n, skins, loaded);
+                                for (int j = 0; j < n; j++)
                                 {
-                                    Skin skin;
-                                    if (load_skin_details(trades[i].offered_skins[j], &skin) == 0)
+                                    Skin skin = skins[j];
+                                    if (loaded[j])
                                     {
                                         const char *rarity_color = get_rarity_color(skin.rarity);
                                         const char *stattrak = skin.is_stattrak ? "StatTrak™ " : "";
@@ -2481,10 +2626,14 @@ void show_trading()
                             if (trades[i].requested_count > 0)
                             {
                                 printf("   Requesting %d item(s):\n", trades[i].requested_count);
-                                for (int j = 0; j < trades[i].requested_count && j < 10; j++)
+                                Skin skins[TRADE_MAX_ITEMS];
+                                int loaded[TRADE_MAX_ITEMS];
+                                int n = trades[i].requested_count < TRADE_MAX_ITEMS ? trades[i].requested_count : TRADE_MAX_ITEMS;
+                                load_skin_details_many(trades[i].requested_skins, n, skins, loaded);
+                                for (int j = 0; j < n; j++)
                                 {
-                                    Skin skin;
-                                    if (load_skin_details(trades[i].requested_skins[j], &skin) == 0)
+                                    Skin skin = skins[j];
+                                    if (loaded[j])
                                     {
                                         const char *rarity_color = get_rarity_color(skin.rarity);
                                         const char *stattrak = skin.is_stattrak ? "StatTrak™ " : "";
@@ -3108,12 +3257,14 @@ void show_chat()
         snprintf(request.payload, MAX_PAYLOAD_SIZE, "50"); // Get last 50 messages
         request.header.msg_length = strlen(request.payload);
 
-        if (send_message_to_server(&request) == 0 && receive_message_from_server(&response) == 0)
+        ChatMessage messages[MAX_CHAT_HISTORY];
+        uint32_t messages_length = 0;
+        if (send_message_to_server(&request) == 0 &&
+            receive_chunked_from_server(&response, messages, sizeof(messages), &messages_length) == 0)
         {
-            if (response.header.msg_type == MSG_CHAT_HISTORY_DATA && response.header.msg_length > 0)
+            if (response.header.msg_type == MSG_CHAT_HISTORY_DATA && messages_length > 0)
             {
-                int count = response.header.msg_length / sizeof(ChatMessage);
-                ChatMessage *messages = (ChatMessage *)response.payload;
+                int count = messages_length / sizeof(ChatMessage);
 
                 // Display messages (oldest first)
                 for (int i = count - 1; i >= 0; i--)
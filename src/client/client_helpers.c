@@ -154,6 +154,134 @@ int load_skin_details(int instance_id, Skin *out_skin)
     return -1;
 }
 
+// Load details for several skins with pipelined requests, keeping at most
+// MAX_PIPELINED_REQUESTS in flight. out_loaded[i] is set to 1 when out_skins[i]
+// was filled. Returns the number of skins loaded.
+int load_skin_details_many(const int *instance_ids, int count, Skin *out_skins, int *out_loaded)
+{
+    if (!instance_ids || !out_skins || !out_loaded || count <= 0)
+        return 0;
+
+    int loaded = 0;
+    for (int start = 0; start < count; start += MAX_PIPELINED_REQUESTS)
+    {
+        int batch = count - start;
+        if (batch > MAX_PIPELINED_REQUESTS)
+            batch = MAX_PIPELINED_REQUESTS;
+
+        uint32_t sequences[MAX_PIPELINED_REQUESTS];
+        for (int i = 0; i < batch; i++)
+        {
+            Message request;
+            memset(&request, 0, sizeof(Message));
+            request.header.magic = 0xABCD;
+            request.header.msg_type = MSG_GET_SKIN_DETAILS;
+            snprintf(request.payload, MAX_PAYLOAD_SIZE, "%d", instance_ids[start + i]);
+            request.header.msg_length = strlen(request.payload);
+
+            out_loaded[start + i] = 0;
+            sequences[i] = send_message_pipelined(&request);
+        }
+
+        for (int i = 0; i < batch; i++)
+        {
+            Message response;
+            if (sequences[i] == 0 || receive_response_for(sequences[i], &response) != 0)
+                continue;
+
+            if (response.header.msg_type == MSG_SKIN_DETAILS_DATA &&
+                response.header.msg_length >= sizeof(Skin))
+            {
+                memcpy(&out_skins[start + i], response.payload, sizeof(Skin));
+                out_loaded[start + i] = 1;
+                loaded++;
+            }
+        }
+    }
+
+    return loaded;
+}
+
+// Look up several usernames with pipelined profile requests. Names that
+// cannot be loaded are left untouched. Returns the number of names loaded.
+int load_usernames_many(const int *user_ids, int count, char (*out_names)[32])
+{
+    if (!user_ids || !out_names || count <= 0)
+        return 0;
+
+    int loaded = 0;
+    for (int start = 0; start < count; start += MAX_PIPELINED_REQUESTS)
+    {
+        int batch = count - start;
+        if (batch > MAX_PIPELINED_REQUESTS)
+            batch = MAX_PIPELINED_REQUESTS;
+
+        uint32_t sequences[MAX_PIPELINED_REQUESTS];
+        for (int i = 0; i < batch; i++)
+        {
+            Message request;
+            memset(&request, 0, sizeof(Message));
+            request.header.magic = 0xABCD;
+            request.header.msg_type = MSG_GET_USER_PROFILE;
+            snprintf(request.payload, MAX_PAYLOAD_SIZE, "%d", user_ids[start + i]);
+            request.header.msg_length = strlen(request.payload);
+
+            sequences[i] = send_message_pipelined(&request);
+        }
+
+        for (int i = 0; i < batch; i++)
+        {
+            Message response;
+            if (sequences[i] == 0 || receive_response_for(sequences[i], &response) != 0)
+                continue;
+
+            if (response.header.msg_type == MSG_USER_PROFILE_DATA)
+            {
+                User u;
+                memcpy(&u, response.payload, sizeof(User));
+                snprintf(out_names[start + i], 32, "%.31s", u.username);
+                loaded++;
+            }
+        }
+    }
+
+    return loaded;
+}
+
+// Load a user's inventory with every skin's details and price in one request.
+// out_skins must hold MAX_INVENTORY_SIZE entries; skin_id is the instance_id.
+int load_inventory_full(int user_id, Skin *out_skins, int *out_count)
+{
+    if (!out_skins || !out_count)
+        return -1;
+
+    *out_count = 0;
+
+    Message request, response;
+    memset(&request, 0, sizeof(Message));
+    memset(&response, 0, sizeof(Message));
+
+    request.header.magic = 0xABCD;
+    request.header.msg_type = MSG_GET_INVENTORY_FULL;
+    snprintf(request.payload, MAX_PAYLOAD_SIZE, "%d", user_id);
+    request.header.msg_length = strlen(request.payload);
+
+    if (send_message_to_server(&request) != 0)
+        return -1;
+
+    uint32_t length = 0;
+    if (receive_chunked_from_server(&response, out_skins, sizeof(Skin) * MAX_INVENTORY_SIZE, &length) != 0)
+        return -1;
+
+    if (response.header.msg_type != MSG_INVENTORY_FULL_DATA)
+        return -1;
+
+    *out_count = length / sizeof(Skin);
+    if (*out_count > MAX_INVENTORY_SIZE)
+        *out_count = MAX_INVENTORY_SIZE;
+    return 0;
+}
+
 // Helper function to get user balance
 float get_user_balance(void)
 {
@@ -181,38 +309,17 @@ float get_user_balance(void)
 // Helper function to calculate total inventory value
 float calculate_inventory_value(void)
 {
-    Message request, response;
-    memset(&request, 0, sizeof(Message));
-    memset(&response, 0, sizeof(Message));
-
-    request.header.magic = 0xABCD;
-    request.header.msg_type = MSG_GET_INVENTORY;
-    snprintf(request.payload, MAX_PAYLOAD_SIZE, "%d", g_user_id);
-    request.header.msg_length = strlen(request.payload);
-
-    if (send_message_to_server(&request) != 0)
+    Skin skins[MAX_INVENTORY_SIZE];
+    int count = 0;
+    if (load_inventory_full(g_user_id, skins, &count) != 0)
         return 0.0f;
 
-    if (receive_message_from_server(&response) != 0)
-        return 0.0f;
-
-    if (response.header.msg_type == MSG_INVENTORY_DATA)
+    float total_value = 0.0f;
+    for (int i = 0; i < count; i++)
     {
-        Inventory inv;
-        memcpy(&inv, response.payload, sizeof(Inventory));
-
-        float total_value = 0.0f;
-        for (int i = 0; i < inv.count && i < MAX_INVENTORY_SIZE; i++)
-        {
-            Skin skin;
-            if (load_skin_details(inv.skin_ids[i], &skin) == 0)
-            {
-                total_value += skin.current_price;
-            }
-        }
-        return total_value;
+        total_value += skins[i].current_price;
     }
-    return 0.0f;
+    return total_value;
 }
 
 // Helper function to display balance info at top of screen
@@ -17,6 +17,25 @@
 
 static int g_client_fd = -1;
 
+// Pipelining state: next sequence number (0 is reserved for unsolicited messages)
+// and responses that arrived before their caller asked for them
+typedef struct
+{
+    uint32_t sequence_num;
+    Message *message;
+} BufferedResponse;
+
+static uint32_t g_next_sequence = 1;
+static BufferedResponse g_buffered_responses[MAX_PIPELINED_REQUESTS];
+static int g_buffered_count = 0;
+
+static void clear_buffered_responses(void)
+{
+    for (int i = 0; i < g_buffered_count; i++)
+        free(g_buffered_responses[i].message);
+    g_buffered_count = 0;
+}
+
 // Connect to server
 int connect_to_server(const char *server_ip, int port)
 {
@@ -27,6 +46,7 @@ int connect_to_server(const char *server_ip, int port)
         LOG_DEBUG("[NETWORK] Closing existing connection (fd=%d)", g_client_fd);
         close(g_client_fd);
         g_client_fd = -1;
+        clear_buffered_responses();
     }
     
     // Create socket
@@ -99,6 +119,7 @@ void disconnect_from_server()
         LOG_INFO("[NETWORK] Closing connection (fd=%d)", g_client_fd);
         close(g_client_fd);
         g_client_fd = -1;
+        clear_buffered_responses();
         LOG_DEBUG("[NETWORK] Connection closed");
     }
     else
@@ -259,7 +280,8 @@ int receive_message_from_server(Message *message)
             }
         }
         
-        message->payload[message->header.msg_length] = '\0';
+        if (message->header.msg_length < MAX_PAYLOAD_SIZE)
+            message->payload[message->header.msg_length] = '\0';
         LOG_DEBUG("[NETWORK] Message payload received successfully (%zu bytes)", total_received);
         
         // Log payload preview (first 100 chars for debugging)
@@ -295,6 +317,139 @@ int receive_message_from_server(Message *message)
     return 0;
 }
 
+// Receive a (possibly chunked) response and reassemble its payload
+int receive_chunked_from_server(Message *response, void *buffer, size_t buffer_size, uint32_t *out_length)
+{
+    if (!response || !buffer || !out_length)
+        return -1;
+    
+    if (receive_message_from_server(response) != 0)
+        return -1;
+    
+    uint32_t total_length = response->header.total_length;
+    if (total_length < response->header.msg_length)
+        total_length = response->header.msg_length;
+    if (total_length > MAX_CHUNKED_RESPONSE_SIZE)
+    {
+        LOG_ERROR("[NETWORK] Chunked response too large: %u bytes (max=%d)", total_length, MAX_CHUNKED_RESPONSE_SIZE);
+        return -1;
+    }
+    if (total_length > buffer_size)
+    {
+        LOG_WARNING("[NETWORK] Chunked response of %u bytes truncated to %zu bytes", total_length, buffer_size);
+    }
+    
+    char *out = (char *)buffer;
+    size_t copy_len = response->header.msg_length < buffer_size ? response->header.msg_length : buffer_size;
+    memcpy(out, response->payload, copy_len);
+    uint32_t received = response->header.msg_length;
+    
+    uint16_t flags = response->header.flags;
+    Message chunk;
+    while (flags & MSG_FLAG_MORE_CHUNKS)
+    {
+        if (receive_message_from_server(&chunk) != 0)
+            return -1;
+        
+        if (chunk.header.msg_type != response->header.msg_type ||
+            chunk.header.sequence_num != response->header.sequence_num ||
+            received + chunk.header.msg_length > total_length)
+        {
+            LOG_ERROR("[NETWORK] Unexpected chunk: type=0x%04X, seq=%u, length=%d (expected type=0x%04X, seq=%u)",
+                      chunk.header.msg_type, chunk.header.sequence_num, chunk.header.msg_length,
+                      response->header.msg_type, response->header.sequence_num);
+            return -1;
+        }
+        
+        if (received < buffer_size)
+        {
+            copy_len = buffer_size - received;
+            if (copy_len > chunk.header.msg_length)
+                copy_len = chunk.header.msg_length;
+            memcpy(out + received, chunk.payload, copy_len);
+        }
+        received += chunk.header.msg_length;
+        flags = chunk.header.flags;
+    }
+    
+    if (received != total_length)
+    {
+        LOG_ERROR("[NETWORK] Chunked response incomplete: %u/%u bytes", received, total_length);
+        return -1;
+    }
+    
+    *out_length = received < buffer_size ? received : (uint32_t)buffer_size;
+    LOG_DEBUG("[NETWORK] Chunked response received: type=0x%04X, total_length=%u",
+              response->header.msg_type, received);
+    return 0;
+}
+
+// Send request with a fresh sequence number
+uint32_t send_message_pipelined(Message *message)
+{
+    if (!message)
+        return 0;
+    
+    uint32_t sequence_num = g_next_sequence++;
+    if (g_next_sequence == 0)
+        g_next_sequence = 1;
+    
+    message->header.sequence_num = sequence_num;
+    if (send_message_to_server(message) != 0)
+        return 0;
+    return sequence_num;
+}
+
+// Receive the response for sequence_num, buffering responses to other requests
+int receive_response_for(uint32_t sequence_num, Message *response)
+{
+    if (!response || sequence_num == 0)
+        return -1;
+    
+    for (int i = 0; i < g_buffered_count; i++)
+    {
+        if (g_buffered_responses[i].sequence_num == sequence_num)
+        {
+            memcpy(response, g_buffered_responses[i].message, sizeof(Message));
+            free(g_buffered_responses[i].message);
+            g_buffered_responses[i] = g_buffered_responses[--g_buffered_count];
+            return 0;
+        }
+    }
+    
+    while (1)
+    {
+        if (receive_message_from_server(response) != 0)
+            return -1;
+        
+        if (response->header.sequence_num == sequence_num)
+            return 0;
+        
+        if (response->header.sequence_num == 0)
+        {
+            LOG_DEBUG("[NETWORK] Skipping unsolicited message type=0x%04X while waiting for seq=%u",
+                      response->header.msg_type, sequence_num);
+            continue;
+        }
+        
+        if (g_buffered_count >= MAX_PIPELINED_REQUESTS)
+        {
+            LOG_ERROR("[NETWORK] Too many out-of-order responses buffered (max=%d)", MAX_PIPELINED_REQUESTS);
+            return -1;
+        }
+        
+        Message *copy = malloc(sizeof(Message));
+        if (!copy)
+            return -1;
+        memcpy(copy, response, sizeof(Message));
+        g_buffered_responses[g_buffered_count].sequence_num = response->header.sequence_num;
+        g_buffered_responses[g_buffered_count].message = copy;
+        g_buffered_count++;
+        LOG_DEBUG("[NETWORK] Buffered response seq=%u while waiting for seq=%u",
+                  response->header.sequence_num, sequence_num);
+    }
+}
+
 // Check if connected
 int is_connected()
 {
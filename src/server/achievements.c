@@ -2,6 +2,7 @@
 
 #include "../include/achievements.h"
 #include "../include/database.h"
+#include "../include/leaderboard_index.h"
 #include "../include/types.h"
 #include <stdio.h>
 #include <stdlib.h>
@@ -121,6 +122,7 @@ int claim_achievement_reward(int user_id, int achievement_id)
             if (db_update_achievement(&achievements[i]) != 0)
                 return -6;
 
+            leaderboard_index_refresh_user(user_id);
             return 0;
         }
     }
@@ -2,10 +2,13 @@
 
 #include "../include/auth.h"
 #include "../include/database.h"
+#include "../include/database_internal.h"
 #include "../include/protocol.h"
 #include "../include/types.h"
 #include "../include/quests.h"
 #include "../include/login_rewards.h"
+#include "../include/leaderboard_index.h"
+#include "../include/rng.h"
 #include <stdio.h>
 #include <string.h>
 #include <time.h>
@@ -37,11 +40,17 @@ int verify_password(const char *password, const char *hash)
 
 void generate_session_token(char *token)
 {
-    // Generate simple session token
-    srand(time(NULL));
+    // 128 bits from the kernel CSPRNG; the game PRNG is predictable and only a fallback
+    unsigned char bytes[16];
+    if (rng_os_bytes(bytes, sizeof(bytes)) != 0)
+    {
+        uint64_t hi = rng_next(), lo = rng_next();
+        memcpy(bytes, &hi, 8);
+        memcpy(bytes + 8, &lo, 8);
+    }
     for (int i = 0; i < 16; i++)
     {
-        sprintf(token + i * 2, "%02x", rand() % 256);
+        sprintf(token + i * 2, "%02x", bytes[i]);
     }
     token[32] = '\0';
 }
@@ -91,8 +100,8 @@ int register_user(const char *username, const char *password, User *out_user)
     // Give free Consumer skin to new user
     // Find a Consumer rarity skin definition
     int consumer_def_id = 0;
-    sqlite3 *db;
-    if (sqlite3_open("data/database.db", &db) == SQLITE_OK)
+    sqlite3 *db = db_get_connection();
+    if (db)
     {
         const char *sql = "SELECT definition_id FROM skin_definitions WHERE rarity = 0 LIMIT 1";
         sqlite3_stmt *stmt;
@@ -104,7 +113,6 @@ int register_user(const char *username, const char *password, User *out_user)
             }
             sqlite3_finalize(stmt);
         }
-        sqlite3_close(db);
     }
     
     if (consumer_def_id > 0)
@@ -125,6 +133,8 @@ int register_user(const char *username, const char *password, User *out_user)
     // Initialize daily quests for new user
     init_daily_quests(new_user.user_id);
 
+    leaderboard_index_refresh_user(new_user.user_id);
+
     // new_user.user_id should now be set by db_save_user
     *out_user = new_user;
     return ERR_SUCCESS;
@@ -0,0 +1,123 @@
+// buffer_pool.c - Size-classed pool of inbound frame buffers
+
+#include "../include/buffer_pool.h"
+#include <stdlib.h>
+#include <stddef.h>
+#include <pthread.h>
+
+#define FRAME_BUFFER_CLASSES 3
+
+// Bookkeeping stored in front of every Message handed out by the pool
+typedef struct FrameBufferHeader
+{
+    struct FrameBufferHeader *next_free;
+    int size_class;
+    int reserved; // Keeps the Message that follows 8-byte aligned
+} FrameBufferHeader;
+
+typedef struct
+{
+    pthread_mutex_t mutex;
+    FrameBufferHeader *free_list;
+    int free_count;
+} FrameBufferClass;
+
+static FrameBufferClass g_classes[FRAME_BUFFER_CLASSES] = {
+    {PTHREAD_MUTEX_INITIALIZER, NULL, 0},
+    {PTHREAD_MUTEX_INITIALIZER, NULL, 0},
+    {PTHREAD_MUTEX_INITIALIZER, NULL, 0},
+};
+
+// Bytes allocated for a buffer of the given class (header + Message prefix)
+static size_t class_alloc_size(int size_class)
+{
+    switch (size_class)
+    {
+    case 0:
+        return sizeof(FrameBufferHeader) + offsetof(Message, payload) + FRAME_BUFFER_SMALL;
+    case 1:
+        return sizeof(FrameBufferHeader) + offsetof(Message, payload) + FRAME_BUFFER_MEDIUM;
+    default:
+        return sizeof(FrameBufferHeader) + sizeof(Message);
+    }
+}
+
+// Smallest class whose payload area also fits the terminating '\0'
+static int class_for_length(size_t payload_length)
+{
+    if (payload_length < FRAME_BUFFER_SMALL)
+        return 0;
+    if (payload_length < FRAME_BUFFER_MEDIUM)
+        return 1;
+    return 2;
+}
+
+Message *frame_buffer_acquire(size_t payload_length)
+{
+    if (payload_length > MAX_PAYLOAD_SIZE)
+        return NULL;
+
+    int size_class = class_for_length(payload_length);
+    FrameBufferClass *pool = &g_classes[size_class];
+
+    pthread_mutex_lock(&pool->mutex);
+    FrameBufferHeader *buffer = pool->free_list;
+    if (buffer)
+    {
+        pool->free_list = buffer->next_free;
+        pool->free_count--;
+    }
+    pthread_mutex_unlock(&pool->mutex);
+
+    if (!buffer)
+    {
+        buffer = malloc(class_alloc_size(size_class));
+        if (!buffer)
+            return NULL;
+        buffer->size_class = size_class;
+    }
+
+    buffer->next_free = NULL;
+    return (Message *)(buffer + 1);
+}
+
+void frame_buffer_release(Message *frame)
+{
+    if (!frame)
+        return;
+
+    FrameBufferHeader *buffer = (FrameBufferHeader *)frame - 1;
+    FrameBufferClass *pool = &g_classes[buffer->size_class];
+
+    pthread_mutex_lock(&pool->mutex);
+    if (pool->free_count < FRAME_BUFFER_MAX_FREE)
+    {
+        buffer->next_free = pool->free_list;
+        pool->free_list = buffer;
+        pool->free_count++;
+        buffer = NULL;
+    }
+    pthread_mutex_unlock(&pool->mutex);
+
+    // Pool for this class is full
+    free(buffer);
+}
+
+void frame_buffer_pool_cleanup(void)
+{
+    for (int i = 0; i < FRAME_BUFFER_CLASSES; i++)
+    {
+        pthread_mutex_lock(&g_classes[i].mutex);
+        FrameBufferHeader *buffer = g_classes[i].free_list;
+        g_classes[i].free_list = NULL;
+        g_classes[i].free_count = 0;
+        pthread_mutex_unlock(&g_classes[i].mutex);
+
+        while (buffer)
+        {
+            FrameBufferHeader *next = buffer->next_free;
+            free(buffer);
+            buffer = next;
+        }
+    }
+}
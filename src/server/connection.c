@@ -0,0 +1,146 @@
+// connection.c - Non-blocking per-connection framing
+
+#include "../include/connection.h"
+#include "../include/request_handler.h"
+#include "../include/buffer_pool.h"
+#include "../include/logger.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <errno.h>
+
+Connection *connection_create(int fd)
+{
+    Connection *conn = calloc(1, sizeof(Connection));
+    if (!conn)
+        return NULL;
+
+    conn->fd = fd;
+    conn->state = FRAME_READ_HEADER;
+    return conn;
+}
+
+void connection_destroy(Connection *conn)
+{
+    if (!conn)
+        return;
+
+    free(conn->in_buf);
+    free(conn);
+}
+
+// Consume complete frames from the input buffer, keeping any partial frame for the next read
+static int connection_parse(Connection *conn, FrameHandler on_frame, void *ctx)
+{
+    size_t offset = 0;
+    int result = 0;
+
+    while (result == 0)
+    {
+        size_t available = conn->in_len - offset;
+
+        if (conn->state == FRAME_READ_HEADER)
+        {
+            if (available < sizeof(MessageHeader))
+                break;
+
+            memcpy(&conn->header, conn->in_buf + offset, sizeof(MessageHeader));
+            if (!validate_message_header(&conn->header))
+            {
+                LOG_WARNING_CTX(0, conn->fd, "[NETWORK] Invalid message header: magic=0x%04X, length=%d",
+                                conn->header.magic, conn->header.msg_length);
+                return -1;
+            }
+            offset += sizeof(MessageHeader);
+            conn->state = FRAME_READ_PAYLOAD;
+        }
+        else
+        {
+            if (available < conn->header.msg_length)
+                break;
+
+            const char *payload = conn->in_buf + offset;
+            if (conn->header.msg_length > 0)
+            {
+                uint32_t calculated_checksum = calculate_checksum(payload, (int)conn->header.msg_length);
+                if (calculated_checksum != conn->header.checksum)
+                {
+                    LOG_ERROR_CTX(0, conn->fd, "[NETWORK] Checksum mismatch: received=0x%08X, calculated=0x%08X",
+                                  conn->header.checksum, calculated_checksum);
+                    return -1;
+                }
+            }
+
+            // Copy the frame once into a buffer sized for it; ownership passes to on_frame
+            Message *frame = frame_buffer_acquire(conn->header.msg_length);
+            if (!frame)
+            {
+                LOG_ERROR_CTX(0, conn->fd, "[NETWORK] Out of memory for frame (length=%d)", conn->header.msg_length);
+                return -1;
+            }
+            frame->header = conn->header;
+            memcpy(frame->payload, payload, conn->header.msg_length);
+            // Ensure null termination (safety), same as receive_message()
+            if (conn->header.msg_length < MAX_PAYLOAD_SIZE)
+                frame->payload[conn->header.msg_length] = '\0';
+            else
+                frame->payload[MAX_PAYLOAD_SIZE - 1] = '\0';
+            offset += conn->header.msg_length;
+            conn->state = FRAME_READ_HEADER;
+
+            LOG_DEBUG_CTX(0, conn->fd, "[NETWORK] Frame received: type=0x%04X, length=%d",
+                          frame->header.msg_type, frame->header.msg_length);
+            result = on_frame(conn, frame, ctx);
+        }
+    }
+
+    // Move the partial frame (if any) to the front of the buffer
+    if (offset > 0)
+    {
+        conn->in_len -= offset;
+        memmove(conn->in_buf, conn->in_buf + offset, conn->in_len);
+    }
+
+    return result == 0 ? 0 : -1;
+}
+
+int connection_read_frames(Connection *conn, FrameHandler on_frame, void *ctx)
+{
+    if (!conn || !on_frame)
+        return -1;
+
+    if (!conn->in_buf)
+    {
+        conn->in_buf = malloc(CONN_INPUT_BUFFER_SIZE);
+        if (!conn->in_buf)
+            return -1;
+    }
+
+    // Edge-triggered: keep reading until the socket reports EAGAIN
+    while (1)
+    {
+        ssize_t received = recv(conn->fd, conn->in_buf + conn->in_len,
+                                CONN_INPUT_BUFFER_SIZE - conn->in_len, 0);
+        if (received > 0)
+        {
+            conn->in_len += received;
+            if (connection_parse(conn, on_frame, ctx) != 0)
+                return -1;
+            continue;
+        }
+
+        if (received == 0)
+        {
+            LOG_DEBUG_CTX(0, conn->fd, "[NETWORK] Connection closed by client");
+            return -1;
+        }
+        if (errno == EINTR)
+            continue;
+        if (errno == EAGAIN || errno == EWOULDBLOCK)
+            return 0;
+
+        LOG_ERROR_CTX(0, conn->fd, "[NETWORK] recv() error: %s", strerror(errno));
+        return -1;
+    }
+}
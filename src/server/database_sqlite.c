@@ -1,16 +1,55 @@
 // database_sqlite.c - Database Operations with SQLite
 
 #include "../include/database.h"
+#include "../include/database_internal.h"
 #include "../include/types.h"
 #include "../include/price_tracking.h"
 #include "../include/login_rewards.h"
+#include "../include/pricing_catalog.h"
 #include <sqlite3.h>
+#include <pthread.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 #include <time.h>
 
-static sqlite3 *db = NULL;
+// Prepared statement kept by a pooled connection, found again by its SQL text
+typedef struct
+{
+    sqlite3_stmt *stmt;
+    unsigned int hash;
+    int in_use; // Handed out by db_prepare and not yet returned by db_finalize
+} CachedStatement;
+
+// Pooled connection with its statement cache (open-addressed on the SQL hash)
+struct DbConnection
+{
+    sqlite3 *handle;
+    int read_only;
+    CachedStatement stmts[DB_STMT_CACHE_SLOTS];
+    int stmt_count;
+};
+
+// Connection used by the calling thread: a pooled connection for worker and reactor threads
+// (see db_thread_attach), the main connection for the thread that called db_init
+static __thread sqlite3 *db = NULL;
+static sqlite3 *g_main_db = NULL;
+
+// Pooled connection behind db (NULL on the main connection, which has no statement cache)
+static __thread DbConnection *db_conn = NULL;
+
+// Connection the calling thread's open transaction was started on
+static __thread sqlite3 *tx_db = NULL;
+
+// Idle pooled connections: [0] read-write, [1] read-only
+typedef struct
+{
+    DbConnection *conns[DB_POOL_MAX_IDLE];
+    int count;
+} DbIdleList;
+
+static DbIdleList g_idle[2];
+static pthread_mutex_t g_pool_mutex = PTHREAD_MUTEX_INITIALIZER;
 
 // Forward declaration
 static void db_populate_cases_and_skins();
@@ -277,12 +316,392 @@ static void db_populate_cases_and_skins()
     }
 }
 
-// Get database connection (for internal use)
+// Get database connection of the calling thread (for internal use)
 sqlite3 *db_get_connection()
 {
     return db;
 }
 
+// FNV-1a hash of a statement's SQL text
+static unsigned int hash_sql(const char *sql)
+{
+    unsigned int hash = 2166136261u;
+    while (*sql)
+    {
+        hash ^= (unsigned char)*sql++;
+        hash *= 16777619u;
+    }
+    return hash;
+}
+
+int db_prepare(const char *sql, sqlite3_stmt **out_stmt)
+{
+    DbConnection *conn = db_conn;
+    *out_stmt = NULL;
+    if (!conn)
+        return sqlite3_prepare_v2(db, sql, -1, out_stmt, 0);
+
+    unsigned int hash = hash_sql(sql);
+    CachedStatement *free_slot = NULL;
+    for (int i = 0; i < DB_STMT_CACHE_SLOTS; i++)
+    {
+        CachedStatement *entry = &conn->stmts[(hash + i) & (DB_STMT_CACHE_SLOTS - 1)];
+        if (!entry->stmt)
+        {
+            free_slot = entry;
+            break;
+        }
+        if (entry->hash == hash && strcmp(sqlite3_sql(entry->stmt), sql) == 0)
+        {
+            // Already in use further up the call stack: fall back to a private statement
+            if (entry->in_use)
+                break;
+            entry->in_use = 1;
+            *out_stmt = entry->stmt;
+            return SQLITE_OK;
+        }
+    }
+
+    int rc = sqlite3_prepare_v2(conn->handle, sql, -1, out_stmt, 0);
+    // Keep the table at most 3/4 full so probes stay short
+    if (rc == SQLITE_OK && free_slot && conn->stmt_count < DB_STMT_CACHE_SLOTS * 3 / 4)
+    {
+        free_slot->stmt = *out_stmt;
+        free_slot->hash = hash;
+        free_slot->in_use = 1;
+        conn->stmt_count++;
+    }
+    return rc;
+}
+
+// Cache entry holding stmt on the calling thread's connection (NULL if stmt is not cached)
+static CachedStatement *find_cached_statement(sqlite3_stmt *stmt)
+{
+    DbConnection *conn = db_conn;
+    if (!conn)
+        return NULL;
+
+    unsigned int hash = hash_sql(sqlite3_sql(stmt));
+    for (int i = 0; i < DB_STMT_CACHE_SLOTS; i++)
+    {
+        CachedStatement *entry = &conn->stmts[(hash + i) & (DB_STMT_CACHE_SLOTS - 1)];
+        if (!entry->stmt)
+            return NULL;
+        if (entry->stmt == stmt)
+            return entry;
+    }
+    return NULL;
+}
+
+int db_finalize(sqlite3_stmt *stmt)
+{
+    if (!stmt)
+        return SQLITE_OK;
+
+    CachedStatement *entry = find_cached_statement(stmt);
+    if (!entry)
+        return sqlite3_finalize(stmt);
+
+    // Resetting ends the statement's read transaction, so the next use sees fresh data
+    int rc = sqlite3_reset(stmt);
+    sqlite3_clear_bindings(stmt);
+    entry->in_use = 0;
+    return rc;
+}
+
+// Open and configure a pooled connection
+static DbConnection *db_open_connection(int read_only)
+{
+    DbConnection *conn = calloc(1, sizeof(DbConnection));
+    if (!conn)
+        return NULL;
+
+    // A connection is only used by one thread at a time, so SQLite's connection mutex is not needed
+    int flags = (read_only ? SQLITE_OPEN_READONLY : SQLITE_OPEN_READWRITE) | SQLITE_OPEN_NOMUTEX;
+    int rc = sqlite3_open_v2(DB_PATH, &conn->handle, flags, NULL);
+    if (rc != SQLITE_OK)
+    {
+        fprintf(stderr, "Cannot open pooled connection: %s\n",
+                conn->handle ? sqlite3_errmsg(conn->handle) : "out of memory");
+        sqlite3_close(conn->handle);
+        free(conn);
+        return NULL;
+    }
+    conn->read_only = read_only;
+
+    // Same settings as the main connection (WAL is a property of the file and already on)
+    sqlite3_exec(conn->handle, "PRAGMA foreign_keys = ON;", 0, 0, 0);
+    sqlite3_busy_timeout(conn->handle, DB_BUSY_TIMEOUT_MS);
+    return conn;
+}
+
+// Finalize the cached statements and close the connection
+static void db_close_connection(DbConnection *conn)
+{
+    if (!conn)
+        return;
+    for (int i = 0; i < DB_STMT_CACHE_SLOTS; i++)
+        sqlite3_finalize(conn->stmts[i].stmt);
+    sqlite3_close(conn->handle);
+    free(conn);
+}
+
+DbConnection *db_checkout(int read_only)
+{
+    DbIdleList *list = &g_idle[read_only ? 1 : 0];
+    DbConnection *conn = NULL;
+
+    pthread_mutex_lock(&g_pool_mutex);
+    if (list->count > 0)
+        conn = list->conns[--list->count];
+    pthread_mutex_unlock(&g_pool_mutex);
+
+    return conn ? conn : db_open_connection(read_only);
+}
+
+void db_checkin(DbConnection *conn)
+{
+    if (!conn)
+        return;
+
+    // Statements the caller never finalized would keep their read transaction open
+    for (int i = 0; i < DB_STMT_CACHE_SLOTS; i++)
+    {
+        if (conn->stmts[i].in_use)
+        {
+            fprintf(stderr, "db_checkin: statement was not finalized: %s\n", sqlite3_sql(conn->stmts[i].stmt));
+            sqlite3_reset(conn->stmts[i].stmt);
+            sqlite3_clear_bindings(conn->stmts[i].stmt);
+            conn->stmts[i].in_use = 0;
+        }
+    }
+
+    // Never hand a connection with an open transaction to the next thread
+    if (!sqlite3_get_autocommit(conn->handle))
+    {
+        fprintf(stderr, "db_checkin: rolling back a transaction left open\n");
+        sqlite3_exec(conn->handle, "ROLLBACK", 0, 0, 0);
+    }
+
+    DbIdleList *list = &g_idle[conn->read_only ? 1 : 0];
+    pthread_mutex_lock(&g_pool_mutex);
+    if (list->count < DB_POOL_MAX_IDLE)
+    {
+        list->conns[list->count++] = conn;
+        conn = NULL;
+    }
+    pthread_mutex_unlock(&g_pool_mutex);
+
+    // Pool is full
+    db_close_connection(conn);
+}
+
+sqlite3 *db_connection_handle(DbConnection *conn)
+{
+    return conn ? conn->handle : NULL;
+}
+
+// Bind the calling thread to a pooled connection
+int db_thread_attach(int read_only)
+{
+    db_conn = g_main_db ? db_checkout(read_only) : NULL;
+    if (!db_conn)
+    {
+        db = g_main_db;
+        return -1;
+    }
+    db = db_conn->handle;
+    return 0;
+}
+
+// Return the calling thread's connection to the pool
+void db_thread_detach(void)
+{
+    db_checkin(db_conn);
+    db_conn = NULL;
+    db = NULL;
+    tx_db = NULL;
+}
+
+static void parse_int_array(const char *json, int *out_array, int *out_count, int max_count);
+
+// Copies the items of one JSON column ("[12,34]") into trade_items rows for the given side.
+static int migrate_trade_side(sqlite3_stmt *insert, int trade_id, int side, const char *json)
+{
+    int items[TRADE_MAX_ITEMS];
+    int count = 0;
+    parse_int_array(json, items, &count, TRADE_MAX_ITEMS);
+
+    for (int i = 0; i < count; i++)
+    {
+        sqlite3_reset(insert);
+        sqlite3_bind_int(insert, 1, trade_id);
+        sqlite3_bind_int(insert, 2, side);
+        sqlite3_bind_int(insert, 3, i);
+        sqlite3_bind_int(insert, 4, items[i]);
+        if (sqlite3_step(insert) != SQLITE_DONE)
+            return -1;
+    }
+    return 0;
+}
+
+// Databases created before trade_items stored each side of a trade as a JSON array in
+// trades.offered_skins / trades.requested_skins. Copy those into trade_items and drop the columns.
+// The arrays are parsed here and the table is rebuilt with create-copy-rename, so the
+// migration needs neither JSON1 nor ALTER TABLE DROP COLUMN (SQLite 3.35+).
+static int db_migrate_trade_items(void)
+{
+    sqlite3_stmt *stmt;
+    if (sqlite3_prepare_v2(db, "SELECT offered_skins, requested_skins FROM trades LIMIT 0", -1, &stmt, 0) != SQLITE_OK)
+        return 0; // Already migrated (or a new database)
+    sqlite3_finalize(stmt);
+
+    // Dropping the old table must not cascade into trade_items; the pragma is a no-op inside a transaction
+    sqlite3_exec(db, "PRAGMA foreign_keys = OFF;", 0, 0, 0);
+    if (sqlite3_exec(db, "BEGIN IMMEDIATE TRANSACTION", 0, 0, 0) != SQLITE_OK)
+    {
+        sqlite3_exec(db, "PRAGMA foreign_keys = ON;", 0, 0, 0);
+        return -1;
+    }
+
+    sqlite3_stmt *insert = NULL;
+    int failed = sqlite3_prepare_v2(db, "SELECT trade_id, offered_skins, requested_skins FROM trades", -1, &stmt, 0) != SQLITE_OK;
+    if (!failed &&
+        sqlite3_prepare_v2(db, "INSERT OR IGNORE INTO trade_items (trade_id, side, slot, instance_id) VALUES (?, ?, ?, ?)",
+                           -1, &insert, 0) != SQLITE_OK)
+        failed = 1;
+
+    while (!failed && sqlite3_step(stmt) == SQLITE_ROW)
+    {
+        int trade_id = sqlite3_column_int(stmt, 0);
+        if (migrate_trade_side(insert, trade_id, 0, (const char *)sqlite3_column_text(stmt, 1)) != 0 ||
+            migrate_trade_side(insert, trade_id, 1, (const char *)sqlite3_column_text(stmt, 2)) != 0)
+            failed = 1;
+    }
+    sqlite3_finalize(insert);
+    sqlite3_finalize(stmt);
+
+    const char *rebuild_sql =
+        "CREATE TABLE trades_migrated ("
+        "trade_id INTEGER PRIMARY KEY AUTOINCREMENT, "
+        "from_user_id INTEGER NOT NULL, "
+        "to_user_id INTEGER NOT NULL, "
+        "offered_count INTEGER NOT NULL, "
+        "offered_cash REAL NOT NULL, "
+        "requested_count INTEGER NOT NULL, "
+        "requested_cash REAL NOT NULL, "
+        "status INTEGER NOT NULL, "
+        "created_at INTEGER NOT NULL, "
+        "expires_at INTEGER NOT NULL, "
+        "FOREIGN KEY (from_user_id) REFERENCES users(user_id), "
+        "FOREIGN KEY (to_user_id) REFERENCES users(user_id)"
+        ");"
+        "INSERT INTO trades_migrated (trade_id, from_user_id, to_user_id, offered_count, offered_cash, "
+        "requested_count, requested_cash, status, created_at, expires_at) "
+        "SELECT trade_id, from_user_id, to_user_id, offered_count, offered_cash, "
+        "requested_count, requested_cash, status, created_at, expires_at FROM trades;"
+        "DROP TABLE trades;"
+        "ALTER TABLE trades_migrated RENAME TO trades;"
+        "COMMIT;";
+
+    char *err_msg = 0;
+    if (failed || sqlite3_exec(db, rebuild_sql, 0, 0, &err_msg) != SQLITE_OK)
+    {
+        fprintf(stderr, "trade_items migration failed: %s\n", err_msg ? err_msg : sqlite3_errmsg(db));
+        sqlite3_free(err_msg);
+        sqlite3_exec(db, "ROLLBACK", 0, 0, 0);
+        sqlite3_exec(db, "PRAGMA foreign_keys = ON;", 0, 0, 0);
+        return -1;
+    }
+    sqlite3_exec(db, "PRAGMA foreign_keys = ON;", 0, 0, 0);
+    return 0;
+}
+
+static int insert_ledger_row(const LedgerEntry *entry);
+
+// Databases created before the ledger only have the amounts inside transaction_logs.details.
+// Parse them once into ledger rows; counterparties were never logged and stay 0.
+static int db_migrate_ledger(void)
+{
+    sqlite3_stmt *stmt;
+    int has_ledger_rows = 1;
+    if (db_prepare("SELECT EXISTS (SELECT 1 FROM ledger)", &stmt) != SQLITE_OK)
+        return -1;
+    if (sqlite3_step(stmt) == SQLITE_ROW)
+        has_ledger_rows = sqlite3_column_int(stmt, 0);
+    db_finalize(stmt);
+    if (has_ledger_rows)
+        return 0;
+
+    if (sqlite3_exec(db, "BEGIN IMMEDIATE TRANSACTION", 0, 0, 0) != SQLITE_OK)
+        return -1;
+    if (db_prepare("SELECT log_id, type, user_id, details, timestamp FROM transaction_logs "
+                   "WHERE type IN (?, ?, ?, ?) ORDER BY log_id",
+                   &stmt) != SQLITE_OK)
+    {
+        sqlite3_exec(db, "ROLLBACK", 0, 0, 0);
+        return -1;
+    }
+    sqlite3_bind_int(stmt, 1, LOG_TRADE);
+    sqlite3_bind_int(stmt, 2, LOG_UNBOX);
+    sqlite3_bind_int(stmt, 3, LOG_MARKET_BUY);
+    sqlite3_bind_int(stmt, 4, LOG_MARKET_SELL);
+
+    int failed = 0;
+    while (!failed && sqlite3_step(stmt) == SQLITE_ROW)
+    {
+        const char *details = (const char *)sqlite3_column_text(stmt, 3);
+        if (!details)
+            continue;
+
+        LedgerEntry entry;
+        memset(&entry, 0, sizeof(entry));
+        entry.log_id = sqlite3_column_int(stmt, 0);
+        entry.kind = (LogType)sqlite3_column_int(stmt, 1);
+        entry.user_id = sqlite3_column_int(stmt, 2);
+        entry.timestamp = (time_t)sqlite3_column_int64(stmt, 4);
+
+        float received = 0.0f, refund = 0.0f;
+        int parsed = 0;
+        switch (entry.kind)
+        {
+        case LOG_MARKET_BUY:
+            parsed = sscanf(details, "Bought instance %d for $%f", &entry.instance_id, &entry.amount) == 2;
+            entry.cost = entry.amount;
+            break;
+        case LOG_MARKET_SELL:
+            parsed = sscanf(details, "Sold instance %d for $%f (received $%f after fee, +$%f listing fee refund)",
+                            &entry.instance_id, &entry.amount, &received, &refund) >= 3;
+            entry.fee = entry.amount - (received + refund);
+            break;
+        case LOG_TRADE:
+            parsed = sscanf(details, "Accepted trade offer %*d: gave $%f (items + cash), received $%f",
+                            &entry.cost, &entry.amount) == 2;
+            break;
+        case LOG_UNBOX:
+            parsed = sscanf(details, "Unboxed case %*d (%*[^)]) -> instance %d (def %d, rarity %*d, wear %*f, "
+                                     "pattern %*d, stattrak %*d, cost $%f, value $%f",
+                            &entry.instance_id, &entry.definition_id, &entry.cost, &entry.amount) == 4;
+            break;
+        default:
+            break;
+        }
+        if (!parsed)
+            continue; // Offers, declines, rare-drop announcements: nothing changed hands
+        if (insert_ledger_row(&entry) != 0)
+            failed = 1;
+    }
+    db_finalize(stmt);
+
+    if (failed || sqlite3_exec(db, "COMMIT", 0, 0, 0) != SQLITE_OK)
+    {
+        fprintf(stderr, "ledger migration failed: %s\n", sqlite3_errmsg(db));
+        sqlite3_exec(db, "ROLLBACK", 0, 0, 0);
+        return -1;
+    }
+    return 0;
+}
+
 // Initialize database
 int db_init()
 {
@@ -291,14 +710,16 @@ int db_init()
     // Create data directory if it doesn't exist
     system("mkdir -p data");
 
-    int rc = sqlite3_open("data/database.db", &db);
+    int rc = sqlite3_open(DB_PATH, &db);
 
     if (rc != SQLITE_OK)
     {
         fprintf(stderr, "Cannot open database: %s\n", sqlite3_errmsg(db));
         sqlite3_close(db);
+        db = NULL;
         return -1;
     }
+    g_main_db = db;
 
     // Enable foreign key constraints
     sqlite3_exec(db, "PRAGMA foreign_keys = ON;", 0, 0, 0);
@@ -309,7 +730,7 @@ int db_init()
     
     // Set busy timeout to 5 seconds (wait if database is locked)
     // This prevents "Database is locked" errors when multiple threads write
-    sqlite3_busy_timeout(db, 5000);
+    sqlite3_busy_timeout(db, DB_BUSY_TIMEOUT_MS);
 
     // Create schema if tables don't exist
     const char *schema_sql =
@@ -348,10 +769,8 @@ int db_init()
         "trade_id INTEGER PRIMARY KEY AUTOINCREMENT, "
         "from_user_id INTEGER NOT NULL, "
         "to_user_id INTEGER NOT NULL, "
-        "offered_skins TEXT NOT NULL, "
         "offered_count INTEGER NOT NULL, "
         "offered_cash REAL NOT NULL, "
-        "requested_skins TEXT NOT NULL, "
         "requested_count INTEGER NOT NULL, "
         "requested_cash REAL NOT NULL, "
         "status INTEGER NOT NULL, "
@@ -360,6 +779,15 @@ int db_init()
         "FOREIGN KEY (from_user_id) REFERENCES users(user_id), "
         "FOREIGN KEY (to_user_id) REFERENCES users(user_id)"
         ");"
+        // Items of a trade, one row per instance (side: 0 = offered, 1 = requested)
+        "CREATE TABLE IF NOT EXISTS trade_items ("
+        "trade_id INTEGER NOT NULL, "
+        "side INTEGER NOT NULL, "
+        "slot INTEGER NOT NULL, "
+        "instance_id INTEGER NOT NULL, "
+        "PRIMARY KEY (trade_id, side, slot), "
+        "FOREIGN KEY (trade_id) REFERENCES trades(trade_id)"
+        ") WITHOUT ROWID;"
         "CREATE TABLE IF NOT EXISTS market_listings ("
         "listing_id INTEGER PRIMARY KEY AUTOINCREMENT, "
         "seller_id INTEGER NOT NULL, "
@@ -395,6 +823,29 @@ int db_init()
         "timestamp INTEGER NOT NULL, "
         "FOREIGN KEY (user_id) REFERENCES users(user_id)"
         ");"
+        // Typed amounts for every transaction_logs row that moves money or value (see LedgerEntry)
+        "CREATE TABLE IF NOT EXISTS ledger ("
+        "entry_id INTEGER PRIMARY KEY, "
+        "log_id INTEGER, "
+        "user_id INTEGER NOT NULL, "
+        "kind INTEGER NOT NULL, "
+        "amount REAL NOT NULL DEFAULT 0, "
+        "cost REAL NOT NULL DEFAULT 0, "
+        "fee REAL NOT NULL DEFAULT 0, "
+        "instance_id INTEGER NOT NULL DEFAULT 0, "
+        "counterparty_id INTEGER NOT NULL DEFAULT 0, "
+        "definition_id INTEGER NOT NULL DEFAULT 0, "
+        "timestamp INTEGER NOT NULL, "
+        "FOREIGN KEY (user_id) REFERENCES users(user_id)"
+        ");"
+        // The LEADERBOARD_TOP_UNBOXES most valuable unboxes, rewritten as the in-memory heap changes
+        "CREATE TABLE IF NOT EXISTS top_unboxes ("
+        "instance_id INTEGER PRIMARY KEY, "
+        "user_id INTEGER NOT NULL, "
+        "definition_id INTEGER NOT NULL, "
+        "value REAL NOT NULL, "
+        "unboxed_at INTEGER NOT NULL"
+        ");"
         "CREATE TABLE IF NOT EXISTS reports ("
         "report_id INTEGER PRIMARY KEY AUTOINCREMENT, "
         "reporter_id INTEGER NOT NULL, "
@@ -527,6 +978,7 @@ int db_init()
         "CREATE INDEX IF NOT EXISTS idx_trades_status ON trades(status);"
         "CREATE INDEX IF NOT EXISTS idx_trades_expires ON trades(expires_at);"
         "CREATE INDEX IF NOT EXISTS idx_trades_user_status ON trades(from_user_id, to_user_id, status);"
+        "CREATE INDEX IF NOT EXISTS idx_trade_items_instance ON trade_items(instance_id);"
         "CREATE INDEX IF NOT EXISTS idx_market_active ON market_listings(is_sold);"
         "CREATE INDEX IF NOT EXISTS idx_market_seller ON market_listings(seller_id, is_sold);"
         "CREATE INDEX IF NOT EXISTS idx_sessions_token ON sessions(session_token);"
@@ -542,12 +994,52 @@ int db_init()
         "CREATE INDEX IF NOT EXISTS idx_reports_reporter ON reports(reporter_id);"
         "CREATE INDEX IF NOT EXISTS idx_case_skins_definition ON case_skins(definition_id);"
         "CREATE INDEX IF NOT EXISTS idx_transaction_logs_user ON transaction_logs(user_id, timestamp);"
+        "DROP INDEX IF EXISTS idx_transaction_logs_timestamp;"
+        "CREATE INDEX IF NOT EXISTS idx_ledger_user_kind ON ledger(user_id, kind, timestamp);"
+        "CREATE INDEX IF NOT EXISTS idx_ledger_instance ON ledger(instance_id);"
+        "CREATE INDEX IF NOT EXISTS idx_ledger_timestamp ON ledger(timestamp);"
         "CREATE INDEX IF NOT EXISTS idx_skin_definitions_name ON skin_definitions(name);"
         "CREATE INDEX IF NOT EXISTS idx_quests_user ON quests(user_id, is_completed, is_claimed);"
         "CREATE INDEX IF NOT EXISTS idx_achievements_user ON achievements(user_id, is_unlocked, is_claimed);"
         "CREATE INDEX IF NOT EXISTS idx_chat_messages_timestamp ON chat_messages(timestamp);"
         "CREATE INDEX IF NOT EXISTS idx_price_history_definition ON price_history(definition_id, timestamp);"
-        "CREATE INDEX IF NOT EXISTS idx_price_history_timestamp ON price_history(timestamp);";
+        "CREATE INDEX IF NOT EXISTS idx_price_history_timestamp ON price_history(timestamp);"
+        // Bumped by the triggers below so the in-memory pricing catalog and roll tables notice edits
+        "CREATE TABLE IF NOT EXISTS catalog_version ("
+        "id INTEGER PRIMARY KEY CHECK (id = 1), "
+        "version INTEGER NOT NULL"
+        ");"
+        "INSERT OR IGNORE INTO catalog_version (id, version) VALUES (1, 0);"
+        "CREATE TRIGGER IF NOT EXISTS trg_skin_definitions_ins AFTER INSERT ON skin_definitions "
+        "BEGIN UPDATE catalog_version SET version = version + 1 WHERE id = 1; END;"
+        "CREATE TRIGGER IF NOT EXISTS trg_skin_definitions_upd AFTER UPDATE ON skin_definitions "
+        "BEGIN UPDATE catalog_version SET version = version + 1 WHERE id = 1; END;"
+        "CREATE TRIGGER IF NOT EXISTS trg_skin_definitions_del AFTER DELETE ON skin_definitions "
+        "BEGIN UPDATE catalog_version SET version = version + 1 WHERE id = 1; END;"
+        "CREATE TRIGGER IF NOT EXISTS trg_rarity_multipliers_ins AFTER INSERT ON rarity_multipliers "
+        "BEGIN UPDATE catalog_version SET version = version + 1 WHERE id = 1; END;"
+        "CREATE TRIGGER IF NOT EXISTS trg_rarity_multipliers_upd AFTER UPDATE ON rarity_multipliers "
+        "BEGIN UPDATE catalog_version SET version = version + 1 WHERE id = 1; END;"
+        "CREATE TRIGGER IF NOT EXISTS trg_rarity_multipliers_del AFTER DELETE ON rarity_multipliers "
+        "BEGIN UPDATE catalog_version SET version = version + 1 WHERE id = 1; END;"
+        "CREATE TRIGGER IF NOT EXISTS trg_wear_multipliers_ins AFTER INSERT ON wear_multipliers "
+        "BEGIN UPDATE catalog_version SET version = version + 1 WHERE id = 1; END;"
+        "CREATE TRIGGER IF NOT EXISTS trg_wear_multipliers_upd AFTER UPDATE ON wear_multipliers "
+        "BEGIN UPDATE catalog_version SET version = version + 1 WHERE id = 1; END;"
+        "CREATE TRIGGER IF NOT EXISTS trg_wear_multipliers_del AFTER DELETE ON wear_multipliers "
+        "BEGIN UPDATE catalog_version SET version = version + 1 WHERE id = 1; END;"
+        "CREATE TRIGGER IF NOT EXISTS trg_cases_ins AFTER INSERT ON cases "
+        "BEGIN UPDATE catalog_version SET version = version + 1 WHERE id = 1; END;"
+        "CREATE TRIGGER IF NOT EXISTS trg_cases_upd AFTER UPDATE ON cases "
+        "BEGIN UPDATE catalog_version SET version = version + 1 WHERE id = 1; END;"
+        "CREATE TRIGGER IF NOT EXISTS trg_cases_del AFTER DELETE ON cases "
+        "BEGIN UPDATE catalog_version SET version = version + 1 WHERE id = 1; END;"
+        "CREATE TRIGGER IF NOT EXISTS trg_case_skins_ins AFTER INSERT ON case_skins "
+        "BEGIN UPDATE catalog_version SET version = version + 1 WHERE id = 1; END;"
+        "CREATE TRIGGER IF NOT EXISTS trg_case_skins_upd AFTER UPDATE ON case_skins "
+        "BEGIN UPDATE catalog_version SET version = version + 1 WHERE id = 1; END;"
+        "CREATE TRIGGER IF NOT EXISTS trg_case_skins_del AFTER DELETE ON case_skins "
+        "BEGIN UPDATE catalog_version SET version = version + 1 WHERE id = 1; END;";
 
     rc = sqlite3_exec(db, schema_sql, 0, 0, &err_msg);
     if (rc != SQLITE_OK)
@@ -577,9 +1069,23 @@ int db_init()
         sqlite3_free(migration_err);
     }
 
+    // Migration: move trade items out of the JSON text columns into trade_items
+    if (db_migrate_trade_items() != 0)
+    {
+        sqlite3_close(db);
+        return -1;
+    }
+
+    // Migration: typed ledger rows for logs written before the ledger existed
+    if (db_migrate_ledger() != 0)
+    {
+        sqlite3_close(db);
+        return -1;
+    }
+
     // Insert initial data if tables are empty
     sqlite3_stmt *stmt;
-    rc = sqlite3_prepare_v2(db, "SELECT COUNT(*) FROM wear_multipliers", -1, &stmt, 0);
+    rc = db_prepare("SELECT COUNT(*) FROM wear_multipliers", &stmt);
     int should_populate = 0;
     if (rc == SQLITE_OK)
     {
@@ -587,7 +1093,7 @@ int db_init()
         {
             should_populate = 1;
         }
-        sqlite3_finalize(stmt);
+        db_finalize(stmt);
     }
 
     if (should_populate)
@@ -624,30 +1130,45 @@ int db_init()
     {
         char check_sql[128];
         snprintf(check_sql, sizeof(check_sql), "SELECT COUNT(*) FROM case_skins WHERE case_id = %d", case_id);
-        rc = sqlite3_prepare_v2(db, check_sql, -1, &stmt, 0);
+        rc = db_prepare(check_sql, &stmt);
         if (rc == SQLITE_OK)
         {
             if (sqlite3_step(stmt) == SQLITE_ROW && sqlite3_column_int(stmt, 0) == 0)
             {
-                sqlite3_finalize(stmt);
+                db_finalize(stmt);
                 // Populate all cases if any case is missing
                 db_populate_cases_and_skins();
                 break; // Only need to populate once
             }
-            sqlite3_finalize(stmt);
+            db_finalize(stmt);
         }
     }
 
+    if (pricing_catalog_init() != 0)
+        fprintf(stderr, "Pricing catalog unavailable, prices are computed with SQL and cases cannot be opened\n");
+
     return 0;
 }
 
 // Cleanup database connection
 void db_close()
 {
-    if (db)
+    pricing_catalog_cleanup();
+
+    pthread_mutex_lock(&g_pool_mutex);
+    for (int i = 0; i < 2; i++)
     {
-        sqlite3_close(db);
+        while (g_idle[i].count > 0)
+            db_close_connection(g_idle[i].conns[--g_idle[i].count]);
+    }
+    pthread_mutex_unlock(&g_pool_mutex);
+
+    if (g_main_db)
+    {
+        sqlite3_close(g_main_db);
+        g_main_db = NULL;
     }
+    db = NULL;
 }
 
 // ==================== USER OPERATIONS ====================
@@ -675,7 +1196,7 @@ int db_save_user(User *user)
     }
 
     sqlite3_stmt *stmt;
-    int rc = sqlite3_prepare_v2(db, sql, -1, &stmt, 0);
+    int rc = db_prepare(sql, &stmt);
     if (rc != SQLITE_OK)
         return -1;
 
@@ -698,7 +1219,7 @@ int db_save_user(User *user)
         user->user_id = (int)sqlite3_last_insert_rowid(db);
     }
 
-    sqlite3_finalize(stmt);
+    db_finalize(stmt);
 
     return (rc == SQLITE_DONE) ? 0 : -1;
 }
@@ -710,7 +1231,7 @@ int db_load_user(int user_id, User *out_user)
 
     const char *sql = "SELECT * FROM users WHERE user_id = ?";
     sqlite3_stmt *stmt;
-    int rc = sqlite3_prepare_v2(db, sql, -1, &stmt, 0);
+    int rc = db_prepare(sql, &stmt);
     if (rc != SQLITE_OK)
         return -1;
 
@@ -726,11 +1247,11 @@ int db_load_user(int user_id, User *out_user)
         out_user->last_login = sqlite3_column_int64(stmt, 5);
         out_user->is_banned = sqlite3_column_int(stmt, 6);
 
-        sqlite3_finalize(stmt);
+        db_finalize(stmt);
         return 0;
     }
 
-    sqlite3_finalize(stmt);
+    db_finalize(stmt);
     return -1;
 }
 
@@ -744,7 +1265,7 @@ int db_load_user_by_username(const char *username, User *out_user)
 
     const char *sql = "SELECT * FROM users WHERE username = ?";
     sqlite3_stmt *stmt;
-    int rc = sqlite3_prepare_v2(db, sql, -1, &stmt, 0);
+    int rc = db_prepare(sql, &stmt);
     if (rc != SQLITE_OK)
         return -1;
 
@@ -760,11 +1281,11 @@ int db_load_user_by_username(const char *username, User *out_user)
         out_user->last_login = sqlite3_column_int64(stmt, 5);
         out_user->is_banned = sqlite3_column_int(stmt, 6);
 
-        sqlite3_finalize(stmt);
+        db_finalize(stmt);
         return 0;
     }
 
-    sqlite3_finalize(stmt);
+    db_finalize(stmt);
     return -1;
 }
 
@@ -780,7 +1301,7 @@ int db_update_user(User *user)
                       "created_at = ?, last_login = ?, is_banned = ? WHERE user_id = ?";
 
     sqlite3_stmt *stmt;
-    int rc = sqlite3_prepare_v2(db, sql, -1, &stmt, 0);
+    int rc = db_prepare(sql, &stmt);
     if (rc != SQLITE_OK)
         return -1;
 
@@ -793,7 +1314,7 @@ int db_update_user(User *user)
     sqlite3_bind_int(stmt, 7, user->user_id);
 
     rc = sqlite3_step(stmt);
-    sqlite3_finalize(stmt);
+    db_finalize(stmt);
 
     return (rc == SQLITE_DONE) ? 0 : -1;
 }
@@ -802,7 +1323,7 @@ int db_user_exists(const char *username)
 {
     const char *sql = "SELECT COUNT(*) FROM users WHERE username = ?";
     sqlite3_stmt *stmt;
-    int rc = sqlite3_prepare_v2(db, sql, -1, &stmt, 0);
+    int rc = db_prepare(sql, &stmt);
     if (rc != SQLITE_OK)
         return 0;
 
@@ -811,11 +1332,11 @@ int db_user_exists(const char *username)
     if (sqlite3_step(stmt) == SQLITE_ROW)
     {
         int count = sqlite3_column_int(stmt, 0);
-        sqlite3_finalize(stmt);
+        db_finalize(stmt);
         return count > 0;
     }
 
-    sqlite3_finalize(stmt);
+    db_finalize(stmt);
     return 0;
 }
 
@@ -830,7 +1351,7 @@ int db_save_skin(Skin *skin)
                       "VALUES (?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?)";
 
     sqlite3_stmt *stmt;
-    int rc = sqlite3_prepare_v2(db, sql, -1, &stmt, 0);
+    int rc = db_prepare(sql, &stmt);
     if (rc != SQLITE_OK)
         return -1;
 
@@ -847,7 +1368,7 @@ int db_save_skin(Skin *skin)
     sqlite3_bind_int(stmt, 11, skin->is_tradable);
 
     rc = sqlite3_step(stmt);
-    sqlite3_finalize(stmt);
+    db_finalize(stmt);
 
     return (rc == SQLITE_DONE) ? 0 : -1;
 }
@@ -859,7 +1380,7 @@ int db_load_skin(int skin_id, Skin *out_skin)
 
     const char *sql = "SELECT * FROM skins WHERE skin_id = ?";
     sqlite3_stmt *stmt;
-    int rc = sqlite3_prepare_v2(db, sql, -1, &stmt, 0);
+    int rc = db_prepare(sql, &stmt);
     if (rc != SQLITE_OK)
         return -1;
 
@@ -887,11 +1408,11 @@ int db_load_skin(int skin_id, Skin *out_skin)
         out_skin->acquired_at = sqlite3_column_int64(stmt, 9);
         out_skin->is_tradable = sqlite3_column_int(stmt, 10);
 
-        sqlite3_finalize(stmt);
+        db_finalize(stmt);
         return 0;
     }
 
-    sqlite3_finalize(stmt);
+    db_finalize(stmt);
     return -1;
 }
 
@@ -904,7 +1425,7 @@ int db_update_skin(Skin *skin)
                       "current_price = ?, owner_id = ?, acquired_at = ?, is_tradable = ? WHERE skin_id = ?";
 
     sqlite3_stmt *stmt;
-    int rc = sqlite3_prepare_v2(db, sql, -1, &stmt, 0);
+    int rc = db_prepare(sql, &stmt);
     if (rc != SQLITE_OK)
         return -1;
 
@@ -921,7 +1442,7 @@ int db_update_skin(Skin *skin)
     sqlite3_bind_int(stmt, 11, skin->skin_id);
 
     rc = sqlite3_step(stmt);
-    sqlite3_finalize(stmt);
+    db_finalize(stmt);
 
     return (rc == SQLITE_DONE) ? 0 : -1;
 }
@@ -943,7 +1464,7 @@ int db_load_inventory(int user_id, Inventory *out_inv)
     // Load instance_id from inventories table
     const char *sql = "SELECT instance_id FROM inventories WHERE user_id = ?";
     sqlite3_stmt *stmt;
-    int rc = sqlite3_prepare_v2(db, sql, -1, &stmt, 0);
+    int rc = db_prepare(sql, &stmt);
     if (rc != SQLITE_OK)
         return 0; // Empty inventory
 
@@ -956,7 +1477,7 @@ int db_load_inventory(int user_id, Inventory *out_inv)
     }
 
     out_inv->count = count;
-    sqlite3_finalize(stmt);
+    db_finalize(stmt);
     return 0;
 }
 
@@ -968,7 +1489,7 @@ int db_add_to_inventory(int user_id, int skin_id)
     // Note: skin_id parameter is actually instance_id in the new system
     const char *sql = "INSERT OR IGNORE INTO inventories (user_id, instance_id) VALUES (?, ?)";
     sqlite3_stmt *stmt;
-    int rc = sqlite3_prepare_v2(db, sql, -1, &stmt, 0);
+    int rc = db_prepare(sql, &stmt);
     if (rc != SQLITE_OK)
         return -1;
 
@@ -976,7 +1497,7 @@ int db_add_to_inventory(int user_id, int skin_id)
     sqlite3_bind_int(stmt, 2, skin_id); // Actually instance_id
 
     rc = sqlite3_step(stmt);
-    sqlite3_finalize(stmt);
+    db_finalize(stmt);
 
     return (rc == SQLITE_DONE) ? 0 : -1;
 }
@@ -989,7 +1510,7 @@ int db_remove_from_inventory(int user_id, int skin_id)
     // Note: skin_id parameter is actually instance_id in the new system
     const char *sql = "DELETE FROM inventories WHERE user_id = ? AND instance_id = ?";
     sqlite3_stmt *stmt;
-    int rc = sqlite3_prepare_v2(db, sql, -1, &stmt, 0);
+    int rc = db_prepare(sql, &stmt);
     if (rc != SQLITE_OK)
         return -1;
 
@@ -997,76 +1518,229 @@ int db_remove_from_inventory(int user_id, int skin_id)
     sqlite3_bind_int(stmt, 2, skin_id); // Actually instance_id
 
     rc = sqlite3_step(stmt);
-    sqlite3_finalize(stmt);
+    db_finalize(stmt);
 
     return (rc == SQLITE_DONE) ? 0 : -1;
 }
 
 // ==================== TRADE OPERATIONS ====================
 
-int db_save_trade(TradeOffer *trade)
+// trade_items.side
+#define TRADE_SIDE_OFFERED 0
+#define TRADE_SIDE_REQUESTED 1
+
+// Columns of trades in the order read by read_trade_row
+#define TRADE_COLUMNS "trade_id, from_user_id, to_user_id, offered_count, offered_cash, " \
+                      "requested_count, requested_cash, status, created_at, expires_at"
+
+// Savepoints nest inside a transaction opened with db_begin_transaction as well as on their own
+static int db_savepoint(const char *name)
 {
-    if (!trade)
+    char sql[64];
+    snprintf(sql, sizeof(sql), "SAVEPOINT %s", name);
+    return sqlite3_exec(db, sql, 0, 0, 0) == SQLITE_OK ? 0 : -1;
+}
+
+static int db_release_savepoint(const char *name, int commit)
+{
+    char sql[96];
+    if (commit)
+        snprintf(sql, sizeof(sql), "RELEASE %s", name);
+    else
+        snprintf(sql, sizeof(sql), "ROLLBACK TO %s; RELEASE %s", name, name);
+    return sqlite3_exec(db, sql, 0, 0, 0) == SQLITE_OK ? 0 : -1;
+}
+
+// Replace the trade_items rows of a trade with the items in the TradeOffer
+static int db_write_trade_items(const TradeOffer *trade)
+{
+    sqlite3_stmt *stmt;
+    if (db_prepare("DELETE FROM trade_items WHERE trade_id = ?", &stmt) != SQLITE_OK)
+        return -1;
+    sqlite3_bind_int(stmt, 1, trade->trade_id);
+    int rc = sqlite3_step(stmt);
+    db_finalize(stmt);
+    if (rc != SQLITE_DONE)
         return -1;
 
-    if (!db)
+    if (db_prepare("INSERT INTO trade_items (trade_id, side, slot, instance_id) VALUES (?, ?, ?, ?)", &stmt) != SQLITE_OK)
         return -1;
 
-    // Serialize arrays to JSON strings
-    char offered_str[512] = {0};
-    char requested_str[512] = {0};
+    for (int side = TRADE_SIDE_OFFERED; side <= TRADE_SIDE_REQUESTED && rc == SQLITE_DONE; side++)
+    {
+        const int *items = side == TRADE_SIDE_OFFERED ? trade->offered_skins : trade->requested_skins;
+        int count = side == TRADE_SIDE_OFFERED ? trade->offered_count : trade->requested_count;
+        if (count > 10)
+            count = 10;
+
+        for (int i = 0; i < count && rc == SQLITE_DONE; i++)
+        {
+            sqlite3_bind_int(stmt, 1, trade->trade_id);
+            sqlite3_bind_int(stmt, 2, side);
+            sqlite3_bind_int(stmt, 3, i);
+            sqlite3_bind_int(stmt, 4, items[i]);
+            rc = sqlite3_step(stmt);
+            sqlite3_reset(stmt);
+        }
+    }
+
+    db_finalize(stmt);
+    return rc == SQLITE_DONE ? 0 : -1;
+}
+
+// Fill a TradeOffer from a row selected with TRADE_COLUMNS (items are loaded separately)
+static void read_trade_row(sqlite3_stmt *stmt, TradeOffer *trade)
+{
+    trade->trade_id = sqlite3_column_int(stmt, 0);
+    trade->from_user_id = sqlite3_column_int(stmt, 1);
+    trade->to_user_id = sqlite3_column_int(stmt, 2);
+    trade->offered_count = 0;
+    trade->offered_cash = sqlite3_column_double(stmt, 4);
+    trade->requested_count = 0;
+    trade->requested_cash = sqlite3_column_double(stmt, 6);
+    trade->status = (TradeStatus)sqlite3_column_int(stmt, 7);
+    trade->created_at = sqlite3_column_int64(stmt, 8);
+    trade->expires_at = sqlite3_column_int64(stmt, 9);
+    memset(trade->offered_skins, 0, sizeof(trade->offered_skins));
+    memset(trade->requested_skins, 0, sizeof(trade->requested_skins));
+}
+
+// Write the placeholders of a fixed-width IN list, "?, ?, ..." with DB_BATCH_MAX_IDS entries.
+// out must hold DB_BATCH_MAX_IDS * 3 bytes. Every chunk binds all of them (unused slots to
+// NULL, which matches nothing), so the same statement text is reused from the cache.
+static void batch_placeholders(char *out)
+{
+    int len = 0;
+    for (int i = 0; i < DB_BATCH_MAX_IDS; i++)
+        len += sprintf(out + len, i ? ", ?" : "?");
+}
 
-    strcat(offered_str, "[");
-    for (int i = 0; i < trade->offered_count; i++)
+// Bind ids[0..n) to the first n slots of a batch_placeholders() list starting at parameter first
+static void bind_batch_ids(sqlite3_stmt *stmt, int first, const int *ids, int n)
+{
+    for (int i = 0; i < DB_BATCH_MAX_IDS; i++)
     {
-        if (i > 0)
-            strcat(offered_str, ",");
-        char num[16];
-        sprintf(num, "%d", trade->offered_skins[i]);
-        strcat(offered_str, num);
+        if (i < n)
+            sqlite3_bind_int(stmt, first + i, ids[i]);
+        else
+            sqlite3_bind_null(stmt, first + i);
     }
-    strcat(offered_str, "]");
+}
 
-    strcat(requested_str, "[");
-    for (int i = 0; i < trade->requested_count; i++)
+// Load the items of several trades, DB_BATCH_MAX_IDS trades per query (counts are set from the rows found)
+static int db_read_trade_items(TradeOffer *trades, int count)
+{
+    if (count <= 0)
+        return 0;
+
+    char placeholders[DB_BATCH_MAX_IDS * 3];
+    batch_placeholders(placeholders);
+
+    char sql[256 + sizeof(placeholders)];
+    snprintf(sql, sizeof(sql),
+             "SELECT trade_id, side, instance_id FROM trade_items "
+             "WHERE trade_id IN (%s) ORDER BY trade_id, side, slot",
+             placeholders);
+
+    for (int start = 0; start < count; start += DB_BATCH_MAX_IDS)
     {
-        if (i > 0)
-            strcat(requested_str, ",");
-        char num[16];
-        sprintf(num, "%d", trade->requested_skins[i]);
-        strcat(requested_str, num);
+        int chunk = count - start;
+        if (chunk > DB_BATCH_MAX_IDS)
+            chunk = DB_BATCH_MAX_IDS;
+
+        int trade_ids[DB_BATCH_MAX_IDS];
+        for (int i = 0; i < chunk; i++)
+            trade_ids[i] = trades[start + i].trade_id;
+
+        sqlite3_stmt *stmt;
+        if (db_prepare(sql, &stmt) != SQLITE_OK)
+            return -1;
+
+        bind_batch_ids(stmt, 1, trade_ids, chunk);
+
+        TradeOffer *trade = NULL;
+        while (sqlite3_step(stmt) == SQLITE_ROW)
+        {
+            int trade_id = sqlite3_column_int(stmt, 0);
+            if (!trade || trade->trade_id != trade_id)
+            {
+                trade = NULL;
+                for (int i = 0; i < chunk; i++)
+                {
+                    if (trade_ids[i] == trade_id)
+                    {
+                        trade = &trades[start + i];
+                        break;
+                    }
+                }
+                if (!trade)
+                    continue;
+            }
+
+            int instance_id = sqlite3_column_int(stmt, 2);
+            if (sqlite3_column_int(stmt, 1) == TRADE_SIDE_OFFERED)
+            {
+                if (trade->offered_count < TRADE_MAX_ITEMS)
+                    trade->offered_skins[trade->offered_count++] = instance_id;
+            }
+            else if (trade->requested_count < TRADE_MAX_ITEMS)
+            {
+                trade->requested_skins[trade->requested_count++] = instance_id;
+            }
+        }
+
+        db_finalize(stmt);
     }
-    strcat(requested_str, "]");
+    return 0;
+}
 
-    const char *sql = "INSERT INTO trades (from_user_id, to_user_id, offered_skins, offered_count, "
-                      "offered_cash, requested_skins, requested_count, requested_cash, status, created_at, expires_at) "
-                      "VALUES (?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?)";
+int db_save_trade(TradeOffer *trade)
+{
+    if (!trade)
+        return -1;
+
+    if (!db)
+        return -1;
+
+    const char *sql = "INSERT INTO trades (from_user_id, to_user_id, offered_count, offered_cash, "
+                      "requested_count, requested_cash, status, created_at, expires_at) "
+                      "VALUES (?, ?, ?, ?, ?, ?, ?, ?, ?)";
+
+    if (db_savepoint("save_trade") != 0)
+        return -1;
 
     sqlite3_stmt *stmt;
-    int rc = sqlite3_prepare_v2(db, sql, -1, &stmt, 0);
+    int rc = db_prepare(sql, &stmt);
     if (rc != SQLITE_OK)
+    {
+        db_release_savepoint("save_trade", 0);
         return -1;
+    }
 
     sqlite3_bind_int(stmt, 1, trade->from_user_id);
     sqlite3_bind_int(stmt, 2, trade->to_user_id);
-    sqlite3_bind_text(stmt, 3, offered_str, -1, SQLITE_STATIC);
-    sqlite3_bind_int(stmt, 4, trade->offered_count);
-    sqlite3_bind_double(stmt, 5, trade->offered_cash);
-    sqlite3_bind_text(stmt, 6, requested_str, -1, SQLITE_STATIC);
-    sqlite3_bind_int(stmt, 7, trade->requested_count);
-    sqlite3_bind_double(stmt, 8, trade->requested_cash);
-    sqlite3_bind_int(stmt, 9, trade->status);
-    sqlite3_bind_int64(stmt, 10, trade->created_at);
-    sqlite3_bind_int64(stmt, 11, trade->expires_at);
+    sqlite3_bind_int(stmt, 3, trade->offered_count);
+    sqlite3_bind_double(stmt, 4, trade->offered_cash);
+    sqlite3_bind_int(stmt, 5, trade->requested_count);
+    sqlite3_bind_double(stmt, 6, trade->requested_cash);
+    sqlite3_bind_int(stmt, 7, trade->status);
+    sqlite3_bind_int64(stmt, 8, trade->created_at);
+    sqlite3_bind_int64(stmt, 9, trade->expires_at);
 
     rc = sqlite3_step(stmt);
     if (rc == SQLITE_DONE && trade->trade_id == 0)
     {
         trade->trade_id = (int)sqlite3_last_insert_rowid(db);
     }
-    sqlite3_finalize(stmt);
+    db_finalize(stmt);
 
-    return (rc == SQLITE_DONE) ? 0 : -1;
+    if (rc != SQLITE_DONE || db_write_trade_items(trade) != 0)
+    {
+        db_release_savepoint("save_trade", 0);
+        return -1;
+    }
+
+    return db_release_savepoint("save_trade", 1);
 }
 
 int db_load_trade(int trade_id, TradeOffer *out_trade)
@@ -1077,9 +1751,9 @@ int db_load_trade(int trade_id, TradeOffer *out_trade)
     if (!db)
         return -1;
 
-    const char *sql = "SELECT * FROM trades WHERE trade_id = ?";
+    const char *sql = "SELECT " TRADE_COLUMNS " FROM trades WHERE trade_id = ?";
     sqlite3_stmt *stmt;
-    int rc = sqlite3_prepare_v2(db, sql, -1, &stmt, 0);
+    int rc = db_prepare(sql, &stmt);
     if (rc != SQLITE_OK)
         return -1;
 
@@ -1087,88 +1761,12 @@ int db_load_trade(int trade_id, TradeOffer *out_trade)
 
     if (sqlite3_step(stmt) == SQLITE_ROW)
     {
-        // Column order from SELECT * FROM trades:
-        // 0: trade_id, 1: from_user_id, 2: to_user_id, 3: offered_skins, 4: offered_count,
-        // 5: offered_cash, 6: requested_skins, 7: requested_count, 8: requested_cash,
-        // 9: status, 10: created_at, 11: expires_at
-        out_trade->trade_id = sqlite3_column_int(stmt, 0);
-        out_trade->from_user_id = sqlite3_column_int(stmt, 1);
-        out_trade->to_user_id = sqlite3_column_int(stmt, 2);
-
-        const char *offered_str = (char *)sqlite3_column_text(stmt, 3);
-        out_trade->offered_count = sqlite3_column_int(stmt, 4);
-        out_trade->offered_cash = sqlite3_column_double(stmt, 5);
-        const char *requested_str = (char *)sqlite3_column_text(stmt, 6);
-        out_trade->requested_count = sqlite3_column_int(stmt, 7);
-        out_trade->requested_cash = sqlite3_column_double(stmt, 8);
-        out_trade->status = (TradeStatus)sqlite3_column_int(stmt, 9);
-        out_trade->created_at = sqlite3_column_int64(stmt, 10);
-        out_trade->expires_at = sqlite3_column_int64(stmt, 11);
-
-        // Initialize arrays
-        memset(out_trade->offered_skins, 0, sizeof(out_trade->offered_skins));
-        memset(out_trade->requested_skins, 0, sizeof(out_trade->requested_skins));
-
-        // Parse JSON arrays
-        if (offered_str && offered_str[0] == '[')
-        {
-            int idx = 0;
-            const char *p = offered_str + 1;
-            while (*p && *p != ']' && idx < 10)
-            {
-                if (*p >= '0' && *p <= '9')
-                {
-                    out_trade->offered_skins[idx++] = atoi(p);
-                    while (*p >= '0' && *p <= '9')
-                        p++;
-                }
-                else
-                    p++;
-            }
-            // Ensure count matches parsed items
-            if (idx != out_trade->offered_count)
-            {
-                out_trade->offered_count = idx;
-            }
-        }
-        else
-        {
-            // If no valid JSON, reset count
-            out_trade->offered_count = 0;
-        }
-
-        if (requested_str && requested_str[0] == '[')
-        {
-            int idx = 0;
-            const char *p = requested_str + 1;
-            while (*p && *p != ']' && idx < 10)
-            {
-                if (*p >= '0' && *p <= '9')
-                {
-                    out_trade->requested_skins[idx++] = atoi(p);
-                    while (*p >= '0' && *p <= '9')
-                        p++;
-                }
-                else
-                    p++;
-            }
-            // Ensure count matches parsed items
-            if (idx != out_trade->requested_count)
-            {
-                out_trade->requested_count = idx;
-            }
-        }
-        else
-        {
-            // If no valid JSON, reset count
-            out_trade->requested_count = 0;
-        }
-
-        sqlite3_finalize(stmt);
-        return 0;
+        read_trade_row(stmt, out_trade);
+        db_finalize(stmt);
+        return db_read_trade_items(out_trade, 1);
     }
 
-    sqlite3_finalize(stmt);
+    db_finalize(stmt);
     return -1;
 }
 
@@ -1177,58 +1775,42 @@ int db_update_trade(TradeOffer *trade)
     if (!trade)
         return -1;
 
-    // Serialize arrays to JSON strings
-    char offered_str[512] = {0};
-    char requested_str[512] = {0};
-
-    strcat(offered_str, "[");
-    for (int i = 0; i < trade->offered_count; i++)
-    {
-        if (i > 0)
-            strcat(offered_str, ",");
-        char num[16];
-        sprintf(num, "%d", trade->offered_skins[i]);
-        strcat(offered_str, num);
-    }
-    strcat(offered_str, "]");
-
-    strcat(requested_str, "[");
-    for (int i = 0; i < trade->requested_count; i++)
-    {
-        if (i > 0)
-            strcat(requested_str, ",");
-        char num[16];
-        sprintf(num, "%d", trade->requested_skins[i]);
-        strcat(requested_str, num);
-    }
-    strcat(requested_str, "]");
+    const char *sql = "UPDATE trades SET from_user_id = ?, to_user_id = ?, offered_count = ?, offered_cash = ?, "
+                      "requested_count = ?, requested_cash = ?, status = ?, created_at = ?, expires_at = ? "
+                      "WHERE trade_id = ?";
 
-    const char *sql = "UPDATE trades SET from_user_id = ?, to_user_id = ?, offered_skins = ?, offered_count = ?, "
-                      "offered_cash = ?, requested_skins = ?, requested_count = ?, requested_cash = ?, "
-                      "status = ?, created_at = ?, expires_at = ? WHERE trade_id = ?";
+    if (db_savepoint("update_trade") != 0)
+        return -1;
 
     sqlite3_stmt *stmt;
-    int rc = sqlite3_prepare_v2(db, sql, -1, &stmt, 0);
+    int rc = db_prepare(sql, &stmt);
     if (rc != SQLITE_OK)
+    {
+        db_release_savepoint("update_trade", 0);
         return -1;
+    }
 
     sqlite3_bind_int(stmt, 1, trade->from_user_id);
     sqlite3_bind_int(stmt, 2, trade->to_user_id);
-    sqlite3_bind_text(stmt, 3, offered_str, -1, SQLITE_STATIC);
-    sqlite3_bind_int(stmt, 4, trade->offered_count);
-    sqlite3_bind_double(stmt, 5, trade->offered_cash);
-    sqlite3_bind_text(stmt, 6, requested_str, -1, SQLITE_STATIC);
-    sqlite3_bind_int(stmt, 7, trade->requested_count);
-    sqlite3_bind_double(stmt, 8, trade->requested_cash);
-    sqlite3_bind_int(stmt, 9, trade->status);
-    sqlite3_bind_int64(stmt, 10, trade->created_at);
-    sqlite3_bind_int64(stmt, 11, trade->expires_at);
-    sqlite3_bind_int(stmt, 12, trade->trade_id);
+    sqlite3_bind_int(stmt, 3, trade->offered_count);
+    sqlite3_bind_double(stmt, 4, trade->offered_cash);
+    sqlite3_bind_int(stmt, 5, trade->requested_count);
+    sqlite3_bind_double(stmt, 6, trade->requested_cash);
+    sqlite3_bind_int(stmt, 7, trade->status);
+    sqlite3_bind_int64(stmt, 8, trade->created_at);
+    sqlite3_bind_int64(stmt, 9, trade->expires_at);
+    sqlite3_bind_int(stmt, 10, trade->trade_id);
 
     rc = sqlite3_step(stmt);
-    sqlite3_finalize(stmt);
+    db_finalize(stmt);
 
-    return (rc == SQLITE_DONE) ? 0 : -1;
+    if (rc != SQLITE_DONE || db_write_trade_items(trade) != 0)
+    {
+        db_release_savepoint("update_trade", 0);
+        return -1;
+    }
+
+    return db_release_savepoint("update_trade", 1);
 }
 
 int db_get_user_trades(int user_id, TradeOffer *out_trades, int *count)
@@ -1238,9 +1820,10 @@ int db_get_user_trades(int user_id, TradeOffer *out_trades, int *count)
 
     // Get ALL trades (pending, accepted, declined, cancelled, expired) for the user
     // Order by: pending first, then by created_at DESC
-    const char *sql = "SELECT * FROM trades WHERE (from_user_id = ? OR to_user_id = ?) ORDER BY CASE WHEN status = 0 THEN 0 ELSE 1 END, created_at DESC";
+    const char *sql = "SELECT " TRADE_COLUMNS " FROM trades WHERE (from_user_id = ? OR to_user_id = ?) "
+                      "ORDER BY CASE WHEN status = 0 THEN 0 ELSE 1 END, created_at DESC";
     sqlite3_stmt *stmt;
-    int rc = sqlite3_prepare_v2(db, sql, -1, &stmt, 0);
+    int rc = db_prepare(sql, &stmt);
     if (rc != SQLITE_OK)
     {
         *count = 0;
@@ -1253,89 +1836,15 @@ int db_get_user_trades(int user_id, TradeOffer *out_trades, int *count)
     int found = 0;
     while (sqlite3_step(stmt) == SQLITE_ROW && found < 50)
     {
-        TradeOffer *trade = &out_trades[found];
-        // Column order from SELECT * FROM trades:
-        // 0: trade_id, 1: from_user_id, 2: to_user_id, 3: offered_skins, 4: offered_count,
-        // 5: offered_cash, 6: requested_skins, 7: requested_count, 8: requested_cash,
-        // 9: status, 10: created_at, 11: expires_at
-        trade->trade_id = sqlite3_column_int(stmt, 0);
-        trade->from_user_id = sqlite3_column_int(stmt, 1);
-        trade->to_user_id = sqlite3_column_int(stmt, 2);
-
-        const char *offered_str = (char *)sqlite3_column_text(stmt, 3);
-        trade->offered_count = sqlite3_column_int(stmt, 4);
-        trade->offered_cash = sqlite3_column_double(stmt, 5);
-        const char *requested_str = (char *)sqlite3_column_text(stmt, 6);
-        trade->requested_count = sqlite3_column_int(stmt, 7);
-        trade->requested_cash = sqlite3_column_double(stmt, 8);
-        trade->status = (TradeStatus)sqlite3_column_int(stmt, 9);
-        trade->created_at = sqlite3_column_int64(stmt, 10);
-        trade->expires_at = sqlite3_column_int64(stmt, 11);
-
-        // Initialize arrays
-        memset(trade->offered_skins, 0, sizeof(trade->offered_skins));
-        memset(trade->requested_skins, 0, sizeof(trade->requested_skins));
-        
-        // Parse JSON arrays
-        if (offered_str && offered_str[0] == '[')
-        {
-            int idx = 0;
-            const char *p = offered_str + 1;
-            while (*p && *p != ']' && idx < 10)
-            {
-                if (*p >= '0' && *p <= '9')
-                {
-                    trade->offered_skins[idx++] = atoi(p);
-                    while (*p >= '0' && *p <= '9')
-                        p++;
-                }
-                else
-                    p++;
-            }
-            // Ensure count matches parsed items
-            if (idx != trade->offered_count)
-            {
-                trade->offered_count = idx;
-            }
-        }
-        else
-        {
-            // If no valid JSON, reset count
-            trade->offered_count = 0;
-        }
-
-        if (requested_str && requested_str[0] == '[')
-        {
-            int idx = 0;
-            const char *p = requested_str + 1;
-            while (*p && *p != ']' && idx < 10)
-            {
-                if (*p >= '0' && *p <= '9')
-                {
-                    trade->requested_skins[idx++] = atoi(p);
-                    while (*p >= '0' && *p <= '9')
-                        p++;
-                }
-                else
-                    p++;
-            }
-            // Ensure count matches parsed items
-            if (idx != trade->requested_count)
-            {
-                trade->requested_count = idx;
-            }
-        }
-        else
-        {
-            // If no valid JSON, reset count
-            trade->requested_count = 0;
-        }
-
+        read_trade_row(stmt, &out_trades[found]);
         found++;
     }
+    db_finalize(stmt);
+
+    // Items of all returned trades in one query
+    db_read_trade_items(out_trades, found);
 
     *count = found;
-    sqlite3_finalize(stmt);
     return 0;
 }
 
@@ -1350,7 +1859,7 @@ int db_save_listing(MarketListing *listing)
                       "VALUES (?, ?, ?, ?, ?, ?)";
 
     sqlite3_stmt *stmt;
-    int rc = sqlite3_prepare_v2(db, sql, -1, &stmt, 0);
+    int rc = db_prepare(sql, &stmt);
     if (rc != SQLITE_OK)
         return -1;
 
@@ -1362,7 +1871,7 @@ int db_save_listing(MarketListing *listing)
     sqlite3_bind_int(stmt, 6, listing->is_sold);
 
     rc = sqlite3_step(stmt);
-    sqlite3_finalize(stmt);
+    db_finalize(stmt);
 
     return (rc == SQLITE_DONE) ? 0 : -1;
 }
@@ -1374,7 +1883,7 @@ int db_load_listings(MarketListing *out_listings, int *count)
 
     const char *sql = "SELECT * FROM market_listings WHERE is_sold = 0";
     sqlite3_stmt *stmt;
-    int rc = sqlite3_prepare_v2(db, sql, -1, &stmt, 0);
+    int rc = db_prepare(sql, &stmt);
     if (rc != SQLITE_OK)
     {
         *count = 0;
@@ -1395,7 +1904,7 @@ int db_load_listings(MarketListing *out_listings, int *count)
     }
 
     *count = found;
-    sqlite3_finalize(stmt);
+    db_finalize(stmt);
     return 0;
 }
 
@@ -1407,7 +1916,7 @@ int db_update_listing(MarketListing *listing)
     const char *sql = "UPDATE market_listings SET seller_id = ?, skin_id = ?, price = ?, listed_at = ?, is_sold = ? WHERE listing_id = ?";
 
     sqlite3_stmt *stmt;
-    int rc = sqlite3_prepare_v2(db, sql, -1, &stmt, 0);
+    int rc = db_prepare(sql, &stmt);
     if (rc != SQLITE_OK)
         return -1;
 
@@ -1419,7 +1928,7 @@ int db_update_listing(MarketListing *listing)
     sqlite3_bind_int(stmt, 6, listing->listing_id);
 
     rc = sqlite3_step(stmt);
-    sqlite3_finalize(stmt);
+    db_finalize(stmt);
 
     return (rc == SQLITE_DONE) ? 0 : -1;
 }
@@ -1443,7 +1952,7 @@ int db_log_transaction(TransactionLog *log)
                       "VALUES (?, ?, ?, ?)";
 
     sqlite3_stmt *stmt;
-    int rc = sqlite3_prepare_v2(db, sql, -1, &stmt, 0);
+    int rc = db_prepare(sql, &stmt);
     if (rc != SQLITE_OK)
     {
         fprintf(stderr, "db_log_transaction: sqlite3_prepare_v2 failed: %s\n", sqlite3_errmsg(db));
@@ -1460,14 +1969,63 @@ int db_log_transaction(TransactionLog *log)
     if (rc != SQLITE_DONE)
     {
         fprintf(stderr, "db_log_transaction: sqlite3_step failed: %s (rc=%d)\n", sqlite3_errmsg(db), rc);
-        sqlite3_finalize(stmt);
+        db_finalize(stmt);
         return -1;
     }
     
-    sqlite3_finalize(stmt);
+    db_finalize(stmt);
     return 0;
 }
 
+static int insert_ledger_row(const LedgerEntry *entry)
+{
+    sqlite3_stmt *stmt;
+    if (db_prepare("INSERT INTO ledger (log_id, user_id, kind, amount, cost, fee, instance_id, counterparty_id, "
+                   "definition_id, timestamp) VALUES (?, ?, ?, ?, ?, ?, ?, ?, ?, ?)",
+                   &stmt) != SQLITE_OK)
+        return -1;
+    sqlite3_bind_int(stmt, 1, entry->log_id);
+    sqlite3_bind_int(stmt, 2, entry->user_id);
+    sqlite3_bind_int(stmt, 3, entry->kind);
+    sqlite3_bind_double(stmt, 4, entry->amount);
+    sqlite3_bind_double(stmt, 5, entry->cost);
+    sqlite3_bind_double(stmt, 6, entry->fee);
+    sqlite3_bind_int(stmt, 7, entry->instance_id);
+    sqlite3_bind_int(stmt, 8, entry->counterparty_id);
+    sqlite3_bind_int(stmt, 9, entry->definition_id);
+    sqlite3_bind_int64(stmt, 10, entry->timestamp);
+    int rc = sqlite3_step(stmt);
+    db_finalize(stmt);
+    return rc == SQLITE_DONE ? 0 : -1;
+}
+
+int db_log_ledger(TransactionLog *log, const LedgerEntry *entry)
+{
+    if (!log || !entry)
+        return -1;
+
+    if (db_savepoint("log_ledger") != 0)
+        return -1;
+    if (db_log_transaction(log) != 0)
+    {
+        db_release_savepoint("log_ledger", 0);
+        return -1;
+    }
+    log->log_id = (int)sqlite3_last_insert_rowid(db);
+
+    LedgerEntry row = *entry;
+    row.log_id = log->log_id;
+    row.kind = log->type;
+    row.user_id = log->user_id;
+    row.timestamp = log->timestamp;
+    if (insert_ledger_row(&row) != 0)
+    {
+        db_release_savepoint("log_ledger", 0);
+        return -1;
+    }
+    return db_release_savepoint("log_ledger", 1);
+}
+
 // ==================== SESSION OPERATIONS ====================
 
 int db_save_session(Session *session)
@@ -1479,7 +2037,7 @@ int db_save_session(Session *session)
                       "VALUES (?, ?, ?, ?, ?, ?)";
 
     sqlite3_stmt *stmt;
-    int rc = sqlite3_prepare_v2(db, sql, -1, &stmt, 0);
+    int rc = db_prepare(sql, &stmt);
     if (rc != SQLITE_OK)
         return -1;
 
@@ -1491,7 +2049,7 @@ int db_save_session(Session *session)
     sqlite3_bind_int(stmt, 6, session->is_active);
 
     rc = sqlite3_step(stmt);
-    sqlite3_finalize(stmt);
+    db_finalize(stmt);
 
     return (rc == SQLITE_DONE) ? 0 : -1;
 }
@@ -1503,7 +2061,7 @@ int db_load_session(const char *token, Session *out_session)
 
     const char *sql = "SELECT * FROM sessions WHERE session_token = ?";
     sqlite3_stmt *stmt;
-    int rc = sqlite3_prepare_v2(db, sql, -1, &stmt, 0);
+    int rc = db_prepare(sql, &stmt);
     if (rc != SQLITE_OK)
         return -1;
 
@@ -1518,11 +2076,11 @@ int db_load_session(const char *token, Session *out_session)
         out_session->last_activity = sqlite3_column_int64(stmt, 4);
         out_session->is_active = sqlite3_column_int(stmt, 5);
 
-        sqlite3_finalize(stmt);
+        db_finalize(stmt);
         return 0;
     }
 
-    sqlite3_finalize(stmt);
+    db_finalize(stmt);
     return -1;
 }
 
@@ -1533,14 +2091,14 @@ int db_delete_session(const char *token)
 
     const char *sql = "DELETE FROM sessions WHERE session_token = ?";
     sqlite3_stmt *stmt;
-    int rc = sqlite3_prepare_v2(db, sql, -1, &stmt, 0);
+    int rc = db_prepare(sql, &stmt);
     if (rc != SQLITE_OK)
         return -1;
 
     sqlite3_bind_text(stmt, 1, token, -1, SQLITE_STATIC);
 
     rc = sqlite3_step(stmt);
-    sqlite3_finalize(stmt);
+    db_finalize(stmt);
 
     return (rc == SQLITE_DONE) ? 0 : -1;
 }
@@ -1552,9 +2110,20 @@ int db_load_skin_definition(int definition_id, char *name, float *base_price)
     if (!name || !base_price)
         return -1;
 
+    const PricingCatalog *catalog = pricing_catalog_get();
+    if (catalog)
+    {
+        const CatalogDefinition *def;
+        if (pricing_catalog_definition(catalog, definition_id, &def) != 0)
+            return -1;
+        memcpy(name, def->name, MAX_ITEM_NAME_LEN);
+        *base_price = def->base_price;
+        return 0;
+    }
+
     const char *sql = "SELECT name, base_price FROM skin_definitions WHERE definition_id = ?";
     sqlite3_stmt *stmt;
-    int rc = sqlite3_prepare_v2(db, sql, -1, &stmt, 0);
+    int rc = db_prepare(sql, &stmt);
     if (rc != SQLITE_OK)
         return -1;
 
@@ -1572,11 +2141,11 @@ int db_load_skin_definition(int definition_id, char *name, float *base_price)
             name[0] = '\0';
         }
         *base_price = (float)sqlite3_column_double(stmt, 1);
-        sqlite3_finalize(stmt);
+        db_finalize(stmt);
         return 0;
     }
 
-    sqlite3_finalize(stmt);
+    db_finalize(stmt);
     return -1;
 }
 
@@ -1589,9 +2158,21 @@ int db_load_skin_definition_with_rarity(int definition_id, char *name, float *ba
     if (!db)
         return -1;
 
+    const PricingCatalog *catalog = pricing_catalog_get();
+    if (catalog)
+    {
+        const CatalogDefinition *def;
+        if (pricing_catalog_definition(catalog, definition_id, &def) != 0)
+            return -1;
+        memcpy(name, def->name, MAX_ITEM_NAME_LEN);
+        *base_price = def->base_price;
+        *rarity = def->rarity;
+        return 0;
+    }
+
     const char *sql = "SELECT name, base_price, rarity FROM skin_definitions WHERE definition_id = ?";
     sqlite3_stmt *stmt;
-    int rc = sqlite3_prepare_v2(db, sql, -1, &stmt, 0);
+    int rc = db_prepare(sql, &stmt);
     if (rc != SQLITE_OK)
         return -1;
 
@@ -1604,11 +2185,11 @@ int db_load_skin_definition_with_rarity(int definition_id, char *name, float *ba
         *base_price = (float)sqlite3_column_double(stmt, 1);
         *rarity = (SkinRarity)sqlite3_column_int(stmt, 2);
         
-        sqlite3_finalize(stmt);
+        db_finalize(stmt);
         return 0;
     }
 
-    sqlite3_finalize(stmt);
+    db_finalize(stmt);
     return -1;
 }
 
@@ -1625,7 +2206,7 @@ int db_get_case_skins_by_rarity(int case_id, SkinRarity rarity, int *definition_
                       "INNER JOIN skin_definitions sd ON cs.definition_id = sd.definition_id "
                       "WHERE cs.case_id = ? AND sd.rarity = ?";
     sqlite3_stmt *stmt;
-    int rc = sqlite3_prepare_v2(db, sql, -1, &stmt, 0);
+    int rc = db_prepare(sql, &stmt);
     if (rc != SQLITE_OK)
     {
         *count = 0;
@@ -1643,7 +2224,7 @@ int db_get_case_skins_by_rarity(int case_id, SkinRarity rarity, int *definition_
     }
 
     *count = idx;
-    sqlite3_finalize(stmt);
+    db_finalize(stmt);
     return 0;
 }
 
@@ -1654,7 +2235,7 @@ int db_load_skin_instance(int instance_id, int *definition_id, SkinRarity *rarit
 
     const char *sql = "SELECT definition_id, rarity, wear, pattern_seed, is_stattrak, owner_id, acquired_at, is_tradable FROM skin_instances WHERE instance_id = ?";
     sqlite3_stmt *stmt;
-    int rc = sqlite3_prepare_v2(db, sql, -1, &stmt, 0);
+    int rc = db_prepare(sql, &stmt);
     if (rc != SQLITE_OK)
         return -1;
 
@@ -1670,14 +2251,189 @@ int db_load_skin_instance(int instance_id, int *definition_id, SkinRarity *rarit
         *owner_id = sqlite3_column_int(stmt, 5);
         *acquired_at = sqlite3_column_int64(stmt, 6);
         *is_tradable = sqlite3_column_int(stmt, 7);
-        sqlite3_finalize(stmt);
+        db_finalize(stmt);
         return 0;
     }
 
-    sqlite3_finalize(stmt);
+    db_finalize(stmt);
     return -1;
 }
 
+// Columns read by read_instance_record, after any leading columns of the query
+#define INSTANCE_RECORD_COLUMNS "si.instance_id, si.definition_id, si.rarity, si.wear, si.pattern_seed, " \
+                                "si.is_stattrak, si.owner_id, si.acquired_at, si.is_tradable, " \
+                                "sd.name, sd.base_price, sd.rarity"
+
+// Fill rec from INSTANCE_RECORD_COLUMNS starting at column col
+static void read_instance_record(sqlite3_stmt *stmt, int col, SkinInstanceRecord *rec)
+{
+    rec->instance_id = sqlite3_column_int(stmt, col);
+    rec->definition_id = sqlite3_column_int(stmt, col + 1);
+    rec->rarity = (SkinRarity)sqlite3_column_int(stmt, col + 2);
+    rec->wear = (WearCondition)sqlite3_column_double(stmt, col + 3); // REAL column
+    rec->pattern_seed = sqlite3_column_int(stmt, col + 4);
+    rec->is_stattrak = sqlite3_column_int(stmt, col + 5);
+    rec->owner_id = sqlite3_column_int(stmt, col + 6);
+    rec->acquired_at = sqlite3_column_int64(stmt, col + 7);
+    rec->is_tradable = sqlite3_column_int(stmt, col + 8);
+    const char *name = (const char *)sqlite3_column_text(stmt, col + 9);
+    strncpy(rec->name, name ? name : "", MAX_ITEM_NAME_LEN - 1);
+    rec->name[MAX_ITEM_NAME_LEN - 1] = '\0';
+    rec->base_price = (float)sqlite3_column_double(stmt, col + 10);
+    rec->definition_rarity = sqlite3_column_type(stmt, col + 11) == SQLITE_NULL
+                                 ? rec->rarity
+                                 : (SkinRarity)sqlite3_column_int(stmt, col + 11);
+}
+
+// Load skin instances in chunks of DB_BATCH_MAX_IDS, each bound as one fixed-width IN list.
+// Rows come back in no particular order, so each is placed at the positions that asked for it.
+int db_load_skin_instances(const int *instance_ids, int count, SkinInstanceRecord *out_records, int *out_found)
+{
+    if (out_found)
+        *out_found = 0;
+    if (!instance_ids || !out_records || count < 0)
+        return -1;
+
+    memset(out_records, 0, sizeof(SkinInstanceRecord) * (size_t)count);
+    if (count == 0)
+        return 0;
+
+    char placeholders[DB_BATCH_MAX_IDS * 3];
+    batch_placeholders(placeholders);
+
+    char sql[512 + sizeof(placeholders)];
+    snprintf(sql, sizeof(sql),
+             "SELECT " INSTANCE_RECORD_COLUMNS " "
+             "FROM skin_instances si "
+             "LEFT JOIN skin_definitions sd ON sd.definition_id = si.definition_id "
+             "WHERE si.instance_id IN (%s)",
+             placeholders);
+
+    int found = 0;
+
+    for (int start = 0; start < count; start += DB_BATCH_MAX_IDS)
+    {
+        int chunk = count - start;
+        if (chunk > DB_BATCH_MAX_IDS)
+            chunk = DB_BATCH_MAX_IDS;
+
+        sqlite3_stmt *stmt;
+        if (db_prepare(sql, &stmt) != SQLITE_OK)
+            return -1;
+
+        bind_batch_ids(stmt, 1, instance_ids + start, chunk);
+
+        int rc;
+        while ((rc = sqlite3_step(stmt)) == SQLITE_ROW)
+        {
+            SkinInstanceRecord rec;
+            read_instance_record(stmt, 0, &rec);
+
+            // An id listed twice gets a copy at each position
+            for (int i = 0; i < chunk; i++)
+            {
+                if (instance_ids[start + i] == rec.instance_id)
+                {
+                    out_records[start + i] = rec;
+                    found++;
+                }
+            }
+        }
+
+        db_finalize(stmt);
+        if (rc != SQLITE_DONE)
+            return -1;
+    }
+
+    if (out_found)
+        *out_found = found;
+    return 0;
+}
+
+int db_load_inventory_instances(int user_id, SkinInstanceRecord *out_records, int *count)
+{
+    if (!out_records || !count)
+        return -1;
+
+    *count = 0;
+
+    const char *sql = "SELECT " INSTANCE_RECORD_COLUMNS " "
+                      "FROM inventories inv "
+                      "JOIN skin_instances si ON si.instance_id = inv.instance_id "
+                      "LEFT JOIN skin_definitions sd ON sd.definition_id = si.definition_id "
+                      "WHERE inv.user_id = ? ORDER BY inv.inventory_id LIMIT ?";
+    sqlite3_stmt *stmt;
+    if (db_prepare(sql, &stmt) != SQLITE_OK)
+        return -1;
+
+    sqlite3_bind_int(stmt, 1, user_id);
+    sqlite3_bind_int(stmt, 2, MAX_INVENTORY_SIZE);
+
+    int n = 0;
+    int rc;
+    while ((rc = sqlite3_step(stmt)) == SQLITE_ROW && n < MAX_INVENTORY_SIZE)
+    {
+        read_instance_record(stmt, 0, &out_records[n]);
+        n++;
+    }
+
+    db_finalize(stmt);
+    if (rc != SQLITE_DONE && rc != SQLITE_ROW)
+        return -1;
+
+    *count = n;
+    return 0;
+}
+
+int db_create_owned_instances(int owner_id, const SkinInstanceRecord *items, int count, int *out_instance_ids)
+{
+    if (!db || !items || !out_instance_ids || count <= 0)
+        return -1;
+
+    sqlite3_stmt *insert_instance, *insert_inventory;
+    if (db_prepare("INSERT INTO skin_instances (definition_id, rarity, wear, pattern_seed, is_stattrak, owner_id, acquired_at, is_tradable) "
+                   "VALUES (?, ?, ?, ?, ?, ?, ?, 1)",
+                   &insert_instance) != SQLITE_OK)
+        return -1;
+    if (db_prepare("INSERT OR IGNORE INTO inventories (user_id, instance_id) VALUES (?, ?)", &insert_inventory) != SQLITE_OK)
+    {
+        db_finalize(insert_instance);
+        return -1;
+    }
+
+    // Both statements are bound once per row and reset, never re-prepared
+    time_t now = time(NULL);
+    sqlite3_bind_int(insert_instance, 6, owner_id);
+    sqlite3_bind_int64(insert_instance, 7, now);
+    sqlite3_bind_int(insert_inventory, 1, owner_id);
+
+    int result = 0;
+    for (int i = 0; i < count && result == 0; i++)
+    {
+        sqlite3_bind_int(insert_instance, 1, items[i].definition_id);
+        sqlite3_bind_int(insert_instance, 2, items[i].rarity);
+        sqlite3_bind_double(insert_instance, 3, items[i].wear);
+        sqlite3_bind_int(insert_instance, 4, items[i].pattern_seed);
+        sqlite3_bind_int(insert_instance, 5, items[i].is_stattrak);
+        if (sqlite3_step(insert_instance) != SQLITE_DONE)
+        {
+            result = -1;
+            break;
+        }
+        sqlite3_reset(insert_instance);
+        out_instance_ids[i] = (int)sqlite3_last_insert_rowid(db);
+
+        sqlite3_bind_int(insert_inventory, 2, out_instance_ids[i]);
+        if (sqlite3_step(insert_inventory) != SQLITE_DONE)
+            result = -1;
+        sqlite3_reset(insert_inventory);
+    }
+
+    db_finalize(insert_instance);
+    db_finalize(insert_inventory);
+    return result;
+}
+
 int db_create_skin_instance(int definition_id, SkinRarity rarity, WearCondition wear, int pattern_seed, int is_stattrak, int owner_id, int *out_instance_id)
 {
     if (!out_instance_id)
@@ -1689,7 +2445,7 @@ int db_create_skin_instance(int definition_id, SkinRarity rarity, WearCondition
     const char *sql = "INSERT INTO skin_instances (definition_id, rarity, wear, pattern_seed, is_stattrak, owner_id, acquired_at, is_tradable) "
                       "VALUES (?, ?, ?, ?, ?, ?, ?, 1)"; // Default is_tradable = 1 (tradable)
     sqlite3_stmt *stmt;
-    int rc = sqlite3_prepare_v2(db, sql, -1, &stmt, 0);
+    int rc = db_prepare(sql, &stmt);
     if (rc != SQLITE_OK)
         return -1;
 
@@ -1705,11 +2461,11 @@ int db_create_skin_instance(int definition_id, SkinRarity rarity, WearCondition
     if (rc == SQLITE_DONE)
     {
         *out_instance_id = (int)sqlite3_last_insert_rowid(db);
-        sqlite3_finalize(stmt);
+        db_finalize(stmt);
         return 0;
     }
 
-    sqlite3_finalize(stmt);
+    db_finalize(stmt);
     return -1;
 }
 
@@ -1717,7 +2473,7 @@ int db_update_skin_instance_owner(int instance_id, int new_owner_id)
 {
     const char *sql = "UPDATE skin_instances SET owner_id = ? WHERE instance_id = ?";
     sqlite3_stmt *stmt;
-    int rc = sqlite3_prepare_v2(db, sql, -1, &stmt, 0);
+    int rc = db_prepare(sql, &stmt);
     if (rc != SQLITE_OK)
         return -1;
 
@@ -1725,7 +2481,7 @@ int db_update_skin_instance_owner(int instance_id, int new_owner_id)
     sqlite3_bind_int(stmt, 2, instance_id);
 
     rc = sqlite3_step(stmt);
-    sqlite3_finalize(stmt);
+    db_finalize(stmt);
 
     return (rc == SQLITE_DONE) ? 0 : -1;
 }
@@ -1735,11 +2491,15 @@ int db_get_wear_multiplier(WearCondition wear_float, float *multiplier)
     if (!multiplier || wear_float < 0.0f || wear_float > 1.0f)
         return -1;
 
+    const PricingCatalog *catalog = pricing_catalog_get();
+    if (catalog)
+        return pricing_catalog_wear_multiplier(catalog, wear_float, multiplier);
+
     // Find multiplier based on float range
     // Special case: wear = 1.00 should match BS range (0.45-1.00 inclusive)
     const char *sql = "SELECT multiplier FROM wear_multipliers WHERE ? >= wear_min AND (? <= wear_max OR (wear_max = 1.0 AND ? = 1.0)) LIMIT 1";
     sqlite3_stmt *stmt;
-    int rc = sqlite3_prepare_v2(db, sql, -1, &stmt, 0);
+    int rc = db_prepare(sql, &stmt);
     if (rc != SQLITE_OK)
         return -1;
 
@@ -1750,11 +2510,11 @@ int db_get_wear_multiplier(WearCondition wear_float, float *multiplier)
     if (sqlite3_step(stmt) == SQLITE_ROW)
     {
         *multiplier = sqlite3_column_double(stmt, 0);
-        sqlite3_finalize(stmt);
+        db_finalize(stmt);
         return 0;
     }
 
-    sqlite3_finalize(stmt);
+    db_finalize(stmt);
     return -1;
 }
 
@@ -1763,9 +2523,13 @@ int db_get_rarity_multiplier(SkinRarity rarity, float *multiplier)
     if (!multiplier)
         return -1;
 
+    const PricingCatalog *catalog = pricing_catalog_get();
+    if (catalog)
+        return pricing_catalog_rarity_multiplier(catalog, rarity, multiplier);
+
     const char *sql = "SELECT multiplier FROM rarity_multipliers WHERE rarity = ?";
     sqlite3_stmt *stmt;
-    int rc = sqlite3_prepare_v2(db, sql, -1, &stmt, 0);
+    int rc = db_prepare(sql, &stmt);
     if (rc != SQLITE_OK)
         return -1;
 
@@ -1774,16 +2538,21 @@ int db_get_rarity_multiplier(SkinRarity rarity, float *multiplier)
     if (sqlite3_step(stmt) == SQLITE_ROW)
     {
         *multiplier = (float)sqlite3_column_double(stmt, 0);
-        sqlite3_finalize(stmt);
+        db_finalize(stmt);
         return 0;
     }
 
-    sqlite3_finalize(stmt);
+    db_finalize(stmt);
     return -1;
 }
 
 float db_calculate_skin_price(int definition_id, SkinRarity rarity, WearCondition wear)
 {
+    // Served from memory; the SQL lookups below only run if the catalog could not be loaded
+    const PricingCatalog *catalog = pricing_catalog_get();
+    if (catalog)
+        return pricing_catalog_price(catalog, definition_id, rarity, wear);
+
     char name[MAX_ITEM_NAME_LEN];
     float base_price;
     float rarity_mult;
@@ -1809,7 +2578,7 @@ int db_get_case_skins(int case_id, int *definition_ids, int *count)
 
     const char *sql = "SELECT DISTINCT definition_id FROM case_skins WHERE case_id = ?";
     sqlite3_stmt *stmt;
-    int rc = sqlite3_prepare_v2(db, sql, -1, &stmt, 0);
+    int rc = db_prepare(sql, &stmt);
     if (rc != SQLITE_OK)
     {
         *count = 0;
@@ -1826,7 +2595,7 @@ int db_get_case_skins(int case_id, int *definition_ids, int *count)
     }
 
     *count = idx;
-    sqlite3_finalize(stmt);
+    db_finalize(stmt);
     return 0;
 }
 
@@ -1845,7 +2614,7 @@ int db_fetch_full_case_info(int case_id, void *out_skins, int *out_count)
                       "ORDER BY sd.definition_id";
 
     sqlite3_stmt *stmt;
-    int rc = sqlite3_prepare_v2(db, sql, -1, &stmt, 0);
+    int rc = db_prepare(sql, &stmt);
     if (rc != SQLITE_OK)
     {
         *out_count = 0;
@@ -1878,90 +2647,29 @@ int db_fetch_full_case_info(int case_id, void *out_skins, int *out_count)
     }
 
     *out_count = idx;
-    sqlite3_finalize(stmt);
+    db_finalize(stmt);
     return 0;
 }
 
-// Check if instance is in any pending trade
+// Check if instance is in any pending trade (index probe on trade_items.instance_id)
 int db_is_instance_in_pending_trade(int instance_id)
 {
     if (!db || instance_id <= 0)
         return 0; // Not in trade if invalid
 
-    // Check if instance is in any pending trade (either offered or requested)
-    const char *sql = "SELECT COUNT(*) FROM trades WHERE status = ? AND (offered_skins LIKE ? OR requested_skins LIKE ?)";
+    const char *sql = "SELECT 1 FROM trade_items ti JOIN trades t ON t.trade_id = ti.trade_id "
+                      "WHERE ti.instance_id = ? AND t.status = ? LIMIT 1";
     sqlite3_stmt *stmt;
-    int rc = sqlite3_prepare_v2(db, sql, -1, &stmt, 0);
+    int rc = db_prepare(sql, &stmt);
     if (rc != SQLITE_OK)
         return 0; // Assume not in trade if query fails
 
-    sqlite3_bind_int(stmt, 1, TRADE_PENDING);
-
-    // Build LIKE pattern: [instance_id] or [instance_id, or ,instance_id, or ,instance_id]
-    char pattern1[64], pattern2[64], pattern3[64], pattern4[64];
-    snprintf(pattern1, sizeof(pattern1), "[%d]", instance_id);
-    snprintf(pattern2, sizeof(pattern2), "[%d,", instance_id);
-    snprintf(pattern3, sizeof(pattern3), ",%d,", instance_id);
-    snprintf(pattern4, sizeof(pattern4), ",%d]", instance_id);
-
-    // Check offered_skins
-    sqlite3_bind_text(stmt, 2, pattern1, -1, SQLITE_STATIC);
-    sqlite3_bind_text(stmt, 3, pattern1, -1, SQLITE_STATIC);
-
-    int result = 0;
-    if (sqlite3_step(stmt) == SQLITE_ROW)
-    {
-        result = sqlite3_column_int(stmt, 0);
-    }
-    sqlite3_finalize(stmt);
-
-    if (result > 0)
-        return 1;
-
-    // Also check with other patterns
-    rc = sqlite3_prepare_v2(db, sql, -1, &stmt, 0);
-    if (rc == SQLITE_OK)
-    {
-        sqlite3_bind_int(stmt, 1, TRADE_PENDING);
-        sqlite3_bind_text(stmt, 2, pattern2, -1, SQLITE_STATIC);
-        sqlite3_bind_text(stmt, 3, pattern2, -1, SQLITE_STATIC);
-        if (sqlite3_step(stmt) == SQLITE_ROW && sqlite3_column_int(stmt, 0) > 0)
-        {
-            sqlite3_finalize(stmt);
-            return 1;
-        }
-        sqlite3_finalize(stmt);
-    }
-
-    rc = sqlite3_prepare_v2(db, sql, -1, &stmt, 0);
-    if (rc == SQLITE_OK)
-    {
-        sqlite3_bind_int(stmt, 1, TRADE_PENDING);
-        sqlite3_bind_text(stmt, 2, pattern3, -1, SQLITE_STATIC);
-        sqlite3_bind_text(stmt, 3, pattern3, -1, SQLITE_STATIC);
-        if (sqlite3_step(stmt) == SQLITE_ROW && sqlite3_column_int(stmt, 0) > 0)
-        {
-            sqlite3_finalize(stmt);
-            return 1;
-        }
-        sqlite3_finalize(stmt);
-    }
-
-    rc = sqlite3_prepare_v2(db, sql, -1, &stmt, 0);
-    if (rc == SQLITE_OK)
-    {
-        sqlite3_bind_int(stmt, 1, TRADE_PENDING);
-        sqlite3_bind_text(stmt, 2, pattern4, -1, SQLITE_STATIC);
-        sqlite3_bind_text(stmt, 3, pattern4, -1, SQLITE_STATIC);
-        if (sqlite3_step(stmt) == SQLITE_ROW && sqlite3_column_int(stmt, 0) > 0)
-        {
-            sqlite3_finalize(stmt);
-            return 1;
-        }
-        sqlite3_finalize(stmt);
-    }
+    sqlite3_bind_int(stmt, 1, instance_id);
+    sqlite3_bind_int(stmt, 2, TRADE_PENDING);
 
-    return 0; // Not in any pending trade
+    int result = (sqlite3_step(stmt) == SQLITE_ROW);
+    db_finalize(stmt);
+    return result;
 }
 
 // ==================== MARKET LISTINGS V2 OPERATIONS ====================
@@ -1977,7 +2685,7 @@ int db_save_listing_v2(int seller_id, int instance_id, float price, int *out_lis
     const char *sql = "INSERT INTO market_listings_v2 (seller_id, instance_id, price, listed_at, is_sold) "
                       "VALUES (?, ?, ?, ?, 0)";
     sqlite3_stmt *stmt;
-    int rc = sqlite3_prepare_v2(db, sql, -1, &stmt, 0);
+    int rc = db_prepare(sql, &stmt);
     if (rc != SQLITE_OK)
         return -1;
 
@@ -1990,11 +2698,11 @@ int db_save_listing_v2(int seller_id, int instance_id, float price, int *out_lis
     if (rc == SQLITE_DONE)
     {
         *out_listing_id = (int)sqlite3_last_insert_rowid(db);
-        sqlite3_finalize(stmt);
+        db_finalize(stmt);
         return 0;
     }
 
-    sqlite3_finalize(stmt);
+    db_finalize(stmt);
     return -1;
 }
 
@@ -2006,7 +2714,7 @@ int db_load_listings_v2(MarketListing *out_listings, int *count)
     const char *sql = "SELECT listing_id, seller_id, instance_id, price, listed_at, is_sold "
                       "FROM market_listings_v2 WHERE is_sold = 0 ORDER BY listed_at DESC";
     sqlite3_stmt *stmt;
-    int rc = sqlite3_prepare_v2(db, sql, -1, &stmt, 0);
+    int rc = db_prepare(sql, &stmt);
     if (rc != SQLITE_OK)
     {
         *count = 0;
@@ -2027,7 +2735,7 @@ int db_load_listings_v2(MarketListing *out_listings, int *count)
     }
 
     *count = found;
-    sqlite3_finalize(stmt);
+    db_finalize(stmt);
     return 0;
 }
 
@@ -2045,7 +2753,7 @@ int db_search_listings_by_name(const char *search_term, MarketListing *out_listi
                       "ORDER BY ml.listed_at DESC";
 
     sqlite3_stmt *stmt;
-    int rc = sqlite3_prepare_v2(db, sql, -1, &stmt, 0);
+    int rc = db_prepare(sql, &stmt);
     if (rc != SQLITE_OK)
     {
         *count = 0;
@@ -2071,7 +2779,7 @@ int db_search_listings_by_name(const char *search_term, MarketListing *out_listi
     }
 
     *count = found;
-    sqlite3_finalize(stmt);
+    db_finalize(stmt);
     return 0;
 }
 
@@ -2082,7 +2790,7 @@ int db_get_listing_v2(int listing_id, int *seller_id, int *instance_id, float *p
 
     const char *sql = "SELECT seller_id, instance_id, price, is_sold FROM market_listings_v2 WHERE listing_id = ?";
     sqlite3_stmt *stmt;
-    int rc = sqlite3_prepare_v2(db, sql, -1, &stmt, 0);
+    int rc = db_prepare(sql, &stmt);
     if (rc != SQLITE_OK)
         return -1;
 
@@ -2094,11 +2802,11 @@ int db_get_listing_v2(int listing_id, int *seller_id, int *instance_id, float *p
         *instance_id = sqlite3_column_int(stmt, 1);
         *price = sqlite3_column_double(stmt, 2);
         *is_sold = sqlite3_column_int(stmt, 3);
-        sqlite3_finalize(stmt);
+        db_finalize(stmt);
         return 0;
     }
 
-    sqlite3_finalize(stmt);
+    db_finalize(stmt);
     return -1;
 }
 
@@ -2106,14 +2814,14 @@ int db_mark_listing_sold(int listing_id)
 {
     const char *sql = "UPDATE market_listings_v2 SET is_sold = 1 WHERE listing_id = ?";
     sqlite3_stmt *stmt;
-    int rc = sqlite3_prepare_v2(db, sql, -1, &stmt, 0);
+    int rc = db_prepare(sql, &stmt);
     if (rc != SQLITE_OK)
         return -1;
 
     sqlite3_bind_int(stmt, 1, listing_id);
 
     rc = sqlite3_step(stmt);
-    sqlite3_finalize(stmt);
+    db_finalize(stmt);
 
     return (rc == SQLITE_DONE) ? 0 : -1;
 }
@@ -2122,14 +2830,14 @@ int db_remove_listing_v2(int listing_id)
 {
     const char *sql = "DELETE FROM market_listings_v2 WHERE listing_id = ?";
     sqlite3_stmt *stmt;
-    int rc = sqlite3_prepare_v2(db, sql, -1, &stmt, 0);
+    int rc = db_prepare(sql, &stmt);
     if (rc != SQLITE_OK)
         return -1;
 
     sqlite3_bind_int(stmt, 1, listing_id);
 
     rc = sqlite3_step(stmt);
-    sqlite3_finalize(stmt);
+    db_finalize(stmt);
 
     return (rc == SQLITE_DONE) ? 0 : -1;
 }
@@ -2143,7 +2851,7 @@ int db_load_user_listing_history(int user_id, MarketListing *out_listings, int *
     const char *sql = "SELECT listing_id, seller_id, instance_id, price, listed_at, is_sold "
                       "FROM market_listings_v2 WHERE seller_id = ? ORDER BY listed_at DESC LIMIT 100";
     sqlite3_stmt *stmt;
-    int rc = sqlite3_prepare_v2(db, sql, -1, &stmt, 0);
+    int rc = db_prepare(sql, &stmt);
     if (rc != SQLITE_OK)
     {
         *count = 0;
@@ -2166,7 +2874,7 @@ int db_load_user_listing_history(int user_id, MarketListing *out_listings, int *
     }
 
     *count = found;
-    sqlite3_finalize(stmt);
+    db_finalize(stmt);
     return 0;
 }
 
@@ -2179,7 +2887,7 @@ int db_check_trade_lock(int instance_id, int *is_locked)
 
     const char *sql = "SELECT is_tradable, acquired_at FROM skin_instances WHERE instance_id = ?";
     sqlite3_stmt *stmt;
-    int rc = sqlite3_prepare_v2(db, sql, -1, &stmt, 0);
+    int rc = db_prepare(sql, &stmt);
     if (rc != SQLITE_OK)
         return -1;
 
@@ -2201,11 +2909,11 @@ int db_check_trade_lock(int instance_id, int *is_locked)
             *is_locked = 0;
         }
 
-        sqlite3_finalize(stmt);
+        db_finalize(stmt);
         return 0;
     }
 
-    sqlite3_finalize(stmt);
+    db_finalize(stmt);
     return -1;
 }
 
@@ -2213,7 +2921,7 @@ int db_apply_trade_lock(int instance_id)
 {
     const char *sql = "UPDATE skin_instances SET is_tradable = 0, acquired_at = ? WHERE instance_id = ?";
     sqlite3_stmt *stmt;
-    int rc = sqlite3_prepare_v2(db, sql, -1, &stmt, 0);
+    int rc = db_prepare(sql, &stmt);
     if (rc != SQLITE_OK)
         return -1;
 
@@ -2221,7 +2929,7 @@ int db_apply_trade_lock(int instance_id)
     sqlite3_bind_int(stmt, 2, instance_id);
 
     rc = sqlite3_step(stmt);
-    sqlite3_finalize(stmt);
+    db_finalize(stmt);
 
     return (rc == SQLITE_DONE) ? 0 : -1;
 }
@@ -2234,7 +2942,7 @@ int db_unlock_expired_trades()
 
     const char *sql = "UPDATE skin_instances SET is_tradable = 1 WHERE is_tradable = 0 AND acquired_at <= ?";
     sqlite3_stmt *stmt;
-    int rc = sqlite3_prepare_v2(db, sql, -1, &stmt, 0);
+    int rc = db_prepare(sql, &stmt);
     if (rc != SQLITE_OK)
         return -1;
 
@@ -2242,7 +2950,7 @@ int db_unlock_expired_trades()
 
     rc = sqlite3_step(stmt);
     int changes = sqlite3_changes(db);
-    sqlite3_finalize(stmt);
+    db_finalize(stmt);
 
     return changes;
 }
@@ -2253,7 +2961,7 @@ int db_clean_expired_trades()
 
     const char *sql = "UPDATE trades SET status = ? WHERE status = ? AND expires_at < ?";
     sqlite3_stmt *stmt;
-    int rc = sqlite3_prepare_v2(db, sql, -1, &stmt, 0);
+    int rc = db_prepare(sql, &stmt);
     if (rc != SQLITE_OK)
         return -1;
 
@@ -2263,7 +2971,7 @@ int db_clean_expired_trades()
 
     rc = sqlite3_step(stmt);
     int changes = sqlite3_changes(db);
-    sqlite3_finalize(stmt);
+    db_finalize(stmt);
 
     return changes;
 }
@@ -2357,7 +3065,7 @@ int db_load_cases(Case *out_cases, int *count)
                       "GROUP BY c.case_id, c.name, c.price "
                       "ORDER BY c.case_id";
     sqlite3_stmt *stmt;
-    int rc = sqlite3_prepare_v2(db, sql, -1, &stmt, 0);
+    int rc = db_prepare(sql, &stmt);
     
     if (rc != SQLITE_OK)
     {
@@ -2401,7 +3109,7 @@ int db_load_cases(Case *out_cases, int *count)
     }
 
     *count = idx;
-    sqlite3_finalize(stmt);
+    db_finalize(stmt);
     return 0;
 }
 
@@ -2415,7 +3123,7 @@ int db_load_case(int case_id, Case *out_case)
 
     const char *sql = "SELECT case_id, name, price, possible_skins, probabilities, skin_count FROM cases WHERE case_id = ?";
     sqlite3_stmt *stmt;
-    int rc = sqlite3_prepare_v2(db, sql, -1, &stmt, 0);
+    int rc = db_prepare(sql, &stmt);
     if (rc != SQLITE_OK)
         return -1;
 
@@ -2457,11 +3165,11 @@ int db_load_case(int case_id, Case *out_case)
         parse_float_array(probs_json, out_case->probabilities, &parsed_prob_count, 50);
         (void)parsed_prob_count;
 
-        sqlite3_finalize(stmt);
+        db_finalize(stmt);
         return 0;
     }
 
-    sqlite3_finalize(stmt);
+    db_finalize(stmt);
     return -1;
 }
 
@@ -2475,7 +3183,7 @@ int db_save_report(Report *report)
     const char *sql = "INSERT INTO reports (reporter_id, reported_id, reason, created_at, is_resolved) "
                       "VALUES (?, ?, ?, ?, ?)";
     sqlite3_stmt *stmt;
-    int rc = sqlite3_prepare_v2(db, sql, -1, &stmt, 0);
+    int rc = db_prepare(sql, &stmt);
     if (rc != SQLITE_OK)
         return -1;
 
@@ -2490,7 +3198,7 @@ int db_save_report(Report *report)
     {
         report->report_id = (int)sqlite3_last_insert_rowid(db);
     }
-    sqlite3_finalize(stmt);
+    db_finalize(stmt);
 
     return (rc == SQLITE_DONE) ? 0 : -1;
 }
@@ -2504,7 +3212,7 @@ int db_load_reports_for_user(int user_id, Report *out_reports, int *count)
                       "FROM reports WHERE reported_id = ? AND is_resolved = 0 "
                       "ORDER BY created_at DESC";
     sqlite3_stmt *stmt;
-    int rc = sqlite3_prepare_v2(db, sql, -1, &stmt, 0);
+    int rc = db_prepare(sql, &stmt);
     if (rc != SQLITE_OK)
     {
         *count = 0;
@@ -2529,7 +3237,7 @@ int db_load_reports_for_user(int user_id, Report *out_reports, int *count)
     }
 
     *count = idx;
-    sqlite3_finalize(stmt);
+    db_finalize(stmt);
     return 0;
 }
 
@@ -2537,7 +3245,7 @@ int db_get_report_count(int user_id)
 {
     const char *sql = "SELECT COUNT(*) FROM reports WHERE reported_id = ? AND is_resolved = 0";
     sqlite3_stmt *stmt;
-    int rc = sqlite3_prepare_v2(db, sql, -1, &stmt, 0);
+    int rc = db_prepare(sql, &stmt);
     if (rc != SQLITE_OK)
         return -1;
 
@@ -2549,7 +3257,7 @@ int db_get_report_count(int user_id)
         count = sqlite3_column_int(stmt, 0);
     }
 
-    sqlite3_finalize(stmt);
+    db_finalize(stmt);
     return count;
 }
 
@@ -2563,7 +3271,7 @@ int db_save_quest(Quest *quest)
     const char *sql = "INSERT INTO quests (user_id, quest_type, progress, target, is_completed, is_claimed, started_at, completed_at) "
                       "VALUES (?, ?, ?, ?, ?, ?, ?, ?)";
     sqlite3_stmt *stmt;
-    int rc = sqlite3_prepare_v2(db, sql, -1, &stmt, 0);
+    int rc = db_prepare(sql, &stmt);
     if (rc != SQLITE_OK)
         return -1;
 
@@ -2584,7 +3292,7 @@ int db_save_quest(Quest *quest)
     {
         quest->quest_id = (int)sqlite3_last_insert_rowid(db);
     }
-    sqlite3_finalize(stmt);
+    db_finalize(stmt);
 
     return (rc == SQLITE_DONE) ? 0 : -1;
 }
@@ -2599,7 +3307,7 @@ int db_load_user_quests(int user_id, Quest *out_quests, int *count)
     const char *sql = "SELECT quest_id, user_id, quest_type, progress, target, is_completed, is_claimed, started_at, completed_at "
                       "FROM quests WHERE user_id = ? AND is_claimed = 0 ORDER BY quest_type";
     sqlite3_stmt *stmt;
-    int rc = sqlite3_prepare_v2(db, sql, -1, &stmt, 0);
+    int rc = db_prepare(sql, &stmt);
     if (rc != SQLITE_OK)
     {
         *count = 0;
@@ -2625,7 +3333,7 @@ int db_load_user_quests(int user_id, Quest *out_quests, int *count)
     }
 
     *count = idx;
-    sqlite3_finalize(stmt);
+    db_finalize(stmt);
     return 0;
 }
 
@@ -2636,7 +3344,7 @@ int db_update_quest(Quest *quest)
 
     const char *sql = "UPDATE quests SET progress = ?, is_completed = ?, is_claimed = ?, completed_at = ? WHERE quest_id = ?";
     sqlite3_stmt *stmt;
-    int rc = sqlite3_prepare_v2(db, sql, -1, &stmt, 0);
+    int rc = db_prepare(sql, &stmt);
     if (rc != SQLITE_OK)
         return -1;
 
@@ -2650,7 +3358,7 @@ int db_update_quest(Quest *quest)
     sqlite3_bind_int(stmt, 5, quest->quest_id);
 
     rc = sqlite3_step(stmt);
-    sqlite3_finalize(stmt);
+    db_finalize(stmt);
 
     return (rc == SQLITE_DONE) ? 0 : -1;
 }
@@ -2665,7 +3373,7 @@ int db_save_achievement(Achievement *achievement)
     const char *sql = "INSERT OR REPLACE INTO achievements (user_id, achievement_type, is_unlocked, is_claimed, unlocked_at) "
                       "VALUES (?, ?, ?, ?, ?)";
     sqlite3_stmt *stmt;
-    int rc = sqlite3_prepare_v2(db, sql, -1, &stmt, 0);
+    int rc = db_prepare(sql, &stmt);
     if (rc != SQLITE_OK)
         return -1;
 
@@ -2683,7 +3391,7 @@ int db_save_achievement(Achievement *achievement)
     {
         achievement->achievement_id = (int)sqlite3_last_insert_rowid(db);
     }
-    sqlite3_finalize(stmt);
+    db_finalize(stmt);
 
     return (rc == SQLITE_DONE) ? 0 : -1;
 }
@@ -2696,7 +3404,7 @@ int db_load_user_achievements(int user_id, Achievement *out_achievements, int *c
     const char *sql = "SELECT achievement_id, user_id, achievement_type, is_unlocked, is_claimed, unlocked_at "
                       "FROM achievements WHERE user_id = ? ORDER BY achievement_type";
     sqlite3_stmt *stmt;
-    int rc = sqlite3_prepare_v2(db, sql, -1, &stmt, 0);
+    int rc = db_prepare(sql, &stmt);
     if (rc != SQLITE_OK)
     {
         *count = 0;
@@ -2719,7 +3427,7 @@ int db_load_user_achievements(int user_id, Achievement *out_achievements, int *c
     }
 
     *count = idx;
-    sqlite3_finalize(stmt);
+    db_finalize(stmt);
     return 0;
 }
 
@@ -2730,7 +3438,7 @@ int db_update_achievement(Achievement *achievement)
 
     const char *sql = "UPDATE achievements SET is_unlocked = ?, is_claimed = ?, unlocked_at = ? WHERE achievement_id = ?";
     sqlite3_stmt *stmt;
-    int rc = sqlite3_prepare_v2(db, sql, -1, &stmt, 0);
+    int rc = db_prepare(sql, &stmt);
     if (rc != SQLITE_OK)
         return -1;
 
@@ -2743,7 +3451,7 @@ int db_update_achievement(Achievement *achievement)
     sqlite3_bind_int(stmt, 4, achievement->achievement_id);
 
     rc = sqlite3_step(stmt);
-    sqlite3_finalize(stmt);
+    db_finalize(stmt);
 
     return (rc == SQLITE_DONE) ? 0 : -1;
 }
@@ -2758,7 +3466,7 @@ int db_save_login_streak(LoginStreak *streak)
     const char *sql = "INSERT OR REPLACE INTO login_streaks (user_id, current_streak, last_login_date, last_reward_date) "
                       "VALUES (?, ?, ?, ?)";
     sqlite3_stmt *stmt;
-    int rc = sqlite3_prepare_v2(db, sql, -1, &stmt, 0);
+    int rc = db_prepare(sql, &stmt);
     if (rc != SQLITE_OK)
         return -1;
 
@@ -2771,7 +3479,7 @@ int db_save_login_streak(LoginStreak *streak)
         sqlite3_bind_null(stmt, 4);
 
     rc = sqlite3_step(stmt);
-    sqlite3_finalize(stmt);
+    db_finalize(stmt);
 
     return (rc == SQLITE_DONE) ? 0 : -1;
 }
@@ -2783,7 +3491,7 @@ int db_load_login_streak(int user_id, LoginStreak *out_streak)
 
     const char *sql = "SELECT user_id, current_streak, last_login_date, last_reward_date FROM login_streaks WHERE user_id = ?";
     sqlite3_stmt *stmt;
-    int rc = sqlite3_prepare_v2(db, sql, -1, &stmt, 0);
+    int rc = db_prepare(sql, &stmt);
     if (rc != SQLITE_OK)
         return -1;
 
@@ -2796,11 +3504,11 @@ int db_load_login_streak(int user_id, LoginStreak *out_streak)
         out_streak->last_login_date = sqlite3_column_int64(stmt, 2);
         const char *last_reward_str = (const char *)sqlite3_column_text(stmt, 3);
         out_streak->last_reward_date = last_reward_str ? sqlite3_column_int64(stmt, 3) : 0;
-        sqlite3_finalize(stmt);
+        db_finalize(stmt);
         return 0;
     }
 
-    sqlite3_finalize(stmt);
+    db_finalize(stmt);
     return -1;
 }
 
@@ -2813,7 +3521,7 @@ int db_save_chat_message(int user_id, const char *username, const char *message)
 
     const char *sql = "INSERT INTO chat_messages (user_id, username, message, timestamp) VALUES (?, ?, ?, ?)";
     sqlite3_stmt *stmt;
-    int rc = sqlite3_prepare_v2(db, sql, -1, &stmt, 0);
+    int rc = db_prepare(sql, &stmt);
     if (rc != SQLITE_OK)
         return -1;
 
@@ -2823,7 +3531,7 @@ int db_save_chat_message(int user_id, const char *username, const char *message)
     sqlite3_bind_int64(stmt, 4, time(NULL));
 
     rc = sqlite3_step(stmt);
-    sqlite3_finalize(stmt);
+    db_finalize(stmt);
 
     return (rc == SQLITE_DONE) ? 0 : -1;
 }
@@ -2839,7 +3547,7 @@ int db_load_recent_chat_messages(ChatMessage *out_messages, int *count, int limi
     const char *sql = "SELECT message_id, user_id, username, message, timestamp "
                       "FROM chat_messages ORDER BY timestamp DESC LIMIT ?";
     sqlite3_stmt *stmt;
-    int rc = sqlite3_prepare_v2(db, sql, -1, &stmt, 0);
+    int rc = db_prepare(sql, &stmt);
     if (rc != SQLITE_OK)
     {
         *count = 0;
@@ -2862,7 +3570,7 @@ int db_load_recent_chat_messages(ChatMessage *out_messages, int *count, int limi
     }
 
     *count = idx;
-    sqlite3_finalize(stmt);
+    db_finalize(stmt);
     return 0;
 }
 
@@ -2876,7 +3584,7 @@ int db_save_price_history(int definition_id, float price, int transaction_type)
     const char *sql = "INSERT INTO price_history (definition_id, price, transaction_type, timestamp) "
                       "VALUES (?, ?, ?, ?)";
     sqlite3_stmt *stmt;
-    int rc = sqlite3_prepare_v2(db, sql, -1, &stmt, 0);
+    int rc = db_prepare(sql, &stmt);
     if (rc != SQLITE_OK)
         return -1;
 
@@ -2886,7 +3594,7 @@ int db_save_price_history(int definition_id, float price, int transaction_type)
     sqlite3_bind_int64(stmt, 4, time(NULL));
 
     rc = sqlite3_step(stmt);
-    sqlite3_finalize(stmt);
+    db_finalize(stmt);
 
     return (rc == SQLITE_DONE) ? 0 : -1;
 }
@@ -2905,7 +3613,7 @@ int db_get_price_history_24h(int definition_id, PriceHistoryEntry *out_history,
                       "ORDER BY timestamp ASC "
                       "LIMIT 100";
     sqlite3_stmt *stmt;
-    int rc = sqlite3_prepare_v2(db, sql, -1, &stmt, 0);
+    int rc = db_prepare(sql, &stmt);
     if (rc != SQLITE_OK)
     {
         *count = 0;
@@ -2926,7 +3634,7 @@ int db_get_price_history_24h(int definition_id, PriceHistoryEntry *out_history,
     }
 
     *count = idx;
-    sqlite3_finalize(stmt);
+    db_finalize(stmt);
     return 0;
 }
 
@@ -2942,7 +3650,7 @@ int db_get_price_24h_ago(int definition_id, float *out_price)
                       "WHERE definition_id = ? AND timestamp >= ? "
                       "ORDER BY timestamp ASC LIMIT 1";
     sqlite3_stmt *stmt;
-    int rc = sqlite3_prepare_v2(db, sql, -1, &stmt, 0);
+    int rc = db_prepare(sql, &stmt);
     if (rc != SQLITE_OK)
         return -1;
 
@@ -2952,20 +3660,26 @@ int db_get_price_24h_ago(int definition_id, float *out_price)
     if (sqlite3_step(stmt) == SQLITE_ROW)
     {
         *out_price = (float)sqlite3_column_double(stmt, 0);
-        sqlite3_finalize(stmt);
+        db_finalize(stmt);
         return 0;
     }
 
-    sqlite3_finalize(stmt);
+    db_finalize(stmt);
     return -1; // No price history found
 }
 
 // ==================== TRANSACTION MANAGEMENT ====================
 
+// Transactions belong to the connection that started them, which is the calling thread's own
 int db_begin_transaction(void)
 {
     if (!db)
         return -1;
+    if (tx_db)
+    {
+        fprintf(stderr, "db_begin_transaction failed: a transaction is already open on this thread\n");
+        return -1;
+    }
     
     char *err_msg = 0;
     int rc = sqlite3_exec(db, "BEGIN IMMEDIATE TRANSACTION", 0, 0, &err_msg);
@@ -2978,18 +3692,20 @@ int db_begin_transaction(void)
         }
         return -1;
     }
+    tx_db = db;
     return 0;
 }
 
 int db_commit_transaction(void)
 {
-    if (!db)
+    if (!tx_db)
         return -1;
     
     char *err_msg = 0;
-    int rc = sqlite3_exec(db, "COMMIT", 0, 0, &err_msg);
+    int rc = sqlite3_exec(tx_db, "COMMIT", 0, 0, &err_msg);
     if (rc != SQLITE_OK)
     {
+        // The transaction is still open: the caller rolls it back
         if (err_msg)
         {
             fprintf(stderr, "db_commit_transaction failed: %s\n", err_msg);
@@ -2997,16 +3713,18 @@ int db_commit_transaction(void)
         }
         return -1;
     }
+    tx_db = NULL;
     return 0;
 }
 
 int db_rollback_transaction(void)
 {
-    if (!db)
+    if (!tx_db)
         return -1;
     
     char *err_msg = 0;
-    int rc = sqlite3_exec(db, "ROLLBACK", 0, 0, &err_msg);
+    int rc = sqlite3_exec(tx_db, "ROLLBACK", 0, 0, &err_msg);
+    tx_db = NULL;
     if (rc != SQLITE_OK)
     {
         if (err_msg)
@@ -3036,7 +3754,7 @@ int db_atomic_mark_listing_sold(int listing_id, int *seller_id, int *instance_id
     const char *select_sql = "SELECT seller_id, instance_id, price, is_sold "
                              "FROM market_listings_v2 WHERE listing_id = ?";
     sqlite3_stmt *select_stmt;
-    int rc = sqlite3_prepare_v2(db, select_sql, -1, &select_stmt, 0);
+    int rc = db_prepare(select_sql, &select_stmt);
     if (rc != SQLITE_OK)
         return -1;
     
@@ -3044,7 +3762,7 @@ int db_atomic_mark_listing_sold(int listing_id, int *seller_id, int *instance_id
     
     if (sqlite3_step(select_stmt) != SQLITE_ROW)
     {
-        sqlite3_finalize(select_stmt);
+        db_finalize(select_stmt);
         return -1; // Listing not found
     }
     
@@ -3053,7 +3771,7 @@ int db_atomic_mark_listing_sold(int listing_id, int *seller_id, int *instance_id
     *price = sqlite3_column_double(select_stmt, 2);
     int is_sold = sqlite3_column_int(select_stmt, 3);
     
-    sqlite3_finalize(select_stmt);
+    db_finalize(select_stmt);
     
     if (is_sold)
         return -2; // Already sold
@@ -3063,14 +3781,14 @@ int db_atomic_mark_listing_sold(int listing_id, int *seller_id, int *instance_id
     const char *update_sql = "UPDATE market_listings_v2 SET is_sold = 1 "
                              "WHERE listing_id = ? AND is_sold = 0";
     sqlite3_stmt *update_stmt;
-    rc = sqlite3_prepare_v2(db, update_sql, -1, &update_stmt, 0);
+    rc = db_prepare(update_sql, &update_stmt);
     if (rc != SQLITE_OK)
         return -1;
     
     sqlite3_bind_int(update_stmt, 1, listing_id);
     
     rc = sqlite3_step(update_stmt);
-    sqlite3_finalize(update_stmt);
+    db_finalize(update_stmt);
     
     if (rc != SQLITE_DONE)
         return -1;
@@ -3102,7 +3820,7 @@ int db_atomic_accept_trade(int trade_id)
     // This is atomic at database level - only one thread can succeed
     const char *update_sql = "UPDATE trades SET status = ? WHERE trade_id = ? AND status = ?";
     sqlite3_stmt *update_stmt;
-    int rc = sqlite3_prepare_v2(db, update_sql, -1, &update_stmt, 0);
+    int rc = db_prepare(update_sql, &update_stmt);
     if (rc != SQLITE_OK)
         return -1;
     
@@ -3111,7 +3829,7 @@ int db_atomic_accept_trade(int trade_id)
     sqlite3_bind_int(update_stmt, 3, TRADE_PENDING);
     
     rc = sqlite3_step(update_stmt);
-    sqlite3_finalize(update_stmt);
+    db_finalize(update_stmt);
     
     if (rc != SQLITE_DONE)
         return -1;
@@ -3124,16 +3842,16 @@ int db_atomic_accept_trade(int trade_id)
         // Check if trade exists
         const char *check_sql = "SELECT trade_id FROM trades WHERE trade_id = ?";
         sqlite3_stmt *check_stmt;
-        rc = sqlite3_prepare_v2(db, check_sql, -1, &check_stmt, 0);
+        rc = db_prepare(check_sql, &check_stmt);
         if (rc == SQLITE_OK)
         {
             sqlite3_bind_int(check_stmt, 1, trade_id);
             if (sqlite3_step(check_stmt) == SQLITE_ROW)
             {
-                sqlite3_finalize(check_stmt);
+                db_finalize(check_stmt);
                 return -2; // Trade exists but already processed (race condition)
             }
-            sqlite3_finalize(check_stmt);
+            db_finalize(check_stmt);
         }
         return -1; // Trade not found
     }
@@ -0,0 +1,581 @@
+// leaderboard_index.c - In-memory net-worth ranking (indexable skip list)
+
+#include "../include/leaderboard_index.h"
+#include "../include/database.h"
+#include "../include/database_internal.h"
+#include "../include/pricing_catalog.h"
+#include "../include/logger.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+
+// Each link also counts how many ranks it skips, so rank and select are O(log n)
+typedef struct LbNode
+{
+    int user_id;
+    float net_worth;
+    char username[MAX_USERNAME_LEN];
+    int level;
+    struct
+    {
+        struct LbNode *next;
+        int span;
+    } links[];
+} LbNode;
+
+typedef struct
+{
+    LbNode *head;         // Sentinel with LEADERBOARD_MAX_LEVEL links
+    int level;            // Highest level in use
+    int size;
+    LbNode **by_user;     // Indexed by user_id
+    int by_user_cap;
+    uint64_t level_state; // Node levels come from here, not from the game's roll streams
+} LbList;
+
+static pthread_rwlock_t g_lock = PTHREAD_RWLOCK_INITIALIZER;
+static LbList g_list = {.level = 1};
+static int g_seeded = 0;
+static long long g_catalog_version = -1; // Prices the ranking was computed with
+
+// A rebuild reads the database without g_lock and swaps the finished list in. Users refreshed
+// meanwhile only reached the old list, so they are noted and refreshed again after the swap.
+static pthread_mutex_t g_build_mutex = PTHREAD_MUTEX_INITIALIZER;
+static int g_building = 0; // Under g_lock
+static int *g_missed = NULL;
+static int g_missed_count = 0;
+static int g_missed_cap = 0;
+
+// ==================== Skip list ====================
+
+static LbNode *node_new(int level, int user_id, float net_worth, const char *username)
+{
+    LbNode *node = calloc(1, sizeof(LbNode) + level * sizeof(node->links[0]));
+    if (!node)
+        return NULL;
+    node->user_id = user_id;
+    node->net_worth = net_worth;
+    node->level = level;
+    if (username)
+    {
+        strncpy(node->username, username, MAX_USERNAME_LEN - 1);
+        node->username[MAX_USERNAME_LEN - 1] = '\0';
+    }
+    return node;
+}
+
+// Richer first, then lower user_id
+static inline int ranks_before(const LbNode *node, float net_worth, int user_id)
+{
+    return node->net_worth > net_worth || (node->net_worth == net_worth && node->user_id < user_id);
+}
+
+// splitmix64 step over the list's own state
+static int random_level(LbList *list)
+{
+    uint64_t bits = (list->level_state += 0x9e3779b97f4a7c15ULL);
+    bits = (bits ^ (bits >> 30)) * 0xbf58476d1ce4e5b9ULL;
+    bits = (bits ^ (bits >> 27)) * 0x94d049bb133111ebULL;
+    bits ^= bits >> 31;
+
+    int level = 1;
+    while (level < LEADERBOARD_MAX_LEVEL && (bits & 3) == 0) // p = 1/4
+    {
+        level++;
+        bits >>= 2;
+    }
+    return level;
+}
+
+static void list_insert(LbList *list, LbNode *node)
+{
+    LbNode *update[LEADERBOARD_MAX_LEVEL];
+    int rank[LEADERBOARD_MAX_LEVEL];
+
+    LbNode *x = list->head;
+    for (int i = list->level - 1; i >= 0; i--)
+    {
+        rank[i] = (i == list->level - 1) ? 0 : rank[i + 1];
+        while (x->links[i].next && ranks_before(x->links[i].next, node->net_worth, node->user_id))
+        {
+            rank[i] += x->links[i].span;
+            x = x->links[i].next;
+        }
+        update[i] = x;
+    }
+
+    if (node->level > list->level)
+    {
+        for (int i = list->level; i < node->level; i++)
+        {
+            rank[i] = 0;
+            update[i] = list->head;
+            update[i]->links[i].span = list->size;
+        }
+        list->level = node->level;
+    }
+
+    for (int i = 0; i < node->level; i++)
+    {
+        node->links[i].next = update[i]->links[i].next;
+        update[i]->links[i].next = node;
+        node->links[i].span = update[i]->links[i].span - (rank[0] - rank[i]);
+        update[i]->links[i].span = (rank[0] - rank[i]) + 1;
+    }
+    for (int i = node->level; i < list->level; i++)
+        update[i]->links[i].span++;
+    list->size++;
+}
+
+static void list_remove(LbList *list, LbNode *node)
+{
+    LbNode *update[LEADERBOARD_MAX_LEVEL];
+    LbNode *x = list->head;
+    for (int i = list->level - 1; i >= 0; i--)
+    {
+        while (x->links[i].next && ranks_before(x->links[i].next, node->net_worth, node->user_id))
+            x = x->links[i].next;
+        update[i] = x;
+    }
+
+    for (int i = 0; i < list->level; i++)
+    {
+        if (update[i]->links[i].next == node)
+        {
+            update[i]->links[i].span += node->links[i].span - 1;
+            update[i]->links[i].next = node->links[i].next;
+        }
+        else
+        {
+            update[i]->links[i].span--;
+        }
+    }
+    while (list->level > 1 && !list->head->links[list->level - 1].next)
+        list->level--;
+    list->size--;
+}
+
+static int list_rank(const LbList *list, const LbNode *node)
+{
+    int rank = 0;
+    LbNode *x = list->head;
+    for (int i = list->level - 1; i >= 0; i--)
+    {
+        while (x->links[i].next && (x->links[i].next == node || ranks_before(x->links[i].next, node->net_worth, node->user_id)))
+        {
+            rank += x->links[i].span;
+            x = x->links[i].next;
+            if (x == node)
+                return rank;
+        }
+    }
+    return -1;
+}
+
+static LbNode *list_at(const LbList *list, int rank)
+{
+    int traversed = 0;
+    LbNode *x = list->head;
+    for (int i = list->level - 1; i >= 0; i--)
+    {
+        while (x->links[i].next && traversed + x->links[i].span <= rank)
+        {
+            traversed += x->links[i].span;
+            x = x->links[i].next;
+        }
+        if (traversed == rank)
+            return x;
+    }
+    return NULL;
+}
+
+static void list_free(LbList *list)
+{
+    if (list->head)
+    {
+        LbNode *x = list->head->links[0].next;
+        while (x)
+        {
+            LbNode *next = x->links[0].next;
+            free(x);
+            x = next;
+        }
+        free(list->head);
+    }
+    free(list->by_user);
+    memset(list, 0, sizeof(LbList));
+    list->level = 1;
+}
+
+static int ensure_user_slot(LbList *list, int user_id)
+{
+    if (user_id < list->by_user_cap)
+        return 0;
+    int cap = list->by_user_cap ? list->by_user_cap : 1024;
+    while (cap <= user_id)
+        cap *= 2;
+    LbNode **grown = realloc(list->by_user, cap * sizeof(LbNode *));
+    if (!grown)
+        return -1;
+    memset(grown + list->by_user_cap, 0, (cap - list->by_user_cap) * sizeof(LbNode *));
+    list->by_user = grown;
+    list->by_user_cap = cap;
+    return 0;
+}
+
+// Insert or move a user (write lock held, or the list is not published yet)
+static void place_user(LbList *list, int user_id, const char *username, float net_worth)
+{
+    if (user_id <= 0 || ensure_user_slot(list, user_id) != 0)
+        return;
+
+    LbNode *node = list->by_user[user_id];
+    if (node)
+    {
+        if (node->net_worth == net_worth)
+            return;
+        list_remove(list, node);
+        node->net_worth = net_worth;
+        if (username && username[0])
+        {
+            strncpy(node->username, username, MAX_USERNAME_LEN - 1);
+            node->username[MAX_USERNAME_LEN - 1] = '\0';
+        }
+        list_insert(list, node);
+        return;
+    }
+
+    node = node_new(random_level(list), user_id, net_worth, username);
+    if (!node)
+        return;
+    list_insert(list, node);
+    list->by_user[user_id] = node;
+}
+
+// Entries first_rank .. first_rank + limit - 1 (lock held)
+static int copy_range(const LbList *list, int first_rank, int limit, LeaderboardEntry *out_entries)
+{
+    int n = 0;
+    LbNode *x = first_rank <= list->size ? list_at(list, first_rank) : NULL;
+    while (x && n < limit)
+    {
+        LeaderboardEntry *e = &out_entries[n++];
+        memset(e, 0, sizeof(LeaderboardEntry));
+        e->user_id = x->user_id;
+        memcpy(e->username, x->username, MAX_USERNAME_LEN);
+        e->value = x->net_worth;
+        x = x->links[0].next;
+    }
+    return n;
+}
+
+// ==================== Seeding ====================
+
+typedef struct
+{
+    int user_id;
+    char username[MAX_USERNAME_LEN];
+    float net_worth; // Summed like leaderboard_index_refresh_user() so both give the same value
+} SeedUser;
+
+// Every user's net worth in two queries, into a list nobody else can see yet (no lock held)
+static int build_list(LbList *out)
+{
+    memset(out, 0, sizeof(LbList));
+    out->level = 1;
+
+    sqlite3_stmt *stmt;
+    if (db_prepare("SELECT COUNT(*), MAX(user_id) FROM users", &stmt) != SQLITE_OK)
+        return -1;
+    int user_count = 0, max_user_id = 0;
+    if (sqlite3_step(stmt) == SQLITE_ROW)
+    {
+        user_count = sqlite3_column_int(stmt, 0);
+        max_user_id = sqlite3_column_int(stmt, 1);
+    }
+    db_finalize(stmt);
+
+    SeedUser *users = calloc(user_count > 0 ? user_count : 1, sizeof(SeedUser));
+    int *slot = calloc(max_user_id + 1, sizeof(int)); // user_id -> index + 1
+    if (!users || !slot)
+    {
+        free(users);
+        free(slot);
+        return -1;
+    }
+
+    int count = 0;
+    if (db_prepare("SELECT user_id, username, balance FROM users", &stmt) != SQLITE_OK)
+        goto fail;
+    while (sqlite3_step(stmt) == SQLITE_ROW && count < user_count)
+    {
+        int user_id = sqlite3_column_int(stmt, 0);
+        if (user_id <= 0 || user_id > max_user_id)
+            continue;
+        SeedUser *u = &users[count];
+        u->user_id = user_id;
+        const char *username = (const char *)sqlite3_column_text(stmt, 1);
+        if (username)
+            strncpy(u->username, username, MAX_USERNAME_LEN - 1);
+        u->net_worth = (float)sqlite3_column_double(stmt, 2);
+        slot[user_id] = ++count;
+    }
+    db_finalize(stmt);
+
+    if (db_prepare("SELECT i.user_id, si.definition_id, si.rarity, si.wear FROM inventories i "
+                   "JOIN skin_instances si ON si.instance_id = i.instance_id ORDER BY i.inventory_id",
+                   &stmt) != SQLITE_OK)
+        goto fail;
+    while (sqlite3_step(stmt) == SQLITE_ROW)
+    {
+        int user_id = sqlite3_column_int(stmt, 0);
+        if (user_id <= 0 || user_id > max_user_id || !slot[user_id])
+            continue;
+        users[slot[user_id] - 1].net_worth += db_calculate_skin_price(sqlite3_column_int(stmt, 1),
+                                                                      (SkinRarity)sqlite3_column_int(stmt, 2),
+                                                                      (WearCondition)sqlite3_column_double(stmt, 3));
+    }
+    db_finalize(stmt);
+
+    out->head = node_new(LEADERBOARD_MAX_LEVEL, 0, 0.0f, NULL);
+    if (!out->head || ensure_user_slot(out, max_user_id) != 0)
+        goto fail;
+    for (int i = 0; i < count; i++)
+        place_user(out, users[i].user_id, users[i].username, users[i].net_worth);
+
+    free(users);
+    free(slot);
+    return 0;
+
+fail:
+    free(users);
+    free(slot);
+    list_free(out);
+    return -1;
+}
+
+// Note a refresh that a running rebuild may have missed (write lock held)
+static void note_missed(int user_id)
+{
+    if (g_missed_count == g_missed_cap)
+    {
+        int cap = g_missed_cap ? g_missed_cap * 2 : 64;
+        int *grown = realloc(g_missed, cap * sizeof(int));
+        if (!grown)
+            return;
+        g_missed = grown;
+        g_missed_cap = cap;
+    }
+    g_missed[g_missed_count++] = user_id;
+}
+
+// Build a fresh list off-lock and swap it in; readers keep the old one until then.
+// force rebuilds even if the list already matches the catalog (startup). g_build_mutex held.
+static int rebuild_locked(int force)
+{
+    const PricingCatalog *catalog = pricing_catalog_get();
+    long long version = catalog ? catalog->version : -1;
+
+    pthread_rwlock_wrlock(&g_lock);
+    if (!force && g_seeded && g_catalog_version == version)
+    {
+        // Another thread rebuilt while this one waited for g_build_mutex
+        pthread_rwlock_unlock(&g_lock);
+        return 0;
+    }
+    g_building = 1;
+    g_missed_count = 0;
+    pthread_rwlock_unlock(&g_lock);
+
+    LbList fresh;
+    int rc = build_list(&fresh);
+
+    LbList old = {.level = 1};
+    pthread_rwlock_wrlock(&g_lock);
+    if (rc == 0)
+    {
+        old = g_list;
+        g_list = fresh;
+        g_seeded = 1;
+        g_catalog_version = version;
+    }
+    g_building = 0;
+    int *missed = g_missed;
+    int missed_count = g_missed_count;
+    int size = g_list.size;
+    g_missed = NULL;
+    g_missed_count = 0;
+    g_missed_cap = 0;
+    pthread_rwlock_unlock(&g_lock);
+
+    list_free(&old);
+    if (rc == 0)
+    {
+        for (int i = 0; i < missed_count; i++)
+            leaderboard_index_refresh_user(missed[i]);
+        LOG_INFO("[LEADERBOARD] Net-worth index built: %d users", size);
+    }
+    else
+    {
+        LOG_ERROR("[LEADERBOARD] Failed to build net-worth index");
+    }
+    free(missed);
+    return rc;
+}
+
+// Seed on first use and after the prices changed
+static void ensure_current(void)
+{
+    const PricingCatalog *catalog = pricing_catalog_get();
+    long long version = catalog ? catalog->version : -1;
+
+    pthread_rwlock_rdlock(&g_lock);
+    int seeded = g_seeded;
+    int current = seeded && g_catalog_version == version;
+    pthread_rwlock_unlock(&g_lock);
+    if (current)
+        return;
+
+    // With a ranking to serve, don't queue behind a rebuild that is already running
+    if (seeded)
+    {
+        if (pthread_mutex_trylock(&g_build_mutex) != 0)
+            return;
+    }
+    else
+    {
+        pthread_mutex_lock(&g_build_mutex);
+    }
+    rebuild_locked(0);
+    pthread_mutex_unlock(&g_build_mutex);
+}
+
+// ==================== Public API ====================
+
+int leaderboard_index_init(void)
+{
+    pthread_mutex_lock(&g_build_mutex);
+    int rc = rebuild_locked(1);
+    pthread_mutex_unlock(&g_build_mutex);
+    return rc;
+}
+
+void leaderboard_index_cleanup(void)
+{
+    pthread_rwlock_wrlock(&g_lock);
+    list_free(&g_list);
+    g_seeded = 0;
+    g_catalog_version = -1;
+    free(g_missed);
+    g_missed = NULL;
+    g_missed_count = 0;
+    g_missed_cap = 0;
+    pthread_rwlock_unlock(&g_lock);
+}
+
+void leaderboard_index_refresh_user(int user_id)
+{
+    if (user_id <= 0)
+        return;
+
+    User user;
+    if (db_load_user(user_id, &user) != 0)
+        return;
+
+    float net_worth = user.balance;
+    SkinInstanceRecord records[MAX_INVENTORY_SIZE];
+    int count = 0;
+    if (db_load_inventory_instances(user_id, records, &count) == 0)
+    {
+        for (int i = 0; i < count; i++)
+            net_worth += db_calculate_skin_price(records[i].definition_id, records[i].rarity, records[i].wear);
+    }
+
+    pthread_rwlock_wrlock(&g_lock);
+    if (g_seeded)
+        place_user(&g_list, user_id, user.username, net_worth);
+    if (g_building)
+        note_missed(user_id);
+    pthread_rwlock_unlock(&g_lock);
+}
+
+int leaderboard_index_range(int first_rank, int limit, LeaderboardEntry *out_entries, int *count)
+{
+    if (first_rank <= 0 || limit <= 0 || !out_entries || !count)
+        return -1;
+
+    ensure_current();
+
+    pthread_rwlock_rdlock(&g_lock);
+    if (!g_seeded)
+    {
+        pthread_rwlock_unlock(&g_lock);
+        return -1;
+    }
+
+    *count = copy_range(&g_list, first_rank, limit, out_entries);
+    pthread_rwlock_unlock(&g_lock);
+    return 0;
+}
+
+int leaderboard_index_around(int user_id, int radius, LeaderboardEntry *out_entries, int *count,
+                             int *out_first_rank, int *out_rank)
+{
+    if (user_id <= 0 || radius < 0 || !out_entries || !count)
+        return -1;
+
+    ensure_current();
+
+    // Rank and neighbours under one lock, so the user is always inside the window
+    pthread_rwlock_rdlock(&g_lock);
+    if (!g_seeded || user_id >= g_list.by_user_cap || !g_list.by_user[user_id])
+    {
+        pthread_rwlock_unlock(&g_lock);
+        return -1;
+    }
+    int rank = list_rank(&g_list, g_list.by_user[user_id]);
+    int first_rank = rank > radius ? rank - radius : 1;
+    *count = copy_range(&g_list, first_rank, rank + radius - first_rank + 1, out_entries);
+    pthread_rwlock_unlock(&g_lock);
+
+    if (out_first_rank)
+        *out_first_rank = first_rank;
+    if (out_rank)
+        *out_rank = rank;
+    return 0;
+}
+
+int leaderboard_index_rank(int user_id, int *out_rank, float *out_net_worth)
+{
+    if (user_id <= 0)
+        return -1;
+
+    ensure_current();
+
+    pthread_rwlock_rdlock(&g_lock);
+    int rank = -1;
+    if (g_seeded && user_id < g_list.by_user_cap && g_list.by_user[user_id])
+    {
+        rank = list_rank(&g_list, g_list.by_user[user_id]);
+        if (out_net_worth)
+            *out_net_worth = g_list.by_user[user_id]->net_worth;
+    }
+    pthread_rwlock_unlock(&g_lock);
+
+    if (rank < 0)
+        return -1;
+    if (out_rank)
+        *out_rank = rank;
+    return 0;
+}
+
+int leaderboard_index_size(void)
+{
+    ensure_current();
+
+    pthread_rwlock_rdlock(&g_lock);
+    int size = g_list.size;
+    pthread_rwlock_unlock(&g_lock);
+    return size;
+}
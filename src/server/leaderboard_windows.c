@@ -0,0 +1,434 @@
+// leaderboard_windows.c - Daily / weekly / monthly leaderboards from rotating day buckets
+
+#include "../include/leaderboard_windows.h"
+#include "../include/database.h"
+#include "../include/database_internal.h"
+#include "../include/pricing_catalog.h"
+#include "../include/logger.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+#include <time.h>
+
+#define SECONDS_PER_DAY 86400
+
+// One user's activity, bucketed by UTC day; slot = day % LEADERBOARD_WINDOW_DAYS
+typedef struct
+{
+    int day[LEADERBOARD_WINDOW_DAYS]; // Day number the slot holds (0 = never written)
+    float volume[LEADERBOARD_WINDOW_DAYS];
+    float profit[LEADERBOARD_WINDOW_DAYS];
+    float best_unbox[LEADERBOARD_WINDOW_DAYS];
+    int best_definition[LEADERBOARD_WINDOW_DAYS];
+    int last_day; // Newest day written, lets queries skip users idle for the whole window
+} WindowUser;
+
+// Best users of one board over one window. Rebuilt when something was recorded or a new day
+// started, but at most once per WINDOW_CACHE_REFRESH_MS; the scan takes the read lock
+// WINDOW_SCAN_BATCH users at a time so recording never waits for a whole pass.
+#define WINDOW_CACHE_SIZE 100
+#define WINDOW_CACHE_REFRESH_MS 1000
+#define WINDOW_SCAN_BATCH 256
+typedef struct
+{
+    int user_id;
+    int definition_id;
+    float value;
+} RankedUser;
+
+typedef struct
+{
+    unsigned long generation; // g_generation the ranking was built at (0 = empty)
+    int day;
+    long long built_ms;
+    int rebuilding; // A thread is scanning; others keep serving this ranking
+    int count;
+    RankedUser top[WINDOW_CACHE_SIZE];
+} WindowCache;
+
+static pthread_rwlock_t g_lock = PTHREAD_RWLOCK_INITIALIZER;
+static WindowUser **g_users = NULL; // Indexed by user_id, NULL until the user has activity
+static int g_users_cap = 0;
+static int *g_active = NULL;        // user_ids with a WindowUser, for queries
+static int g_active_count = 0;
+static int g_active_cap = 0;
+static unsigned long g_generation = 1; // Bumped by every recorded event
+
+static pthread_mutex_t g_cache_mutex = PTHREAD_MUTEX_INITIALIZER;
+static WindowCache g_cache[LEADERBOARD_MOST_PROFITABLE + 1][LEADERBOARD_MONTHLY + 1];
+
+static long long monotonic_ms(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (long long)ts.tv_sec * 1000 + ts.tv_nsec / 1000000;
+}
+
+static inline int day_of(time_t when)
+{
+    return (int)(when / SECONDS_PER_DAY);
+}
+
+static int window_days(LeaderboardWindow window)
+{
+    switch (window)
+    {
+    case LEADERBOARD_DAILY:
+        return 1;
+    case LEADERBOARD_WEEKLY:
+        return 7;
+    case LEADERBOARD_MONTHLY:
+        return LEADERBOARD_WINDOW_DAYS;
+    default:
+        return 0;
+    }
+}
+
+// ==================== Buckets ====================
+
+static WindowUser *user_state(int user_id)
+{
+    if (user_id <= 0)
+        return NULL;
+
+    if (user_id >= g_users_cap)
+    {
+        int cap = g_users_cap ? g_users_cap : 1024;
+        while (cap <= user_id)
+            cap *= 2;
+        WindowUser **grown = realloc(g_users, cap * sizeof(WindowUser *));
+        if (!grown)
+            return NULL;
+        memset(grown + g_users_cap, 0, (cap - g_users_cap) * sizeof(WindowUser *));
+        g_users = grown;
+        g_users_cap = cap;
+    }
+    if (g_users[user_id])
+        return g_users[user_id];
+
+    if (g_active_count == g_active_cap)
+    {
+        int cap = g_active_cap ? g_active_cap * 2 : 1024;
+        int *grown = realloc(g_active, cap * sizeof(int));
+        if (!grown)
+            return NULL;
+        g_active = grown;
+        g_active_cap = cap;
+    }
+    WindowUser *u = calloc(1, sizeof(WindowUser));
+    if (!u)
+        return NULL;
+    g_users[user_id] = u;
+    g_active[g_active_count++] = user_id;
+    return u;
+}
+
+// Slot for an event on `day`, cleared first if it still holds an older day.
+// -1 if the event is older than every window (write lock held)
+static int bucket(WindowUser *u, int day)
+{
+    int today = day_of(time(NULL));
+    if (day <= today - LEADERBOARD_WINDOW_DAYS)
+        return -1;
+
+    int slot = day % LEADERBOARD_WINDOW_DAYS;
+    if (u->day[slot] == day)
+        return slot;
+    if (u->day[slot] > day)
+        return -1;
+
+    u->day[slot] = day;
+    if (day > u->last_day)
+        u->last_day = day;
+    u->volume[slot] = 0.0f;
+    u->profit[slot] = 0.0f;
+    u->best_unbox[slot] = 0.0f;
+    u->best_definition[slot] = 0;
+    return slot;
+}
+
+static void add_volume(int user_id, float amount, int day)
+{
+    WindowUser *u = user_state(user_id);
+    int slot = u ? bucket(u, day) : -1;
+    if (slot >= 0)
+        u->volume[slot] += amount;
+}
+
+static void add_profit(int user_id, float amount, int day)
+{
+    WindowUser *u = user_state(user_id);
+    int slot = u ? bucket(u, day) : -1;
+    if (slot >= 0)
+        u->profit[slot] += amount;
+}
+
+static void add_unbox(int user_id, int definition_id, float value, int day)
+{
+    WindowUser *u = user_state(user_id);
+    int slot = u ? bucket(u, day) : -1;
+    if (slot >= 0 && value > u->best_unbox[slot])
+    {
+        u->best_unbox[slot] = value;
+        u->best_definition[slot] = definition_id;
+    }
+}
+
+// ==================== Seeding ====================
+
+// Replay one ledger row (write lock held)
+static void replay_entry(LogType kind, int user_id, float amount, float cost, int definition_id, int day)
+{
+    switch (kind)
+    {
+    case LOG_MARKET_SELL:
+        add_volume(user_id, amount, day);
+        add_profit(user_id, amount, day);
+        break;
+    case LOG_MARKET_BUY:
+        add_volume(user_id, amount, day);
+        break;
+    case LOG_TRADE:
+        add_volume(user_id, amount + cost, day);
+        break;
+    case LOG_UNBOX:
+        add_unbox(user_id, definition_id, amount, day);
+        break;
+    default:
+        break;
+    }
+}
+
+int leaderboard_windows_init(void)
+{
+    time_t since = ((time_t)day_of(time(NULL)) - LEADERBOARD_WINDOW_DAYS + 1) * SECONDS_PER_DAY;
+
+    sqlite3_stmt *stmt;
+    if (db_prepare("SELECT kind, user_id, amount, cost, definition_id, timestamp FROM ledger WHERE timestamp >= ?",
+                   &stmt) != SQLITE_OK)
+        return -1;
+    sqlite3_bind_int64(stmt, 1, (sqlite3_int64)since);
+
+    int rows = 0;
+    pthread_rwlock_wrlock(&g_lock);
+    while (sqlite3_step(stmt) == SQLITE_ROW)
+    {
+        replay_entry((LogType)sqlite3_column_int(stmt, 0), sqlite3_column_int(stmt, 1),
+                     (float)sqlite3_column_double(stmt, 2), (float)sqlite3_column_double(stmt, 3),
+                     sqlite3_column_int(stmt, 4), day_of((time_t)sqlite3_column_int64(stmt, 5)));
+        rows++;
+    }
+    int users = g_active_count;
+    g_generation++;
+    pthread_rwlock_unlock(&g_lock);
+    db_finalize(stmt);
+
+    LOG_INFO("[LEADERBOARD] Window buckets filled from %d ledger rows (%d users)", rows, users);
+    return 0;
+}
+
+void leaderboard_windows_cleanup(void)
+{
+    pthread_rwlock_wrlock(&g_lock);
+    for (int i = 0; i < g_active_count; i++)
+    {
+        free(g_users[g_active[i]]);
+    }
+    free(g_users);
+    free(g_active);
+    g_users = NULL;
+    g_active = NULL;
+    g_users_cap = 0;
+    g_active_count = 0;
+    g_active_cap = 0;
+    g_generation++;
+    pthread_rwlock_unlock(&g_lock);
+}
+
+// ==================== Recording ====================
+
+void leaderboard_windows_record_sale(int seller_id, int buyer_id, float price, time_t when)
+{
+    int day = day_of(when);
+    pthread_rwlock_wrlock(&g_lock);
+    add_volume(seller_id, price, day);
+    add_profit(seller_id, price, day);
+    add_volume(buyer_id, price, day);
+    g_generation++;
+    pthread_rwlock_unlock(&g_lock);
+}
+
+void leaderboard_windows_record_trade(int user_id, float gave_value, float received_value, time_t when)
+{
+    pthread_rwlock_wrlock(&g_lock);
+    add_volume(user_id, gave_value + received_value, day_of(when));
+    g_generation++;
+    pthread_rwlock_unlock(&g_lock);
+}
+
+void leaderboard_windows_record_unbox(int user_id, int definition_id, float value, time_t when)
+{
+    pthread_rwlock_wrlock(&g_lock);
+    add_unbox(user_id, definition_id, value, day_of(when));
+    g_generation++;
+    pthread_rwlock_unlock(&g_lock);
+}
+
+// ==================== Queries ====================
+
+// A user's value on one board over the days first_day .. today (read lock held)
+static float window_value(const WindowUser *u, LeaderboardType type, int first_day, int today, int *out_definition)
+{
+    float value = 0.0f;
+    for (int slot = 0; slot < LEADERBOARD_WINDOW_DAYS; slot++)
+    {
+        if (u->day[slot] < first_day || u->day[slot] > today)
+            continue;
+        switch (type)
+        {
+        case LEADERBOARD_TOP_TRADERS:
+            value += u->volume[slot];
+            break;
+        case LEADERBOARD_MOST_PROFITABLE:
+            value += u->profit[slot];
+            break;
+        case LEADERBOARD_LUCKIEST_UNBOXERS:
+            if (u->best_unbox[slot] > value)
+            {
+                value = u->best_unbox[slot];
+                *out_definition = u->best_definition[slot];
+            }
+            break;
+        }
+    }
+    return value;
+}
+
+// Insert into a sorted top list, highest first, ties by lower user_id
+static void rank_user(RankedUser *top, int *count, int user_id, int definition_id, float value)
+{
+    int n = *count;
+    if (value <= 0.0f || (n == WINDOW_CACHE_SIZE && value <= top[n - 1].value))
+        return;
+
+    int pos = n < WINDOW_CACHE_SIZE ? n++ : n - 1;
+    while (pos > 0 && (top[pos - 1].value < value || (top[pos - 1].value == value && top[pos - 1].user_id > user_id)))
+    {
+        top[pos] = top[pos - 1];
+        pos--;
+    }
+    top[pos].user_id = user_id;
+    top[pos].definition_id = definition_id;
+    top[pos].value = value;
+    *count = n;
+}
+
+// Rank every active user into out, taking the read lock one batch at a time (no lock held).
+// Users only ever get appended to g_active, so an index stays valid between batches.
+static void build_ranking(WindowCache *out, LeaderboardType type, int first_day, int today)
+{
+    out->count = 0;
+    int i = 0;
+    while (1)
+    {
+        pthread_rwlock_rdlock(&g_lock);
+        int end = i + WINDOW_SCAN_BATCH < g_active_count ? i + WINDOW_SCAN_BATCH : g_active_count;
+        for (; i < end; i++)
+        {
+            int user_id = g_active[i];
+            const WindowUser *u = g_users[user_id];
+            if (u->last_day < first_day)
+                continue;
+
+            int definition_id = 0;
+            float value = window_value(u, type, first_day, today, &definition_id);
+            rank_user(out->top, &out->count, user_id, definition_id, value);
+        }
+        int done = i >= g_active_count;
+        pthread_rwlock_unlock(&g_lock);
+        if (done)
+            break;
+    }
+}
+
+int leaderboard_windows_top(LeaderboardType type, LeaderboardWindow window, LeaderboardEntry *out_entries,
+                            int *count, int limit)
+{
+    int days = window_days(window);
+    if (days <= 0 || type < LEADERBOARD_TOP_TRADERS || type > LEADERBOARD_MOST_PROFITABLE ||
+        !out_entries || !count || limit <= 0)
+        return -1;
+    if (limit > WINDOW_CACHE_SIZE)
+        limit = WINDOW_CACHE_SIZE;
+
+    int today = day_of(time(NULL));
+    long long now_ms = monotonic_ms();
+    WindowCache *cache = &g_cache[type][window];
+    RankedUser top[WINDOW_CACHE_SIZE];
+    int n;
+
+    pthread_rwlock_rdlock(&g_lock);
+    unsigned long generation = g_generation;
+    pthread_rwlock_unlock(&g_lock);
+
+    pthread_mutex_lock(&g_cache_mutex);
+    int built = cache->generation != 0 && cache->day == today;
+    int stale = !built || (cache->generation != generation && now_ms - cache->built_ms >= WINDOW_CACHE_REFRESH_MS);
+    if (stale && (!built || !cache->rebuilding))
+    {
+        cache->rebuilding = 1;
+        pthread_mutex_unlock(&g_cache_mutex);
+
+        // Scanned without g_cache_mutex, so other boards and readers of this one don't wait
+        WindowCache *fresh = malloc(sizeof(WindowCache));
+        if (fresh)
+            build_ranking(fresh, type, today - days + 1, today);
+
+        pthread_mutex_lock(&g_cache_mutex);
+        if (fresh)
+        {
+            memcpy(cache->top, fresh->top, fresh->count * sizeof(RankedUser));
+            cache->count = fresh->count;
+            cache->generation = generation;
+            cache->day = today;
+            cache->built_ms = now_ms;
+        }
+        cache->rebuilding = 0;
+        free(fresh);
+    }
+    n = cache->count < limit ? cache->count : limit;
+    memcpy(top, cache->top, n * sizeof(RankedUser));
+    pthread_mutex_unlock(&g_cache_mutex);
+
+    const PricingCatalog *catalog = pricing_catalog_get();
+    for (int i = 0; i < n; i++)
+    {
+        LeaderboardEntry *e = &out_entries[i];
+        memset(e, 0, sizeof(LeaderboardEntry));
+        e->user_id = top[i].user_id;
+        e->value = top[i].value;
+
+        User user;
+        if (db_load_user(e->user_id, &user) == 0)
+            snprintf(e->username, sizeof(e->username), "%s", user.username);
+
+        const CatalogDefinition *def = NULL;
+        switch (type)
+        {
+        case LEADERBOARD_TOP_TRADERS:
+            snprintf(e->details, sizeof(e->details), "Traded: $%.2f", e->value);
+            break;
+        case LEADERBOARD_MOST_PROFITABLE:
+            snprintf(e->details, sizeof(e->details), "Total profit: +$%.2f", e->value);
+            break;
+        case LEADERBOARD_LUCKIEST_UNBOXERS:
+            if (catalog && pricing_catalog_definition(catalog, top[i].definition_id, &def) == 0)
+                snprintf(e->details, sizeof(e->details), "Unboxed: %s", def->name);
+            break;
+        }
+    }
+
+    *count = n;
+    return 0;
+}
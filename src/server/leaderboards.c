@@ -1,6 +1,9 @@
 // leaderboards.c - Leaderboards Implementation
 
 #include "../include/leaderboards.h"
+#include "../include/leaderboard_index.h"
+#include "../include/leaderboard_windows.h"
+#include "../include/top_unboxes.h"
 #include "../include/database.h"
 #include "../include/database_internal.h"
 #include <sqlite3.h>
@@ -8,194 +11,91 @@
 #include <stdlib.h>
 #include <string.h>
 #include <math.h>
+#include <limits.h>
 #include <time.h>
 
-// Calculate net worth for a user (balance + inventory value)
-static float calculate_net_worth(int user_id)
+// Get top traders by net worth, from the in-memory ranking
+int get_top_traders(LeaderboardEntry *out_entries, int *count, int limit)
 {
-    User user;
-    if (db_load_user(user_id, &user) != 0)
-        return 0.0f;
-    
-    float net_worth = user.balance;
-    
-    // Calculate inventory value
-    Inventory inv;
-    if (db_load_inventory(user_id, &inv) == 0)
-    {
-        for (int i = 0; i < inv.count; i++)
-        {
-            int instance_id = inv.skin_ids[i];
-            int definition_id;
-            SkinRarity rarity;
-            WearCondition wear;
-            int pattern_seed, is_stattrak;
-            int owner_id;
-            time_t acquired_at;
-            int is_tradable;
-            
-            if (db_load_skin_instance(instance_id, &definition_id, &rarity, &wear, &pattern_seed, &is_stattrak, &owner_id, &acquired_at, &is_tradable) == 0)
-            {
-                float price = db_calculate_skin_price(definition_id, rarity, wear);
-                net_worth += price;
-            }
-        }
-    }
-    
-    return net_worth;
+    if (!out_entries || !count || limit <= 0)
+        return -1;
+
+    return leaderboard_index_range(1, limit, out_entries, count);
 }
 
-// Get top traders by net worth
-int get_top_traders(LeaderboardEntry *out_entries, int *count, int limit)
+// Get a user's rank by net worth
+int get_trader_rank(int user_id, LeaderboardRank *out_rank)
 {
-    if (!out_entries || !count || limit <= 0)
+    if (user_id <= 0 || !out_rank)
         return -1;
-    
-    // Get all users
-    // Note: In a full implementation, we'd have a users table query
-    // For now, we'll query from transaction_logs to find active users
-    // This is simplified - in production, we'd have a proper users list
-    
-    // For simplicity, we'll get users from a query
-    // In SQLite, we can query users table directly
-    const char *sql = "SELECT user_id, username FROM users ORDER BY user_id";
-    sqlite3_stmt *stmt;
-    sqlite3 *db = db_get_connection();
-    if (!db)
+
+    memset(out_rank, 0, sizeof(LeaderboardRank));
+    out_rank->user_id = user_id;
+    if (leaderboard_index_rank(user_id, &out_rank->rank, &out_rank->value) != 0)
         return -1;
-    
-    int rc = sqlite3_prepare_v2(db, sql, -1, &stmt, 0);
-    if (rc != SQLITE_OK)
-    {
-        *count = 0;
-        return 0;
-    }
-    
-    LeaderboardEntry entries[100];
-    int entry_count = 0;
-    
-    while (sqlite3_step(stmt) == SQLITE_ROW && entry_count < 100)
-    {
-        int user_id = sqlite3_column_int(stmt, 0);
-        const char *username = (const char *)sqlite3_column_text(stmt, 1);
-        
-        float net_worth = calculate_net_worth(user_id);
-        
-        entries[entry_count].user_id = user_id;
-        strncpy(entries[entry_count].username, username, 31);
-        entries[entry_count].username[31] = '\0';
-        entries[entry_count].value = net_worth;
-        entries[entry_count].details[0] = '\0';
-        entry_count++;
-    }
-    
-    sqlite3_finalize(stmt);
-    
-    // Sort by net worth (descending)
-    for (int i = 0; i < entry_count - 1; i++)
-    {
-        for (int j = i + 1; j < entry_count; j++)
-        {
-            if (entries[i].value < entries[j].value)
-            {
-                LeaderboardEntry temp = entries[i];
-                entries[i] = entries[j];
-                entries[j] = temp;
-            }
-        }
-    }
-    
-    // Copy top entries
-    int copy_count = (entry_count < limit) ? entry_count : limit;
-    for (int i = 0; i < copy_count; i++)
-    {
-        out_entries[i] = entries[i];
-    }
-    
-    *count = copy_count;
+    out_rank->total_ranked = leaderboard_index_size();
     return 0;
 }
 
-// Get luckiest unboxers (best unbox value)
-int get_luckiest_unboxers(LeaderboardEntry *out_entries, int *count, int limit)
+// Get the traders ranked just above and below a user
+int get_traders_around(int user_id, int radius, LeaderboardSlice *out_slice, LeaderboardEntry *out_entries)
 {
-    if (!out_entries || !count || limit <= 0)
+    if (user_id <= 0 || radius < 0 || radius > LEADERBOARD_MAX_RADIUS || !out_slice || !out_entries)
         return -1;
-    
-    // Query skin_instances directly to find highest value unboxed items
-    // Since transaction_logs may not have data, we'll use skin_instances with acquired_at
-    // This ensures we use data from mockdata
-    // JOIN with users and skin_definitions to get username and base_price directly
-    // We'll calculate price in code and sort by value
-    const char *sql = "SELECT si.instance_id, si.definition_id, si.rarity, si.wear, si.owner_id, "
-                      "u.username, sd.name, sd.base_price FROM skin_instances si "
-                      "JOIN users u ON si.owner_id = u.user_id "
-                      "JOIN skin_definitions sd ON si.definition_id = sd.definition_id "
-                      "WHERE si.owner_id > 0 AND si.acquired_at > 0";
-    sqlite3_stmt *stmt;
-    sqlite3 *db = db_get_connection();
-    if (!db)
+
+    memset(out_slice, 0, sizeof(LeaderboardSlice));
+    if (leaderboard_index_around(user_id, radius, out_entries, &out_slice->count,
+                                 &out_slice->first_rank, &out_slice->user_rank) != 0)
         return -1;
-    
-    int rc = sqlite3_prepare_v2(db, sql, -1, &stmt, 0);
-    if (rc != SQLITE_OK)
-    {
-        *count = 0;
-        return 0;
-    }
-    
-    LeaderboardEntry entries[100];
-    int entry_count = 0;
-    
-    while (sqlite3_step(stmt) == SQLITE_ROW && entry_count < 100)
-    {
-        int instance_id = sqlite3_column_int(stmt, 0);
-        int definition_id = sqlite3_column_int(stmt, 1);
-        SkinRarity rarity = (SkinRarity)sqlite3_column_int(stmt, 2);
-        WearCondition wear = (WearCondition)sqlite3_column_double(stmt, 3);
-        int owner_id = sqlite3_column_int(stmt, 4);
-        const char *username = (const char *)sqlite3_column_text(stmt, 5);
-        const char *skin_name = (const char *)sqlite3_column_text(stmt, 6);
-        
-                float price = db_calculate_skin_price(definition_id, rarity, wear);
-                
-        if (username && skin_name)
-                    {
-            entries[entry_count].user_id = owner_id;
-            strncpy(entries[entry_count].username, username, 31);
-                        entries[entry_count].username[31] = '\0';
-                        entries[entry_count].value = price;
-                        snprintf(entries[entry_count].details, sizeof(entries[entry_count].details), 
-                                "Unboxed: %s", skin_name);
-                        entry_count++;
-        }
-    }
-    
-    sqlite3_finalize(stmt);
-    
-    // Sort by value (descending)
-    for (int i = 0; i < entry_count - 1; i++)
-    {
-        for (int j = i + 1; j < entry_count; j++)
-        {
-            if (entries[i].value < entries[j].value)
-            {
-                LeaderboardEntry temp = entries[i];
-                entries[i] = entries[j];
-                entries[j] = temp;
-            }
-        }
-    }
-    
-    // Copy top entries
-    int copy_count = (entry_count < limit) ? entry_count : limit;
-    for (int i = 0; i < copy_count; i++)
+    out_slice->total_ranked = leaderboard_index_size();
+    return 0;
+}
+
+// Get one page of traders by net worth
+int get_traders_page(int page, int page_size, LeaderboardSlice *out_slice, LeaderboardEntry *out_entries)
+{
+    if (page <= 0 || page_size <= 0 || page_size > LEADERBOARD_MAX_PAGE_SIZE || !out_slice || !out_entries)
+        return -1;
+    if (page > (INT_MAX - 1) / page_size)
+        return -1;
+
+    memset(out_slice, 0, sizeof(LeaderboardSlice));
+    out_slice->first_rank = (page - 1) * page_size + 1;
+    if (leaderboard_index_range(out_slice->first_rank, page_size, out_entries, &out_slice->count) != 0)
+        return -1;
+    out_slice->total_ranked = leaderboard_index_size();
+    return 0;
+}
+
+// Get a board over a time window
+int get_windowed_leaderboard(LeaderboardType type, LeaderboardWindow window, LeaderboardEntry *out_entries,
+                             int *count, int limit)
+{
+    if (!out_entries || !count || limit <= 0)
+        return -1;
+
+    if (window != LEADERBOARD_ALL_TIME)
+        return leaderboard_windows_top(type, window, out_entries, count, limit);
+
+    switch (type)
     {
-        out_entries[i] = entries[i];
+    case LEADERBOARD_TOP_TRADERS:
+        return get_top_traders(out_entries, count, limit);
+    case LEADERBOARD_LUCKIEST_UNBOXERS:
+        return get_luckiest_unboxers(out_entries, count, limit);
+    case LEADERBOARD_MOST_PROFITABLE:
+        return get_most_profitable(out_entries, count, limit);
     }
-    
-    *count = copy_count;
-    return 0;
+    return -1;
+}
+
+// Get luckiest unboxers (best unbox value), from the kept top unboxes
+int get_luckiest_unboxers(LeaderboardEntry *out_entries, int *count, int limit)
+{
+    if (!out_entries || !count || limit <= 0)
+        return -1;
+
+    return top_unboxes_get(out_entries, count, limit);
 }
 
 // Get most profitable traders
@@ -204,91 +104,37 @@ int get_most_profitable(LeaderboardEntry *out_entries, int *count, int limit)
     if (!out_entries || !count || limit <= 0)
         return -1;
     
-    // Calculate profit from market transactions
-    // Profit = (sell price - buy price) for each transaction
-    // This is simplified - in full implementation, we'd track buy prices
-    
-    // For now, we'll use a simplified approach:
-    // Calculate profit as: (total market sell revenue) - (estimated buy cost)
-    // Or use balance change over time
-    
-    // Get all users and calculate their profit
-    const char *sql = "SELECT user_id, username FROM users ORDER BY user_id";
+    // Profit is market sale proceeds (listing price of every sale), summed from the ledger
+    // in one grouped pass over the user_id-ordered index
+    const char *sql = "SELECT g.user_id, u.username, SUM(g.amount) AS total "
+                      "FROM ledger g JOIN users u ON u.user_id = g.user_id "
+                      "WHERE g.kind = ? GROUP BY g.user_id HAVING total > 0 "
+                      "ORDER BY total DESC, g.user_id LIMIT ?";
     sqlite3_stmt *stmt;
-    sqlite3 *db = db_get_connection();
-    if (!db)
-        return -1;
-    
-    int rc = sqlite3_prepare_v2(db, sql, -1, &stmt, 0);
-    if (rc != SQLITE_OK)
+    if (db_prepare(sql, &stmt) != SQLITE_OK)
     {
         *count = 0;
         return 0;
     }
+    sqlite3_bind_int(stmt, 1, LOG_MARKET_SELL);
+    sqlite3_bind_int(stmt, 2, limit);
     
-    LeaderboardEntry entries[100];
     int entry_count = 0;
-    
-    while (sqlite3_step(stmt) == SQLITE_ROW && entry_count < 100)
+    while (sqlite3_step(stmt) == SQLITE_ROW && entry_count < limit)
     {
-        int user_id = sqlite3_column_int(stmt, 0);
+        LeaderboardEntry *e = &out_entries[entry_count];
         const char *username = (const char *)sqlite3_column_text(stmt, 1);
+        float profit = (float)sqlite3_column_double(stmt, 2);
         
-        // Calculate profit from transaction logs
-        // Sum up LOG_MARKET_SELL transactions
-        const char *profit_sql = "SELECT SUM(CAST(SUBSTR(details, INSTR(details, '$') + 1, 20) AS REAL)) "
-                                 "FROM transaction_logs "
-                                 "WHERE user_id = ? AND type = ?";
-        sqlite3_stmt *profit_stmt;
-        rc = sqlite3_prepare_v2(db, profit_sql, -1, &profit_stmt, 0);
-        if (rc == SQLITE_OK)
-        {
-            sqlite3_bind_int(profit_stmt, 1, user_id);
-            sqlite3_bind_int(profit_stmt, 2, LOG_MARKET_SELL);
-            
-            float profit = 0.0f;
-            if (sqlite3_step(profit_stmt) == SQLITE_ROW)
-            {
-                profit = (float)sqlite3_column_double(profit_stmt, 0);
-            }
-            sqlite3_finalize(profit_stmt);
-            
-            if (profit > 0)
-            {
-                entries[entry_count].user_id = user_id;
-                strncpy(entries[entry_count].username, username, 31);
-                entries[entry_count].username[31] = '\0';
-                entries[entry_count].value = profit;
-                snprintf(entries[entry_count].details, sizeof(entries[entry_count].details), 
-                        "Total profit: +$%.2f", profit);
-                entry_count++;
-            }
-        }
-    }
-    
-    sqlite3_finalize(stmt);
-    
-    // Sort by profit (descending)
-    for (int i = 0; i < entry_count - 1; i++)
-    {
-        for (int j = i + 1; j < entry_count; j++)
-        {
-            if (entries[i].value < entries[j].value)
-            {
-                LeaderboardEntry temp = entries[i];
-                entries[i] = entries[j];
-                entries[j] = temp;
-            }
-        }
-    }
-    
-    // Copy top entries
-    int copy_count = (entry_count < limit) ? entry_count : limit;
-    for (int i = 0; i < copy_count; i++)
-    {
-        out_entries[i] = entries[i];
+        memset(e, 0, sizeof(LeaderboardEntry));
+        e->user_id = sqlite3_column_int(stmt, 0);
+        snprintf(e->username, sizeof(e->username), "%s", username ? username : "");
+        e->value = profit;
+        snprintf(e->details, sizeof(e->details), "Total profit: +$%.2f", profit);
+        entry_count++;
     }
+    db_finalize(stmt);
     
-    *count = copy_count;
+    *count = entry_count;
     return 0;
 }
@@ -2,6 +2,7 @@
 
 #include "../include/login_rewards.h"
 #include "../include/database.h"
+#include "../include/leaderboard_index.h"
 #include "../include/types.h"
 #include <stdio.h>
 #include <stdlib.h>
@@ -114,6 +115,8 @@ int claim_daily_reward(int user_id, float *reward_amount, int *streak_day)
     if (db_save_login_streak(&streak) != 0)
         return -5;
 
+    leaderboard_index_refresh_user(user_id);
+
     *reward_amount = reward;
     *streak_day = streak.current_streak;
     return 0;
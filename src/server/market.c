@@ -7,6 +7,8 @@
 #include "../include/quests.h"
 #include "../include/price_tracking.h"
 #include "../include/trading_challenges.h"
+#include "../include/leaderboard_index.h"
+#include "../include/leaderboard_windows.h"
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
@@ -108,6 +110,9 @@ int list_skin_on_market(int user_id, int instance_id, float price)
         return -9; // Failed to commit transaction
     }
 
+    // Fee paid and item off the inventory
+    leaderboard_index_refresh_user(user_id);
+
     return 0;
 }
 
@@ -208,7 +213,7 @@ int buy_from_market(int buyer_id, int listing_id)
     db_apply_trade_lock(instance_id);
 
     // Get definition_id for price history tracking
-    int definition_id;
+    int definition_id = 0;
     SkinRarity rarity;
     WearCondition wear;
     int pattern_seed, is_stattrak;
@@ -223,22 +228,25 @@ int buy_from_market(int buyer_id, int listing_id)
         save_price_history(definition_id, price, 1);
     }
 
-    // COMMIT TRANSACTION - All operations succeeded, make changes permanent
-    if (db_commit_transaction() != 0)
-    {
-        // Commit failed - rollback everything
-        db_rollback_transaction();
-        return -13; // Failed to commit transaction
-    }
-
-    // Log transaction (after commit - these are not critical for atomicity)
+    // Ledger rows are part of the sale: they commit or roll back with it
     TransactionLog log;
     log.log_id = 0; // Auto-increment
     log.type = LOG_MARKET_BUY;
     log.user_id = buyer_id;
     snprintf(log.details, sizeof(log.details), "Bought instance %d for $%.2f", instance_id, price);
     log.timestamp = time(NULL);
-    db_log_transaction(&log);
+    LedgerEntry entry;
+    memset(&entry, 0, sizeof(entry));
+    entry.amount = price;
+    entry.cost = price;
+    entry.instance_id = instance_id;
+    entry.counterparty_id = seller_id;
+    entry.definition_id = definition_id;
+    if (db_log_ledger(&log, &entry) != 0)
+    {
+        db_rollback_transaction();
+        return -13;
+    }
 
     TransactionLog log2;
     log2.log_id = 0;
@@ -246,7 +254,24 @@ int buy_from_market(int buyer_id, int listing_id)
     log2.user_id = seller_id;
     snprintf(log2.details, sizeof(log2.details), "Sold instance %d for $%.2f (received $%.2f after fee, +$%.2f listing fee refund)", instance_id, price, seller_payout - LISTING_FEE, LISTING_FEE);
     log2.timestamp = time(NULL);
-    db_log_transaction(&log2);
+    entry.cost = 0.0f;
+    entry.fee = price - seller_payout;
+    entry.counterparty_id = buyer_id;
+    if (db_log_ledger(&log2, &entry) != 0)
+    {
+        db_rollback_transaction();
+        return -13;
+    }
+
+    // COMMIT TRANSACTION - All operations succeeded, make changes permanent
+    if (db_commit_transaction() != 0)
+    {
+        // Commit failed - rollback everything
+        db_rollback_transaction();
+        return -13; // Failed to commit transaction
+    }
+
+    leaderboard_windows_record_sale(seller_id, buyer_id, price, log2.timestamp);
 
     // Update quests (after commit - these are not critical for atomicity)
     // Market Explorer quest: Buy 5 items from market
@@ -265,6 +290,9 @@ int buy_from_market(int buyer_id, int listing_id)
     update_user_active_challenges(buyer_id);
     update_user_active_challenges(seller_id);
 
+    leaderboard_index_refresh_user(buyer_id);
+    leaderboard_index_refresh_user(seller_id);
+
     return 0;
 }
 
@@ -297,6 +325,7 @@ int remove_listing(int listing_id)
     {
         // If adding to inventory fails, still remove listing but return error code
         db_remove_listing_v2(listing_id);
+        leaderboard_index_refresh_user(seller_id);
         return -3; // Failed to return item to inventory
     }
 
@@ -306,7 +335,9 @@ int remove_listing(int listing_id)
     // If item was unlocked before listing, it remains unlocked
 
     // Remove listing
-    return db_remove_listing_v2(listing_id);
+    int result = db_remove_listing_v2(listing_id);
+    leaderboard_index_refresh_user(seller_id);
+    return result;
 }
 
 // Update market prices based on supply/demand (simplified)
@@ -0,0 +1,540 @@
+// pricing_catalog.c - In-memory skin pricing tables and case roll tables
+
+#include "../include/pricing_catalog.h"
+#include "../include/database_internal.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdatomic.h>
+#include <pthread.h>
+#include <time.h>
+
+static _Atomic(PricingCatalog *) g_catalog = NULL;
+static PricingCatalog *g_retired = NULL; // Replaced catalogs, another thread may still be reading one
+static pthread_mutex_t g_reload_mutex = PTHREAD_MUTEX_INITIALIZER;
+static atomic_llong g_next_check = 0;    // time() at which catalog_version is read again
+
+// Drop rates in percent, rarest first. A rarity the case does not contain passes its share
+// down to the next more common one it does contain.
+static const struct
+{
+    SkinRarity rarity;
+    double percent;
+} g_drop_rates[] = {
+    {RARITY_CONTRABAND, 0.26},
+    {RARITY_COVERT, 0.64},
+    {RARITY_CLASSIFIED, 3.20},
+    {RARITY_RESTRICTED, 15.98},
+    {RARITY_MIL_SPEC, 79.92},
+};
+
+static void free_catalog(PricingCatalog *catalog)
+{
+    if (!catalog)
+        return;
+    if (catalog->cases)
+    {
+        for (int i = 0; i <= catalog->max_case_id; i++)
+        {
+            free(catalog->cases[i].definition_ids);
+            free(catalog->cases[i].accept);
+            free(catalog->cases[i].alias);
+        }
+    }
+    free(catalog->cases);
+    free(catalog->definitions);
+    free(catalog);
+}
+
+static int read_version(long long *version)
+{
+    sqlite3_stmt *stmt;
+    if (db_prepare("SELECT version FROM catalog_version WHERE id = 1", &stmt) != SQLITE_OK)
+        return -1;
+
+    int rc = -1;
+    if (sqlite3_step(stmt) == SQLITE_ROW)
+    {
+        *version = sqlite3_column_int64(stmt, 0);
+        rc = 0;
+    }
+    db_finalize(stmt);
+    return rc;
+}
+
+static int load_definitions(PricingCatalog *catalog)
+{
+    sqlite3_stmt *stmt;
+    if (db_prepare("SELECT MAX(definition_id) FROM skin_definitions", &stmt) != SQLITE_OK)
+        return -1;
+    if (sqlite3_step(stmt) == SQLITE_ROW)
+        catalog->max_definition_id = sqlite3_column_int(stmt, 0);
+    db_finalize(stmt);
+
+    if (catalog->max_definition_id < 0)
+        catalog->max_definition_id = 0;
+    catalog->definitions = calloc(catalog->max_definition_id + 1, sizeof(CatalogDefinition));
+    if (!catalog->definitions)
+        return -1;
+
+    if (db_prepare("SELECT definition_id, name, base_price, rarity FROM skin_definitions", &stmt) != SQLITE_OK)
+        return -1;
+    while (sqlite3_step(stmt) == SQLITE_ROW)
+    {
+        int definition_id = sqlite3_column_int(stmt, 0);
+        if (definition_id < 0 || definition_id > catalog->max_definition_id)
+            continue;
+
+        CatalogDefinition *def = &catalog->definitions[definition_id];
+        const char *name = (const char *)sqlite3_column_text(stmt, 1);
+        if (name)
+        {
+            strncpy(def->name, name, MAX_ITEM_NAME_LEN - 1);
+            def->name[MAX_ITEM_NAME_LEN - 1] = '\0';
+        }
+        def->base_price = (float)sqlite3_column_double(stmt, 2);
+        def->rarity = (SkinRarity)sqlite3_column_int(stmt, 3);
+        def->exists = 1;
+    }
+    db_finalize(stmt);
+    return 0;
+}
+
+static int load_rarities(PricingCatalog *catalog)
+{
+    sqlite3_stmt *stmt;
+    if (db_prepare("SELECT rarity, multiplier FROM rarity_multipliers", &stmt) != SQLITE_OK)
+        return -1;
+    while (sqlite3_step(stmt) == SQLITE_ROW)
+    {
+        int rarity = sqlite3_column_int(stmt, 0);
+        if (rarity < 0 || rarity >= CATALOG_RARITY_COUNT)
+            continue;
+        catalog->rarity_multipliers[rarity] = (float)sqlite3_column_double(stmt, 1);
+        catalog->rarity_known[rarity] = 1;
+    }
+    db_finalize(stmt);
+    return 0;
+}
+
+static int load_wear_ranges(PricingCatalog *catalog)
+{
+    sqlite3_stmt *stmt;
+    if (db_prepare("SELECT wear_min, wear_max, multiplier FROM wear_multipliers ORDER BY wear_min", &stmt) != SQLITE_OK)
+        return -1;
+
+    int count = 0;
+    while (sqlite3_step(stmt) == SQLITE_ROW && count < CATALOG_MAX_WEAR_RANGES)
+    {
+        catalog->wear_min[count] = sqlite3_column_double(stmt, 0);
+        catalog->wear_max[count] = sqlite3_column_double(stmt, 1);
+        catalog->wear_multiplier[count] = (float)sqlite3_column_double(stmt, 2);
+        if (catalog->wear_max[count] - catalog->wear_min[count] < 1.0 / CATALOG_WEAR_BUCKETS)
+            fprintf(stderr, "pricing_catalog: wear range %.4f-%.4f is narrower than a lookup bucket\n",
+                    catalog->wear_min[count], catalog->wear_max[count]);
+        count++;
+    }
+    db_finalize(stmt);
+    catalog->wear_range_count = count;
+
+    // Sentinel range that never matches, so lookups can always index one past a real range
+    catalog->wear_min[count] = 2.0;
+    catalog->wear_max[count] = 2.0;
+    catalog->wear_multiplier[count] = 0.0f;
+
+    // Lower range wins on a shared boundary, like the old "LIMIT 1" query
+    int range = 0;
+    for (int b = 0; b <= CATALOG_WEAR_BUCKETS; b++)
+    {
+        double start = (double)b / CATALOG_WEAR_BUCKETS;
+        while (range < count && catalog->wear_max[range] < start)
+            range++;
+        catalog->wear_bucket[b] = (unsigned char)range;
+    }
+    return 0;
+}
+
+// Chance of each rarity given which rarities the case contains. If none of the rarities
+// from a band's own down to Mil-Spec is present, the share goes to the most common one.
+static void case_rarity_weights(const int *pool_size, double *weight)
+{
+    int lowest = -1;
+    for (int r = 0; r < CATALOG_RARITY_COUNT; r++)
+    {
+        weight[r] = 0.0;
+        if (lowest < 0 && pool_size[r] > 0)
+            lowest = r;
+    }
+    if (lowest < 0)
+        return;
+
+    int bands = (int)(sizeof(g_drop_rates) / sizeof(g_drop_rates[0]));
+    for (int i = 0; i < bands; i++)
+    {
+        int target = lowest;
+        for (int j = i; j < bands; j++)
+        {
+            if (pool_size[g_drop_rates[j].rarity] > 0)
+            {
+                target = g_drop_rates[j].rarity;
+                break;
+            }
+        }
+        weight[target] += g_drop_rates[i].percent / 100.0;
+    }
+}
+
+// Vose's alias method over weights that sum to 1
+static int build_alias_table(CatalogCase *c, const double *weights)
+{
+    int n = c->skin_count;
+    double *scaled = malloc(n * sizeof(double));
+    int *small = malloc(n * sizeof(int));
+    int *large = malloc(n * sizeof(int));
+    if (!scaled || !small || !large)
+    {
+        free(scaled);
+        free(small);
+        free(large);
+        return -1;
+    }
+
+    int small_count = 0, large_count = 0;
+    for (int i = 0; i < n; i++)
+    {
+        scaled[i] = weights[i] * n;
+        if (scaled[i] < 1.0)
+            small[small_count++] = i;
+        else
+            large[large_count++] = i;
+    }
+
+    while (small_count > 0 && large_count > 0)
+    {
+        int s = small[--small_count];
+        int l = large[--large_count];
+        c->accept[s] = scaled[s];
+        c->alias[s] = l;
+        scaled[l] = (scaled[l] + scaled[s]) - 1.0;
+        if (scaled[l] < 1.0)
+            small[small_count++] = l;
+        else
+            large[large_count++] = l;
+    }
+    // Whatever is left is 1 up to rounding
+    while (large_count > 0)
+    {
+        int l = large[--large_count];
+        c->accept[l] = 1.0;
+        c->alias[l] = l;
+    }
+    while (small_count > 0)
+    {
+        int s = small[--small_count];
+        c->accept[s] = 1.0;
+        c->alias[s] = s;
+    }
+
+    free(scaled);
+    free(small);
+    free(large);
+    return 0;
+}
+
+// Compile one case's skins (definition ids, all known to the catalog) into its roll table
+static int build_case(const PricingCatalog *catalog, CatalogCase *c, const int *ids, int count)
+{
+    int pool_size[CATALOG_RARITY_COUNT] = {0};
+    for (int i = 0; i < count; i++)
+    {
+        SkinRarity rarity = catalog->definitions[ids[i]].rarity;
+        if ((int)rarity >= 0 && rarity < CATALOG_RARITY_COUNT)
+            pool_size[rarity]++;
+    }
+    case_rarity_weights(pool_size, c->rarity_weight);
+
+    double *weights = malloc(count * sizeof(double));
+    c->definition_ids = malloc(count * sizeof(int));
+    c->accept = malloc(count * sizeof(double));
+    c->alias = malloc(count * sizeof(int));
+    if (!weights || !c->definition_ids || !c->accept || !c->alias)
+    {
+        free(weights);
+        return -1;
+    }
+
+    int n = 0;
+    for (int i = 0; i < count; i++)
+    {
+        SkinRarity rarity = catalog->definitions[ids[i]].rarity;
+        if ((int)rarity < 0 || rarity >= CATALOG_RARITY_COUNT || c->rarity_weight[rarity] <= 0.0)
+            continue;
+        c->definition_ids[n] = ids[i];
+        weights[n] = c->rarity_weight[rarity] / pool_size[rarity];
+        n++;
+    }
+    c->skin_count = n;
+
+    int rc = n > 0 ? build_alias_table(c, weights) : 0;
+    free(weights);
+    return rc;
+}
+
+// Per-case skin lists are collected first, then each case is compiled into an alias table
+static int load_cases(PricingCatalog *catalog)
+{
+    sqlite3_stmt *stmt;
+    if (db_prepare("SELECT MAX(case_id) FROM cases", &stmt) != SQLITE_OK)
+        return -1;
+    if (sqlite3_step(stmt) == SQLITE_ROW)
+        catalog->max_case_id = sqlite3_column_int(stmt, 0);
+    db_finalize(stmt);
+
+    if (catalog->max_case_id < 0)
+        catalog->max_case_id = 0;
+    catalog->cases = calloc(catalog->max_case_id + 1, sizeof(CatalogCase));
+    if (!catalog->cases)
+        return -1;
+
+    if (db_prepare("SELECT case_id, name, price FROM cases", &stmt) != SQLITE_OK)
+        return -1;
+    while (sqlite3_step(stmt) == SQLITE_ROW)
+    {
+        int case_id = sqlite3_column_int(stmt, 0);
+        if (case_id < 0 || case_id > catalog->max_case_id)
+            continue;
+
+        CatalogCase *c = &catalog->cases[case_id];
+        const char *name = (const char *)sqlite3_column_text(stmt, 1);
+        if (name)
+        {
+            strncpy(c->name, name, sizeof(c->name) - 1);
+            c->name[sizeof(c->name) - 1] = '\0';
+        }
+        c->price = (float)sqlite3_column_double(stmt, 2);
+        c->exists = 1;
+    }
+    db_finalize(stmt);
+
+    // Ordered by case so each case's skins arrive together
+    if (db_prepare("SELECT case_id, definition_id FROM case_skins ORDER BY case_id, definition_id", &stmt) != SQLITE_OK)
+        return -1;
+
+    int capacity = 64;
+    int *ids = malloc(capacity * sizeof(int));
+    if (!ids)
+    {
+        db_finalize(stmt);
+        return -1;
+    }
+
+    int rc = 0;
+    int current = -1, count = 0;
+    int step;
+    while (1)
+    {
+        step = sqlite3_step(stmt);
+        int case_id = step == SQLITE_ROW ? sqlite3_column_int(stmt, 0) : -1;
+        if (case_id != current)
+        {
+            if (current >= 0)
+                rc = build_case(catalog, &catalog->cases[current], ids, count);
+            count = 0;
+            current = (case_id >= 0 && case_id <= catalog->max_case_id && catalog->cases[case_id].exists) ? case_id : -1;
+        }
+        if (step != SQLITE_ROW || rc != 0)
+            break;
+
+        int definition_id = sqlite3_column_int(stmt, 1);
+        if (current < 0 || definition_id < 0 || definition_id > catalog->max_definition_id ||
+            !catalog->definitions[definition_id].exists)
+            continue;
+        if (count == capacity)
+        {
+            int *grown = realloc(ids, capacity * 2 * sizeof(int));
+            if (!grown)
+            {
+                rc = -1;
+                break;
+            }
+            ids = grown;
+            capacity *= 2;
+        }
+        ids[count++] = definition_id;
+    }
+    db_finalize(stmt);
+    free(ids);
+    if (step != SQLITE_DONE && rc == 0)
+        rc = -1;
+    return rc;
+}
+
+// Build a catalog from the calling thread's connection, in one read snapshot
+static PricingCatalog *load_catalog(void)
+{
+    sqlite3 *db = db_get_connection();
+    if (!db)
+        return NULL;
+
+    PricingCatalog *catalog = calloc(1, sizeof(PricingCatalog));
+    if (!catalog)
+        return NULL;
+
+    // Already inside a transaction (e.g. on the writer that just changed a table): use it
+    int own_transaction = sqlite3_get_autocommit(db) && sqlite3_exec(db, "BEGIN", 0, 0, 0) == SQLITE_OK;
+
+    int rc = read_version(&catalog->version);
+    if (rc == 0)
+        rc = load_definitions(catalog);
+    if (rc == 0)
+        rc = load_rarities(catalog);
+    if (rc == 0)
+        rc = load_wear_ranges(catalog);
+    if (rc == 0)
+        rc = load_cases(catalog);
+
+    if (own_transaction)
+        sqlite3_exec(db, "COMMIT", 0, 0, 0);
+
+    if (rc != 0)
+    {
+        fprintf(stderr, "pricing_catalog: load failed: %s\n", sqlite3_errmsg(db));
+        free_catalog(catalog);
+        return NULL;
+    }
+    return catalog;
+}
+
+int pricing_catalog_reload(void)
+{
+    pthread_mutex_lock(&g_reload_mutex);
+    PricingCatalog *catalog = load_catalog();
+    if (!catalog)
+    {
+        pthread_mutex_unlock(&g_reload_mutex);
+        return -1;
+    }
+
+    PricingCatalog *old = atomic_exchange_explicit(&g_catalog, catalog, memory_order_acq_rel);
+    if (old)
+    {
+        old->retired_next = g_retired;
+        g_retired = old;
+    }
+    atomic_store(&g_next_check, (long long)time(NULL) + CATALOG_CHECK_INTERVAL_SEC);
+    pthread_mutex_unlock(&g_reload_mutex);
+    return 0;
+}
+
+int pricing_catalog_init(void)
+{
+    return pricing_catalog_reload();
+}
+
+const PricingCatalog *pricing_catalog_get(void)
+{
+    PricingCatalog *catalog = atomic_load_explicit(&g_catalog, memory_order_acquire);
+
+    // One caller per interval checks whether the tables changed
+    long long now = (long long)time(NULL);
+    long long next = atomic_load_explicit(&g_next_check, memory_order_relaxed);
+    if (now >= next && atomic_compare_exchange_strong(&g_next_check, &next, now + CATALOG_CHECK_INTERVAL_SEC))
+    {
+        long long version;
+        if (!catalog || (read_version(&version) == 0 && version != catalog->version))
+        {
+            pricing_catalog_reload();
+            catalog = atomic_load_explicit(&g_catalog, memory_order_acquire);
+        }
+    }
+    return catalog;
+}
+
+void pricing_catalog_cleanup(void)
+{
+    pthread_mutex_lock(&g_reload_mutex);
+    free_catalog(atomic_exchange(&g_catalog, NULL));
+    while (g_retired)
+    {
+        PricingCatalog *next = g_retired->retired_next;
+        free_catalog(g_retired);
+        g_retired = next;
+    }
+    atomic_store(&g_next_check, 0);
+    pthread_mutex_unlock(&g_reload_mutex);
+}
+
+int pricing_catalog_definition(const PricingCatalog *catalog, int definition_id, const CatalogDefinition **out_def)
+{
+    if (!catalog || definition_id < 0 || definition_id > catalog->max_definition_id ||
+        !catalog->definitions[definition_id].exists)
+        return -1;
+    *out_def = &catalog->definitions[definition_id];
+    return 0;
+}
+
+int pricing_catalog_rarity_multiplier(const PricingCatalog *catalog, SkinRarity rarity, float *multiplier)
+{
+    if (!catalog || (int)rarity < 0 || rarity >= CATALOG_RARITY_COUNT || !catalog->rarity_known[rarity])
+        return -1;
+    *multiplier = catalog->rarity_multipliers[rarity];
+    return 0;
+}
+
+// Multiplier of the range holding wear (0..1), 0 if it falls in a gap between ranges
+static inline float wear_lookup(const PricingCatalog *catalog, WearCondition wear, int *found)
+{
+    double w = wear;
+    int range = catalog->wear_bucket[(int)(w * CATALOG_WEAR_BUCKETS)];
+    range += (w > catalog->wear_max[range]); // A bucket spans at most one range boundary
+    int hit = (w >= catalog->wear_min[range]) & (w <= catalog->wear_max[range]);
+    *found = hit;
+    return catalog->wear_multiplier[range] * (float)hit;
+}
+
+int pricing_catalog_wear_multiplier(const PricingCatalog *catalog, WearCondition wear, float *multiplier)
+{
+    if (!catalog || !(wear >= 0.0f && wear <= 1.0f))
+        return -1;
+
+    int found;
+    float value = wear_lookup(catalog, wear, &found);
+    if (!found)
+        return -1;
+    *multiplier = value;
+    return 0;
+}
+
+float pricing_catalog_price(const PricingCatalog *catalog, int definition_id, SkinRarity rarity, WearCondition wear)
+{
+    if (!catalog || definition_id < 0 || definition_id > catalog->max_definition_id ||
+        (int)rarity < 0 || rarity >= CATALOG_RARITY_COUNT || !(wear >= 0.0f && wear <= 1.0f))
+        return 0.0f;
+
+    // Unknown definitions and rarities have a zero price or multiplier, so no further checks are needed
+    const CatalogDefinition *def = &catalog->definitions[definition_id];
+    int found;
+    float wear_mult = wear_lookup(catalog, wear, &found);
+    return def->base_price * (float)def->exists * catalog->rarity_multipliers[rarity] * wear_mult;
+}
+
+int pricing_catalog_case(const PricingCatalog *catalog, int case_id, const CatalogCase **out_case)
+{
+    if (!catalog || case_id < 0 || case_id > catalog->max_case_id || !catalog->cases[case_id].exists)
+        return -1;
+    *out_case = &catalog->cases[case_id];
+    return 0;
+}
+
+int pricing_catalog_roll_case(const CatalogCase *case_data, double u1, double u2)
+{
+    if (!case_data || case_data->skin_count <= 0)
+        return -1;
+
+    int column = (int)(u1 * case_data->skin_count);
+    if (column >= case_data->skin_count)
+        column = case_data->skin_count - 1;
+    if (u2 >= case_data->accept[column])
+        column = case_data->alias[column];
+    return case_data->definition_ids[column];
+}
@@ -2,8 +2,10 @@
 
 #include "../include/quests.h"
 #include "../include/database.h"
+#include "../include/database_internal.h"
 #include "../include/types.h"
 #include "../include/logger.h"
+#include "../include/leaderboard_index.h"
 #include <sqlite3.h>
 #include <stdio.h>
 #include <stdlib.h>
@@ -44,8 +46,8 @@ int init_daily_quests(int user_id)
 
     // Delete ALL old quests for this user (both completed and incomplete, but not claimed)
     // Daily quests reset after 24 hours, so we delete all unclaimed quests
-    sqlite3 *db;
-    if (sqlite3_open("data/database.db", &db) != SQLITE_OK)
+    sqlite3 *db = db_get_connection();
+    if (!db)
         return -1;
 
     // Delete all unclaimed quests (both completed and incomplete)
@@ -59,8 +61,6 @@ int init_daily_quests(int user_id)
         LOG_INFO("[QUESTS] Deleted old unclaimed quests for user %d", user_id);
     }
 
-    sqlite3_close(db);
-
     // Create 5 daily quests
     Quest quests[5] = {0};
     time_t now = time(NULL);
@@ -285,6 +285,7 @@ int claim_quest_reward(int user_id, int quest_id)
 
             LOG_INFO("[QUESTS] Quest reward claimed successfully: user_id=%d, quest_id=%d, reward=$%.2f, new_balance=$%.2f",
                      user_id, quest_id, reward, user.balance);
+            leaderboard_index_refresh_user(user_id);
             return 0;
         }
     }
@@ -25,7 +25,13 @@
 #include <arpa/inet.h>
 #include <errno.h>
 #include <time.h>
+#include <poll.h>
 #define MAGIC_NUMBER 0xABCD
+#define SEND_TIMEOUT_MS 5000 // Give up on a client that does not drain one response within this time
+
+// sequence_num of the request this worker is handling, echoed in every response so
+// clients can pipeline requests and match replies
+static __thread uint32_t t_request_sequence = 0;
 
 
 // Validate message header
@@ -191,12 +197,53 @@ int receive_message(int client_fd, Message *message)
     return 0;
 }
 
-// Send response to client (handles partial sends)
-int send_response(int client_fd, Message *response)
+// Current time on the monotonic clock in milliseconds (send deadlines)
+static long long monotonic_ms(void)
 {
-    if (!response || client_fd < 0)
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (long long)ts.tv_sec * 1000 + ts.tv_nsec / 1000000;
+}
+
+// Wait until a non-blocking socket can accept more data or the deadline passes (0 = writable)
+static int wait_for_writable(int client_fd, long long deadline_ms)
+{
+    struct pollfd pfd;
+    pfd.fd = client_fd;
+    pfd.events = POLLOUT;
+    pfd.revents = 0;
+
+    int ready;
+    do
     {
-        LOG_ERROR_CTX(0, client_fd, "[NETWORK] Cannot send response: invalid socket or null response");
+        long long remaining = deadline_ms - monotonic_ms();
+        if (remaining <= 0)
+            return -1;
+        ready = poll(&pfd, 1, (int)remaining);
+    } while (ready < 0 && errno == EINTR);
+
+    if (ready <= 0 || (pfd.revents & (POLLERR | POLLHUP | POLLNVAL)))
+        return -1;
+    return 0;
+}
+
+// A frame was cut off: later frames would be misread, so shut the socket down and let the
+// network thread reap the connection
+static void abort_stream(int client_fd)
+{
+    LOG_WARNING_CTX(0, client_fd, "[NETWORK] Response cut off, shutting down connection");
+    shutdown(client_fd, SHUT_RDWR);
+}
+
+// Send one frame (handles partial sends), waiting for socket space until deadline_ms at the latest.
+// If the frame is left half-written the connection is shut down. Only the worker that owns the
+// connection's mailbox writes to the socket, so frames never interleave.
+static int send_frame(int client_fd, Message *response, long long deadline_ms)
+{
+    if (response->header.msg_length > MAX_PAYLOAD_SIZE)
+    {
+        LOG_ERROR_CTX(0, client_fd, "[NETWORK] Response payload too large for one frame: %d bytes (max=%d)",
+                      response->header.msg_length, MAX_PAYLOAD_SIZE);
         return -1;
     }
     
@@ -216,7 +263,7 @@ int send_response(int client_fd, Message *response)
     while (total_sent < sizeof(MessageHeader))
     {
         ssize_t sent = send(client_fd, header_ptr + total_sent, 
-                           sizeof(MessageHeader) - total_sent, 0);
+                           sizeof(MessageHeader) - total_sent, MSG_NOSIGNAL);
         if (sent < 0)
         {
             if (errno == EINTR)
@@ -226,10 +273,17 @@ int send_response(int client_fd, Message *response)
             }
             if (errno == EAGAIN || errno == EWOULDBLOCK)
             {
-                LOG_DEBUG_CTX(0, client_fd, "[NETWORK] send() would block");
-                return -1; // Would block
+                // Client sockets are non-blocking under the epoll reactor: wait for buffer space
+                if (wait_for_writable(client_fd, deadline_ms) == 0)
+                    continue;
+                LOG_DEBUG_CTX(0, client_fd, "[NETWORK] send() timed out");
+                if (total_sent > 0)
+                    abort_stream(client_fd);
+                return -1; // Client is not draining its socket
             }
             LOG_ERROR_CTX(0, client_fd, "[NETWORK] send() error while sending header: %s", strerror(errno));
+            if (total_sent > 0)
+                abort_stream(client_fd);
             return -1; // Error
         }
         if (sent == 0)
@@ -254,7 +308,7 @@ int send_response(int client_fd, Message *response)
         while (total_sent < response->header.msg_length)
         {
             ssize_t sent = send(client_fd, response->payload + total_sent,
-                               response->header.msg_length - total_sent, 0);
+                               response->header.msg_length - total_sent, MSG_NOSIGNAL);
             if (sent < 0)
             {
                 if (errno == EINTR)
@@ -264,10 +318,14 @@ int send_response(int client_fd, Message *response)
                 }
                 if (errno == EAGAIN || errno == EWOULDBLOCK)
                 {
-                    LOG_DEBUG_CTX(0, client_fd, "[NETWORK] send() would block");
-                    return -1; // Would block
+                    if (wait_for_writable(client_fd, deadline_ms) == 0)
+                        continue;
+                    LOG_DEBUG_CTX(0, client_fd, "[NETWORK] send() timed out");
+                    abort_stream(client_fd); // Header is already out
+                    return -1; // Client is not draining its socket
                 }
                 LOG_ERROR_CTX(0, client_fd, "[NETWORK] send() error while sending payload: %s", strerror(errno));
+                abort_stream(client_fd);
                 return -1; // Error
             }
             if (sent == 0)
@@ -305,6 +363,43 @@ int send_response(int client_fd, Message *response)
     return 0;
 }
 
+// Send response to client
+int send_response(int client_fd, Message *response)
+{
+    if (!response || client_fd < 0)
+    {
+        LOG_ERROR_CTX(0, client_fd, "[NETWORK] Cannot send response: invalid socket or null response");
+        return -1;
+    }
+    
+    // Single frame: the whole response is in this payload
+    response->header.total_length = response->header.msg_length;
+    response->header.flags = 0;
+    
+    return send_frame(client_fd, response, monotonic_ms() + SEND_TIMEOUT_MS);
+}
+
+// Reject a request with ERR_SERVER_FULL. Called by a worker when the connection's mailbox
+// reaches the shed request, so the reply follows the responses to earlier requests.
+int send_server_full_response(int client_fd, const MessageHeader *request_header)
+{
+    if (!request_header || client_fd < 0)
+        return -1;
+    
+    Message response;
+    memset(&response.header, 0, sizeof(MessageHeader));
+    response.header.magic = MAGIC_NUMBER;
+    response.header.msg_type = MSG_ERROR;
+    response.header.msg_length = sizeof(uint16_t) + sizeof(uint32_t);
+    response.header.sequence_num = request_header->sequence_num;
+    
+    uint32_t error_code = ERR_SERVER_FULL;
+    memcpy(response.payload, &request_header->msg_type, sizeof(uint16_t));
+    memcpy(response.payload + sizeof(uint16_t), &error_code, sizeof(uint32_t));
+    
+    return send_response(client_fd, &response);
+}
+
 // Helper: Create error response
 static void create_error_response(Message *response, uint16_t request_type, uint32_t error_code)
 {
@@ -312,7 +407,7 @@ static void create_error_response(Message *response, uint16_t request_type, uint
     response->header.magic = MAGIC_NUMBER;
     response->header.msg_type = MSG_ERROR;
     response->header.msg_length = sizeof(uint16_t) + sizeof(uint32_t);
-    response->header.sequence_num = 0;
+    response->header.sequence_num = t_request_sequence;
     
     // Pack error info into payload
     memcpy(response->payload, &request_type, sizeof(uint16_t));
@@ -326,7 +421,7 @@ static void create_success_response(Message *response, uint16_t msg_type, const
     response->header.magic = MAGIC_NUMBER;
     response->header.msg_type = msg_type;
     response->header.msg_length = data_len;
-    response->header.sequence_num = 0;
+    response->header.sequence_num = t_request_sequence;
     
     if (data && data_len > 0 && data_len <= MAX_PAYLOAD_SIZE)
     {
@@ -334,6 +429,41 @@ static void create_success_response(Message *response, uint16_t msg_type, const
     }
 }
 
+// Helper: Send a success response of any size, split into MAX_PAYLOAD_SIZE chunks when needed
+static int send_chunked_response(int client_fd, Message *response, uint16_t msg_type, const void *data, size_t data_len)
+{
+    if (data_len <= MAX_PAYLOAD_SIZE)
+    {
+        create_success_response(response, msg_type, data, data_len);
+        return send_response(client_fd, response);
+    }
+    
+    LOG_DEBUG_CTX(0, client_fd, "[NETWORK] Sending chunked response: type=0x%04X, total_length=%zu, chunks=%zu",
+                  msg_type, data_len, (data_len + MAX_PAYLOAD_SIZE - 1) / MAX_PAYLOAD_SIZE);
+    
+    // The connection's mailbox stays in flight until the last chunk is out, so no broadcast or
+    // other response is written between them. One deadline covers the whole response.
+    long long deadline_ms = monotonic_ms() + SEND_TIMEOUT_MS;
+    int result = 0;
+    size_t offset = 0;
+    while (offset < data_len && result == 0)
+    {
+        size_t chunk_len = data_len - offset;
+        if (chunk_len > MAX_PAYLOAD_SIZE)
+            chunk_len = MAX_PAYLOAD_SIZE;
+        
+        create_success_response(response, msg_type, (const char *)data + offset, chunk_len);
+        response->header.total_length = (uint32_t)data_len;
+        response->header.flags = (offset + chunk_len < data_len) ? MSG_FLAG_MORE_CHUNKS : 0;
+        result = send_frame(client_fd, response, deadline_ms);
+        if (result != 0 && offset > 0)
+            abort_stream(client_fd); // Earlier chunks are out, the client would wait for the rest
+        offset += chunk_len;
+    }
+    
+    return result;
+}
+
 // Handle authentication messages
 static int handle_auth_request(int client_fd, Message *request, Message *response)
 {
@@ -840,8 +970,7 @@ static int handle_trading_request(int client_fd, Message *request, Message *resp
         if (result == 0 && count > 0)
         {
             if (count > 50) count = 50;
-            create_success_response(response, MSG_TRADES_DATA, trades, sizeof(TradeOffer) * count);
-            response->header.msg_length = sizeof(TradeOffer) * count;
+            return send_chunked_response(client_fd, response, MSG_TRADES_DATA, trades, sizeof(TradeOffer) * count);
         }
         else
         {
@@ -902,8 +1031,7 @@ static int handle_unbox_request(int client_fd, Message *request, Message *respon
         
         if (result == 0 && count > 0)
         {
-            create_success_response(response, MSG_CASES_DATA, cases, sizeof(Case) * count);
-            response->header.msg_length = sizeof(Case) * count;
+            return send_chunked_response(client_fd, response, MSG_CASES_DATA, cases, sizeof(Case) * count);
         }
         else
         {
@@ -940,6 +1068,35 @@ static int handle_unbox_request(int client_fd, Message *request, Message *respon
         }
         break;
     }
+
+    case MSG_UNBOX_CASE_BATCH:
+    {
+        // Parse: user_id:case_id:count
+        uint32_t user_id, case_id, count;
+        if (sscanf((char *)request->payload, "%u:%u:%u", &user_id, &case_id, &count) != 3 ||
+            count == 0 || count > MAX_UNBOX_BATCH)
+        {
+            create_error_response(response, MSG_UNBOX_CASE_BATCH, ERR_INVALID_REQUEST);
+            return send_response(client_fd, response);
+        }
+
+        // Summary first, then the skins, as one chunked payload
+        struct
+        {
+            UnboxBatchResult summary;
+            Skin skins[MAX_UNBOX_BATCH];
+        } batch;
+        memset(&batch, 0, sizeof(batch));
+        int result = unbox_case_batch((int)user_id, (int)case_id, (int)count, batch.skins, &batch.summary);
+
+        if (result == 0)
+        {
+            return send_chunked_response(client_fd, response, MSG_UNBOX_BATCH_RESULT, &batch,
+                                         sizeof(UnboxBatchResult) + sizeof(Skin) * count);
+        }
+        create_error_response(response, MSG_UNBOX_CASE_BATCH, map_unbox_error(result));
+        break;
+    }
     
     default:
         create_error_response(response, request->header.msg_type, ERR_INVALID_REQUEST);
@@ -949,6 +1106,27 @@ static int handle_unbox_request(int client_fd, Message *request, Message *respon
     return send_response(client_fd, response);
 }
 
+// Build the Skin sent to clients from an instance record (rarity and price from its definition)
+static void skin_from_record(const SkinInstanceRecord *rec, Skin *skin)
+{
+    memset(skin, 0, sizeof(Skin));
+    skin->skin_id = rec->instance_id;
+    snprintf(skin->name, sizeof(skin->name), "%s", rec->name);
+    skin->rarity = rec->definition_rarity;
+    skin->wear = rec->wear;
+    skin->pattern_seed = rec->pattern_seed;
+    skin->is_stattrak = rec->is_stattrak;
+
+    float rarity_mult = 1.0f;
+    db_get_rarity_multiplier(skin->rarity, &rarity_mult);
+    skin->base_price = rec->base_price * rarity_mult;
+
+    skin->current_price = db_calculate_skin_price(rec->definition_id, skin->rarity, rec->wear);
+    skin->owner_id = rec->owner_id;
+    skin->acquired_at = rec->acquired_at;
+    skin->is_tradable = rec->is_tradable;
+}
+
 // Handle inventory messages
 static int handle_inventory_request(int client_fd, Message *request, Message *response)
 {
@@ -979,6 +1157,32 @@ static int handle_inventory_request(int client_fd, Message *request, Message *re
         break;
     }
     
+    case MSG_GET_INVENTORY_FULL:
+    {
+        // Parse: user_id
+        uint32_t user_id;
+        if (sscanf((char *)request->payload, "%u", &user_id) != 1)
+        {
+            create_error_response(response, MSG_GET_INVENTORY_FULL, ERR_INVALID_REQUEST);
+            return send_response(client_fd, response);
+        }
+        
+        // Every item resolved in one query, sent as one (chunked) response
+        SkinInstanceRecord records[MAX_INVENTORY_SIZE];
+        int count = 0;
+        if (db_load_inventory_instances((int)user_id, records, &count) != 0)
+        {
+            create_error_response(response, MSG_GET_INVENTORY_FULL, ERR_DATABASE_ERROR);
+            return send_response(client_fd, response);
+        }
+        
+        Skin skins[MAX_INVENTORY_SIZE];
+        for (int i = 0; i < count; i++)
+            skin_from_record(&records[i], &skins[i]);
+        
+        return send_chunked_response(client_fd, response, MSG_INVENTORY_FULL_DATA, skins, sizeof(Skin) * count);
+    }
+    
     case MSG_GET_USER_PROFILE:
     {
         // Parse: user_id
@@ -1039,52 +1243,18 @@ static int handle_inventory_request(int client_fd, Message *request, Message *re
             return send_response(client_fd, response);
         }
         
-        // Load skin instance
-        int definition_id;
-        SkinRarity rarity;
-        WearCondition wear;
-        int pattern_seed;
-        int is_stattrak;
-        int owner_id;
-        time_t acquired_at;
-        int is_tradable;
-        
-        if (db_load_skin_instance((int)instance_id, &definition_id, &rarity, &wear, &pattern_seed, &is_stattrak, &owner_id, &acquired_at, &is_tradable) != 0)
+        // Load skin instance with its definition
+        int id = (int)instance_id;
+        SkinInstanceRecord rec;
+        int found = 0;
+        if (db_load_skin_instances(&id, 1, &rec, &found) != 0 || found == 0 || rec.name[0] == '\0')
         {
             create_error_response(response, MSG_GET_SKIN_DETAILS, ERR_ITEM_NOT_FOUND);
             return send_response(client_fd, response);
         }
         
-        // Load skin definition
-        char def_name[MAX_ITEM_NAME_LEN];
-        float def_base_price;
-        if (db_load_skin_definition_with_rarity(definition_id, def_name, &def_base_price, &rarity) != 0)
-        {
-            create_error_response(response, MSG_GET_SKIN_DETAILS, ERR_ITEM_NOT_FOUND);
-            return send_response(client_fd, response);
-        }
-        
-        // Calculate price
-        float current_price = db_calculate_skin_price(definition_id, rarity, wear);
-        
-        // Construct full Skin object
         Skin skin;
-        memset(&skin, 0, sizeof(Skin));
-        skin.skin_id = (int)instance_id;
-        strncpy(skin.name, def_name, MAX_ITEM_NAME_LEN);
-        skin.rarity = rarity;
-        skin.wear = wear;
-        skin.pattern_seed = pattern_seed;
-        skin.is_stattrak = is_stattrak;
-        
-        float rarity_mult = 1.0f;
-        db_get_rarity_multiplier(rarity, &rarity_mult);
-        skin.base_price = def_base_price * rarity_mult;
-        
-        skin.current_price = current_price;
-        skin.owner_id = owner_id;
-        skin.acquired_at = acquired_at;
-        skin.is_tradable = is_tradable;
+        skin_from_record(&rec, &skin);
         
         create_success_response(response, MSG_SKIN_DETAILS_DATA, &skin, sizeof(Skin));
         response->header.msg_length = sizeof(Skin);
@@ -1323,8 +1493,7 @@ static int handle_chat_request(int client_fd, Message *request, Message *respons
         int count = 0;
         if (get_recent_chat_messages(messages, &count, limit) == 0)
         {
-            create_success_response(response, MSG_CHAT_HISTORY_DATA, messages, sizeof(ChatMessage) * count);
-            response->header.msg_length = sizeof(ChatMessage) * count;
+            return send_chunked_response(client_fd, response, MSG_CHAT_HISTORY_DATA, messages, sizeof(ChatMessage) * count);
         }
         else
         {
@@ -1348,26 +1517,31 @@ static int handle_leaderboards_request(int client_fd, Message *request, Message
     {
     case MSG_GET_TOP_TRADERS:
     {
-        // Parse: limit (optional, default 10)
+        // Parse: limit:window (both optional, default 10 all-time)
         int limit = 10;
+        int window = LEADERBOARD_ALL_TIME;
         if (request->header.msg_length > 0)
         {
-            sscanf((char *)request->payload, "%d", &limit);
+            sscanf((char *)request->payload, "%d:%d", &limit, &window);
         }
         if (limit <= 0 || limit > 100)
             limit = 10;
+        if (window < LEADERBOARD_ALL_TIME || window > LEADERBOARD_MONTHLY)
+        {
+            create_error_response(response, request->header.msg_type, ERR_INVALID_REQUEST);
+            break;
+        }
         
         LeaderboardEntry entries[100];
         int count = 0;
-        int result = get_top_traders(entries, &count, limit);
+        int result = get_windowed_leaderboard(LEADERBOARD_TOP_TRADERS, (LeaderboardWindow)window, entries, &count, limit);
         
         if (result == 0)
         {
             // Always return success, even if count is 0 (empty leaderboard)
             if (count > 0)
             {
-                create_success_response(response, MSG_TOP_TRADERS_DATA, entries, sizeof(LeaderboardEntry) * count);
-                response->header.msg_length = sizeof(LeaderboardEntry) * count;
+                return send_chunked_response(client_fd, response, MSG_TOP_TRADERS_DATA, entries, sizeof(LeaderboardEntry) * count);
             }
             else
             {
@@ -1384,26 +1558,31 @@ static int handle_leaderboards_request(int client_fd, Message *request, Message
     
     case MSG_GET_LUCKIEST_UNBOXERS:
     {
-        // Parse: limit (optional, default 10)
+        // Parse: limit:window (both optional, default 10 all-time)
         int limit = 10;
+        int window = LEADERBOARD_ALL_TIME;
         if (request->header.msg_length > 0)
         {
-            sscanf((char *)request->payload, "%d", &limit);
+            sscanf((char *)request->payload, "%d:%d", &limit, &window);
         }
         if (limit <= 0 || limit > 100)
             limit = 10;
+        if (window < LEADERBOARD_ALL_TIME || window > LEADERBOARD_MONTHLY)
+        {
+            create_error_response(response, request->header.msg_type, ERR_INVALID_REQUEST);
+            break;
+        }
         
         LeaderboardEntry entries[100];
         int count = 0;
-        int result = get_luckiest_unboxers(entries, &count, limit);
+        int result = get_windowed_leaderboard(LEADERBOARD_LUCKIEST_UNBOXERS, (LeaderboardWindow)window, entries, &count, limit);
         
         if (result == 0)
         {
             // Always return success, even if count is 0 (empty leaderboard)
             if (count > 0)
             {
-                create_success_response(response, MSG_LUCKIEST_UNBOXERS_DATA, entries, sizeof(LeaderboardEntry) * count);
-                response->header.msg_length = sizeof(LeaderboardEntry) * count;
+                return send_chunked_response(client_fd, response, MSG_LUCKIEST_UNBOXERS_DATA, entries, sizeof(LeaderboardEntry) * count);
             }
             else
             {
@@ -1420,23 +1599,28 @@ static int handle_leaderboards_request(int client_fd, Message *request, Message
     
     case MSG_GET_MOST_PROFITABLE:
     {
-        // Parse: limit (optional, default 10)
+        // Parse: limit:window (both optional, default 10 all-time)
         int limit = 10;
+        int window = LEADERBOARD_ALL_TIME;
         if (request->header.msg_length > 0)
         {
-            sscanf((char *)request->payload, "%d", &limit);
+            sscanf((char *)request->payload, "%d:%d", &limit, &window);
         }
         if (limit <= 0 || limit > 100)
             limit = 10;
+        if (window < LEADERBOARD_ALL_TIME || window > LEADERBOARD_MONTHLY)
+        {
+            create_error_response(response, request->header.msg_type, ERR_INVALID_REQUEST);
+            break;
+        }
         
         LeaderboardEntry entries[100];
         int count = 0;
-        int result = get_most_profitable(entries, &count, limit);
+        int result = get_windowed_leaderboard(LEADERBOARD_MOST_PROFITABLE, (LeaderboardWindow)window, entries, &count, limit);
         
         if (result == 0 && count > 0)
         {
-            create_success_response(response, MSG_MOST_PROFITABLE_DATA, entries, sizeof(LeaderboardEntry) * count);
-            response->header.msg_length = sizeof(LeaderboardEntry) * count;
+            return send_chunked_response(client_fd, response, MSG_MOST_PROFITABLE_DATA, entries, sizeof(LeaderboardEntry) * count);
         }
         else
         {
@@ -1444,6 +1628,62 @@ static int handle_leaderboards_request(int client_fd, Message *request, Message
         }
         break;
     }
+
+    case MSG_GET_LEADERBOARD_RANK:
+    {
+        // Parse: user_id
+        uint32_t user_id;
+        if (sscanf((char *)request->payload, "%u", &user_id) != 1)
+        {
+            create_error_response(response, MSG_GET_LEADERBOARD_RANK, ERR_INVALID_REQUEST);
+            break;
+        }
+
+        LeaderboardRank rank;
+        if (get_trader_rank((int)user_id, &rank) == 0)
+        {
+            create_success_response(response, MSG_LEADERBOARD_RANK_DATA, &rank, sizeof(LeaderboardRank));
+        }
+        else
+        {
+            create_error_response(response, MSG_GET_LEADERBOARD_RANK, ERR_ITEM_NOT_FOUND);
+        }
+        break;
+    }
+
+    case MSG_GET_LEADERBOARD_AROUND:
+    case MSG_GET_LEADERBOARD_PAGE:
+    {
+        // Parse: user_id:radius (around) or page:page_size (page)
+        int is_around = request->header.msg_type == MSG_GET_LEADERBOARD_AROUND;
+        int key = 0, size = is_around ? 5 : 10;
+        int parsed = sscanf((char *)request->payload, "%d:%d", &key, &size);
+        if (parsed < 1 || key <= 0 ||
+            (is_around ? (size < 0 || size > LEADERBOARD_MAX_RADIUS) : (size <= 0 || size > LEADERBOARD_MAX_PAGE_SIZE)))
+        {
+            create_error_response(response, request->header.msg_type, ERR_INVALID_REQUEST);
+            break;
+        }
+
+        // Slice header first, then the entries, as one chunked payload
+        struct
+        {
+            LeaderboardSlice header;
+            LeaderboardEntry entries[LEADERBOARD_MAX_PAGE_SIZE];
+        } slice;
+        int result = is_around ? get_traders_around(key, size, &slice.header, slice.entries)
+                               : get_traders_page(key, size, &slice.header, slice.entries);
+
+        if (result == 0)
+        {
+            return send_chunked_response(client_fd, response,
+                                         is_around ? MSG_LEADERBOARD_AROUND_DATA : MSG_LEADERBOARD_PAGE_DATA, &slice,
+                                         sizeof(LeaderboardSlice) + sizeof(LeaderboardEntry) * slice.header.count);
+        }
+        // Sizes were checked above, so this is a user who is not ranked
+        create_error_response(response, request->header.msg_type, ERR_ITEM_NOT_FOUND);
+        break;
+    }
     
     default:
         create_error_response(response, request->header.msg_type, ERR_INVALID_REQUEST);
@@ -1485,8 +1725,7 @@ static int handle_trade_analytics_request(int client_fd, Message *request, Messa
         if (result == 0 && count > 0)
         {
             LOG_DEBUG_CTX((int)user_id, client_fd, "MSG_GET_TRADE_HISTORY: returning %d logs", count);
-            create_success_response(response, MSG_TRADE_HISTORY_DATA, logs, sizeof(TransactionLog) * count);
-            response->header.msg_length = sizeof(TransactionLog) * count;
+            return send_chunked_response(client_fd, response, MSG_TRADE_HISTORY_DATA, logs, sizeof(TransactionLog) * count);
         }
         else
         {
@@ -1765,6 +2004,7 @@ int handle_client_request(int client_fd, Message *request)
         return -1;
     
     Message response;
+    t_request_sequence = request->header.sequence_num;
     
     // Route based on message type
     uint16_t msg_type = request->header.msg_type;
@@ -1774,7 +2014,7 @@ int handle_client_request(int client_fd, Message *request)
     if (request->header.msg_length > 0)
     {
         // Try to parse user_id from common request formats
-        if (msg_type == MSG_GET_INVENTORY || msg_type == MSG_GET_TRADES || 
+        if (msg_type == MSG_GET_INVENTORY || msg_type == MSG_GET_INVENTORY_FULL || msg_type == MSG_GET_TRADES || 
             msg_type == MSG_SEND_TRADE_OFFER || msg_type == MSG_ACCEPT_TRADE ||
             msg_type == MSG_DECLINE_TRADE || msg_type == MSG_CANCEL_TRADE)
         {
@@ -1804,20 +2044,22 @@ int handle_client_request(int client_fd, Message *request)
     {
         handle_trading_request(client_fd, request, &response);
     }
-    else if (msg_type >= MSG_GET_INVENTORY && msg_type <= MSG_DEFINITION_ID_DATA)
+    else if (msg_type >= MSG_GET_INVENTORY && msg_type <= MSG_INVENTORY_FULL_DATA)
     {
         handle_inventory_request(client_fd, request, &response);
     }
-    // Check unbox messages (0x0080-0x0083) - must check before leaderboards (0x0040-0x0045)
+    // Check unbox messages (0x0080-0x0085) - must check before leaderboards (0x0040-0x0045)
     // to avoid range conflicts, even though there's no actual overlap anymore
     else if (msg_type == MSG_UNBOX_CASE || msg_type == MSG_UNBOX_RESULT || 
-             msg_type == MSG_GET_CASES || msg_type == MSG_CASES_DATA)
+             msg_type == MSG_GET_CASES || msg_type == MSG_CASES_DATA ||
+             msg_type == MSG_UNBOX_CASE_BATCH || msg_type == MSG_UNBOX_BATCH_RESULT)
     {
         handle_unbox_request(client_fd, request, &response);
     }
     else if (msg_type == MSG_GET_TOP_TRADERS || msg_type == MSG_TOP_TRADERS_DATA || 
              msg_type == MSG_GET_LUCKIEST_UNBOXERS || msg_type == MSG_LUCKIEST_UNBOXERS_DATA ||
-             msg_type == MSG_GET_MOST_PROFITABLE || msg_type == MSG_MOST_PROFITABLE_DATA)
+             msg_type == MSG_GET_MOST_PROFITABLE || msg_type == MSG_MOST_PROFITABLE_DATA ||
+             (msg_type >= MSG_GET_LEADERBOARD_RANK && msg_type <= MSG_LEADERBOARD_PAGE_DATA))
     {
         handle_leaderboards_request(client_fd, request, &response);
     }
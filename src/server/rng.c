@@ -0,0 +1,245 @@
+// rng.c - Per-thread xoshiro256** streams with a logged base seed
+
+#include "../include/rng.h"
+#include "../include/logger.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <stdatomic.h>
+#include <pthread.h>
+#include <sys/random.h>
+#include <time.h>
+#include <unistd.h>
+
+typedef struct
+{
+    uint64_t s[4];
+    unsigned int epoch; // g_epoch the stream was taken from
+} RngState;
+
+static pthread_mutex_t g_seed_mutex = PTHREAD_MUTEX_INITIALIZER;
+static uint64_t g_base_seed;
+static uint64_t g_base_state[4];  // Stream 0, the start of every bound stream
+static uint64_t g_next_stream[4]; // Handed to the next unbound thread that rolls, then jumped
+static atomic_uint g_epoch = 0;   // 0 = no base seed yet, bumped by every rng_seed()
+
+// Only the thread bound to an index touches its state (slots are reused after a join)
+static RngState g_bound[RNG_BOUND_STREAMS];
+
+static __thread RngState t_rng;     // Stream of an unbound thread
+static __thread RngState *t_state;  // &t_rng or &g_bound[t_bound], NULL until attached
+static __thread int t_bound = -1;
+
+static inline uint64_t rotl(uint64_t x, int k)
+{
+    return (x << k) | (x >> (64 - k));
+}
+
+static inline uint64_t xoshiro_next(uint64_t *s)
+{
+    uint64_t result = rotl(s[1] * 5, 7) * 9;
+    uint64_t t = s[1] << 17;
+    s[2] ^= s[0];
+    s[3] ^= s[1];
+    s[1] ^= s[2];
+    s[0] ^= s[3];
+    s[2] ^= t;
+    s[3] = rotl(s[3], 45);
+    return result;
+}
+
+static const uint64_t JUMP_2_128[] = {0x180ec6d33cfd0abaULL, 0xd5a61266f0c9392cULL,
+                                      0xa9582618e03fc9aaULL, 0x39abdc4529b1661cULL};
+static const uint64_t JUMP_2_192[] = {0x76e15d3efefdcbbfULL, 0xc5004e441c522fb3ULL,
+                                      0x77710069854ee241ULL, 0x39109bb02acbe635ULL};
+
+// Advance by the distance encoded in jump (2^128 or 2^192 steps)
+static void xoshiro_jump(uint64_t *s, const uint64_t *jump)
+{
+    uint64_t s0 = 0, s1 = 0, s2 = 0, s3 = 0;
+    for (int i = 0; i < 4; i++)
+    {
+        for (int b = 0; b < 64; b++)
+        {
+            if (jump[i] & (UINT64_C(1) << b))
+            {
+                s0 ^= s[0];
+                s1 ^= s[1];
+                s2 ^= s[2];
+                s3 ^= s[3];
+            }
+            xoshiro_next(s);
+        }
+    }
+    s[0] = s0;
+    s[1] = s1;
+    s[2] = s2;
+    s[3] = s3;
+}
+
+// Expands a 64-bit seed into a full state (never all zero)
+static uint64_t splitmix64(uint64_t *x)
+{
+    uint64_t z = (*x += 0x9e3779b97f4a7c15ULL);
+    z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ULL;
+    z = (z ^ (z >> 27)) * 0x94d049bb133111ebULL;
+    return z ^ (z >> 31);
+}
+
+int rng_os_bytes(void *buf, size_t len)
+{
+    unsigned char *p = buf;
+    while (len > 0)
+    {
+        ssize_t n = getrandom(p, len, 0);
+        if (n < 0)
+        {
+            if (errno == EINTR)
+                continue;
+            FILE *f = fopen("/dev/urandom", "rb");
+            if (!f)
+                return -1;
+            size_t got = fread(p, 1, len, f);
+            fclose(f);
+            return got == len ? 0 : -1;
+        }
+        p += n;
+        len -= (size_t)n;
+    }
+    return 0;
+}
+
+static void seed_locked(uint64_t seed)
+{
+    g_base_seed = seed;
+    uint64_t x = seed;
+    for (int i = 0; i < 4; i++)
+        g_base_state[i] = splitmix64(&x);
+    memcpy(g_next_stream, g_base_state, sizeof(g_next_stream));
+    xoshiro_jump(g_next_stream, JUMP_2_192);
+    atomic_fetch_add(&g_epoch, 1);
+}
+
+void rng_seed(uint64_t seed)
+{
+    pthread_mutex_lock(&g_seed_mutex);
+    seed_locked(seed);
+    pthread_mutex_unlock(&g_seed_mutex);
+}
+
+static uint64_t os_seed(void)
+{
+    uint64_t seed;
+    if (rng_os_bytes(&seed, sizeof(seed)) != 0)
+    {
+        // No kernel entropy: still differ between runs and processes
+        struct timespec ts;
+        clock_gettime(CLOCK_REALTIME, &ts);
+        seed = ((uint64_t)ts.tv_sec << 32) ^ (uint64_t)ts.tv_nsec ^ ((uint64_t)getpid() << 16);
+    }
+    return seed;
+}
+
+int rng_init(void)
+{
+    const char *env = getenv(RNG_SEED_ENV);
+    if (env && *env)
+    {
+        char *end;
+        errno = 0;
+        unsigned long long seed = strtoull(env, &end, 0);
+        if (errno != 0 || *end != '\0')
+        {
+            LOG_ERROR("[RNG] Invalid %s=%s", RNG_SEED_ENV, env);
+            return -1;
+        }
+        rng_seed((uint64_t)seed);
+        LOG_WARNING("[RNG] Deterministic seed %llu from %s, rolls are reproducible for the same request order", seed, RNG_SEED_ENV);
+        return 0;
+    }
+
+    rng_seed(os_seed());
+    LOG_INFO("[RNG] Seed %llu (set %s to replay)", (unsigned long long)rng_base_seed(), RNG_SEED_ENV);
+    return 0;
+}
+
+uint64_t rng_base_seed(void)
+{
+    pthread_mutex_lock(&g_seed_mutex);
+    uint64_t seed = g_base_seed;
+    pthread_mutex_unlock(&g_seed_mutex);
+    return seed;
+}
+
+void rng_bind_stream(unsigned int index)
+{
+    if (index >= RNG_BOUND_STREAMS)
+    {
+        LOG_WARNING("[RNG] Stream %u out of range, thread keeps a first-use stream", index);
+        return;
+    }
+    t_bound = (int)index;
+    t_state = NULL;
+}
+
+// Attach to the thread's stream of the current base seed: its bound stream, or the next free one
+static RngState *attach_stream(void)
+{
+    uint64_t seed = atomic_load(&g_epoch) == 0 ? os_seed() : 0;
+
+    pthread_mutex_lock(&g_seed_mutex);
+    if (atomic_load(&g_epoch) == 0)
+        seed_locked(seed);
+    unsigned int epoch = atomic_load(&g_epoch);
+    if (t_bound >= 0)
+    {
+        t_state = &g_bound[t_bound];
+        if (t_state->epoch != epoch) // First use of this index since the last rng_seed()
+        {
+            memcpy(t_state->s, g_base_state, sizeof(t_state->s));
+            for (int i = 0; i < t_bound; i++)
+                xoshiro_jump(t_state->s, JUMP_2_128);
+            t_state->epoch = epoch;
+        }
+    }
+    else
+    {
+        memcpy(t_rng.s, g_next_stream, sizeof(t_rng.s));
+        xoshiro_jump(g_next_stream, JUMP_2_128);
+        t_rng.epoch = epoch;
+        t_state = &t_rng;
+    }
+    pthread_mutex_unlock(&g_seed_mutex);
+    return t_state;
+}
+
+uint64_t rng_next(void)
+{
+    RngState *state = t_state;
+    if (!state || state->epoch != atomic_load_explicit(&g_epoch, memory_order_relaxed))
+        state = attach_stream();
+    return xoshiro_next(state->s);
+}
+
+double rng_uniform(void)
+{
+    return (double)(rng_next() >> 11) * 0x1.0p-53;
+}
+
+uint32_t rng_below(uint32_t bound)
+{
+    // Lemire's multiply-shift, rejecting the few low products that would bias the result
+    uint64_t m = (uint64_t)(uint32_t)(rng_next() >> 32) * bound;
+    uint32_t low = (uint32_t)m;
+    if (low < bound)
+    {
+        uint32_t threshold = -bound % bound;
+        while (low < threshold)
+        {
+            m = (uint64_t)(uint32_t)(rng_next() >> 32) * bound;
+            low = (uint32_t)m;
+        }
+    }
+    return (uint32_t)(m >> 32);
+}
@@ -4,8 +4,13 @@
 #include "../include/protocol.h"
 #include "../include/database.h"
 #include "../include/thread_pool.h"
+#include "../include/buffer_pool.h"
 #include "../include/request_handler.h"
 #include "../include/logger.h"
+#include "../include/rng.h"
+#include "../include/leaderboard_index.h"
+#include "../include/leaderboard_windows.h"
+#include "../include/top_unboxes.h"
 
 // Forward declaration for calculate_checksum (from protocol.c)
 extern uint32_t calculate_checksum(const char *data, int length);
@@ -17,21 +22,44 @@ extern uint32_t calculate_checksum(const char *data, int length);
 #include <netinet/in.h>
 #include <arpa/inet.h>
 #include <sys/select.h>
+#include <sys/resource.h>
 #include <fcntl.h>
 #include <signal.h>
 #include <errno.h>
 #include <time.h>
 #include <pthread.h>
 
+#ifndef USE_SELECT_LOOP
+#include <sys/epoll.h>
+#include "../include/connection.h"
+
+// One event loop thread with its own SO_REUSEPORT listener and connection set
+typedef struct
+{
+    int id;
+    int listen_fd;
+    int epoll_fd;
+    Connection *clients; // Registered connections, only touched by the reactor's thread
+    pthread_t thread;
+} Reactor;
+#endif
+
+// Build with -DUSE_SELECT_LOOP to fall back to the old select() loop (capped at MAX_CLIENTS)
 #define MAX_CLIENTS 1000
 #define DEFAULT_PORT 8888
+#define LISTEN_BACKLOG SOMAXCONN
+#define EPOLL_MAX_EVENTS 256
+#define EPOLL_WAIT_TIMEOUT_MS 1000 // Only used to notice shutdown, events wake us immediately
+#define DEFAULT_REACTORS 1
+#define MAX_REACTORS 64
 
-static int server_running = 1;
+static volatile sig_atomic_t server_running = 1;
 static ThreadPool g_thread_pool;
 
-// Global client tracking for broadcasting
-static int g_client_fds[MAX_CLIENTS];
+// Global client tracking for broadcasting (grows on demand)
+static int *g_client_fds = NULL;
 static int g_client_count = 0;
+static int g_client_capacity = 0;
 static pthread_mutex_t g_client_mutex = PTHREAD_MUTEX_INITIALIZER;
 
 // Signal handler for graceful shutdown
@@ -102,8 +130,8 @@ static int setup_server_socket(int port)
     LOG_INFO("[NETWORK] Socket bound successfully");
 
     // Listen
-    LOG_INFO("[NETWORK] Setting socket to listen mode (backlog=10)");
-    if (listen(server_fd, 10) < 0)
+    LOG_INFO("[NETWORK] Setting socket to listen mode (backlog=%d)", LISTEN_BACKLOG);
+    if (listen(server_fd, LISTEN_BACKLOG) < 0)
     {
         LOG_ERROR("[NETWORK] listen() failed: %s", strerror(errno));
         close(server_fd);
@@ -144,69 +172,27 @@ static int accept_connection(int server_fd)
     return client_fd;
 }
 
-int main(int argc, char *argv[])
+// Add client to broadcast list (caller holds g_client_mutex)
+static int client_list_add(int client_fd)
 {
-    int port = DEFAULT_PORT;
-
-    if (argc > 1)
-    {
-        port = atoi(argv[1]);
-        if (port <= 0 || port > 65535)
-        {
-            fprintf(stderr, "Invalid port number: %d\n", port);
-            return 1;
-        }
-    }
-
-    // Initialize logger (log to both terminal and file)
-    // Create logs directory if it doesn't exist
-    system("mkdir -p logs");
-    if (logger_init("logs/server.log", LOG_LEVEL_DEBUG) != 0)
-    {
-        fprintf(stderr, "Failed to initialize logger\n");
-        return 1;
-    }
-
-    LOG_INFO("=== CS2 Skin Trading Server ===");
-    LOG_INFO("Starting on port %d", port);
-
-    // Setup signal handlers
-    signal(SIGINT, signal_handler);
-    signal(SIGTERM, signal_handler);
-
-    // Initialize database
-    if (db_init() != 0)
+    if (g_client_count == g_client_capacity)
     {
-        LOG_ERROR("Failed to initialize database");
-        logger_close();
-        return 1;
+        int new_capacity = g_client_capacity ? g_client_capacity * 2 : 64;
+        int *grown = realloc(g_client_fds, new_capacity * sizeof(int));
+        if (!grown)
+            return -1;
+        g_client_fds = grown;
+        g_client_capacity = new_capacity;
     }
-    LOG_INFO("Database initialized");
+    g_client_fds[g_client_count++] = client_fd;
+    return 0;
+}
 
-    // Initialize thread pool
-    if (thread_pool_init(&g_thread_pool) != 0)
-    {
-        LOG_ERROR("Failed to initialize thread pool");
-        db_close();
-        logger_close();
-        return 1;
-    }
-    LOG_INFO("Thread pool initialized (%d workers)", NUM_WORKER_THREADS);
+#ifdef USE_SELECT_LOOP
 
-    // Setup server socket
-    int server_fd = setup_server_socket(port);
-    if (server_fd < 0)
-    {
-        LOG_ERROR("Failed to setup server socket");
-        thread_pool_shutdown(&g_thread_pool);
-        db_close();
-        logger_close();
-        return 1;
-    }
-    LOG_INFO("Server socket listening on port %d", port);
-    LOG_INFO("Server ready to accept connections");
-
-    // Main server loop
+// select() event loop: rebuilds the fd_set every iteration, limited to MAX_CLIENTS / FD_SETSIZE
+static void run_select_loop(int server_fd)
+{
     fd_set read_fds;
     int max_fd = server_fd;
 
@@ -249,10 +235,9 @@ int main(int argc, char *argv[])
             if (client_fd >= 0)
             {
                 pthread_mutex_lock(&g_client_mutex);
-                if (g_client_count < MAX_CLIENTS)
+                if (g_client_count < MAX_CLIENTS && client_fd < FD_SETSIZE &&
+                    client_list_add(client_fd) == 0)
                 {
-                    // Add to client list
-                    g_client_fds[g_client_count++] = client_fd;
                     LOG_INFO_CTX(0, client_fd, "New client connected (total clients: %d)", g_client_count);
                 }
                 else
@@ -273,22 +258,28 @@ int main(int argc, char *argv[])
             {
                 int client_fd = g_client_fds[i];
 
-                // Receive message from client
-                Message request;
-                int recv_result = receive_message(client_fd, &request);
+                // Receive message from client (length unknown yet, so take a full-size buffer)
+                Message *request = frame_buffer_acquire(MAX_PAYLOAD_SIZE);
+                int recv_result = request ? receive_message(client_fd, request) : -1;
 
                 if (recv_result == 0)
                 {
-                    // Add job to thread pool (keep client in list for more requests)
+                    // Add job to thread pool, which now owns the buffer (keep client in list for more requests)
                     LOG_DEBUG_CTX(0, client_fd, "Received message type: 0x%04X, length: %d",
-                                  request.header.msg_type, request.header.msg_length);
-                    int add_result = thread_pool_add_job(&g_thread_pool, client_fd, &request);
+                                  request->header.msg_type, request->header.msg_length);
+                    MessageHeader header = request->header;
+                    int add_result = thread_pool_add_job(&g_thread_pool, client_fd, request);
 
-                    if (add_result != 0)
+                    if (add_result == THREAD_POOL_REJECTED)
+                    {
+                        // A worker answers ERR_SERVER_FULL after the earlier responses
+                        LOG_WARNING_CTX(0, client_fd, "Server busy, shed request type=0x%04X", header.msg_type);
+                    }
+                    else if (add_result != 0)
                     {
-                        // Queue full or shutdown, close connection
-                        LOG_WARNING_CTX(0, client_fd, "Thread pool queue full or shutdown, closing connection");
-                        close(client_fd);
+                        // Shutdown, out of memory or too many busy replies waiting, close connection
+                        LOG_WARNING_CTX(0, client_fd, "Thread pool shutdown or too many busy replies waiting, closing connection");
+                        thread_pool_close_connection(&g_thread_pool, client_fd);
                         g_client_fds[i] = -1; // Mark as closed
                     }
                     // Keep client in list for more requests - don't remove it
@@ -296,8 +287,9 @@ int main(int argc, char *argv[])
                 else
                 {
                     // Failed to receive message (error or connection closed)
+                    frame_buffer_release(request);
                     LOG_DEBUG_CTX(0, client_fd, "Connection closed or receive error");
-                    close(client_fd);
+                    thread_pool_close_connection(&g_thread_pool, client_fd);
                     g_client_fds[i] = -1; // Mark as closed
                 }
             }
@@ -315,11 +307,409 @@ int main(int argc, char *argv[])
         g_client_count = write_idx;
         pthread_mutex_unlock(&g_client_mutex);
     }
+}
+
+#else
+
+// Remove client from broadcast list (caller holds g_client_mutex)
+static void client_list_remove(int client_fd)
+{
+    for (int i = 0; i < g_client_count; i++)
+    {
+        if (g_client_fds[i] == client_fd)
+        {
+            g_client_fds[i] = g_client_fds[--g_client_count];
+            return;
+        }
+    }
+}
+
+// Raise the open file limit so the reactor is not capped at the default 1024 fds
+static void raise_fd_limit(void)
+{
+    struct rlimit rl;
+    if (getrlimit(RLIMIT_NOFILE, &rl) == 0 && rl.rlim_cur < rl.rlim_max)
+    {
+        rl.rlim_cur = rl.rlim_max;
+        if (setrlimit(RLIMIT_NOFILE, &rl) == 0)
+            LOG_INFO("[NETWORK] Raised open file limit to %llu", (unsigned long long)rl.rlim_cur);
+    }
+}
+
+static int set_nonblocking(int fd)
+{
+    int flags = fcntl(fd, F_GETFL, 0);
+    if (flags < 0)
+        return -1;
+    return fcntl(fd, F_SETFL, flags | O_NONBLOCK);
+}
+
+// Unregister and close a client connection
+static void close_client(Reactor *reactor, Connection *conn)
+{
+    int client_fd = conn->fd;
+    epoll_ctl(reactor->epoll_fd, EPOLL_CTL_DEL, client_fd, NULL);
+
+    if (conn->prev)
+        conn->prev->next = conn->next;
+    else
+        reactor->clients = conn->next;
+    if (conn->next)
+        conn->next->prev = conn->prev;
+
+    pthread_mutex_lock(&g_client_mutex);
+    client_list_remove(client_fd);
+    LOG_DEBUG_CTX(0, client_fd, "Connection closed (total clients: %d)", g_client_count);
+    pthread_mutex_unlock(&g_client_mutex);
+
+    connection_destroy(conn);
+    thread_pool_close_connection(&g_thread_pool, client_fd); // Deferred if a job is still running
+}
+
+// Accept every pending connection (edge-triggered: must drain until EAGAIN)
+static void accept_pending_connections(Reactor *reactor)
+{
+    int epoll_fd = reactor->epoll_fd;
+    int server_fd = reactor->listen_fd;
+    while (server_running)
+    {
+        int client_fd = accept_connection(server_fd);
+        if (client_fd < 0)
+            break;
+
+        Connection *conn = NULL;
+        if (set_nonblocking(client_fd) != 0 || !(conn = connection_create(client_fd)))
+        {
+            LOG_WARNING_CTX(0, client_fd, "Connection rejected: cannot set up connection state");
+            close(client_fd);
+            continue;
+        }
+
+        struct epoll_event ev;
+        memset(&ev, 0, sizeof(ev));
+        ev.events = EPOLLIN | EPOLLRDHUP | EPOLLET;
+        ev.data.ptr = conn;
+
+        pthread_mutex_lock(&g_client_mutex);
+        int added = client_list_add(client_fd);
+        int total = g_client_count;
+        pthread_mutex_unlock(&g_client_mutex);
+
+        if (added != 0 || epoll_ctl(epoll_fd, EPOLL_CTL_ADD, client_fd, &ev) != 0)
+        {
+            LOG_WARNING_CTX(0, client_fd, "Connection rejected: cannot register client: %s", strerror(errno));
+            if (added == 0)
+            {
+                pthread_mutex_lock(&g_client_mutex);
+                client_list_remove(client_fd);
+                pthread_mutex_unlock(&g_client_mutex);
+            }
+            connection_destroy(conn);
+            close(client_fd);
+            continue;
+        }
+
+        conn->next = reactor->clients;
+        if (conn->next)
+            conn->next->prev = conn;
+        reactor->clients = conn;
+
+        LOG_INFO_CTX(0, client_fd, "New client connected (total clients: %d)", total);
+    }
+}
+
+// Hand a complete frame to the worker pool
+static int dispatch_frame(Connection *conn, Message *frame, void *ctx)
+{
+    (void)ctx;
+    MessageHeader header = frame->header; // The pool owns frame after the call
+    int result = thread_pool_add_job(&g_thread_pool, conn->fd, frame);
+    if (result == THREAD_POOL_REJECTED)
+    {
+        // Overloaded: a worker answers ERR_SERVER_FULL in order, this reactor never writes
+        LOG_WARNING_CTX(0, conn->fd, "Server busy, shedding request type=0x%04X", header.msg_type);
+        return 0;
+    }
+    if (result != 0)
+    {
+        LOG_WARNING_CTX(0, conn->fd, "Thread pool shutdown, out of memory or too many busy replies waiting, closing connection");
+        return -1;
+    }
+    return 0;
+}
+
+// epoll event loop: each fd is registered once and only ready fds are returned
+static void run_epoll_loop(Reactor *reactor)
+{
+    int server_fd = reactor->listen_fd;
+
+    // Closed by run_reactors() once the pool is stopped and the remaining clients are released
+    int epoll_fd = epoll_create1(EPOLL_CLOEXEC);
+    reactor->epoll_fd = epoll_fd;
+    if (epoll_fd < 0)
+    {
+        LOG_ERROR("[NETWORK] Reactor %d: epoll_create1() failed: %s", reactor->id, strerror(errno));
+        return;
+    }
+
+    if (set_nonblocking(server_fd) != 0)
+    {
+        LOG_ERROR("[NETWORK] Reactor %d: failed to set listen socket non-blocking: %s", reactor->id, strerror(errno));
+        return;
+    }
+
+    // The listen socket is registered with a NULL data.ptr, clients carry their Connection
+    struct epoll_event ev;
+    memset(&ev, 0, sizeof(ev));
+    ev.events = EPOLLIN | EPOLLET;
+    ev.data.ptr = NULL;
+    if (epoll_ctl(epoll_fd, EPOLL_CTL_ADD, server_fd, &ev) != 0)
+    {
+        LOG_ERROR("[NETWORK] Reactor %d: epoll_ctl(ADD listen) failed: %s", reactor->id, strerror(errno));
+        return;
+    }
+
+    struct epoll_event events[EPOLL_MAX_EVENTS];
+
+    while (server_running)
+    {
+        int ready = epoll_wait(epoll_fd, events, EPOLL_MAX_EVENTS, EPOLL_WAIT_TIMEOUT_MS);
+        if (ready < 0)
+        {
+            if (errno == EINTR)
+                continue;
+            LOG_ERROR("[NETWORK] Reactor %d: epoll_wait() failed: %s", reactor->id, strerror(errno));
+            break;
+        }
+
+        for (int i = 0; i < ready; i++)
+        {
+            Connection *conn = events[i].data.ptr;
+            uint32_t flags = events[i].events;
+
+            if (!conn)
+            {
+                accept_pending_connections(reactor);
+            }
+            else if (flags & EPOLLIN)
+            {
+                // Read first: the peer may have sent a request right before closing.
+                // Partial frames stay buffered in the connection until the next edge.
+                if (connection_read_frames(conn, dispatch_frame, NULL) != 0)
+                    close_client(reactor, conn);
+            }
+            else if (flags & (EPOLLERR | EPOLLHUP | EPOLLRDHUP))
+            {
+                close_client(reactor, conn);
+            }
+        }
+    }
+}
+
+static void *reactor_thread(void *arg)
+{
+    Reactor *reactor = (Reactor *)arg;
+    LOG_INFO("[NETWORK] Reactor %d started (listen fd=%d)", reactor->id, reactor->listen_fd);
+    // Disconnect cleanup may touch the database
+    db_thread_attach(0);
+    run_epoll_loop(reactor);
+    db_thread_detach();
+    return NULL;
+}
+
+// Run reactor_count event loops. Each gets its own listener on the same port (SO_REUSEPORT),
+// so the kernel spreads new connections across them. All dispatch into the shared thread pool.
+static void run_reactors(int server_fd, int port, int reactor_count)
+{
+    Reactor reactors[MAX_REACTORS];
+    memset(reactors, 0, sizeof(reactors));
+
+    raise_fd_limit();
+
+    reactors[0].listen_fd = server_fd;
+    for (int i = 1; i < reactor_count; i++)
+    {
+        reactors[i].listen_fd = setup_server_socket(port);
+        if (reactors[i].listen_fd < 0)
+        {
+            LOG_WARNING("[NETWORK] Could not open listener for reactor %d, running with %d reactor(s)", i, i);
+            reactor_count = i;
+            break;
+        }
+    }
+    for (int i = 0; i < reactor_count; i++)
+    {
+        reactors[i].id = i;
+        reactors[i].epoll_fd = -1;
+    }
+
+    if (reactor_count == 1)
+    {
+        run_epoll_loop(&reactors[0]);
+    }
+    else
+    {
+        int started = 0;
+        for (int i = 0; i < reactor_count; i++)
+        {
+            if (pthread_create(&reactors[i].thread, NULL, reactor_thread, &reactors[i]) != 0)
+            {
+                LOG_ERROR("[NETWORK] Failed to start reactor %d: %s", i, strerror(errno));
+                break;
+            }
+            started++;
+        }
+        if (started == 0)
+            server_running = 0;
+        for (int i = 0; i < started; i++)
+            pthread_join(reactors[i].thread, NULL);
+    }
+
+    // Extra listeners are owned here, reactor 0 uses the caller's server_fd
+    for (int i = 1; i < reactor_count; i++)
+        close(reactors[i].listen_fd);
+
+    // Stop the workers first: once no job can still send on an fd or close it late, every
+    // connection left is released the same way as a runtime disconnect
+    thread_pool_shutdown(&g_thread_pool);
+    for (int i = 0; i < reactor_count; i++)
+    {
+        while (reactors[i].clients)
+            close_client(&reactors[i], reactors[i].clients);
+        if (reactors[i].epoll_fd >= 0)
+            close(reactors[i].epoll_fd);
+    }
+}
+
+#endif // USE_SELECT_LOOP
+
+int main(int argc, char *argv[])
+{
+    int port = DEFAULT_PORT;
+    int reactor_count = DEFAULT_REACTORS;
+    int min_workers = 0; // 0 = thread pool default
+    int max_workers = 0;
+
+    if (argc > 1)
+    {
+        port = atoi(argv[1]);
+        if (port <= 0 || port > 65535)
+        {
+            fprintf(stderr, "Invalid port number: %d\n", port);
+            return 1;
+        }
+    }
+
+    // Optional second argument: number of epoll reactors (SO_REUSEPORT listeners)
+    if (argc > 2)
+    {
+        reactor_count = atoi(argv[2]);
+        if (reactor_count <= 0 || reactor_count > MAX_REACTORS)
+        {
+            fprintf(stderr, "Invalid reactor count: %d (1-%d)\n", reactor_count, MAX_REACTORS);
+            return 1;
+        }
+    }
+
+    // Optional third/fourth arguments: worker pool bounds (the pool starts at one worker per CPU)
+    if (argc > 3)
+    {
+        min_workers = atoi(argv[3]);
+        max_workers = argc > 4 ? atoi(argv[4]) : 0;
+        if (min_workers <= 0 || min_workers > MAX_WORKER_THREADS || max_workers < 0 ||
+            max_workers > MAX_WORKER_THREADS || (max_workers > 0 && max_workers < min_workers))
+        {
+            fprintf(stderr, "Invalid worker bounds: %d-%d (1-%d)\n", min_workers, max_workers, MAX_WORKER_THREADS);
+            return 1;
+        }
+    }
+
+    // Initialize logger (log to both terminal and file)
+    // Create logs directory if it doesn't exist
+    system("mkdir -p logs");
+    if (logger_init("logs/server.log", LOG_LEVEL_DEBUG) != 0)
+    {
+        fprintf(stderr, "Failed to initialize logger\n");
+        return 1;
+    }
+
+    LOG_INFO("=== CS2 Skin Trading Server ===");
+    LOG_INFO("Starting on port %d", port);
+
+    // Seed the game PRNG (CS2_RNG_SEED makes rolls reproducible)
+    if (rng_init() != 0)
+    {
+        logger_close();
+        return 1;
+    }
+
+    // Setup signal handlers
+    signal(SIGINT, signal_handler);
+    signal(SIGTERM, signal_handler);
+
+    // Initialize database
+    if (db_init() != 0)
+    {
+        LOG_ERROR("Failed to initialize database");
+        logger_close();
+        return 1;
+    }
+    LOG_INFO("Database initialized");
+
+    // Rank every user by net worth once; from here on each change moves only that user
+    if (leaderboard_index_init() != 0)
+        LOG_WARNING("Net-worth leaderboard could not be built, retrying on first use");
+    if (leaderboard_windows_init() != 0)
+        LOG_WARNING("Daily/weekly/monthly leaderboards start empty (ledger unreadable)");
+    if (top_unboxes_init() != 0)
+        LOG_WARNING("Luckiest-unboxers board starts empty (top_unboxes unreadable)");
+
+    // Initialize thread pool
+    if (thread_pool_init_scaled(&g_thread_pool, min_workers, max_workers) != 0)
+    {
+        LOG_ERROR("Failed to initialize thread pool");
+        db_close();
+        logger_close();
+        return 1;
+    }
+    LOG_INFO("Thread pool initialized (%d readers, scaling %d-%d; %d writer)",
+             thread_pool_worker_count(&g_thread_pool, LANE_READ), g_thread_pool.lanes[LANE_READ].min_workers,
+             g_thread_pool.lanes[LANE_READ].max_workers, thread_pool_worker_count(&g_thread_pool, LANE_WRITE));
+
+    // Setup server socket
+    int server_fd = setup_server_socket(port);
+    if (server_fd < 0)
+    {
+        LOG_ERROR("Failed to setup server socket");
+        thread_pool_shutdown(&g_thread_pool);
+        db_close();
+        logger_close();
+        return 1;
+    }
+    LOG_INFO("Server socket listening on port %d", port);
+    LOG_INFO("Server ready to accept connections");
+
+    // Main server loop
+#ifdef USE_SELECT_LOOP
+    LOG_INFO("[NETWORK] Event loop: select() (max %d clients)", MAX_CLIENTS);
+    if (reactor_count > 1)
+        LOG_WARNING("[NETWORK] Multiple reactors need the epoll build, using a single select() loop");
+    run_select_loop(server_fd);
+#else
+    LOG_INFO("[NETWORK] Event loop: epoll (edge-triggered), %d reactor(s)", reactor_count);
+    run_reactors(server_fd, port, reactor_count);
+#endif
 
     // Cleanup
     LOG_INFO("Shutting down...");
-    thread_pool_shutdown(&g_thread_pool);
+    thread_pool_shutdown(&g_thread_pool); // Already stopped by run_reactors() in the epoll build
+    frame_buffer_pool_cleanup();
     close(server_fd);
+    free(g_client_fds);
+    g_client_fds = NULL;
+    leaderboard_index_cleanup();
+    leaderboard_windows_cleanup();
+    top_unboxes_cleanup();
     db_close();
     LOG_INFO("Server stopped");
     logger_close();
@@ -343,23 +733,29 @@ void broadcast_to_all_clients(const char *username, const char *message)
     snprintf(broadcast.payload, MAX_PAYLOAD_SIZE, "%s: %s", username, message);
     broadcast.header.msg_length = strlen(broadcast.payload);
 
-    // Calculate checksum
-    broadcast.header.checksum = calculate_checksum(broadcast.payload, (int)broadcast.header.msg_length);
+    SharedMessage *shared = shared_message_create(&broadcast);
+    if (!shared)
+        return;
 
-    // Send to all connected clients
+    // Snapshot the client list; a slow client must not hold g_client_mutex (accept and close
+    // wait on it) nor the caller, which is usually the writer lane. Reader lane workers send the
+    // frame after each client's queued responses.
     pthread_mutex_lock(&g_client_mutex);
-    for (int i = 0; i < g_client_count; i++)
+    int count = g_client_count;
+    int *fds = count > 0 ? malloc(count * sizeof(int)) : NULL;
+    if (fds)
+        memcpy(fds, g_client_fds, count * sizeof(int));
+    pthread_mutex_unlock(&g_client_mutex);
+
+    int dropped = 0;
+    for (int i = 0; fds && i < count; i++)
     {
-        if (g_client_fds[i] >= 0)
-        {
-            // Send header
-            ssize_t sent = send(g_client_fds[i], &broadcast.header, sizeof(MessageHeader), MSG_NOSIGNAL);
-            if (sent > 0 && broadcast.header.msg_length > 0)
-            {
-                // Send payload
-                send(g_client_fds[i], broadcast.payload, broadcast.header.msg_length, MSG_NOSIGNAL);
-            }
-        }
+        if (fds[i] >= 0 && thread_pool_queue_broadcast(&g_thread_pool, fds[i], shared) != 0)
+            dropped++;
     }
-    pthread_mutex_unlock(&g_client_mutex);
+    if (dropped > 0)
+        LOG_WARNING("[NETWORK] Broadcast dropped for %d of %d clients", dropped, count);
+
+    free(fds);
+    shared_message_release(shared);
 }
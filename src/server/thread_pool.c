@@ -1,7 +1,14 @@
 // thread_pool.c - Thread Pool Implementation (Phase 8)
+// Work-stealing scheduler: every worker owns a deque, new jobs are spread round-robin
+// and idle workers steal from the others before going to sleep.
+// Workers are split into a reader and a writer lane (see JobLane); stealing stays within a lane.
 
 #include "../include/thread_pool.h"
 #include "../include/request_handler.h"
+#include "../include/buffer_pool.h"
+#include "../include/database.h"
+#include "../include/logger.h"
+#include "../include/rng.h"
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
@@ -14,179 +21,957 @@
 // Global thread pool instance
 static ThreadPool *g_pool = NULL;
 
+// Get the mailbox for client_fd, allocating its chunk on first use (NULL if out of range or memory)
+static Mailbox *get_mailbox(ThreadPool *pool, int client_fd)
+{
+    int chunk_index = client_fd / MAILBOX_CHUNK_SIZE;
+    if (chunk_index >= MAILBOX_MAX_CHUNKS)
+        return NULL;
+
+    Mailbox *chunk = atomic_load(&pool->mailbox_chunks[chunk_index]);
+    if (!chunk)
+    {
+        Mailbox *fresh = calloc(MAILBOX_CHUNK_SIZE, sizeof(Mailbox));
+        if (!fresh)
+            return NULL;
+        for (int i = 0; i < MAILBOX_CHUNK_SIZE; i++)
+        {
+            pthread_mutex_init(&fresh[i].lock, NULL);
+            fresh[i].fd = chunk_index * MAILBOX_CHUNK_SIZE + i;
+        }
+
+        // Another thread may have published the chunk in the meantime
+        if (atomic_compare_exchange_strong(&pool->mailbox_chunks[chunk_index], &chunk, fresh))
+        {
+            chunk = fresh;
+        }
+        else
+        {
+            for (int i = 0; i < MAILBOX_CHUNK_SIZE; i++)
+                pthread_mutex_destroy(&fresh[i].lock);
+            free(fresh);
+        }
+    }
+    return &chunk[client_fd % MAILBOX_CHUNK_SIZE];
+}
+
+// Lane that runs a job, chosen by its request type
+static Lane *lane_for_job(ThreadPool *pool, const Job *job)
+{
+    return &pool->lanes[thread_pool_job_lane(job->request->header.msg_type)];
+}
+
+// Count new work on a lane and wake a sleeping worker if there is one.
+// A worker that is already searching will find the work, so only wake a sleeper otherwise
+static void signal_work(Lane *lane)
+{
+    atomic_fetch_add(&lane->queued_count, 1);
+    if (atomic_load(&lane->searching_count) == 0 && atomic_load(&lane->idle_count) > 0)
+    {
+        pthread_mutex_lock(&lane->idle_mutex);
+        pthread_cond_signal(&lane->work_available);
+        pthread_mutex_unlock(&lane->idle_mutex);
+    }
+}
+
+// Push a job onto a worker's deque and wake a sleeping worker of its lane if there is one
+static void push_job(Worker *worker, const Job *job)
+{
+    WorkerDeque *deque = &worker->deque;
+
+    pthread_mutex_lock(&deque->lock);
+    int count = atomic_load_explicit(&deque->count, memory_order_relaxed);
+    deque->jobs[(deque->head + count) % MAX_QUEUE_SIZE] = *job;
+    atomic_store_explicit(&deque->count, count + 1, memory_order_relaxed);
+    pthread_mutex_unlock(&deque->lock);
+
+    signal_work(worker->lane);
+}
+
+// Hand a mailbox whose next entry is an outgoing frame to the reader lane (the caller set its in_flight)
+static void push_output(ThreadPool *pool, Mailbox *mailbox)
+{
+    pthread_mutex_lock(&pool->output_lock);
+    mailbox->next_output = NULL;
+    if (pool->output_tail)
+        pool->output_tail->next_output = mailbox;
+    else
+        pool->output_head = mailbox;
+    pool->output_tail = mailbox;
+    atomic_fetch_add(&pool->output_queued, 1);
+    pthread_mutex_unlock(&pool->output_lock);
+
+    signal_work(&pool->lanes[LANE_READ]);
+}
+
+// Take the oldest mailbox waiting for a worker to send its outgoing frames
+static int take_output(ThreadPool *pool, int *client_fd)
+{
+    if (atomic_load(&pool->output_queued) == 0)
+        return 0;
+
+    pthread_mutex_lock(&pool->output_lock);
+    Mailbox *mailbox = pool->output_head;
+    if (mailbox)
+    {
+        pool->output_head = mailbox->next_output;
+        if (!pool->output_head)
+            pool->output_tail = NULL;
+        mailbox->next_output = NULL;
+        *client_fd = mailbox->fd;
+        atomic_fetch_sub(&pool->output_queued, 1);
+    }
+    pthread_mutex_unlock(&pool->output_lock);
+
+    if (!mailbox)
+        return 0;
+    atomic_fetch_sub(&pool->lanes[LANE_READ].queued_count, 1);
+    return 1;
+}
+
+// Append an entry to a mailbox (caller holds its lock)
+static void mailbox_append(Mailbox *mailbox, PendingJob *pending)
+{
+    pending->next = NULL;
+    if (mailbox->tail)
+        mailbox->tail->next = pending;
+    else
+        mailbox->head = pending;
+    mailbox->tail = pending;
+}
+
+// Push a job to the next active worker of a lane
+static void push_job_round_robin(Lane *lane, const Job *job)
+{
+    unsigned int target = atomic_fetch_add(&lane->next_worker, 1) % (unsigned int)atomic_load(&lane->active_count);
+    push_job(&lane->workers[target], job);
+}
+
+// Take the oldest job from the worker's own deque
+static int pop_job(Worker *worker, Job *job)
+{
+    WorkerDeque *deque = &worker->deque;
+    int found = 0;
+
+    pthread_mutex_lock(&deque->lock);
+    int count = atomic_load_explicit(&deque->count, memory_order_relaxed);
+    if (count > 0)
+    {
+        *job = deque->jobs[deque->head];
+        deque->head = (deque->head + 1) % MAX_QUEUE_SIZE;
+        atomic_store_explicit(&deque->count, count - 1, memory_order_relaxed);
+        found = 1;
+    }
+    pthread_mutex_unlock(&deque->lock);
+    return found;
+}
+
+// Take the newest job from another worker's deque
+static int steal_job(Worker *victim, Job *job)
+{
+    WorkerDeque *deque = &victim->deque;
+    int found = 0;
+
+    // Skip empty deques without touching their lock
+    if (atomic_load_explicit(&deque->count, memory_order_relaxed) == 0)
+        return 0;
+
+    pthread_mutex_lock(&deque->lock);
+    int count = atomic_load_explicit(&deque->count, memory_order_relaxed);
+    if (count > 0)
+    {
+        *job = deque->jobs[(deque->head + count - 1) % MAX_QUEUE_SIZE];
+        atomic_store_explicit(&deque->count, count - 1, memory_order_relaxed);
+        found = 1;
+    }
+    pthread_mutex_unlock(&deque->lock);
+    return found;
+}
+
+// Find work for a worker: own deque first, then steal starting from the next worker of its lane
+static int take_job(Worker *self, Job *job)
+{
+    Lane *lane = self->lane;
+    int found = pop_job(self, job);
+
+    // Scan every slot ever started: retired workers may still hold jobs pushed just before they left
+    int spawned = atomic_load(&lane->spawned_count);
+    if (!found && spawned > 1)
+    {
+        atomic_fetch_add(&lane->searching_count, 1);
+        for (int i = 1; !found && i < spawned; i++)
+            found = steal_job(&lane->workers[(self->index + i) % spawned], job);
+        atomic_fetch_sub(&lane->searching_count, 1);
+    }
+
+    if (found)
+    {
+        atomic_fetch_sub(&lane->queued_count, 1);
+        atomic_fetch_sub(&lane->pool->job_count, 1);
+    }
+    return found;
+}
+
+// Called after a worker handled a job for client_fd (or took its mailbox from the output queue):
+// send the busy replies and broadcasts queued next, then queue the next job or release the mailbox
+static void finish_job(Worker *self, int client_fd)
+{
+    ThreadPool *pool = self->lane->pool;
+    Mailbox *mailbox = get_mailbox(pool, client_fd);
+
+    while (1)
+    {
+        PendingJob *next = NULL;
+        int close_fd = 0;
+        int hand_off = 0;
+
+        pthread_mutex_lock(&mailbox->lock);
+        if (mailbox->close_pending)
+        {
+            mailbox->in_flight = 0;
+            mailbox->close_pending = 0;
+            close_fd = 1;
+        }
+        else if (mailbox->head && mailbox->head->kind != PENDING_REQUEST && self->lane->id != LANE_READ)
+        {
+            hand_off = 1; // A slow client must not hold up the writer: the readers send the frames
+        }
+        else if (mailbox->head)
+        {
+            next = mailbox->head;
+            mailbox->head = next->next;
+            if (!mailbox->head)
+                mailbox->tail = NULL;
+            if (next->kind != PENDING_REQUEST)
+                mailbox->output_count--;
+        }
+        else
+        {
+            mailbox->in_flight = 0;
+        }
+        pthread_mutex_unlock(&mailbox->lock);
+
+        if (close_fd)
+            close(client_fd);
+        if (hand_off)
+            push_output(pool, mailbox); // Stays in flight
+        if (!next)
+            return;
+
+        // The mailbox stays in flight while sending, so no other response can overtake it
+        if (next->kind != PENDING_REQUEST)
+        {
+            int sent;
+            if (next->kind == PENDING_BUSY_REPLY)
+            {
+                sent = send_server_full_response(client_fd, &next->request_header);
+            }
+            else
+            {
+                // send_response() fills in the header, so every connection sends its own copy
+                Message frame;
+                const Message *shared = &next->shared->message;
+                memcpy(&frame.header, &shared->header, sizeof(MessageHeader));
+                memcpy(frame.payload, shared->payload, shared->header.msg_length);
+                sent = send_response(client_fd, &frame);
+                shared_message_release(next->shared);
+            }
+            free(next);
+
+            // Not drained within the send timeout: stop waiting on this client for every queued
+            // frame and let the network thread reap it
+            if (sent != 0)
+                shutdown(client_fd, SHUT_RDWR);
+            continue;
+        }
+
+        // The parked job was already counted in job_count; keep it on this worker for locality
+        // unless it belongs to the other lane
+        Lane *lane = lane_for_job(pool, &next->job);
+        if (lane == self->lane)
+            push_job(self, &next->job);
+        else
+            push_job_round_robin(lane, &next->job);
+        free(next);
+        return;
+    }
+}
+
 // Worker thread function
 void *worker_thread(void *arg)
 {
-    ThreadPool *pool = (ThreadPool *)arg;
-    
+    Worker *self = (Worker *)arg;
+    Lane *lane = self->lane;
+    ThreadPool *pool = lane->pool;
+
+    // Every worker runs on its own database connection, read-only on the reader lane
+    db_thread_attach(lane->id == LANE_READ);
+    // Rolls are keyed by the worker's slot, not by which thread happened to roll first
+    rng_bind_stream(lane->id == LANE_WRITE ? (unsigned int)self->index : WRITER_LANE_WORKERS + (unsigned int)self->index);
+
     while (1)
     {
         Job job;
-        int got_job = 0;
-        
-        // Lock mutex to access queue
-        pthread_mutex_lock(&pool->job_queue.mutex);
-        
-        // Wait for job or shutdown signal
-        while (pool->job_queue.count == 0 && !pool->job_queue.shutdown)
+        int output_fd;
+
+        // Busy replies and broadcasts first: they are cheap and the client is waiting on them
+        if (lane->id == LANE_READ && take_output(pool, &output_fd))
         {
-            pthread_cond_wait(&pool->job_queue.not_empty, &pool->job_queue.mutex);
+            atomic_fetch_add(&lane->busy_count, 1);
+            finish_job(self, output_fd);
+            atomic_fetch_sub(&lane->busy_count, 1);
+            continue;
         }
-        
-        // Check if we should shutdown
-        if (pool->job_queue.shutdown && pool->job_queue.count == 0)
+
+        if (take_job(self, &job))
         {
-            pthread_mutex_unlock(&pool->job_queue.mutex);
+            atomic_fetch_add(&lane->busy_count, 1);
+            handle_client_request(job.client_fd, job.request);
+            atomic_fetch_sub(&lane->busy_count, 1);
+            frame_buffer_release(job.request);
+            finish_job(self, job.client_fd);
+            // Don't close the socket - keep it open for more requests
+            // The main server loop will handle connection cleanup when client disconnects
+            continue;
+        }
+
+        // Retired by the scaler and nothing left to take
+        if (atomic_load(&self->retire))
             break;
+
+        // Nothing to run or steal: sleep until a job is pushed or the pool shuts down.
+        // idle_count is raised before re-checking queued_count so push_job cannot miss us.
+        pthread_mutex_lock(&lane->idle_mutex);
+        atomic_fetch_add(&lane->idle_count, 1);
+        while (atomic_load(&lane->queued_count) == 0 && !atomic_load(&pool->shutdown) &&
+               !atomic_load(&self->retire))
+        {
+            pthread_cond_wait(&lane->work_available, &lane->idle_mutex);
         }
-        
-        // Get job from queue
-        if (pool->job_queue.count > 0)
-        {
-            job = pool->job_queue.queue[pool->job_queue.head];
-            pool->job_queue.head = (pool->job_queue.head + 1) % MAX_QUEUE_SIZE;
-            pool->job_queue.count--;
-            got_job = 1;
-            
-            // Signal that queue is not full anymore
-            pthread_cond_signal(&pool->job_queue.not_full);
-        }
-        
-        pthread_mutex_unlock(&pool->job_queue.mutex);
-        
-        // Process job if we got one
-        if (got_job)
-        {
-            int result = handle_client_request(job.client_fd, &job.request);
-            
-            if (result == 0)
+        atomic_fetch_sub(&lane->idle_count, 1);
+        int done = atomic_load(&pool->shutdown) && atomic_load(&lane->queued_count) == 0;
+        pthread_mutex_unlock(&lane->idle_mutex);
+
+        if (done)
+            break;
+    }
+
+    db_thread_detach();
+    return NULL;
+}
+
+// Start the worker in slot index (caller is init or the scaler)
+static int start_worker(Lane *lane, int index)
+{
+    Worker *worker = &lane->workers[index];
+    atomic_store(&worker->retire, 0);
+    if (pthread_create(&worker->thread, NULL, worker_thread, worker) != 0)
+        return -1;
+    worker->started = 1;
+
+    if (index + 1 > atomic_load(&lane->spawned_count))
+        atomic_store(&lane->spawned_count, index + 1);
+    return 0;
+}
+
+// Start the first count workers of a lane
+static int start_lane(Lane *lane, int count)
+{
+    for (int i = 0; i < count; i++)
+    {
+        if (start_worker(lane, i) != 0)
+            return -1;
+        atomic_store(&lane->active_count, i + 1);
+    }
+    return 0;
+}
+
+// Stop the newest active worker: it stops receiving jobs, finishes what it can take, then exits
+static void retire_worker(Lane *lane)
+{
+    int index = atomic_load(&lane->active_count) - 1;
+    Worker *worker = &lane->workers[index];
+
+    atomic_store(&lane->active_count, index);
+    atomic_store(&worker->retire, 1);
+
+    pthread_mutex_lock(&lane->idle_mutex);
+    pthread_cond_broadcast(&lane->work_available);
+    pthread_mutex_unlock(&lane->idle_mutex);
+
+    pthread_join(worker->thread, NULL);
+    worker->started = 0;
+}
+
+// Scaler thread: grow the reader lane on backlog, shrink it after a sustained period of low utilization.
+// The writer lane keeps WRITER_LANE_WORKERS, more writers would only wait on SQLite's write lock.
+static void *scaler_thread(void *arg)
+{
+    ThreadPool *pool = (ThreadPool *)arg;
+    Lane *lane = &pool->lanes[LANE_READ];
+    int quiet_intervals = 0;
+
+    pthread_mutex_lock(&pool->scaler_mutex);
+    while (!atomic_load(&pool->shutdown))
+    {
+        struct timespec deadline;
+        clock_gettime(CLOCK_REALTIME, &deadline);
+        deadline.tv_nsec += (long)SCALE_INTERVAL_MS * 1000000L;
+        deadline.tv_sec += deadline.tv_nsec / 1000000000L;
+        deadline.tv_nsec %= 1000000000L;
+        pthread_cond_timedwait(&pool->scaler_wakeup, &pool->scaler_mutex, &deadline);
+        if (atomic_load(&pool->shutdown))
+            break;
+        pthread_mutex_unlock(&pool->scaler_mutex);
+
+        int active = atomic_load(&lane->active_count);
+        int queued = atomic_load(&lane->queued_count);
+        int busy = atomic_load(&lane->busy_count);
+
+        if (active < lane->max_workers &&
+            (queued > active * SCALE_GROW_QUEUE_PER_WORKER || (busy >= active && queued > 0)))
+        {
+            // Grow by a quarter (at least one worker) so a burst is absorbed in a few intervals
+            int target = active + (active / 4 > 0 ? active / 4 : 1);
+            if (target > lane->max_workers)
+                target = lane->max_workers;
+            while (active < target && start_worker(lane, active) == 0)
             {
-                // Response sent successfully
-                // Keep connection open for more requests - don't close it
-                // The main server loop will continue to monitor this socket
+                active++;
+                atomic_store(&lane->active_count, active);
             }
-            else
+            LOG_INFO("[THREAD_POOL] Scaled up to %d readers (queued=%d, busy=%d)", active, queued, busy);
+            quiet_intervals = 0;
+        }
+        else if (active > lane->min_workers && queued == 0 &&
+                 busy * 100 < active * SCALE_SHRINK_BUSY_PERCENT)
+        {
+            if (++quiet_intervals >= SCALE_SHRINK_INTERVALS)
             {
-                // Error occurred, connection will be handled by main loop
+                retire_worker(lane);
+                LOG_INFO("[THREAD_POOL] Scaled down to %d readers (busy=%d)", active - 1, busy);
+                quiet_intervals = 0;
             }
-            // Don't close the socket - keep it open for more requests
-            // The main server loop will handle connection cleanup when client disconnects
         }
+        else
+        {
+            quiet_intervals = 0;
+        }
+
+        pthread_mutex_lock(&pool->scaler_mutex);
     }
-    
+    pthread_mutex_unlock(&pool->scaler_mutex);
+
     return NULL;
 }
 
-// Initialize thread pool
-int thread_pool_init(ThreadPool *pool)
+// Allocate a lane's worker slots (no threads are started)
+static int init_lane(ThreadPool *pool, JobLane id, int min_workers, int max_workers)
 {
-    if (!pool)
+    Lane *lane = &pool->lanes[id];
+    lane->pool = pool;
+    lane->id = id;
+    lane->min_workers = min_workers;
+    lane->max_workers = max_workers;
+    atomic_init(&lane->active_count, 0);
+    atomic_init(&lane->spawned_count, 0);
+    atomic_init(&lane->busy_count, 0);
+    atomic_init(&lane->next_worker, 0);
+    atomic_init(&lane->queued_count, 0);
+    atomic_init(&lane->idle_count, 0);
+    atomic_init(&lane->searching_count, 0);
+
+    pthread_mutex_init(&lane->idle_mutex, NULL);
+    pthread_cond_init(&lane->work_available, NULL);
+
+    lane->workers = calloc(max_workers, sizeof(Worker));
+    if (!lane->workers)
         return -1;
-    
-    // Initialize job queue
-    memset(&pool->job_queue, 0, sizeof(JobQueue));
-    pool->job_queue.head = 0;
-    pool->job_queue.tail = 0;
-    pool->job_queue.count = 0;
-    pool->job_queue.shutdown = 0;
-    
-    if (pthread_mutex_init(&pool->job_queue.mutex, NULL) != 0)
+
+    for (int i = 0; i < max_workers; i++)
+    {
+        lane->workers[i].lane = lane;
+        lane->workers[i].index = i;
+        atomic_init(&lane->workers[i].retire, 0);
+        pthread_mutex_init(&lane->workers[i].deque.lock, NULL);
+    }
+    return 0;
+}
+
+// Free everything allocated by thread_pool_init_range() (no threads may be running)
+static void destroy_pool_state(ThreadPool *pool)
+{
+    for (int l = 0; l < LANE_COUNT; l++)
+    {
+        Lane *lane = &pool->lanes[l];
+        if (lane->workers)
+        {
+            for (int i = 0; i < lane->max_workers; i++)
+                pthread_mutex_destroy(&lane->workers[i].deque.lock);
+        }
+        pthread_mutex_destroy(&lane->idle_mutex);
+        pthread_cond_destroy(&lane->work_available);
+        free(lane->workers);
+        lane->workers = NULL;
+        atomic_store(&lane->active_count, 0);
+    }
+    pthread_mutex_destroy(&pool->scaler_mutex);
+    pthread_cond_destroy(&pool->scaler_wakeup);
+    pthread_mutex_destroy(&pool->output_lock);
+    free(pool->mailbox_chunks);
+    pool->mailbox_chunks = NULL;
+}
+
+static int online_cpus(void)
+{
+    long cpus = sysconf(_SC_NPROCESSORS_ONLN);
+    return cpus > 0 ? (int)cpus : 1;
+}
+
+// Initialize the pool with initial_workers readers running and room to scale between the bounds
+static int thread_pool_init_range(ThreadPool *pool, int min_workers, int max_workers, int initial_workers)
+{
+    if (!pool || min_workers <= 0 || max_workers < min_workers || max_workers > MAX_WORKER_THREADS)
         return -1;
-    
-    if (pthread_cond_init(&pool->job_queue.not_empty, NULL) != 0)
+    if (initial_workers < min_workers)
+        initial_workers = min_workers;
+    if (initial_workers > max_workers)
+        initial_workers = max_workers;
+
+    memset(pool, 0, sizeof(ThreadPool));
+    atomic_init(&pool->job_count, 0);
+    atomic_init(&pool->shutdown, 0);
+    atomic_init(&pool->rejected_count, 0);
+    atomic_init(&pool->output_queued, 0);
+
+    pthread_mutex_init(&pool->scaler_mutex, NULL);
+    pthread_cond_init(&pool->scaler_wakeup, NULL);
+    pthread_mutex_init(&pool->output_lock, NULL);
+
+    pool->mailbox_chunks = calloc(MAILBOX_MAX_CHUNKS, sizeof(*pool->mailbox_chunks));
+    int lanes_ok = init_lane(pool, LANE_READ, min_workers, max_workers) == 0 &&
+                   init_lane(pool, LANE_WRITE, WRITER_LANE_WORKERS, WRITER_LANE_WORKERS) == 0;
+    if (!pool->mailbox_chunks || !lanes_ok)
     {
-        pthread_mutex_destroy(&pool->job_queue.mutex);
+        destroy_pool_state(pool);
         return -1;
     }
-    
-    if (pthread_cond_init(&pool->job_queue.not_full, NULL) != 0)
+
+    // Create worker threads
+    if (start_lane(&pool->lanes[LANE_READ], initial_workers) != 0 ||
+        start_lane(&pool->lanes[LANE_WRITE], WRITER_LANE_WORKERS) != 0)
     {
-        pthread_mutex_destroy(&pool->job_queue.mutex);
-        pthread_cond_destroy(&pool->job_queue.not_empty);
+        // Cleanup on failure
+        thread_pool_shutdown(pool);
         return -1;
     }
-    
-    // Create worker threads
-    for (int i = 0; i < NUM_WORKER_THREADS; i++)
+
+    if (min_workers < max_workers)
     {
-        if (pthread_create(&pool->threads[i], NULL, worker_thread, pool) != 0)
+        if (pthread_create(&pool->scaler_thread, NULL, scaler_thread, pool) != 0)
         {
-            // Cleanup on failure
-            pool->job_queue.shutdown = 1;
-            pthread_cond_broadcast(&pool->job_queue.not_empty);
-            
-            for (int j = 0; j < i; j++)
-            {
-                pthread_join(pool->threads[j], NULL);
-            }
-            
-            pthread_mutex_destroy(&pool->job_queue.mutex);
-            pthread_cond_destroy(&pool->job_queue.not_empty);
-            pthread_cond_destroy(&pool->job_queue.not_full);
+            thread_pool_shutdown(pool);
             return -1;
         }
+        pool->scaler_started = 1;
     }
-    
+
     g_pool = pool;
     return 0;
 }
 
+// Initialize thread pool
+int thread_pool_init(ThreadPool *pool)
+{
+    return thread_pool_init_scaled(pool, 0, 0);
+}
+
+// Initialize thread pool scaling between min_workers and max_workers (0 = default bound)
+int thread_pool_init_scaled(ThreadPool *pool, int min_workers, int max_workers)
+{
+    int cpus = online_cpus();
+
+    if (min_workers <= 0)
+        min_workers = MIN_WORKER_THREADS;
+    if (max_workers <= 0)
+    {
+        max_workers = cpus * WORKERS_PER_CPU_MAX;
+        if (max_workers > MAX_WORKER_THREADS)
+            max_workers = MAX_WORKER_THREADS;
+        if (max_workers < min_workers)
+            max_workers = min_workers;
+    }
+
+    return thread_pool_init_range(pool, min_workers, max_workers, cpus);
+}
+
+// Initialize thread pool with worker_count readers
+int thread_pool_init_workers(ThreadPool *pool, int worker_count)
+{
+    return thread_pool_init_range(pool, worker_count, worker_count, worker_count);
+}
+
+// Number of workers in a lane currently receiving jobs
+int thread_pool_worker_count(ThreadPool *pool, JobLane lane)
+{
+    if (!pool || lane < 0 || lane >= LANE_COUNT)
+        return 0;
+    return atomic_load(&pool->lanes[lane].active_count);
+}
+
+// Cost class used by admission control for a request type
+JobCost thread_pool_job_cost(uint16_t msg_type)
+{
+    switch (msg_type)
+    {
+    case MSG_HEARTBEAT:
+    case MSG_LOGOUT:
+    case MSG_GET_INVENTORY:
+    case MSG_GET_USER_PROFILE:
+    case MSG_GET_SKIN_DETAILS:
+    case MSG_GET_DEFINITION_ID:
+    case MSG_GET_CASES:
+    case MSG_GET_LEADERBOARD_RANK:
+    case MSG_GET_LEADERBOARD_AROUND:
+    case MSG_GET_LEADERBOARD_PAGE:
+        return JOB_COST_CHEAP;
+
+    case MSG_GET_TOP_TRADERS:
+    case MSG_GET_LUCKIEST_UNBOXERS:
+    case MSG_GET_MOST_PROFITABLE:
+    case MSG_GET_TRADE_HISTORY:
+    case MSG_GET_TRADE_STATS:
+    case MSG_GET_BALANCE_HISTORY:
+    case MSG_GET_PRICE_HISTORY:
+    case MSG_GET_PRICE_TREND:
+    case MSG_GET_MARKET_HISTORY:
+    case MSG_SEARCH_MARKET_BY_NAME:
+    case MSG_GET_CHAT_HISTORY:
+    case MSG_UNBOX_CASE_BATCH:
+        return JOB_COST_EXPENSIVE;
+
+    default:
+        return JOB_COST_NORMAL;
+    }
+}
+
+// Lane a request type runs on. Anything not listed (including new message types)
+// is treated as a mutation and runs on the writer lane.
+JobLane thread_pool_job_lane(uint16_t msg_type)
+{
+    switch (msg_type)
+    {
+    case MSG_HEARTBEAT:
+    case MSG_GET_MARKET_LISTINGS:
+    case MSG_SEARCH_MARKET_BY_NAME:
+    case MSG_GET_PRICE_HISTORY:
+    case MSG_GET_PRICE_TREND:
+    case MSG_GET_MARKET_HISTORY:
+    case MSG_GET_TRADES:
+    case MSG_GET_INVENTORY:
+    case MSG_GET_INVENTORY_FULL:
+    case MSG_GET_USER_PROFILE:
+    case MSG_GET_SKIN_DETAILS:
+    case MSG_SEARCH_USER_BY_USERNAME:
+    case MSG_GET_DEFINITION_ID:
+    case MSG_GET_TOP_TRADERS:
+    case MSG_GET_LUCKIEST_UNBOXERS:
+    case MSG_GET_MOST_PROFITABLE:
+    case MSG_GET_LEADERBOARD_RANK:
+    case MSG_GET_LEADERBOARD_AROUND:
+    case MSG_GET_LEADERBOARD_PAGE:
+    case MSG_GET_TRADE_HISTORY:
+    case MSG_GET_TRADE_STATS:
+    case MSG_GET_BALANCE_HISTORY:
+    case MSG_GET_USER_CHALLENGES:
+    case MSG_GET_CASES:
+    case MSG_GET_CHAT_HISTORY:
+    case MSG_GET_QUESTS:
+    case MSG_GET_ACHIEVEMENTS:
+        return LANE_READ;
+
+    default:
+        return LANE_WRITE;
+    }
+}
+
+static int admit_limit(JobCost cost)
+{
+    switch (cost)
+    {
+    case JOB_COST_CHEAP:
+        return ADMIT_LIMIT_CHEAP;
+    case JOB_COST_EXPENSIVE:
+        return ADMIT_LIMIT_EXPENSIVE;
+    default:
+        return ADMIT_LIMIT_NORMAL;
+    }
+}
+
+// Queue an outgoing frame (busy reply or broadcast) in the connection's order: behind the job in
+// flight if there is one, otherwise for the next free reader lane worker. The calling thread
+// never writes to the socket. Takes ownership of pending on success.
+static int queue_output(ThreadPool *pool, int client_fd, PendingJob *pending)
+{
+    Mailbox *mailbox = get_mailbox(pool, client_fd);
+    if (!mailbox)
+        return -1;
+
+    pthread_mutex_lock(&mailbox->lock);
+    if (mailbox->output_count >= MAILBOX_MAX_OUTPUT)
+    {
+        pthread_mutex_unlock(&mailbox->lock);
+        return -1;
+    }
+    mailbox_append(mailbox, pending);
+    mailbox->output_count++;
+
+    int idle = !mailbox->in_flight;
+    mailbox->in_flight = 1;
+    pthread_mutex_unlock(&mailbox->lock);
+
+    if (idle)
+        push_output(pool, mailbox);
+    return 0;
+}
+
+// Answer a shed request with ERR_SERVER_FULL after the connection's earlier responses
+static int queue_busy_reply(ThreadPool *pool, int client_fd, const MessageHeader *request_header)
+{
+    PendingJob *pending = calloc(1, sizeof(PendingJob));
+    if (!pending)
+        return -1;
+    pending->kind = PENDING_BUSY_REPLY;
+    pending->request_header = *request_header;
+    if (queue_output(pool, client_fd, pending) != 0)
+    {
+        LOG_WARNING_CTX(0, client_fd, "[THREAD_POOL] %d replies waiting, client keeps pipelining", MAILBOX_MAX_OUTPUT);
+        free(pending);
+        return -1;
+    }
+    return 0;
+}
+
+SharedMessage *shared_message_create(const Message *message)
+{
+    if (!message || message->header.msg_length > MAX_PAYLOAD_SIZE)
+        return NULL;
+    SharedMessage *shared = malloc(sizeof(SharedMessage));
+    if (!shared)
+        return NULL;
+    atomic_init(&shared->refs, 1);
+    memcpy(&shared->message.header, &message->header, sizeof(MessageHeader));
+    memcpy(shared->message.payload, message->payload, message->header.msg_length);
+    return shared;
+}
+
+void shared_message_release(SharedMessage *shared)
+{
+    if (shared && atomic_fetch_sub(&shared->refs, 1) == 1)
+        free(shared);
+}
+
+int thread_pool_queue_broadcast(ThreadPool *pool, int client_fd, SharedMessage *shared)
+{
+    if (!pool || !shared || client_fd < 0 || atomic_load(&pool->shutdown))
+        return -1;
+
+    PendingJob *pending = calloc(1, sizeof(PendingJob));
+    if (!pending)
+        return -1;
+    pending->kind = PENDING_BROADCAST;
+    pending->shared = shared;
+    atomic_fetch_add(&shared->refs, 1);
+    if (queue_output(pool, client_fd, pending) != 0)
+    {
+        shared_message_release(shared);
+        free(pending);
+        return -1;
+    }
+    return 0;
+}
+
 // Add job to queue
 int thread_pool_add_job(ThreadPool *pool, int client_fd, Message *request)
 {
-    if (!pool || client_fd < 0 || !request)
+    if (!request)
+        return -1;
+    if (!pool || client_fd < 0 || atomic_load(&pool->shutdown))
+    {
+        frame_buffer_release(request);
         return -1;
-    
-    pthread_mutex_lock(&pool->job_queue.mutex);
-    
-    // Wait if queue is full
-    while (pool->job_queue.count >= MAX_QUEUE_SIZE && !pool->job_queue.shutdown)
+    }
+
+    // Reserve a slot, shedding the job instead of blocking the network thread
+    int limit = admit_limit(thread_pool_job_cost(request->header.msg_type));
+    if (atomic_fetch_add(&pool->job_count, 1) >= limit)
     {
-        pthread_cond_wait(&pool->job_queue.not_full, &pool->job_queue.mutex);
+        atomic_fetch_sub(&pool->job_count, 1);
+        atomic_fetch_add(&pool->rejected_count, 1);
+        MessageHeader header = request->header;
+        frame_buffer_release(request);
+        return queue_busy_reply(pool, client_fd, &header) == 0 ? THREAD_POOL_REJECTED : -1;
     }
-    
-    // Check if pool is shutting down
-    if (pool->job_queue.shutdown)
+
+    Mailbox *mailbox = get_mailbox(pool, client_fd);
+    if (!mailbox)
     {
-        pthread_mutex_unlock(&pool->job_queue.mutex);
+        atomic_fetch_sub(&pool->job_count, 1);
+        frame_buffer_release(request);
         return -1;
     }
-    
-    // Add job to queue
-    pool->job_queue.queue[pool->job_queue.tail] = (Job){.client_fd = client_fd, .request = *request};
-    pool->job_queue.tail = (pool->job_queue.tail + 1) % MAX_QUEUE_SIZE;
-    pool->job_queue.count++;
-    
-    // Signal that queue is not empty
-    pthread_cond_signal(&pool->job_queue.not_empty);
-    
-    pthread_mutex_unlock(&pool->job_queue.mutex);
-    
+
+    Job job = {.client_fd = client_fd, .request = request};
+
+    pthread_mutex_lock(&mailbox->lock);
+    if (mailbox->in_flight)
+    {
+        // Another request from this client is queued or running (on either lane): wait behind it
+        PendingJob *pending = calloc(1, sizeof(PendingJob));
+        if (!pending)
+        {
+            pthread_mutex_unlock(&mailbox->lock);
+            atomic_fetch_sub(&pool->job_count, 1);
+            frame_buffer_release(request);
+            return -1;
+        }
+        pending->kind = PENDING_REQUEST;
+        pending->job = job;
+        mailbox_append(mailbox, pending);
+        pthread_mutex_unlock(&mailbox->lock);
+        return 0;
+    }
+    mailbox->in_flight = 1;
+    pthread_mutex_unlock(&mailbox->lock);
+
+    push_job_round_robin(lane_for_job(pool, &job), &job);
+
     return 0;
 }
 
+// Drop queued jobs for a closed connection and close its socket
+void thread_pool_close_connection(ThreadPool *pool, int client_fd)
+{
+    if (!pool || client_fd < 0)
+        return;
+
+    int close_now = 1;
+    int chunk_index = client_fd / MAILBOX_CHUNK_SIZE;
+    Mailbox *chunk = NULL;
+    // After thread_pool_shutdown() no job can hold the fd, it is closed right away
+    if (pool->mailbox_chunks && chunk_index < MAILBOX_MAX_CHUNKS)
+        chunk = atomic_load(&pool->mailbox_chunks[chunk_index]);
+
+    if (chunk)
+    {
+        Mailbox *mailbox = &chunk[client_fd % MAILBOX_CHUNK_SIZE];
+        pthread_mutex_lock(&mailbox->lock);
+        while (mailbox->head)
+        {
+            PendingJob *pending = mailbox->head;
+            mailbox->head = pending->next;
+            if (pending->kind == PENDING_REQUEST)
+            {
+                frame_buffer_release(pending->job.request);
+                atomic_fetch_sub(&pool->job_count, 1);
+            }
+            shared_message_release(pending->shared);
+            free(pending);
+        }
+        mailbox->tail = NULL;
+        mailbox->output_count = 0;
+
+        if (mailbox->in_flight)
+        {
+            // Keep the fd open (and unused by new connections) until the running job is done
+            mailbox->close_pending = 1;
+            close_now = 0;
+        }
+        pthread_mutex_unlock(&mailbox->lock);
+    }
+
+    if (close_now)
+        close(client_fd);
+}
+
 // Shutdown thread pool
 void thread_pool_shutdown(ThreadPool *pool)
 {
-    if (!pool)
+    if (!pool || !pool->mailbox_chunks)
         return;
-    
-    pthread_mutex_lock(&pool->job_queue.mutex);
-    pool->job_queue.shutdown = 1;
-    pthread_cond_broadcast(&pool->job_queue.not_empty);
-    pthread_cond_broadcast(&pool->job_queue.not_full);
-    pthread_mutex_unlock(&pool->job_queue.mutex);
-    
-    // Wait for all threads to finish
-    for (int i = 0; i < NUM_WORKER_THREADS; i++)
-    {
-        pthread_join(pool->threads[i], NULL);
-    }
-    
+
+    atomic_store(&pool->shutdown, 1);
+    for (int l = 0; l < LANE_COUNT; l++)
+    {
+        pthread_mutex_lock(&pool->lanes[l].idle_mutex);
+        pthread_cond_broadcast(&pool->lanes[l].work_available);
+        pthread_mutex_unlock(&pool->lanes[l].idle_mutex);
+    }
+    pthread_mutex_lock(&pool->scaler_mutex);
+    pthread_cond_signal(&pool->scaler_wakeup);
+    pthread_mutex_unlock(&pool->scaler_mutex);
+
+    // Stop the scaler first so the set of running workers no longer changes
+    if (pool->scaler_started)
+    {
+        pthread_join(pool->scaler_thread, NULL);
+        pool->scaler_started = 0;
+    }
+
+    // Wait for all threads to finish (they drain the deques first)
+    for (int l = 0; l < LANE_COUNT; l++)
+    {
+        Lane *lane = &pool->lanes[l];
+        for (int i = 0; lane->workers && i < lane->max_workers; i++)
+        {
+            if (lane->workers[i].started)
+            {
+                pthread_join(lane->workers[i].thread, NULL);
+                lane->workers[i].started = 0;
+            }
+        }
+    }
+
+    // A writer may have handed a parked job to the readers after they exited
+    for (int l = 0; l < LANE_COUNT; l++)
+    {
+        Lane *lane = &pool->lanes[l];
+        for (int i = 0; lane->workers && i < lane->max_workers; i++)
+        {
+            Job job;
+            while (pop_job(&lane->workers[i], &job))
+                frame_buffer_release(job.request);
+        }
+    }
+
+    // Free jobs still parked in mailboxes
+    for (int c = 0; c < MAILBOX_MAX_CHUNKS; c++)
+    {
+        Mailbox *chunk = atomic_load(&pool->mailbox_chunks[c]);
+        if (!chunk)
+            continue;
+        for (int i = 0; i < MAILBOX_CHUNK_SIZE; i++)
+        {
+            while (chunk[i].head)
+            {
+                PendingJob *pending = chunk[i].head;
+                chunk[i].head = pending->next;
+                if (pending->kind == PENDING_REQUEST)
+                    frame_buffer_release(pending->job.request);
+                shared_message_release(pending->shared);
+                free(pending);
+            }
+            pthread_mutex_destroy(&chunk[i].lock);
+        }
+        free(chunk);
+    }
+
+    long rejected = atomic_load(&pool->rejected_count);
+    if (rejected > 0)
+        LOG_INFO("[THREAD_POOL] %ld jobs were shed by admission control", rejected);
+
     // Cleanup synchronization primitives
-    pthread_mutex_destroy(&pool->job_queue.mutex);
-    pthread_cond_destroy(&pool->job_queue.not_empty);
-    pthread_cond_destroy(&pool->job_queue.not_full);
-    
+    destroy_pool_state(pool);
+
     g_pool = NULL;
 }
@@ -0,0 +1,310 @@
+// top_unboxes.c - Most valuable unboxes (bounded min-heap mirrored to top_unboxes)
+
+#include "../include/top_unboxes.h"
+#include "../include/database.h"
+#include "../include/database_internal.h"
+#include "../include/pricing_catalog.h"
+#include "../include/logger.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+
+typedef struct
+{
+    int instance_id;
+    int user_id;
+    int definition_id;
+    float value;
+    time_t unboxed_at;
+    char username[MAX_USERNAME_LEN];
+} KeptUnbox;
+
+static pthread_mutex_t g_mutex = PTHREAD_MUTEX_INITIALIZER;
+// Held while a heap change is written to the table; taken before g_mutex is released, so rows
+// are written in the order the heap changed while queries only wait for the in-memory update
+static pthread_mutex_t g_persist_mutex = PTHREAD_MUTEX_INITIALIZER;
+static KeptUnbox g_heap[LEADERBOARD_TOP_UNBOXES]; // g_heap[0] is the cheapest kept unbox
+static int g_count = 0;
+
+// a ranks below b: lower value, or the same value unboxed later
+static inline int ranks_below(const KeptUnbox *a, const KeptUnbox *b)
+{
+    return a->value < b->value || (a->value == b->value && a->instance_id > b->instance_id);
+}
+
+static void swap(int i, int j)
+{
+    KeptUnbox tmp = g_heap[i];
+    g_heap[i] = g_heap[j];
+    g_heap[j] = tmp;
+}
+
+static void sift_up(int i)
+{
+    while (i > 0 && ranks_below(&g_heap[i], &g_heap[(i - 1) / 2]))
+    {
+        swap(i, (i - 1) / 2);
+        i = (i - 1) / 2;
+    }
+}
+
+static void sift_down(int i)
+{
+    while (1)
+    {
+        int lowest = i;
+        int left = 2 * i + 1, right = 2 * i + 2;
+        if (left < g_count && ranks_below(&g_heap[left], &g_heap[lowest]))
+            lowest = left;
+        if (right < g_count && ranks_below(&g_heap[right], &g_heap[lowest]))
+            lowest = right;
+        if (lowest == i)
+            return;
+        swap(i, lowest);
+        i = lowest;
+    }
+}
+
+// Keep the unbox if there is room or it beats the root. Returns the evicted instance_id,
+// 0 if nothing was evicted, -1 if the unbox was not kept (mutex held)
+static int offer_locked(const KeptUnbox *unbox)
+{
+    if (g_count < LEADERBOARD_TOP_UNBOXES)
+    {
+        g_heap[g_count++] = *unbox;
+        sift_up(g_count - 1);
+        return 0;
+    }
+    if (!ranks_below(&g_heap[0], unbox))
+        return -1;
+
+    int evicted = g_heap[0].instance_id;
+    g_heap[0] = *unbox;
+    sift_down(0);
+    return evicted;
+}
+
+// ==================== Persistence ====================
+
+static int save_row(const KeptUnbox *unbox)
+{
+    sqlite3_stmt *stmt;
+    if (db_prepare("INSERT OR REPLACE INTO top_unboxes (instance_id, user_id, definition_id, value, unboxed_at) "
+                   "VALUES (?, ?, ?, ?, ?)",
+                   &stmt) != SQLITE_OK)
+        return -1;
+    sqlite3_bind_int(stmt, 1, unbox->instance_id);
+    sqlite3_bind_int(stmt, 2, unbox->user_id);
+    sqlite3_bind_int(stmt, 3, unbox->definition_id);
+    sqlite3_bind_double(stmt, 4, unbox->value);
+    sqlite3_bind_int64(stmt, 5, (sqlite3_int64)unbox->unboxed_at);
+    int rc = sqlite3_step(stmt);
+    db_finalize(stmt);
+    return rc == SQLITE_DONE ? 0 : -1;
+}
+
+static int delete_row(int instance_id)
+{
+    sqlite3_stmt *stmt;
+    if (db_prepare("DELETE FROM top_unboxes WHERE instance_id = ?", &stmt) != SQLITE_OK)
+        return -1;
+    sqlite3_bind_int(stmt, 1, instance_id);
+    int rc = sqlite3_step(stmt);
+    db_finalize(stmt);
+    return rc == SQLITE_DONE ? 0 : -1;
+}
+
+// Mirror one heap change: the evicted row (if any) and the new one in a single transaction
+static int persist_change(int evicted, const KeptUnbox *unbox)
+{
+    if (db_begin_transaction() != 0)
+        return -1;
+    if ((evicted > 0 && delete_row(evicted) != 0) || save_row(unbox) != 0)
+    {
+        db_rollback_transaction();
+        return -1;
+    }
+    return db_commit_transaction();
+}
+
+// First start: rank every owned instance at current prices and store the best (mutex held)
+static int seed_from_instances(void)
+{
+    sqlite3_stmt *stmt;
+    if (db_prepare("SELECT instance_id, owner_id, definition_id, rarity, wear, acquired_at FROM skin_instances "
+                   "WHERE owner_id > 0 AND acquired_at > 0",
+                   &stmt) != SQLITE_OK)
+        return -1;
+    while (sqlite3_step(stmt) == SQLITE_ROW)
+    {
+        KeptUnbox unbox;
+        memset(&unbox, 0, sizeof(unbox));
+        unbox.instance_id = sqlite3_column_int(stmt, 0);
+        unbox.user_id = sqlite3_column_int(stmt, 1);
+        unbox.definition_id = sqlite3_column_int(stmt, 2);
+        unbox.value = db_calculate_skin_price(unbox.definition_id, (SkinRarity)sqlite3_column_int(stmt, 3),
+                                              (WearCondition)sqlite3_column_double(stmt, 4));
+        unbox.unboxed_at = (time_t)sqlite3_column_int64(stmt, 5);
+        offer_locked(&unbox);
+    }
+    db_finalize(stmt);
+
+    if (db_begin_transaction() != 0)
+        return -1;
+    for (int i = 0; i < g_count; i++)
+    {
+        if (save_row(&g_heap[i]) != 0)
+        {
+            db_rollback_transaction();
+            return -1;
+        }
+    }
+    return db_commit_transaction();
+}
+
+int top_unboxes_init(void)
+{
+    pthread_mutex_lock(&g_mutex);
+    g_count = 0;
+
+    sqlite3_stmt *stmt;
+    if (db_prepare("SELECT COUNT(*) FROM top_unboxes", &stmt) != SQLITE_OK)
+    {
+        pthread_mutex_unlock(&g_mutex);
+        return -1;
+    }
+    int stored = sqlite3_step(stmt) == SQLITE_ROW ? sqlite3_column_int(stmt, 0) : 0;
+    db_finalize(stmt);
+
+    if (stored == 0 && seed_from_instances() != 0)
+    {
+        LOG_ERROR("[LEADERBOARD] Failed to seed top unboxes");
+        g_count = 0;
+    }
+
+    // Load with usernames; more than LEADERBOARD_TOP_UNBOXES rows only after an interrupted
+    // update, the heap keeps the best of them
+    g_count = 0;
+    if (db_prepare("SELECT t.instance_id, t.user_id, t.definition_id, t.value, t.unboxed_at, u.username "
+                   "FROM top_unboxes t LEFT JOIN users u ON u.user_id = t.user_id",
+                   &stmt) != SQLITE_OK)
+    {
+        pthread_mutex_unlock(&g_mutex);
+        return -1;
+    }
+    while (sqlite3_step(stmt) == SQLITE_ROW)
+    {
+        KeptUnbox unbox;
+        memset(&unbox, 0, sizeof(unbox));
+        unbox.instance_id = sqlite3_column_int(stmt, 0);
+        unbox.user_id = sqlite3_column_int(stmt, 1);
+        unbox.definition_id = sqlite3_column_int(stmt, 2);
+        unbox.value = (float)sqlite3_column_double(stmt, 3);
+        unbox.unboxed_at = (time_t)sqlite3_column_int64(stmt, 4);
+        const char *username = (const char *)sqlite3_column_text(stmt, 5);
+        if (username)
+            snprintf(unbox.username, sizeof(unbox.username), "%s", username);
+        int evicted = offer_locked(&unbox);
+        if (evicted > 0)
+            delete_row(evicted);
+        else if (evicted < 0)
+            delete_row(unbox.instance_id);
+    }
+    db_finalize(stmt);
+    int count = g_count;
+    pthread_mutex_unlock(&g_mutex);
+
+    LOG_INFO("[LEADERBOARD] Top unboxes loaded: %d", count);
+    return 0;
+}
+
+void top_unboxes_cleanup(void)
+{
+    pthread_mutex_lock(&g_mutex);
+    g_count = 0;
+    pthread_mutex_unlock(&g_mutex);
+}
+
+void top_unboxes_record(int user_id, int instance_id, int definition_id, float value, time_t when)
+{
+    if (user_id <= 0 || instance_id <= 0 || value <= 0.0f)
+        return;
+
+    KeptUnbox unbox;
+    memset(&unbox, 0, sizeof(unbox));
+    unbox.instance_id = instance_id;
+    unbox.user_id = user_id;
+    unbox.definition_id = definition_id;
+    unbox.value = value;
+    unbox.unboxed_at = when;
+
+    // Cheap rejection first; nearly every unbox ends here once the heap is full
+    pthread_mutex_lock(&g_mutex);
+    int full = g_count == LEADERBOARD_TOP_UNBOXES;
+    int kept = !full || ranks_below(&g_heap[0], &unbox);
+    pthread_mutex_unlock(&g_mutex);
+    if (!kept)
+        return;
+
+    User user;
+    if (db_load_user(user_id, &user) == 0)
+        snprintf(unbox.username, sizeof(unbox.username), "%s", user.username);
+
+    pthread_mutex_lock(&g_mutex);
+    int evicted = offer_locked(&unbox);
+    if (evicted < 0)
+    {
+        pthread_mutex_unlock(&g_mutex);
+        return;
+    }
+    pthread_mutex_lock(&g_persist_mutex);
+    pthread_mutex_unlock(&g_mutex);
+
+    if (persist_change(evicted, &unbox) != 0)
+        LOG_WARNING("[LEADERBOARD] Could not store top unbox %d", instance_id);
+    pthread_mutex_unlock(&g_persist_mutex);
+}
+
+static int by_rank_desc(const void *a, const void *b)
+{
+    const KeptUnbox *x = a, *y = b;
+    if (ranks_below(x, y))
+        return 1;
+    if (ranks_below(y, x))
+        return -1;
+    return 0;
+}
+
+int top_unboxes_get(LeaderboardEntry *out_entries, int *count, int limit)
+{
+    if (!out_entries || !count || limit <= 0)
+        return -1;
+
+    KeptUnbox kept[LEADERBOARD_TOP_UNBOXES];
+    pthread_mutex_lock(&g_mutex);
+    int n = g_count;
+    memcpy(kept, g_heap, n * sizeof(KeptUnbox));
+    pthread_mutex_unlock(&g_mutex);
+
+    qsort(kept, n, sizeof(KeptUnbox), by_rank_desc);
+    if (n > limit)
+        n = limit;
+
+    const PricingCatalog *catalog = pricing_catalog_get();
+    for (int i = 0; i < n; i++)
+    {
+        LeaderboardEntry *e = &out_entries[i];
+        memset(e, 0, sizeof(LeaderboardEntry));
+        e->user_id = kept[i].user_id;
+        memcpy(e->username, kept[i].username, MAX_USERNAME_LEN);
+        e->value = kept[i].value;
+
+        const CatalogDefinition *def = NULL;
+        if (catalog && pricing_catalog_definition(catalog, kept[i].definition_id, &def) == 0)
+            snprintf(e->details, sizeof(e->details), "Unboxed: %s", def->name);
+    }
+
+    *count = n;
+    return 0;
+}
@@ -6,6 +6,8 @@
 #include "../include/quests.h"
 #include "../include/achievements.h"
 #include "../include/trading_challenges.h"
+#include "../include/leaderboard_index.h"
+#include "../include/leaderboard_windows.h"
 #include "../include/logger.h"
 #include <stdio.h>
 #include <stdlib.h>
@@ -17,6 +19,72 @@
 // Forward declaration
 static int execute_trade_internal(TradeOffer *offer);
 
+// Check that every item of one side of a trade still exists, is owned by owner_id and is in
+// their inventory. Instances and inventory are each loaded with one query.
+static int trade_items_available(const int *instance_ids, int count, int owner_id)
+{
+    if (count <= 0)
+        return 1;
+    if (count > TRADE_MAX_ITEMS)
+        count = TRADE_MAX_ITEMS;
+
+    SkinInstanceRecord records[TRADE_MAX_ITEMS];
+    if (db_load_skin_instances(instance_ids, count, records, NULL) != 0)
+        return 0;
+
+    Inventory inv;
+    int have_inventory = (db_load_inventory(owner_id, &inv) == 0);
+
+    for (int i = 0; i < count; i++)
+    {
+        if (instance_ids[i] <= 0)
+            continue;
+
+        // Item no longer exists, or is no longer owned by this user (may have been traded/sold)
+        if (records[i].instance_id == 0 || records[i].owner_id != owner_id)
+            return 0;
+
+        // Check if item is still in the inventory (may have been removed by another trade)
+        if (have_inventory)
+        {
+            int found = 0;
+            for (int j = 0; j < inv.count; j++)
+            {
+                if (inv.skin_ids[j] == instance_ids[i])
+                {
+                    found = 1;
+                    break;
+                }
+            }
+            if (!found)
+                return 0;
+        }
+    }
+
+    return 1;
+}
+
+// Market value of the items on one side of a trade (missing instances count as 0)
+static float trade_items_value(const int *instance_ids, int count)
+{
+    if (count <= 0)
+        return 0.0f;
+    if (count > TRADE_MAX_ITEMS)
+        count = TRADE_MAX_ITEMS;
+
+    SkinInstanceRecord records[TRADE_MAX_ITEMS];
+    if (db_load_skin_instances(instance_ids, count, records, NULL) != 0)
+        return 0.0f;
+
+    float value = 0.0f;
+    for (int i = 0; i < count; i++)
+    {
+        if (records[i].instance_id != 0)
+            value += db_calculate_skin_price(records[i].definition_id, records[i].rarity, records[i].wear);
+    }
+    return value;
+}
+
 // Send trade offer
 int send_trade_offer(int from_user, int to_user, TradeOffer *offer)
 {
@@ -80,110 +148,13 @@ int accept_trade(int user_id, int trade_id)
 
     // CRITICAL: Validate items are still available before executing trade
     // This prevents duplicate items when multiple trade offers contain the same item
-    // Check offered items are still owned by from_user and in their inventory
-    for (int i = 0; i < trade.offered_count; i++)
+    // Offered items must still be owned by from_user, requested items by to_user
+    if (!trade_items_available(trade.offered_skins, trade.offered_count, trade.from_user_id) ||
+        !trade_items_available(trade.requested_skins, trade.requested_count, trade.to_user_id))
     {
-        int instance_id = trade.offered_skins[i];
-        if (instance_id <= 0)
-            continue;
-
-        int definition_id, owner_id;
-        SkinRarity rarity;
-        WearCondition wear;
-        int pattern_seed, is_stattrak;
-        time_t acquired_at;
-        int is_tradable;
-
-        if (db_load_skin_instance(instance_id, &definition_id, &rarity, &wear, &pattern_seed, &is_stattrak, &owner_id, &acquired_at, &is_tradable) != 0)
-        {
-            // Item no longer exists
-            trade.status = TRADE_EXPIRED;
-            db_update_trade(&trade);
-            return -6; // Item no longer available
-        }
-
-        if (owner_id != trade.from_user_id)
-        {
-            // Item no longer owned by from_user (may have been traded/sold)
-            trade.status = TRADE_EXPIRED;
-            db_update_trade(&trade);
-            return -6; // Item no longer available
-        }
-
-        // Check if item is still in from_user's inventory
-        Inventory inv;
-        if (db_load_inventory(trade.from_user_id, &inv) == 0)
-        {
-            int found = 0;
-            for (int j = 0; j < inv.count; j++)
-            {
-                if (inv.skin_ids[j] == instance_id)
-                {
-                    found = 1;
-                    break;
-                }
-            }
-            if (!found)
-            {
-                // Item not in inventory (may have been removed by another trade)
-                trade.status = TRADE_EXPIRED;
-                db_update_trade(&trade);
-                return -6; // Item no longer available
-            }
-        }
-    }
-
-    // Check requested items are still owned by to_user and in their inventory
-    for (int i = 0; i < trade.requested_count; i++)
-    {
-        int instance_id = trade.requested_skins[i];
-        if (instance_id <= 0)
-            continue;
-
-        int definition_id, owner_id;
-        SkinRarity rarity;
-        WearCondition wear;
-        int pattern_seed, is_stattrak;
-        time_t acquired_at;
-        int is_tradable;
-
-        if (db_load_skin_instance(instance_id, &definition_id, &rarity, &wear, &pattern_seed, &is_stattrak, &owner_id, &acquired_at, &is_tradable) != 0)
-        {
-            // Item no longer exists
-            trade.status = TRADE_EXPIRED;
-            db_update_trade(&trade);
-            return -6; // Item no longer available
-        }
-
-        if (owner_id != trade.to_user_id)
-        {
-            // Item no longer owned by to_user (may have been traded/sold)
-            trade.status = TRADE_EXPIRED;
-            db_update_trade(&trade);
-            return -6; // Item no longer available
-        }
-
-        // Check if item is still in to_user's inventory
-        Inventory inv;
-        if (db_load_inventory(trade.to_user_id, &inv) == 0)
-        {
-            int found = 0;
-            for (int j = 0; j < inv.count; j++)
-            {
-                if (inv.skin_ids[j] == instance_id)
-                {
-                    found = 1;
-                    break;
-                }
-            }
-            if (!found)
-            {
-                // Item not in inventory (may have been removed by another trade)
-                trade.status = TRADE_EXPIRED;
-                db_update_trade(&trade);
-                return -6; // Item no longer available
-            }
-        }
+        trade.status = TRADE_EXPIRED;
+        db_update_trade(&trade);
+        return -6; // Item no longer available
     }
 
     // BEGIN TRANSACTION - All operations must succeed or all rollback
@@ -210,62 +181,14 @@ int accept_trade(int user_id, int trade_id)
         return -5; // Execution failed
     }
 
-    // COMMIT TRANSACTION - All operations succeeded
-    if (db_commit_transaction() != 0)
-    {
-        db_rollback_transaction();
-        return -20; // Failed to commit transaction
-    }
-
     // Calculate trade values for analytics
     float offered_value = trade.offered_cash;
     float requested_value = trade.requested_cash;
 
-    // Calculate value of offered items
-    for (int i = 0; i < trade.offered_count; i++)
-    {
-        int instance_id = trade.offered_skins[i];
-        if (instance_id <= 0)
-            continue;
-
-        int definition_id;
-        SkinRarity rarity;
-        WearCondition wear;
-        int pattern_seed, is_stattrak;
-        int owner_id;
-        time_t acquired_at;
-        int is_tradable;
-
-        if (db_load_skin_instance(instance_id, &definition_id, &rarity, &wear, &pattern_seed, &is_stattrak, &owner_id, &acquired_at, &is_tradable) == 0)
-        {
-            float price = db_calculate_skin_price(definition_id, rarity, wear);
-            offered_value += price;
-        }
-    }
+    offered_value += trade_items_value(trade.offered_skins, trade.offered_count);
+    requested_value += trade_items_value(trade.requested_skins, trade.requested_count);
 
-    // Calculate value of requested items
-    for (int i = 0; i < trade.requested_count; i++)
-    {
-        int instance_id = trade.requested_skins[i];
-        if (instance_id <= 0)
-            continue;
-
-        int definition_id;
-        SkinRarity rarity;
-        WearCondition wear;
-        int pattern_seed, is_stattrak;
-        int owner_id;
-        time_t acquired_at;
-        int is_tradable;
-
-        if (db_load_skin_instance(instance_id, &definition_id, &rarity, &wear, &pattern_seed, &is_stattrak, &owner_id, &acquired_at, &is_tradable) == 0)
-        {
-            float price = db_calculate_skin_price(definition_id, rarity, wear);
-            requested_value += price;
-        }
-    }
-
-    // Log transaction with trade value information
+    // Log transaction with trade value information; the ledger rows commit or roll back with the trade
     // Log for the receiver (user_id = to_user_id)
     // Receiver gave requested_value (what they're giving to sender) and received offered_value (what sender gave them)
     TransactionLog log;
@@ -279,11 +202,18 @@ int accept_trade(int user_id, int trade_id)
     log.timestamp = time(NULL);
     LOG_DEBUG("accept_trade: Logging transaction for receiver (user_id=%d, trade_id=%d): '%s'",
               user_id, trade_id, log.details);
-    int log_result1 = db_log_transaction(&log);
+    LedgerEntry entry;
+    memset(&entry, 0, sizeof(entry));
+    entry.amount = offered_value;
+    entry.cost = requested_value;
+    entry.counterparty_id = trade.from_user_id;
+    int log_result1 = db_log_ledger(&log, &entry);
     if (log_result1 != 0)
     {
-        LOG_ERROR("accept_trade: Failed to log transaction for receiver (user_id=%d, trade_id=%d): db_log_transaction returned %d",
+        LOG_ERROR("accept_trade: Failed to log transaction for receiver (user_id=%d, trade_id=%d): db_log_ledger returned %d",
                   user_id, trade_id, log_result1);
+        db_rollback_transaction();
+        return -20;
     }
     else
     {
@@ -303,11 +233,16 @@ int accept_trade(int user_id, int trade_id)
     log2.timestamp = time(NULL);
     LOG_DEBUG("accept_trade: Logging transaction for sender (user_id=%d, trade_id=%d): '%s'",
               trade.from_user_id, trade_id, log2.details);
-    int log_result2 = db_log_transaction(&log2);
+    entry.amount = requested_value;
+    entry.cost = offered_value;
+    entry.counterparty_id = user_id;
+    int log_result2 = db_log_ledger(&log2, &entry);
     if (log_result2 != 0)
     {
-        LOG_ERROR("accept_trade: Failed to log transaction for sender (user_id=%d, trade_id=%d): db_log_transaction returned %d",
+        LOG_ERROR("accept_trade: Failed to log transaction for sender (user_id=%d, trade_id=%d): db_log_ledger returned %d",
                   trade.from_user_id, trade_id, log_result2);
+        db_rollback_transaction();
+        return -20;
     }
     else
     {
@@ -315,6 +250,19 @@ int accept_trade(int user_id, int trade_id)
                   trade.from_user_id, trade_id);
     }
 
+    // COMMIT TRANSACTION - All operations succeeded
+    if (db_commit_transaction() != 0)
+    {
+        db_rollback_transaction();
+        return -20; // Failed to commit transaction
+    }
+
+    leaderboard_windows_record_trade(user_id, requested_value, offered_value, log.timestamp);
+    leaderboard_windows_record_trade(trade.from_user_id, offered_value, requested_value, log2.timestamp);
+
+    leaderboard_index_refresh_user(trade.from_user_id);
+    leaderboard_index_refresh_user(trade.to_user_id);
+
     return 0;
 }
 
@@ -415,6 +363,18 @@ int validate_trade(TradeOffer *offer)
     if (!offer)
         return -1;
 
+    if (offer->offered_count > TRADE_MAX_ITEMS || offer->requested_count > TRADE_MAX_ITEMS)
+        return -12;
+
+    // Load both sides' instances up front (one query per side)
+    SkinInstanceRecord offered[TRADE_MAX_ITEMS], requested[TRADE_MAX_ITEMS];
+    if (offer->offered_count > 0 &&
+        db_load_skin_instances(offer->offered_skins, offer->offered_count, offered, NULL) != 0)
+        return -2;
+    if (offer->requested_count > 0 &&
+        db_load_skin_instances(offer->requested_skins, offer->requested_count, requested, NULL) != 0)
+        return -5;
+
     // Check if from_user owns offered items
     int valid_offered_count = 0;
     for (int i = 0; i < offer->offered_count; i++)
@@ -423,18 +383,10 @@ int validate_trade(TradeOffer *offer)
         if (instance_id <= 0)
             continue;
 
-        // Check ownership
-        int definition_id, owner_id;
-        WearCondition wear;
-        time_t acquired_at;
-        int is_tradable;
-
-        SkinRarity rarity;
-        int pattern_seed, is_stattrak; // Not used in trading operations
-        if (db_load_skin_instance(instance_id, &definition_id, &rarity, &wear, &pattern_seed, &is_stattrak, &owner_id, &acquired_at, &is_tradable) != 0)
+        if (offered[i].instance_id == 0)
             return -2; // Instance not found
 
-        if (owner_id != offer->from_user_id)
+        if (offered[i].owner_id != offer->from_user_id)
             return -3; // Not owner
 
         // Check if item is already in a pending trade
@@ -454,18 +406,10 @@ int validate_trade(TradeOffer *offer)
         if (instance_id <= 0)
             continue;
 
-        // Check ownership
-        int definition_id, owner_id;
-        SkinRarity rarity;
-        WearCondition wear;
-        int pattern_seed2, is_stattrak2; // Not used in trading operations
-        time_t acquired_at;
-        int is_tradable;
-
-        if (db_load_skin_instance(instance_id, &definition_id, &rarity, &wear, &pattern_seed2, &is_stattrak2, &owner_id, &acquired_at, &is_tradable) != 0)
+        if (requested[i].instance_id == 0)
             return -5; // Instance not found
 
-        if (owner_id != offer->to_user_id)
+        if (requested[i].owner_id != offer->to_user_id)
             return -6; // Not owner
 
         // Check if item is already in a pending trade
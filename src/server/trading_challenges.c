@@ -4,6 +4,7 @@
 #include "../include/database.h"
 #include "../include/database_internal.h"
 #include "../include/leaderboards.h"
+#include "../include/leaderboard_index.h"
 #include <sqlite3.h>
 #include <stdio.h>
 #include <stdlib.h>
@@ -21,23 +22,16 @@ static float calculate_net_worth(int user_id)
     float net_worth = user.balance;
     
     Inventory inv;
-    if (db_load_inventory(user_id, &inv) == 0)
+    if (db_load_inventory(user_id, &inv) == 0 && inv.count > 0)
     {
-        for (int i = 0; i < inv.count; i++)
+        SkinInstanceRecord records[MAX_INVENTORY_SIZE];
+        if (db_load_skin_instances(inv.skin_ids, inv.count, records, NULL) == 0)
         {
-            int instance_id = inv.skin_ids[i];
-            int definition_id;
-            SkinRarity rarity;
-            WearCondition wear;
-            int pattern_seed, is_stattrak;
-            int owner_id;
-            time_t acquired_at;
-            int is_tradable;
-            
-            if (db_load_skin_instance(instance_id, &definition_id, &rarity, &wear, &pattern_seed, &is_stattrak, &owner_id, &acquired_at, &is_tradable) == 0)
+            for (int i = 0; i < inv.count; i++)
             {
-                float price = db_calculate_skin_price(definition_id, rarity, wear);
-                net_worth += price;
+                if (records[i].instance_id == 0)
+                    continue;
+                net_worth += db_calculate_skin_price(records[i].definition_id, records[i].rarity, records[i].wear);
             }
         }
     }
@@ -377,6 +371,9 @@ int complete_challenge(int challenge_id, int *winner_id)
         db_rollback_transaction();
         return -3;
     }
+
+    if (*winner_id > 0)
+        leaderboard_index_refresh_user(*winner_id);
     
     return 0;
 }
@@ -483,6 +480,7 @@ int cancel_challenge(int challenge_id, int user_id)
                                 sqlite3_finalize(stmt);
                                 if (db_commit_transaction() == 0)
                                 {
+                                    leaderboard_index_refresh_user(challenge.challenger_id);
                                     return 0; // Success: timeout reached, challenger penalized, challenge cancelled
                                 }
                             }
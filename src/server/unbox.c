@@ -9,22 +9,30 @@
 #include "../include/chat.h"
 #include "../include/request_handler.h"
 #include "../include/trading_challenges.h"
+#include "../include/leaderboard_index.h"
+#include "../include/leaderboard_windows.h"
+#include "../include/top_unboxes.h"
 #include "../include/logger.h"
+#include "../include/pricing_catalog.h"
+#include "../include/rng.h"
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 #include <time.h>
 #include <math.h>
 
-static int rng_initialized = 0;
-
-static void init_rng()
+// Random float wear (0.00-1.00) using CS2 Integer Division method
+// CS2 Research: Generate integer I in [0, 2^31-1], then R = I / (2^31-1)
+// This ensures uniform distribution across all representable float values
+// Float càng thấp = càng hiếm và giá càng cao (do range nhỏ hơn: FN 7% vs BS 55%)
+static float roll_wear(void)
 {
-    if (!rng_initialized)
-    {
-        srand((unsigned int)time(NULL));
-        rng_initialized = 1;
-    }
+    long long max_int = 2147483647LL;                 // 2^31 - 1
+    long long random_int = (long long)(rng_next() >> 33); // 31 random bits
+    float wear = (float)random_int / (float)max_int;
+
+    // Round to 10 decimal places precision
+    return (float)((long long)(wear * 10000000000.0f)) / 10000000000.0f;
 }
 
 int get_available_cases(Case *out_cases, int *count)
@@ -49,8 +57,6 @@ int roll_unbox(Case *case_data)
     if (!case_data || case_data->skin_count <= 0)
         return -1;
 
-    init_rng();
-
     // Tính tổng xác suất
     float total = 0.0f;
     for (int i = 0; i < case_data->skin_count; i++)
@@ -61,10 +67,10 @@ int roll_unbox(Case *case_data)
     if (total <= 0.0f)
     {
         // fallback: random đều
-        return rand() % case_data->skin_count;
+        return (int)rng_below((uint32_t)case_data->skin_count);
     }
 
-    float r = ((float)rand() / (float)RAND_MAX) * total;
+    float r = (float)rng_uniform() * total;
     float accum = 0.0f;
 
     for (int i = 0; i < case_data->skin_count; i++)
@@ -77,237 +83,196 @@ int roll_unbox(Case *case_data)
     return case_data->skin_count - 1;
 }
 
-// Roll rarity based on standard CS2 drop rates
-// Mil-Spec: 79.92%, Restricted: 15.98%, Classified: 3.2%, Covert: 0.64%, Contraband: 0.26%
-static SkinRarity roll_rarity()
+// The random part of one unbox, decided before any write
+typedef struct
 {
-    float r = ((float)rand() / (float)RAND_MAX) * 100.0f;
-
-    if (r < 0.26f)
-        return RARITY_CONTRABAND; // 0.26%
-    else if (r < 0.90f)
-        return RARITY_COVERT; // 0.64%
-    else if (r < 4.10f)
-        return RARITY_CLASSIFIED; // 3.2%
-    else if (r < 20.08f)
-        return RARITY_RESTRICTED; // 15.98%
-    else
-        return RARITY_MIL_SPEC; // 79.92%
+    int definition_id;
+    const CatalogDefinition *def;
+    float wear;
+    int pattern_seed;
+    int is_stattrak;
+} UnboxRoll;
+
+// Catalog entry of a case (-2 unknown case, -5 no catalog)
+static int find_case(int case_id, const PricingCatalog **out_catalog, const CatalogCase **out_case)
+{
+    const PricingCatalog *catalog = pricing_catalog_get();
+    if (!catalog && pricing_catalog_reload() == 0)
+        catalog = pricing_catalog_get();
+    if (!catalog)
+        return -5;
+
+    if (pricing_catalog_case(catalog, case_id, out_case) != 0)
+        return -2; // Case not found
+    *out_catalog = catalog;
+    return 0;
 }
 
-int unbox_case(int user_id, int case_id, Skin *out_skin)
+static int roll_case_skin(const PricingCatalog *catalog, const CatalogCase *case_data, UnboxRoll *out)
 {
-    if (user_id <= 0 || case_id <= 0 || !out_skin)
+    // Steps 1-3: Draw the skin from the case's alias table. Its weights follow the CS2 drop rates
+    // (Mil-Spec: 79.92%, Restricted: 15.98%, Classified: 3.2%, Covert: 0.64%, Contraband: 0.26%),
+    // a rarity missing from the case passes its share to the next more common one, and skins
+    // of the same rarity are equally likely.
+    out->definition_id = pricing_catalog_roll_case(case_data, rng_uniform(), rng_uniform());
+    if (out->definition_id < 0)
     {
-        return -1;
+        return -5; // No skins available in this case
     }
 
-    init_rng();
-
-    // Step 0: Load case data and verify it exists
-    Case case_data;
-    int load_case_result = db_load_case(case_id, &case_data);
-
-    if (load_case_result != 0)
+    // Each skin definition has a FIXED rarity (e.g., AK-47 | Asiimov is always Covert)
+    if (pricing_catalog_definition(catalog, out->definition_id, &out->def) != 0)
     {
-        return -2; // Case not found
+        return -6; // Failed to load skin definition
     }
 
-    // Step 0.1: Load user and check balance
-    User user;
-    int load_user_result = db_load_user(user_id, &user);
+    // Step 4: Random float wear (0.00-1.00)
+    out->wear = roll_wear();
 
-    if (load_user_result != 0)
+    // Step 5: Roll StatTrak™ (10% chance, except for Gold/Contraband items)
+    out->is_stattrak = 0;
+    if (out->def->rarity != RARITY_CONTRABAND)
     {
-        return -3; // User not found
+        if (rng_uniform() < 0.10) // 10% chance
+            out->is_stattrak = 1;
     }
 
-    // Step 0.2: Calculate total cost (case price + key price)
-    float total_cost = case_data.price + CASE_KEY_PRICE;
+    // Step 6: Roll Pattern Seed (0-999, uniform distribution)
+    // Pattern Seed determines texture position/rotation on skin
+    // CS2 uses 1000 patterns (0-999 inclusive)
+    out->pattern_seed = (int)rng_below(1000); // 0-999 inclusive
+    return 0;
+}
 
-    if (user.balance < total_cost)
-    {
-        return ERR_INSUFFICIENT_FUNDS; // Insufficient funds
-    }
+// Inside the caller's transaction: re-read the balance so a concurrent purchase cannot be
+// overwritten, and deduct total_cost
+static int deduct_balance(int user_id, float total_cost, User *user)
+{
+    if (db_load_user(user_id, user) != 0)
+        return -3;
+    if (user->balance < total_cost)
+        return ERR_INSUFFICIENT_FUNDS;
+    user->balance -= total_cost;
+    if (db_update_user(user) != 0)
+        return -4; // Failed to update balance
+    return 0;
+}
 
-    // BEGIN TRANSACTION - All operations must succeed or all rollback
-    if (db_begin_transaction() != 0)
-        return -8; // Failed to begin transaction
+static void fill_unboxed_skin(Skin *out_skin, const UnboxRoll *roll, int instance_id, int user_id, time_t now)
+{
+    SkinRarity rarity = roll->def->rarity;
 
-    // Step 0.3: Deduct balance BEFORE unboxing (within transaction)
-    user.balance -= total_cost;
-    if (db_update_user(&user) != 0)
-    {
-        db_rollback_transaction();
-        return -4; // Failed to update balance
-    }
+    memset(out_skin, 0, sizeof(Skin));
+    out_skin->skin_id = instance_id;
 
-    // CS2 Logic: Roll rarity FIRST, then select skin from that rarity pool
-    // Step 1: Get all available rarities in this case first
-    SkinRarity available_rarities[7];
-    int rarity_count = 0;
+    snprintf(out_skin->name, sizeof(out_skin->name), "%s", roll->def->name);
+    out_skin->rarity = rarity; // Use definition's rarity
+    out_skin->wear = roll->wear;
+    out_skin->pattern_seed = roll->pattern_seed;
+    out_skin->is_stattrak = roll->is_stattrak;
 
-    // Check each rarity to see if it exists in this case
-    for (SkinRarity r = RARITY_CONSUMER; r <= RARITY_CONTRABAND; r++)
-    {
-        int test_ids[100];
-        int test_count = 0;
-        if (db_get_case_skins_by_rarity(case_id, r, test_ids, &test_count) == 0 && test_count > 0)
-        {
-            available_rarities[rarity_count++] = r;
-        }
-    }
+    // Base price is the definition base price * rarity multiplier
+    float rarity_mult = 1.0f;
+    db_get_rarity_multiplier(rarity, &rarity_mult);
+    out_skin->base_price = roll->def->base_price * rarity_mult;
 
-    if (rarity_count == 0)
-    {
-        db_rollback_transaction();
-        return -5; // No skins available in this case
-    }
+    // Calculate price: base_price * rarity_multiplier * wear_multiplier
+    out_skin->current_price = db_calculate_skin_price(roll->definition_id, rarity, roll->wear);
+    out_skin->owner_id = user_id;
+    out_skin->acquired_at = now;
+    out_skin->is_tradable = 1; // Unboxed items are immediately tradable (no trade lock)
+}
 
-    // Step 2: Roll rarity from available rarities only, using CS2 drop rates
-    // Mil-Spec: 79.92%, Restricted: 15.98%, Classified: 3.2%, Covert: 0.64%, Contraband: 0.26%
-    float r = ((float)rand() / (float)RAND_MAX) * 100.0f;
-    SkinRarity rolled_rarity;
+// One LOG_UNBOX entry and ledger row per skin (inside the unbox transaction)
+static int log_unbox(int user_id, int case_id, const CatalogCase *case_data, const UnboxRoll *roll,
+                      const Skin *skin, float cost, time_t now)
+{
+    float profit = skin->current_price > cost ? skin->current_price - cost : 0.0f;
 
-    // Try to roll in order of rarity (Contraband -> Covert -> Classified -> Restricted -> Mil-Spec)
-    // But only if that rarity is available in the case
-    int found = 0;
-    if (r < 0.26f)
-    {
-        // Try Contraband first
-        for (int i = 0; i < rarity_count; i++)
-        {
-            if (available_rarities[i] == RARITY_CONTRABAND)
-            {
-                rolled_rarity = RARITY_CONTRABAND;
-                found = 1;
-                break;
-            }
-        }
-    }
-    if (!found && r < 0.90f)
-    {
-        // Try Covert
-        for (int i = 0; i < rarity_count; i++)
-        {
-            if (available_rarities[i] == RARITY_COVERT)
-            {
-                rolled_rarity = RARITY_COVERT;
-                found = 1;
-                break;
-            }
-        }
-    }
-    if (!found && r < 4.10f)
-    {
-        // Try Classified
-        for (int i = 0; i < rarity_count; i++)
-        {
-            if (available_rarities[i] == RARITY_CLASSIFIED)
-            {
-                rolled_rarity = RARITY_CLASSIFIED;
-                found = 1;
-                break;
-            }
-        }
-    }
-    if (!found && r < 20.08f)
+    TransactionLog log;
+    log.log_id = 0;
+    log.type = LOG_UNBOX;
+    log.user_id = user_id;
+    if (profit > 0.0f)
     {
-        // Try Restricted
-        for (int i = 0; i < rarity_count; i++)
-        {
-            if (available_rarities[i] == RARITY_RESTRICTED)
-            {
-                rolled_rarity = RARITY_RESTRICTED;
-                found = 1;
-                break;
-            }
-        }
+        snprintf(log.details, sizeof(log.details), "Unboxed case %d (%s) -> instance %d (def %d, rarity %d, wear %.10f, pattern %d, stattrak %d, cost $%.2f, value $%.2f, profit +$%.2f)",
+                 case_id, case_data->name, skin->skin_id, roll->definition_id, skin->rarity, skin->wear, skin->pattern_seed, skin->is_stattrak, cost, skin->current_price, profit);
     }
-    if (!found)
+    else
     {
-        // Default to Mil-Spec or highest available rarity
-        for (int i = 0; i < rarity_count; i++)
-        {
-            if (available_rarities[i] == RARITY_MIL_SPEC)
-            {
-                rolled_rarity = RARITY_MIL_SPEC;
-                found = 1;
-                break;
-            }
-        }
-        // If Mil-Spec not available, use the first available (shouldn't happen, but safety)
-        if (!found)
-        {
-            rolled_rarity = available_rarities[0];
-        }
+        snprintf(log.details, sizeof(log.details), "Unboxed case %d (%s) -> instance %d (def %d, rarity %d, wear %.10f, pattern %d, stattrak %d, cost $%.2f, value $%.2f)",
+                 case_id, case_data->name, skin->skin_id, roll->definition_id, skin->rarity, skin->wear, skin->pattern_seed, skin->is_stattrak, cost, skin->current_price);
     }
+    log.timestamp = now;
 
-    // Step 3: Get skins from this case that match the rolled rarity
-    // IMPORTANT: Each skin definition has a FIXED rarity. We filter by rarity to ensure
-    // we only select skins that can actually have that rarity (e.g., AK-47 | Asiimov is always Covert)
-    int definition_ids[100];
-    int skin_count = 0;
-    int db_result = db_get_case_skins_by_rarity(case_id, rolled_rarity, definition_ids, &skin_count);
+    LedgerEntry entry;
+    memset(&entry, 0, sizeof(entry));
+    entry.amount = skin->current_price;
+    entry.cost = cost;
+    entry.instance_id = skin->skin_id;
+    entry.definition_id = roll->definition_id;
+    return db_log_ledger(&log, &entry);
+}
 
-    if (db_result != 0 || skin_count == 0)
+int unbox_case(int user_id, int case_id, Skin *out_skin)
+{
+    if (user_id <= 0 || case_id <= 0 || !out_skin)
     {
-        db_rollback_transaction();
-        return -5; // No skins with this rarity available in this case
+        return -1;
     }
 
-    // Step 3: Randomly select one skin from the filtered rarity pool
-    int definition_id = definition_ids[rand() % skin_count];
+    // Step 0: Look up the case and its roll table
+    const PricingCatalog *catalog;
+    const CatalogCase *case_data;
+    int result = find_case(case_id, &catalog, &case_data);
+    if (result != 0)
+        return result;
 
-    // Step 3.1: Verify the definition's rarity matches (should always match, but double-check)
-    char def_name[MAX_ITEM_NAME_LEN];
-    float def_base_price;
-    SkinRarity def_rarity;
+    // Step 0.1: Load user and check balance
+    User user;
+    int load_user_result = db_load_user(user_id, &user);
 
-    if (db_load_skin_definition_with_rarity(definition_id, def_name, &def_base_price, &def_rarity) != 0)
+    if (load_user_result != 0)
     {
-        db_rollback_transaction();
-        return -6; // Failed to load skin definition
+        return -3; // User not found
     }
 
-    // Use the definition's rarity (should match rolled_rarity, but use definition's to be safe)
-    SkinRarity final_rarity = def_rarity;
+    // Step 0.2: Calculate total cost (case price + key price)
+    float total_cost = case_data->price + CASE_KEY_PRICE;
 
-    // Step 4: Random float wear (0.00-1.00) using CS2 Integer Division method
-    // CS2 Research: Generate integer I in [0, 2^31-1], then R = I / (2^31-1)
-    // This ensures uniform distribution across all representable float values
-    // Float càng thấp = càng hiếm và giá càng cao (do range nhỏ hơn: FN 7% vs BS 55%)
-    long long max_int = 2147483647LL; // 2^31 - 1
-    long long random_int = ((long long)rand() << 16) | ((long long)rand() & 0xFFFF);
-    random_int = random_int % (max_int + 1);
-    float wear = (float)random_int / (float)max_int;
+    if (user.balance < total_cost)
+    {
+        return ERR_INSUFFICIENT_FUNDS; // Insufficient funds
+    }
 
-    // Round to 10 decimal places precision
-    wear = (float)((long long)(wear * 10000000000.0f)) / 10000000000.0f;
+    // Steps 1-6: Roll skin, wear, StatTrak and pattern
+    UnboxRoll roll;
+    result = roll_case_skin(catalog, case_data, &roll);
+    if (result != 0)
+        return result;
+    SkinRarity final_rarity = roll.def->rarity;
 
-    // Step 5: Roll StatTrak™ (10% chance, except for Gold/Contraband items)
-    int is_stattrak = 0;
-    if (final_rarity != RARITY_CONTRABAND)
+    // BEGIN TRANSACTION - only the balance deduction and the new item are written under the lock
+    if (db_begin_transaction() != 0)
+        return -8; // Failed to begin transaction
+
+    // Step 7: Deduct balance
+    result = deduct_balance(user_id, total_cost, &user);
+    if (result != 0)
     {
-        float stattrak_roll = ((float)rand() / (float)RAND_MAX);
-        if (stattrak_roll <= 0.10f) // 10% chance
-            is_stattrak = 1;
+        db_rollback_transaction();
+        return result;
     }
 
-    // Step 6: Roll Pattern Seed (0-999, uniform distribution)
-    // Pattern Seed determines texture position/rotation on skin
-    // CS2 uses 1000 patterns (0-999 inclusive)
-    int pattern_seed = rand() % 1000; // 0-999 inclusive
-
-    // Step 7: Create instance with definition's rarity (not rolled rarity), wear, pattern_seed, and is_stattrak
+    // Step 8: Create instance with definition's rarity, wear, pattern_seed, and is_stattrak
     int instance_id = 0;
-    if (db_create_skin_instance(definition_id, final_rarity, wear, pattern_seed, is_stattrak, user_id, &instance_id) != 0)
+    if (db_create_skin_instance(roll.definition_id, final_rarity, roll.wear, roll.pattern_seed, roll.is_stattrak, user_id, &instance_id) != 0)
     {
         db_rollback_transaction();
         return -6; // Failed to create skin instance
     }
 
-    // Step 8: Add to inventory
+    // Step 8.1: Add to inventory
     if (db_add_to_inventory(user_id, instance_id) != 0)
     {
         db_rollback_transaction();
@@ -317,6 +282,18 @@ int unbox_case(int user_id, int case_id, Skin *out_skin)
     // Note: Unboxed items are NOT trade locked - only items purchased from market
     // or received from trade offers are trade locked (7 days)
 
+    // Step 9: Fill out_skin and price it using definition's rarity
+    time_t now = time(NULL);
+    fill_unboxed_skin(out_skin, &roll, instance_id, user_id, now);
+    float current_price = out_skin->current_price;
+
+    // Step 9.1: Log unbox transaction; the ledger row commits with the new item
+    if (log_unbox(user_id, case_id, case_data, &roll, out_skin, total_cost, now) != 0)
+    {
+        db_rollback_transaction();
+        return -9;
+    }
+
     // COMMIT TRANSACTION - All critical operations succeeded
     if (db_commit_transaction() != 0)
     {
@@ -324,31 +301,6 @@ int unbox_case(int user_id, int case_id, Skin *out_skin)
         return -9; // Failed to commit transaction
     }
 
-    // Step 9: Calculate price using definition's rarity
-    // Calculate price: base_price * rarity_multiplier * wear_multiplier
-    float current_price = db_calculate_skin_price(definition_id, final_rarity, wear);
-
-    // Fill out_skin
-    memset(out_skin, 0, sizeof(Skin));
-    out_skin->skin_id = instance_id;
-
-    strncpy(out_skin->name, def_name, MAX_ITEM_NAME_LEN);
-    out_skin->name[MAX_ITEM_NAME_LEN - 1] = '\0'; // Ensure null terminator
-    out_skin->rarity = final_rarity;              // Use definition's rarity, not rolled rarity
-    out_skin->wear = wear;
-    out_skin->pattern_seed = pattern_seed;
-    out_skin->is_stattrak = is_stattrak;
-
-    // Base price is the definition base price * rarity multiplier
-    float rarity_mult = 1.0f;
-    db_get_rarity_multiplier(final_rarity, &rarity_mult);
-    out_skin->base_price = def_base_price * rarity_mult;
-
-    out_skin->current_price = current_price;
-    out_skin->owner_id = user_id;
-    out_skin->acquired_at = time(NULL);
-    out_skin->is_tradable = 1; // Unboxed items are immediately tradable (no trade lock)
-
     // Step 10: Calculate profit if skin value > unbox cost
     float profit = 0.0f;
     if (current_price > total_cost)
@@ -364,23 +316,9 @@ int unbox_case(int user_id, int case_id, Skin *out_skin)
                   user_id, case_id, total_cost, current_price, loss);
     }
 
-    // Step 11: Log unbox transaction (include profit if any)
-    TransactionLog log;
-    log.log_id = 0;
-    log.type = LOG_UNBOX;
-    log.user_id = user_id;
-    if (profit > 0.0f)
-    {
-        snprintf(log.details, sizeof(log.details), "Unboxed case %d (%s) -> instance %d (def %d, rarity %d, wear %.10f, pattern %d, stattrak %d, cost $%.2f, value $%.2f, profit +$%.2f)",
-                 case_id, case_data.name, instance_id, definition_id, final_rarity, wear, pattern_seed, is_stattrak, total_cost, current_price, profit);
-    }
-    else
-    {
-        snprintf(log.details, sizeof(log.details), "Unboxed case %d (%s) -> instance %d (def %d, rarity %d, wear %.10f, pattern %d, stattrak %d, cost $%.2f, value $%.2f)",
-                 case_id, case_data.name, instance_id, definition_id, final_rarity, wear, pattern_seed, is_stattrak, total_cost, current_price);
-    }
-    log.timestamp = time(NULL);
-    db_log_transaction(&log);
+    // Step 11: Leaderboards
+    leaderboard_windows_record_unbox(user_id, roll.definition_id, current_price, now);
+    top_unboxes_record(user_id, out_skin->skin_id, roll.definition_id, current_price, now);
 
     // Step 12: Update quests and achievements
     // Lucky Gambler quest: Unbox 5 cases
@@ -411,6 +349,136 @@ int unbox_case(int user_id, int case_id, Skin *out_skin)
         broadcast_rare_unbox(user_id, out_skin);
     }
 
+    leaderboard_index_refresh_user(user_id);
+
+    return 0;
+}
+
+int unbox_case_batch(int user_id, int case_id, int count, Skin *out_skins, UnboxBatchResult *out_result)
+{
+    if (user_id <= 0 || case_id <= 0 || count <= 0 || count > MAX_UNBOX_BATCH || !out_skins || !out_result)
+    {
+        return -1;
+    }
+
+    const PricingCatalog *catalog;
+    const CatalogCase *case_data;
+    int result = find_case(case_id, &catalog, &case_data);
+    if (result != 0)
+        return result;
+
+    // One balance check for the whole batch
+    User user;
+    if (db_load_user(user_id, &user) != 0)
+    {
+        return -3; // User not found
+    }
+
+    float cost_each = case_data->price + CASE_KEY_PRICE;
+    float total_cost = cost_each * count;
+    if (user.balance < total_cost)
+    {
+        return ERR_INSUFFICIENT_FUNDS;
+    }
+
+    // Every roll happens before the transaction
+    UnboxRoll rolls[MAX_UNBOX_BATCH];
+    SkinInstanceRecord items[MAX_UNBOX_BATCH];
+    memset(items, 0, sizeof(SkinInstanceRecord) * count);
+    for (int i = 0; i < count; i++)
+    {
+        result = roll_case_skin(catalog, case_data, &rolls[i]);
+        if (result != 0)
+            return result;
+        items[i].definition_id = rolls[i].definition_id;
+        items[i].rarity = rolls[i].def->rarity;
+        items[i].wear = rolls[i].wear;
+        items[i].pattern_seed = rolls[i].pattern_seed;
+        items[i].is_stattrak = rolls[i].is_stattrak;
+    }
+
+    // One transaction: balance update, all instances and inventory rows, and their log entries
+    if (db_begin_transaction() != 0)
+        return -8;
+
+    result = deduct_balance(user_id, total_cost, &user);
+    if (result != 0)
+    {
+        db_rollback_transaction();
+        return result;
+    }
+
+    int instance_ids[MAX_UNBOX_BATCH];
+    if (db_create_owned_instances(user_id, items, count, instance_ids) != 0)
+    {
+        db_rollback_transaction();
+        return -6;
+    }
+
+    time_t now = time(NULL);
+    memset(out_result, 0, sizeof(UnboxBatchResult));
+    for (int i = 0; i < count; i++)
+    {
+        fill_unboxed_skin(&out_skins[i], &rolls[i], instance_ids[i], user_id, now);
+        if (log_unbox(user_id, case_id, case_data, &rolls[i], &out_skins[i], cost_each, now) != 0)
+        {
+            db_rollback_transaction();
+            return -9;
+        }
+
+        out_result->total_value += out_skins[i].current_price;
+        if (out_skins[i].current_price > out_skins[out_result->best_index].current_price)
+            out_result->best_index = i;
+    }
+
+    if (db_commit_transaction() != 0)
+    {
+        db_rollback_transaction();
+        return -9;
+    }
+
+    out_result->case_id = case_id;
+    out_result->count = count;
+    out_result->total_cost = total_cost;
+    out_result->new_balance = user.balance;
+
+    LOG_INFO("[UNBOX] User %d unboxed %dx case_id=%d: cost=$%.2f, value=$%.2f",
+             user_id, count, case_id, total_cost, out_result->total_value);
+
+    // Quests, achievements and challenges once for the batch, with the same totals as
+    // count single unboxes
+    int profit_total = 0;
+    int got_contraband = 0;
+    for (int i = 0; i < count; i++)
+    {
+        if (out_skins[i].current_price > cost_each)
+            profit_total += (int)(out_skins[i].current_price - cost_each);
+        if (out_skins[i].rarity == RARITY_CONTRABAND)
+            got_contraband = 1;
+        leaderboard_windows_record_unbox(user_id, rolls[i].definition_id, out_skins[i].current_price, now);
+        top_unboxes_record(user_id, out_skins[i].skin_id, rolls[i].definition_id, out_skins[i].current_price, now);
+    }
+
+    update_quest_progress(user_id, QUEST_LUCKY_GAMBLER, count);
+    if (profit_total > 0)
+    {
+        update_quest_progress(user_id, QUEST_PROFIT_MAKER, profit_total);
+    }
+    if (got_contraband)
+    {
+        unlock_achievement(user_id, ACHIEVEMENT_FIRST_KNIFE);
+    }
+    check_quest_completion(user_id);
+    update_user_active_challenges(user_id);
+
+    for (int i = 0; i < count; i++)
+    {
+        if (out_skins[i].rarity == RARITY_CONTRABAND || out_skins[i].rarity == RARITY_COVERT)
+            broadcast_rare_unbox(user_id, &out_skins[i]);
+    }
+
+    leaderboard_index_refresh_user(user_id);
+
     return 0;
 }
 
@@ -496,15 +564,13 @@ int generate_unbox_preview(int case_id, Skin *out_preview_skins, int preview_cou
         return -3; // Invalid weights
     }
 
-    init_rng();
-
     // Step 3: GENERATE PREVIEW (All operations on RAM - very fast)
     int valid_count = 0;
     for (int i = 0; i < preview_count && i < 50; i++)
     {
         // --- WEIGHTED RANDOM SELECTION (not uniform) ---
         // This ensures preview reflects actual drop rates (more blue, less red)
-        int r_val = rand() % total_weight;
+        int r_val = (int)rng_below((uint32_t)total_weight);
         int current_weight = 0;
         int selected_idx = 0;
 
@@ -529,22 +595,18 @@ int generate_unbox_preview(int case_id, Skin *out_preview_skins, int preview_cou
 
         // --- GENERATE RANDOM ATTRIBUTES ---
         // Random wear using CS2 Integer Division method
-        long long max_int = 2147483647LL; // 2^31 - 1
-        long long random_int = ((long long)rand() << 16) | ((long long)rand() & 0xFFFF);
-        random_int = random_int % (max_int + 1);
-        float preview_wear = (float)random_int / (float)max_int;
-        preview_wear = (float)((long long)(preview_wear * 10000000000.0f)) / 10000000000.0f;
+        float preview_wear = roll_wear();
 
         // Random StatTrak (10% chance, except Contraband)
         int preview_stattrak = 0;
         if (def->rarity != RARITY_CONTRABAND)
         {
-            if (((float)rand() / (float)RAND_MAX) <= 0.10f)
+            if (rng_uniform() < 0.10)
                 preview_stattrak = 1;
         }
 
         // Random Pattern Seed (0-999) - CS2 uses 1000 patterns (0-999 inclusive)
-        int pattern_seed = rand() % 1000;
+        int pattern_seed = (int)rng_below(1000);
 
         // --- FILL PREVIEW SKIN ---
         memset(&out_preview_skins[valid_count], 0, sizeof(Skin));
@@ -0,0 +1,220 @@
+// bench_db_statements.c - Hot database lookups with and without the prepared statement cache
+//
+// Build (from the repository root):
+//   gcc -O2 -pthread -Isrc -o bench_db_statements tools/bench_db_statements.c
+//       src/server/database_sqlite.c src/server/pricing_catalog.c -lsqlite3
+// Usage: bench_db_statements [calls_per_run] [rows]
+//
+// Creates a scratch database under /tmp, seeds it with rows users and skin instances,
+// then times db_load_user() and db_load_skin_instance() on a pooled connection against
+// copies of their previous bodies, which prepared and finalized the statement on every call.
+
+#include "../include/database.h"
+#include "../include/database_internal.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <time.h>
+
+static long g_calls = 200000;
+static int g_rows = 1000;
+
+// ==================== Uncached lookups (previous implementation) ====================
+
+static int legacy_load_user(int user_id, User *out_user)
+{
+    sqlite3 *db = db_get_connection();
+    const char *sql = "SELECT * FROM users WHERE user_id = ?";
+    sqlite3_stmt *stmt;
+    if (sqlite3_prepare_v2(db, sql, -1, &stmt, 0) != SQLITE_OK)
+        return -1;
+
+    sqlite3_bind_int(stmt, 1, user_id);
+
+    int result = -1;
+    if (sqlite3_step(stmt) == SQLITE_ROW)
+    {
+        out_user->user_id = sqlite3_column_int(stmt, 0);
+        strncpy(out_user->username, (char *)sqlite3_column_text(stmt, 1), MAX_USERNAME_LEN - 1);
+        strncpy(out_user->password_hash, (char *)sqlite3_column_text(stmt, 2), MAX_PASSWORD_HASH_LEN - 1);
+        out_user->balance = sqlite3_column_double(stmt, 3);
+        out_user->created_at = sqlite3_column_int64(stmt, 4);
+        out_user->last_login = sqlite3_column_int64(stmt, 5);
+        out_user->is_banned = sqlite3_column_int(stmt, 6);
+        result = 0;
+    }
+    sqlite3_finalize(stmt);
+    return result;
+}
+
+static int legacy_load_skin_instance(int instance_id, int *definition_id, SkinRarity *rarity, WearCondition *wear,
+                                     int *pattern_seed, int *is_stattrak, int *owner_id, time_t *acquired_at,
+                                     int *is_tradable)
+{
+    sqlite3 *db = db_get_connection();
+    const char *sql = "SELECT definition_id, rarity, wear, pattern_seed, is_stattrak, owner_id, acquired_at, is_tradable FROM skin_instances WHERE instance_id = ?";
+    sqlite3_stmt *stmt;
+    if (sqlite3_prepare_v2(db, sql, -1, &stmt, 0) != SQLITE_OK)
+        return -1;
+
+    sqlite3_bind_int(stmt, 1, instance_id);
+
+    int result = -1;
+    if (sqlite3_step(stmt) == SQLITE_ROW)
+    {
+        *definition_id = sqlite3_column_int(stmt, 0);
+        *rarity = (SkinRarity)sqlite3_column_int(stmt, 1);
+        *wear = (WearCondition)sqlite3_column_double(stmt, 2);
+        *pattern_seed = sqlite3_column_int(stmt, 3);
+        *is_stattrak = sqlite3_column_int(stmt, 4);
+        *owner_id = sqlite3_column_int(stmt, 5);
+        *acquired_at = sqlite3_column_int64(stmt, 6);
+        *is_tradable = sqlite3_column_int(stmt, 7);
+        result = 0;
+    }
+    sqlite3_finalize(stmt);
+    return result;
+}
+
+// ==================== Driver ====================
+
+static double now_seconds(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static int seed(int *first_instance_id)
+{
+    if (db_begin_transaction() != 0)
+        return -1;
+
+    for (int i = 0; i < g_rows; i++)
+    {
+        User user;
+        memset(&user, 0, sizeof(user));
+        snprintf(user.username, sizeof(user.username), "bench%d", i);
+        snprintf(user.password_hash, sizeof(user.password_hash), "hash%d", i);
+        user.balance = 100.0f;
+        user.created_at = time(NULL);
+
+        int instance_id = 0;
+        if (db_save_user(&user) != 0 ||
+            db_create_skin_instance(1, RARITY_MIL_SPEC, 0.1f, i % 1000, 0, i + 1, &instance_id) != 0)
+        {
+            db_rollback_transaction();
+            return -1;
+        }
+        if (i == 0)
+            *first_instance_id = instance_id;
+    }
+    return db_commit_transaction();
+}
+
+static double run_users(int cached)
+{
+    User user;
+    int found = 0;
+    double start = now_seconds();
+    for (long i = 0; i < g_calls; i++)
+    {
+        int user_id = 1 + (int)(i % g_rows);
+        if ((cached ? db_load_user(user_id, &user) : legacy_load_user(user_id, &user)) == 0)
+            found++;
+    }
+    double elapsed = now_seconds() - start;
+    if (found != g_calls)
+        fprintf(stderr, "Only %d of %ld users found\n", found, g_calls);
+    return g_calls / elapsed;
+}
+
+static double run_instances(int cached, int first_instance_id)
+{
+    int definition_id, pattern_seed, is_stattrak, owner_id, is_tradable;
+    SkinRarity rarity;
+    WearCondition wear;
+    time_t acquired_at;
+    int found = 0;
+    double start = now_seconds();
+    for (long i = 0; i < g_calls; i++)
+    {
+        int instance_id = first_instance_id + (int)(i % g_rows);
+        int rc = cached ? db_load_skin_instance(instance_id, &definition_id, &rarity, &wear, &pattern_seed,
+                                                &is_stattrak, &owner_id, &acquired_at, &is_tradable)
+                        : legacy_load_skin_instance(instance_id, &definition_id, &rarity, &wear, &pattern_seed,
+                                                    &is_stattrak, &owner_id, &acquired_at, &is_tradable);
+        if (rc == 0)
+            found++;
+    }
+    double elapsed = now_seconds() - start;
+    if (found != g_calls)
+        fprintf(stderr, "Only %d of %ld skin instances found\n", found, g_calls);
+    return g_calls / elapsed;
+}
+
+// Runs on its own thread so it gets a pooled connection like a server worker
+static void *bench_thread(void *arg)
+{
+    int first_instance_id = *(int *)arg;
+
+    if (db_thread_attach(1) != 0)
+    {
+        fprintf(stderr, "Could not check out a pooled connection\n");
+        return NULL;
+    }
+
+    printf("%-22s %14s %14s %8s\n", "lookup", "uncached c/s", "cached c/s", "speedup");
+
+    double legacy = run_users(0);
+    double cached = run_users(1);
+    printf("%-22s %14.0f %14.0f %7.2fx\n", "db_load_user", legacy, cached, cached / legacy);
+
+    legacy = run_instances(0, first_instance_id);
+    cached = run_instances(1, first_instance_id);
+    printf("%-22s %14.0f %14.0f %7.2fx\n", "db_load_skin_instance", legacy, cached, cached / legacy);
+
+    db_thread_detach();
+    return NULL;
+}
+
+int main(int argc, char *argv[])
+{
+    g_calls = argc > 1 ? atol(argv[1]) : 200000;
+    g_rows = argc > 2 ? atoi(argv[2]) : 1000;
+    if (g_calls <= 0 || g_rows <= 0)
+    {
+        fprintf(stderr, "Usage: %s [calls_per_run] [rows]\n", argv[0]);
+        return 1;
+    }
+
+    // db_init() opens data/database.db relative to the working directory
+    char dir[] = "/tmp/cs2_bench_XXXXXX";
+    if (!mkdtemp(dir) || chdir(dir) != 0)
+    {
+        perror("scratch directory");
+        return 1;
+    }
+
+    int first_instance_id = 0;
+    if (db_init() != 0 || seed(&first_instance_id) != 0)
+    {
+        fprintf(stderr, "Could not set up the scratch database in %s\n", dir);
+        return 1;
+    }
+
+    printf("=== CS2 Skin Trading - Statement Cache Benchmark ===\n");
+    printf("calls=%ld rows=%d\n\n", g_calls, g_rows);
+
+    pthread_t thread;
+    if (pthread_create(&thread, NULL, bench_thread, &first_instance_id) == 0)
+        pthread_join(thread, NULL);
+
+    db_close();
+
+    char command[64];
+    snprintf(command, sizeof(command), "rm -rf %s", dir);
+    return system(command) == 0 ? 0 : 1;
+}
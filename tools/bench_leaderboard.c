@@ -0,0 +1,257 @@
+// bench_leaderboard.c - Top traders by net worth: per-user scan vs the in-memory ranking
+//
+// Build (from the repository root):
+//   gcc -O2 -pthread -Isrc -o bench_leaderboard tools/bench_leaderboard.c src/server/database_sqlite.c
+//       src/server/pricing_catalog.c src/server/leaderboard_index.c src/server/rng.c src/server/logger.c -lsqlite3
+// Usage: bench_leaderboard [users] [items_per_user]
+//
+// Creates a scratch database under /tmp with the given number of users, each holding a few
+// skins. Compares the previous get_top_traders() approach (net worth of every user, then a
+// sort) with leaderboard_index_range(), leaderboard_index_rank() and leaderboard_index_around(),
+// checks that both give the same order, then changes some balances and checks the ranking follows.
+
+#include "../include/database.h"
+#include "../include/database_internal.h"
+#include "../include/leaderboard_index.h"
+#include "../include/rng.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <time.h>
+
+static int g_users = 5000;
+static int g_items = 5;
+
+// ==================== Scan (previous implementation) ====================
+
+static float legacy_net_worth(int user_id)
+{
+    User user;
+    if (db_load_user(user_id, &user) != 0)
+        return 0.0f;
+
+    float net_worth = user.balance;
+    Inventory inv;
+    if (db_load_inventory(user_id, &inv) == 0 && inv.count > 0)
+    {
+        SkinInstanceRecord records[MAX_INVENTORY_SIZE];
+        if (db_load_skin_instances(inv.skin_ids, inv.count, records, NULL) == 0)
+        {
+            for (int i = 0; i < inv.count; i++)
+            {
+                if (records[i].instance_id != 0)
+                    net_worth += db_calculate_skin_price(records[i].definition_id, records[i].rarity, records[i].wear);
+            }
+        }
+    }
+    return net_worth;
+}
+
+static int by_worth_desc(const void *a, const void *b)
+{
+    const LeaderboardEntry *x = a, *y = b;
+    if (x->value != y->value)
+        return x->value < y->value ? 1 : -1;
+    return x->user_id - y->user_id;
+}
+
+// Net worth of every user, sorted like the index
+static int legacy_ranking(LeaderboardEntry *entries)
+{
+    sqlite3_stmt *stmt;
+    if (db_prepare("SELECT user_id FROM users ORDER BY user_id", &stmt) != SQLITE_OK)
+        return 0;
+    int n = 0;
+    while (sqlite3_step(stmt) == SQLITE_ROW && n < g_users + 16)
+    {
+        entries[n].user_id = sqlite3_column_int(stmt, 0);
+        entries[n].value = legacy_net_worth(entries[n].user_id);
+        n++;
+    }
+    db_finalize(stmt);
+    qsort(entries, n, sizeof(LeaderboardEntry), by_worth_desc);
+    return n;
+}
+
+// ==================== Driver ====================
+
+static double now_seconds(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static int populate(void)
+{
+    sqlite3 *db = db_get_connection();
+    if (sqlite3_exec(db, "BEGIN", 0, 0, 0) != SQLITE_OK)
+        return -1;
+
+    sqlite3_stmt *stmt;
+    if (db_prepare("INSERT INTO users (username, password_hash, balance, created_at) VALUES (?, 'x', ?, 0)", &stmt) != SQLITE_OK)
+        return -1;
+    for (int i = 0; i < g_users; i++)
+    {
+        char name[32];
+        snprintf(name, sizeof(name), "bench_%d", i);
+        sqlite3_bind_text(stmt, 1, name, -1, SQLITE_TRANSIENT);
+        sqlite3_bind_double(stmt, 2, (double)rng_below(100000) / 100.0);
+        sqlite3_step(stmt);
+        sqlite3_reset(stmt);
+    }
+    db_finalize(stmt);
+
+    SkinInstanceRecord items[64];
+    int ids[64];
+    int count = g_items < 64 ? g_items : 64;
+    for (int user_id = 1; user_id <= g_users; user_id++)
+    {
+        memset(items, 0, sizeof(items));
+        for (int i = 0; i < count; i++)
+        {
+            items[i].definition_id = 1 + (int)rng_below(60);
+            items[i].rarity = RARITY_MIL_SPEC + (int)rng_below(4);
+            items[i].wear = (float)rng_uniform();
+        }
+        if (db_create_owned_instances(user_id, items, count, ids) != 0)
+            break;
+    }
+    return sqlite3_exec(db, "COMMIT", 0, 0, 0) == SQLITE_OK ? 0 : -1;
+}
+
+static int same_order(const LeaderboardEntry *a, const LeaderboardEntry *b, int n)
+{
+    for (int i = 0; i < n; i++)
+    {
+        if (a[i].user_id != b[i].user_id)
+        {
+            fprintf(stderr, "rank %d: scan has user %d ($%.2f), index has user %d ($%.2f)\n",
+                    i + 1, a[i].user_id, a[i].value, b[i].user_id, b[i].value);
+            return 0;
+        }
+    }
+    return 1;
+}
+
+static void *bench_thread(void *arg)
+{
+    (void)arg;
+    if (db_thread_attach(0) != 0)
+    {
+        fprintf(stderr, "Could not check out a pooled connection\n");
+        return NULL;
+    }
+
+    int total = leaderboard_index_size();
+    LeaderboardEntry *scan = calloc(total + 16, sizeof(LeaderboardEntry));
+    LeaderboardEntry *index = calloc(total + 16, sizeof(LeaderboardEntry));
+
+    double start = now_seconds();
+    int scanned = legacy_ranking(scan);
+    double scan_seconds = now_seconds() - start;
+
+    int count = 0;
+    start = now_seconds();
+    const int reps = 10000;
+    for (int r = 0; r < reps; r++)
+        leaderboard_index_range(1, 10, index, &count);
+    double top_seconds = (now_seconds() - start) / reps;
+
+    int rank = 0;
+    start = now_seconds();
+    for (int r = 0; r < reps; r++)
+        leaderboard_index_rank(1 + r % total, &rank, NULL);
+    double rank_seconds = (now_seconds() - start) / reps;
+
+    LeaderboardEntry window[2 * 5 + 1];
+    int first = 0, around_ok = 1;
+    start = now_seconds();
+    for (int r = 0; r < reps; r++)
+    {
+        int n = 0, user_id = 1 + r % total;
+        if (leaderboard_index_around(user_id, 5, window, &n, &first, &rank) != 0 ||
+            window[rank - first].user_id != user_id)
+            around_ok = 0;
+    }
+    double around_seconds = (now_seconds() - start) / reps;
+
+    leaderboard_index_range(1, total, index, &count);
+
+    printf("%-28s %14s\n", "query", "time");
+    printf("%-28s %11.2f ms\n", "scan + sort (all users)", scan_seconds * 1e3);
+    printf("%-28s %11.2f us\n", "index top 10", top_seconds * 1e6);
+    printf("%-28s %11.2f us\n", "index rank of one user", rank_seconds * 1e6);
+    printf("%-28s %11.2f us\n", "index user +-5 around", around_seconds * 1e6);
+    printf("\nfull order matches scan: %s (%d users)\n",
+           scanned == count && same_order(scan, index, count) ? "yes" : "NO", count);
+    printf("around window holds the user: %s\n", around_ok ? "yes" : "NO");
+
+    free(scan);
+    free(index);
+    db_thread_detach();
+    return NULL;
+}
+
+int main(int argc, char *argv[])
+{
+    g_users = argc > 1 ? atoi(argv[1]) : 5000;
+    g_items = argc > 2 ? atoi(argv[2]) : 5;
+    if (g_users <= 0 || g_items < 0)
+    {
+        fprintf(stderr, "Usage: %s [users] [items_per_user]\n", argv[0]);
+        return 1;
+    }
+
+    // db_init() opens data/database.db relative to the working directory
+    char dir[] = "/tmp/cs2_bench_XXXXXX";
+    if (!mkdtemp(dir) || chdir(dir) != 0)
+    {
+        perror("scratch directory");
+        return 1;
+    }
+
+    rng_seed(1);
+    if (db_init() != 0 || populate() != 0 || leaderboard_index_init() != 0)
+    {
+        fprintf(stderr, "Could not set up the scratch database in %s\n", dir);
+        return 1;
+    }
+
+    printf("=== CS2 Skin Trading - Leaderboard Benchmark ===\n");
+    printf("users=%d items_per_user=%d\n\n", g_users, g_items);
+
+    pthread_t thread;
+    if (pthread_create(&thread, NULL, bench_thread, NULL) == 0)
+        pthread_join(thread, NULL);
+
+    // Move a few users and check the ranking follows
+    sqlite3 *db = db_get_connection();
+    int ok = 1;
+    for (int i = 0; i < 100 && ok; i++)
+    {
+        int user_id = 1 + (int)rng_below((uint32_t)g_users);
+        char sql[128];
+        snprintf(sql, sizeof(sql), "UPDATE users SET balance = %.2f WHERE user_id = %d", rng_uniform() * 20000.0, user_id);
+        sqlite3_exec(db, sql, 0, 0, 0);
+        leaderboard_index_refresh_user(user_id);
+
+        int rank;
+        float worth;
+        LeaderboardEntry entry;
+        int n;
+        ok = leaderboard_index_rank(user_id, &rank, &worth) == 0 &&
+             leaderboard_index_range(rank, 1, &entry, &n) == 0 && n == 1 && entry.user_id == user_id &&
+             worth == legacy_net_worth(user_id);
+    }
+    printf("ranking follows balance changes: %s\n", ok ? "yes" : "NO");
+
+    leaderboard_index_cleanup();
+    db_close();
+
+    char command[64];
+    snprintf(command, sizeof(command), "rm -rf %s", dir);
+    return system(command) == 0 && ok ? 0 : 1;
+}
@@ -0,0 +1,188 @@
+// bench_pricing_catalog.c - db_calculate_skin_price() from the in-memory catalog vs SQL
+//
+// Build (from the repository root):
+//   gcc -O2 -pthread -Isrc -o bench_pricing_catalog tools/bench_pricing_catalog.c
+//       src/server/database_sqlite.c src/server/pricing_catalog.c -lsqlite3
+// Usage: bench_pricing_catalog [calls_per_run]
+//
+// Creates a scratch database under /tmp and prices every skin definition at a spread of
+// wear values, once through a copy of the previous three-query implementation and once
+// through db_calculate_skin_price(), and checks that both agree.
+
+#include "../include/database.h"
+#include "../include/database_internal.h"
+#include "../include/pricing_catalog.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <time.h>
+
+static long g_calls = 200000;
+
+// ==================== SQL pricing (previous implementation) ====================
+
+static int legacy_load_skin_definition(int definition_id, float *base_price)
+{
+    sqlite3_stmt *stmt;
+    if (db_prepare("SELECT name, base_price FROM skin_definitions WHERE definition_id = ?", &stmt) != SQLITE_OK)
+        return -1;
+    sqlite3_bind_int(stmt, 1, definition_id);
+
+    int result = -1;
+    if (sqlite3_step(stmt) == SQLITE_ROW)
+    {
+        *base_price = (float)sqlite3_column_double(stmt, 1);
+        result = 0;
+    }
+    db_finalize(stmt);
+    return result;
+}
+
+static int legacy_rarity_multiplier(SkinRarity rarity, float *multiplier)
+{
+    sqlite3_stmt *stmt;
+    if (db_prepare("SELECT multiplier FROM rarity_multipliers WHERE rarity = ?", &stmt) != SQLITE_OK)
+        return -1;
+    sqlite3_bind_int(stmt, 1, rarity);
+
+    int result = -1;
+    if (sqlite3_step(stmt) == SQLITE_ROW)
+    {
+        *multiplier = (float)sqlite3_column_double(stmt, 0);
+        result = 0;
+    }
+    db_finalize(stmt);
+    return result;
+}
+
+static int legacy_wear_multiplier(WearCondition wear, float *multiplier)
+{
+    if (wear < 0.0f || wear > 1.0f)
+        return -1;
+
+    sqlite3_stmt *stmt;
+    if (db_prepare("SELECT multiplier FROM wear_multipliers WHERE ? >= wear_min AND (? <= wear_max OR (wear_max = 1.0 AND ? = 1.0)) LIMIT 1", &stmt) != SQLITE_OK)
+        return -1;
+    sqlite3_bind_double(stmt, 1, wear);
+    sqlite3_bind_double(stmt, 2, wear);
+    sqlite3_bind_double(stmt, 3, wear);
+
+    int result = -1;
+    if (sqlite3_step(stmt) == SQLITE_ROW)
+    {
+        *multiplier = (float)sqlite3_column_double(stmt, 0);
+        result = 0;
+    }
+    db_finalize(stmt);
+    return result;
+}
+
+static float legacy_price(int definition_id, SkinRarity rarity, WearCondition wear)
+{
+    float base_price, rarity_mult, wear_mult;
+    if (legacy_load_skin_definition(definition_id, &base_price) != 0 ||
+        legacy_rarity_multiplier(rarity, &rarity_mult) != 0 ||
+        legacy_wear_multiplier(wear, &wear_mult) != 0)
+        return 0.0f;
+    return base_price * rarity_mult * wear_mult;
+}
+
+// ==================== Driver ====================
+
+static double now_seconds(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static int g_definitions;
+
+static void call_args(long i, int *definition_id, SkinRarity *rarity, WearCondition *wear)
+{
+    *definition_id = 1 + (int)(i % g_definitions);
+    *rarity = (SkinRarity)(RARITY_MIL_SPEC + i % 4);
+    *wear = (float)((i * 7919) % 1001) / 1000.0f;
+}
+
+static double run(int catalog, double *checksum)
+{
+    double sum = 0.0;
+    double start = now_seconds();
+    for (long i = 0; i < g_calls; i++)
+    {
+        int definition_id;
+        SkinRarity rarity;
+        WearCondition wear;
+        call_args(i, &definition_id, &rarity, &wear);
+        sum += catalog ? db_calculate_skin_price(definition_id, rarity, wear) : legacy_price(definition_id, rarity, wear);
+    }
+    double elapsed = now_seconds() - start;
+    *checksum = sum;
+    return g_calls / elapsed;
+}
+
+// Runs on its own thread so it gets a pooled connection like a server worker
+static void *bench_thread(void *arg)
+{
+    (void)arg;
+    if (db_thread_attach(1) != 0)
+    {
+        fprintf(stderr, "Could not check out a pooled connection\n");
+        return NULL;
+    }
+
+    double legacy_sum, catalog_sum;
+    double legacy = run(0, &legacy_sum);
+    double catalog = run(1, &catalog_sum);
+
+    printf("%-22s %14s %14s %8s\n", "lookup", "sql c/s", "catalog c/s", "speedup");
+    printf("%-22s %14.0f %14.0f %7.0fx\n", "db_calculate_skin_price", legacy, catalog, catalog / legacy);
+    printf("%-22s %14.1f %14.1f\n", "ns per call", 1e9 / legacy, 1e9 / catalog);
+    if (legacy_sum != catalog_sum)
+        fprintf(stderr, "Price mismatch: sql total %.4f, catalog total %.4f\n", legacy_sum, catalog_sum);
+
+    db_thread_detach();
+    return NULL;
+}
+
+int main(int argc, char *argv[])
+{
+    g_calls = argc > 1 ? atol(argv[1]) : 200000;
+    if (g_calls <= 0)
+    {
+        fprintf(stderr, "Usage: %s [calls_per_run]\n", argv[0]);
+        return 1;
+    }
+
+    // db_init() opens data/database.db relative to the working directory
+    char dir[] = "/tmp/cs2_bench_XXXXXX";
+    if (!mkdtemp(dir) || chdir(dir) != 0)
+    {
+        perror("scratch directory");
+        return 1;
+    }
+
+    const PricingCatalog *catalog;
+    if (db_init() != 0 || !(catalog = pricing_catalog_get()))
+    {
+        fprintf(stderr, "Could not set up the scratch database in %s\n", dir);
+        return 1;
+    }
+    g_definitions = catalog->max_definition_id;
+
+    printf("=== CS2 Skin Trading - Pricing Catalog Benchmark ===\n");
+    printf("calls=%ld definitions=%d wear_ranges=%d\n\n", g_calls, g_definitions, catalog->wear_range_count);
+
+    pthread_t thread;
+    if (pthread_create(&thread, NULL, bench_thread, NULL) == 0)
+        pthread_join(thread, NULL);
+
+    db_close();
+
+    char command[64];
+    snprintf(command, sizeof(command), "rm -rf %s", dir);
+    return system(command) == 0 ? 0 : 1;
+}
@@ -0,0 +1,321 @@
+// bench_reactors.c - Accept/read throughput of the server as epoll reactors are added
+//
+// Usage: bench_reactors <server_binary> [port] [seconds_per_phase] [client_threads] [max_reactors]
+// Starts the server once per reactor count (1, 2, 4, ... max_reactors) in a scratch directory
+// and drives it with heartbeat traffic:
+//   accept phase: every request uses a fresh connection (connect, heartbeat, close)
+//   read phase:   each client keeps one connection and pipelines heartbeats
+
+#include "../include/protocol.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <signal.h>
+#include <errno.h>
+#include <time.h>
+#include <fcntl.h>
+#include <pthread.h>
+#include <sys/socket.h>
+#include <sys/wait.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <arpa/inet.h>
+
+#define DEFAULT_BENCH_PORT 18888
+#define PIPELINE_DEPTH 16
+#define STARTUP_TIMEOUT_SEC 30
+
+typedef struct
+{
+    int port;
+    int pipelined;
+    volatile int *running;
+    long completed;
+    long failed;
+} ClientArgs;
+
+static double now_seconds(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static int connect_to_server(int port)
+{
+    int fd = socket(AF_INET, SOCK_STREAM, 0);
+    if (fd < 0)
+        return -1;
+
+    int one = 1;
+    setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+
+    struct sockaddr_in addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sin_family = AF_INET;
+    addr.sin_port = htons(port);
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+
+    if (connect(fd, (struct sockaddr *)&addr, sizeof(addr)) != 0)
+    {
+        close(fd);
+        return -1;
+    }
+    return fd;
+}
+
+static int send_all(int fd, const void *data, size_t len)
+{
+    const char *p = data;
+    while (len > 0)
+    {
+        ssize_t n = send(fd, p, len, MSG_NOSIGNAL);
+        if (n <= 0)
+        {
+            if (n < 0 && errno == EINTR)
+                continue;
+            return -1;
+        }
+        p += n;
+        len -= n;
+    }
+    return 0;
+}
+
+static int recv_all(int fd, void *data, size_t len)
+{
+    char *p = data;
+    while (len > 0)
+    {
+        ssize_t n = recv(fd, p, len, 0);
+        if (n <= 0)
+        {
+            if (n < 0 && errno == EINTR)
+                continue;
+            return -1;
+        }
+        p += n;
+        len -= n;
+    }
+    return 0;
+}
+
+// Read one response and skip its payload
+static int read_response(int fd)
+{
+    MessageHeader header;
+    if (recv_all(fd, &header, sizeof(header)) != 0 || header.magic != 0xABCD)
+        return -1;
+
+    char payload[MAX_PAYLOAD_SIZE];
+    if (header.msg_length > MAX_PAYLOAD_SIZE)
+        return -1;
+    return recv_all(fd, payload, header.msg_length);
+}
+
+static void fill_heartbeats(MessageHeader *headers, int count)
+{
+    memset(headers, 0, sizeof(MessageHeader) * count);
+    for (int i = 0; i < count; i++)
+    {
+        headers[i].magic = 0xABCD;
+        headers[i].msg_type = MSG_HEARTBEAT;
+        headers[i].msg_length = 0;
+        headers[i].sequence_num = i + 1;
+        headers[i].checksum = 0; // CRC32 of an empty payload
+    }
+}
+
+static void *accept_client(void *arg)
+{
+    ClientArgs *args = (ClientArgs *)arg;
+    MessageHeader heartbeat;
+    fill_heartbeats(&heartbeat, 1);
+
+    while (*args->running)
+    {
+        int fd = connect_to_server(args->port);
+        if (fd < 0)
+        {
+            args->failed++;
+            continue;
+        }
+        if (send_all(fd, &heartbeat, sizeof(heartbeat)) == 0 && read_response(fd) == 0)
+            args->completed++;
+        else
+            args->failed++;
+        close(fd);
+    }
+    return NULL;
+}
+
+static void *read_client(void *arg)
+{
+    ClientArgs *args = (ClientArgs *)arg;
+    MessageHeader batch[PIPELINE_DEPTH];
+    fill_heartbeats(batch, PIPELINE_DEPTH);
+
+    int fd = connect_to_server(args->port);
+    if (fd < 0)
+    {
+        args->failed++;
+        return NULL;
+    }
+
+    while (*args->running)
+    {
+        if (send_all(fd, batch, sizeof(batch)) != 0)
+        {
+            args->failed++;
+            break;
+        }
+        for (int i = 0; i < PIPELINE_DEPTH; i++)
+        {
+            if (read_response(fd) != 0)
+            {
+                args->failed++;
+                close(fd);
+                return NULL;
+            }
+            args->completed++;
+        }
+    }
+    close(fd);
+    return NULL;
+}
+
+// Run one phase with client_threads clients; returns completed requests per second
+static double run_phase(void *(*client)(void *), int port, int client_threads, int seconds, long *failed)
+{
+    pthread_t *threads = calloc(client_threads, sizeof(pthread_t));
+    ClientArgs *args = calloc(client_threads, sizeof(ClientArgs));
+    volatile int running = 1;
+
+    double start = now_seconds();
+    for (int i = 0; i < client_threads; i++)
+    {
+        args[i].port = port;
+        args[i].running = &running;
+        pthread_create(&threads[i], NULL, client, &args[i]);
+    }
+
+    sleep(seconds);
+    running = 0;
+
+    long completed = 0;
+    *failed = 0;
+    for (int i = 0; i < client_threads; i++)
+    {
+        pthread_join(threads[i], NULL);
+        completed += args[i].completed;
+        *failed += args[i].failed;
+    }
+    double elapsed = now_seconds() - start;
+
+    free(threads);
+    free(args);
+    return completed / elapsed;
+}
+
+static pid_t start_server(const char *server_binary, const char *workdir, int port, int reactors)
+{
+    pid_t pid = fork();
+    if (pid != 0)
+        return pid;
+
+    // Child: run the server quietly in the scratch directory
+    if (chdir(workdir) != 0)
+        _exit(127);
+    int devnull = open("/dev/null", O_WRONLY);
+    if (devnull >= 0)
+    {
+        dup2(devnull, STDOUT_FILENO);
+        dup2(devnull, STDERR_FILENO);
+    }
+
+    char port_str[16], reactors_str[16];
+    snprintf(port_str, sizeof(port_str), "%d", port);
+    snprintf(reactors_str, sizeof(reactors_str), "%d", reactors);
+    execl(server_binary, server_binary, port_str, reactors_str, (char *)NULL);
+    _exit(127);
+}
+
+static int wait_for_server(int port)
+{
+    for (int i = 0; i < STARTUP_TIMEOUT_SEC * 10; i++)
+    {
+        int fd = connect_to_server(port);
+        if (fd >= 0)
+        {
+            close(fd);
+            return 0;
+        }
+        usleep(100000);
+    }
+    return -1;
+}
+
+int main(int argc, char *argv[])
+{
+    if (argc < 2)
+    {
+        fprintf(stderr, "Usage: %s <server_binary> [port] [seconds_per_phase] [client_threads] [max_reactors]\n", argv[0]);
+        return 1;
+    }
+
+    char server_binary[4096];
+    if (!realpath(argv[1], server_binary))
+    {
+        fprintf(stderr, "Cannot resolve server binary %s: %s\n", argv[1], strerror(errno));
+        return 1;
+    }
+    int port = argc > 2 ? atoi(argv[2]) : DEFAULT_BENCH_PORT;
+    int seconds = argc > 3 ? atoi(argv[3]) : 5;
+    int client_threads = argc > 4 ? atoi(argv[4]) : 32;
+    long cpus = sysconf(_SC_NPROCESSORS_ONLN);
+    int max_reactors = argc > 5 ? atoi(argv[5]) : (int)(cpus > 0 ? cpus : 4);
+    if (seconds <= 0 || client_threads <= 0 || max_reactors <= 0)
+    {
+        fprintf(stderr, "Invalid arguments\n");
+        return 1;
+    }
+
+    // One scratch directory for all runs so the database is only populated once
+    char workdir[] = "/tmp/cs2_bench_XXXXXX";
+    if (!mkdtemp(workdir))
+    {
+        fprintf(stderr, "mkdtemp failed: %s\n", strerror(errno));
+        return 1;
+    }
+
+    printf("=== CS2 Skin Trading - Reactor Benchmark ===\n");
+    printf("server=%s port=%d phase=%ds clients=%d workdir=%s\n\n", server_binary, port, seconds, client_threads, workdir);
+    printf("%-9s %16s %16s %10s\n", "reactors", "accepts/sec", "requests/sec", "failures");
+
+    for (int reactors = 1; reactors <= max_reactors; reactors *= 2)
+    {
+        pid_t pid = start_server(server_binary, workdir, port, reactors);
+        if (pid < 0 || wait_for_server(port) != 0)
+        {
+            fprintf(stderr, "Server did not start with %d reactor(s)\n", reactors);
+            if (pid > 0)
+            {
+                kill(pid, SIGKILL);
+                waitpid(pid, NULL, 0);
+            }
+            return 1;
+        }
+
+        long accept_failed = 0, read_failed = 0;
+        double accepts = run_phase(accept_client, port, client_threads, seconds, &accept_failed);
+        double requests = run_phase(read_client, port, client_threads, seconds, &read_failed);
+        printf("%-9d %16.0f %16.0f %10ld\n", reactors, accepts, requests, accept_failed + read_failed);
+        fflush(stdout);
+
+        kill(pid, SIGTERM);
+        waitpid(pid, NULL, 0);
+    }
+
+    return 0;
+}
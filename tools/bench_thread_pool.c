@@ -0,0 +1,333 @@
+// bench_thread_pool.c - Job throughput of the work-stealing pool vs. the single-queue pool
+//
+// Build (from the repository root):
+//   gcc -O2 -pthread -Isrc -o bench_thread_pool tools/bench_thread_pool.c
+//       src/server/thread_pool.c src/server/buffer_pool.c src/server/logger.c
+// Usage: bench_thread_pool [jobs_per_run] [producer_threads] [work_iterations]
+//
+// Producers play the role of reactor threads and submit heartbeat jobs for many
+// connections. handle_client_request() is replaced by a stub that spins for
+// work_iterations, so the numbers measure scheduling overhead, not request handling.
+// The single-queue pool below is the previous implementation (one mutex and
+// not_empty/not_full condition variables shared by every producer and worker).
+
+#include "../include/thread_pool.h"
+#include "../include/request_handler.h"
+#include "../include/buffer_pool.h"
+#include "../include/database.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sched.h>
+#include <time.h>
+
+#define FDS_PER_PRODUCER 1024
+
+static atomic_long g_completed;
+static int g_work_iterations = 200;
+
+// Stub for the real request handler: burn a little CPU and count the job
+int handle_client_request(int client_fd, Message *request)
+{
+    volatile unsigned int sink = (unsigned int)client_fd;
+    for (int i = 0; i < g_work_iterations; i++)
+        sink = sink * 31 + request->header.sequence_num;
+    atomic_fetch_add_explicit(&g_completed, 1, memory_order_relaxed);
+    return 0;
+}
+
+// Busy replies and broadcasts are sent by workers; the benchmark has no sockets to write to
+int send_server_full_response(int client_fd, const MessageHeader *request_header)
+{
+    (void)client_fd;
+    (void)request_header;
+    return 0;
+}
+
+int send_response(int client_fd, Message *response)
+{
+    (void)client_fd;
+    (void)response;
+    return 0;
+}
+
+// The benchmark has no database: workers attach to nothing
+int db_thread_attach(int read_only)
+{
+    (void)read_only;
+    return 0;
+}
+
+void db_thread_detach(void)
+{
+}
+
+void rng_bind_stream(unsigned int index)
+{
+    (void)index;
+}
+
+// ==================== Single-queue pool (previous implementation) ====================
+
+typedef struct
+{
+    Job queue[MAX_QUEUE_SIZE];
+    int head;
+    int tail;
+    int count;
+    int shutdown;
+    pthread_mutex_t mutex;
+    pthread_cond_t not_empty;
+    pthread_cond_t not_full;
+    pthread_t *threads;
+    int worker_count;
+    unsigned char *in_flight; // Per-fd mailbox flag
+    PendingJob **pending_head;
+    PendingJob **pending_tail;
+    int pending_count;
+    int fd_capacity;
+} LegacyPool;
+
+static void legacy_enqueue(LegacyPool *pool, const Job *job)
+{
+    pool->queue[pool->tail] = *job;
+    pool->tail = (pool->tail + 1) % MAX_QUEUE_SIZE;
+    pool->count++;
+    pthread_cond_signal(&pool->not_empty);
+}
+
+static void *legacy_worker(void *arg)
+{
+    LegacyPool *pool = (LegacyPool *)arg;
+    while (1)
+    {
+        pthread_mutex_lock(&pool->mutex);
+        while (pool->count == 0 && !pool->shutdown)
+            pthread_cond_wait(&pool->not_empty, &pool->mutex);
+        if (pool->shutdown && pool->count == 0)
+        {
+            pthread_mutex_unlock(&pool->mutex);
+            break;
+        }
+        Job job = pool->queue[pool->head];
+        pool->head = (pool->head + 1) % MAX_QUEUE_SIZE;
+        pool->count--;
+        pthread_cond_signal(&pool->not_full);
+        pthread_mutex_unlock(&pool->mutex);
+
+        handle_client_request(job.client_fd, job.request);
+        frame_buffer_release(job.request);
+
+        pthread_mutex_lock(&pool->mutex);
+        PendingJob *next = pool->pending_head[job.client_fd];
+        if (next)
+        {
+            pool->pending_head[job.client_fd] = next->next;
+            if (!next->next)
+                pool->pending_tail[job.client_fd] = NULL;
+            pool->pending_count--;
+            legacy_enqueue(pool, &next->job);
+            free(next);
+        }
+        else
+        {
+            pool->in_flight[job.client_fd] = 0;
+        }
+        pthread_mutex_unlock(&pool->mutex);
+    }
+    return NULL;
+}
+
+static int legacy_init(LegacyPool *pool, int worker_count, int fd_capacity)
+{
+    memset(pool, 0, sizeof(LegacyPool));
+    pthread_mutex_init(&pool->mutex, NULL);
+    pthread_cond_init(&pool->not_empty, NULL);
+    pthread_cond_init(&pool->not_full, NULL);
+    pool->fd_capacity = fd_capacity;
+    pool->in_flight = calloc(fd_capacity, 1);
+    pool->pending_head = calloc(fd_capacity, sizeof(PendingJob *));
+    pool->pending_tail = calloc(fd_capacity, sizeof(PendingJob *));
+    pool->threads = calloc(worker_count, sizeof(pthread_t));
+    pool->worker_count = worker_count;
+    if (!pool->in_flight || !pool->pending_head || !pool->pending_tail || !pool->threads)
+        return -1;
+    for (int i = 0; i < worker_count; i++)
+        pthread_create(&pool->threads[i], NULL, legacy_worker, pool);
+    return 0;
+}
+
+static int legacy_add_job(LegacyPool *pool, int client_fd, Message *request)
+{
+    pthread_mutex_lock(&pool->mutex);
+    while (pool->count + pool->pending_count >= MAX_QUEUE_SIZE && !pool->shutdown)
+        pthread_cond_wait(&pool->not_full, &pool->mutex);
+
+    Job job = {.client_fd = client_fd, .request = request};
+    if (pool->in_flight[client_fd])
+    {
+        PendingJob *pending = malloc(sizeof(PendingJob));
+        pending->job = job;
+        pending->next = NULL;
+        if (pool->pending_tail[client_fd])
+            pool->pending_tail[client_fd]->next = pending;
+        else
+            pool->pending_head[client_fd] = pending;
+        pool->pending_tail[client_fd] = pending;
+        pool->pending_count++;
+    }
+    else
+    {
+        pool->in_flight[client_fd] = 1;
+        legacy_enqueue(pool, &job);
+    }
+    pthread_mutex_unlock(&pool->mutex);
+    return 0;
+}
+
+static void legacy_shutdown(LegacyPool *pool)
+{
+    pthread_mutex_lock(&pool->mutex);
+    pool->shutdown = 1;
+    pthread_cond_broadcast(&pool->not_empty);
+    pthread_cond_broadcast(&pool->not_full);
+    pthread_mutex_unlock(&pool->mutex);
+    for (int i = 0; i < pool->worker_count; i++)
+        pthread_join(pool->threads[i], NULL);
+    free(pool->threads);
+    free(pool->in_flight);
+    free(pool->pending_head);
+    free(pool->pending_tail);
+    pthread_mutex_destroy(&pool->mutex);
+    pthread_cond_destroy(&pool->not_empty);
+    pthread_cond_destroy(&pool->not_full);
+}
+
+// ==================== Driver ====================
+
+typedef struct
+{
+    int index;
+    long jobs;
+    int use_legacy;
+    LegacyPool *legacy;
+    ThreadPool *pool;
+} ProducerArgs;
+
+static double now_seconds(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static void *producer(void *arg)
+{
+    ProducerArgs *args = (ProducerArgs *)arg;
+    int first_fd = args->index * FDS_PER_PRODUCER;
+
+    for (long i = 0; i < args->jobs; i++)
+    {
+        int fd = first_fd + (int)(i % FDS_PER_PRODUCER);
+        while (1)
+        {
+            Message *request = frame_buffer_acquire(0);
+            if (!request)
+                continue;
+            memset(&request->header, 0, sizeof(MessageHeader));
+            request->header.magic = 0xABCD;
+            request->header.msg_type = MSG_HEARTBEAT;
+            request->header.sequence_num = (uint32_t)i;
+            request->payload[0] = '\0';
+
+            if (args->use_legacy)
+            {
+                legacy_add_job(args->legacy, fd, request);
+                break;
+            }
+            // The pool sheds instead of blocking: back off and resubmit, like a client retrying
+            if (thread_pool_add_job(args->pool, fd, request) == 0)
+                break;
+            sched_yield();
+        }
+    }
+    return NULL;
+}
+
+static double run(int use_legacy, int workers, int producers, long jobs)
+{
+    LegacyPool legacy;
+    ThreadPool *pool = malloc(sizeof(ThreadPool));
+    if (!pool)
+        return 0;
+
+    int init_result = use_legacy ? legacy_init(&legacy, workers, producers * FDS_PER_PRODUCER)
+                                 : thread_pool_init_workers(pool, workers);
+    if (init_result != 0)
+    {
+        fprintf(stderr, "Pool init failed (%d workers)\n", workers);
+        free(pool);
+        return 0;
+    }
+
+    atomic_store(&g_completed, 0);
+    pthread_t *threads = calloc(producers, sizeof(pthread_t));
+    ProducerArgs *args = calloc(producers, sizeof(ProducerArgs));
+    long per_producer = jobs / producers;
+
+    double start = now_seconds();
+    for (int i = 0; i < producers; i++)
+    {
+        args[i].index = i;
+        args[i].jobs = per_producer;
+        args[i].use_legacy = use_legacy;
+        args[i].legacy = &legacy;
+        args[i].pool = pool;
+        pthread_create(&threads[i], NULL, producer, &args[i]);
+    }
+    for (int i = 0; i < producers; i++)
+        pthread_join(threads[i], NULL);
+    while (atomic_load(&g_completed) < per_producer * producers)
+        sched_yield();
+    double elapsed = now_seconds() - start;
+
+    if (use_legacy)
+        legacy_shutdown(&legacy);
+    else
+        thread_pool_shutdown(pool);
+
+    free(threads);
+    free(args);
+    free(pool);
+    return per_producer * producers / elapsed;
+}
+
+int main(int argc, char *argv[])
+{
+    long jobs = argc > 1 ? atol(argv[1]) : 1000000;
+    int producers = argc > 2 ? atoi(argv[2]) : 4;
+    g_work_iterations = argc > 3 ? atoi(argv[3]) : 200;
+    if (jobs <= 0 || producers <= 0 || g_work_iterations < 0)
+    {
+        fprintf(stderr, "Usage: %s [jobs_per_run] [producer_threads] [work_iterations]\n", argv[0]);
+        return 1;
+    }
+
+    static const int worker_counts[] = {1, 8, 32, 64};
+
+    printf("=== CS2 Skin Trading - Thread Pool Benchmark ===\n");
+    printf("jobs=%ld producers=%d work=%d iterations/job\n\n", jobs, producers, g_work_iterations);
+    printf("%-8s %18s %18s %8s\n", "workers", "single-queue j/s", "work-stealing j/s", "speedup");
+
+    for (size_t i = 0; i < sizeof(worker_counts) / sizeof(worker_counts[0]); i++)
+    {
+        int workers = worker_counts[i];
+        double legacy = run(1, workers, producers, jobs);
+        double stealing = run(0, workers, producers, jobs);
+        printf("%-8d %18.0f %18.0f %7.2fx\n", workers, legacy, stealing, legacy > 0 ? stealing / legacy : 0);
+        fflush(stdout);
+    }
+
+    frame_buffer_pool_cleanup();
+    return 0;
+}
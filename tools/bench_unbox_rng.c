@@ -0,0 +1,127 @@
+// bench_unbox_rng.c - Random draws of an unbox roll: shared rand() vs per-thread xoshiro256**
+//
+// Build (from the repository root):
+//   gcc -O2 -pthread -Isrc -o bench_unbox_rng tools/bench_unbox_rng.c src/server/rng.c src/server/logger.c
+// Usage: bench_unbox_rng [rolls_per_thread] [max_threads]
+//
+// Every roll makes the draws unbox_case() makes (skin column and coin, wear, StatTrak, pattern),
+// once through the previous rand() calls and once through rng.h, on 1, 2, 4 ... max_threads
+// threads at once. Also checks that a fixed seed replays the same rolls.
+
+#include "../include/rng.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+#include <time.h>
+
+static long g_rolls = 2000000;
+
+typedef struct
+{
+    int use_rng;
+    double checksum;
+} Worker;
+
+// ==================== Previous draws (glibc rand(), one lock-protected state) ====================
+
+static double legacy_roll(void)
+{
+    double u1 = (double)rand() / ((double)RAND_MAX + 1.0);
+    double u2 = (double)rand() / ((double)RAND_MAX + 1.0);
+    long long random_int = ((long long)rand() << 16) | ((long long)rand() & 0xFFFF);
+    random_int = random_int % (2147483647LL + 1);
+    float wear = (float)random_int / 2147483647.0f;
+    int stattrak = ((float)rand() / (float)RAND_MAX) <= 0.10f;
+    int pattern = rand() % 1000;
+    return u1 + u2 + wear + stattrak + pattern;
+}
+
+static double rng_roll(void)
+{
+    double u1 = rng_uniform();
+    double u2 = rng_uniform();
+    float wear = (float)(long long)(rng_next() >> 33) / 2147483647.0f;
+    int stattrak = rng_uniform() < 0.10;
+    int pattern = (int)rng_below(1000);
+    return u1 + u2 + wear + stattrak + pattern;
+}
+
+// ==================== Driver ====================
+
+static double now_seconds(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static void *worker_main(void *arg)
+{
+    Worker *w = arg;
+    double sum = 0.0;
+    for (long i = 0; i < g_rolls; i++)
+        sum += w->use_rng ? rng_roll() : legacy_roll();
+    w->checksum = sum;
+    return NULL;
+}
+
+// Total rolls per second with threads rolling at once
+static double run(int threads, int use_rng)
+{
+    pthread_t tids[threads];
+    Worker workers[threads];
+    double start = now_seconds();
+    for (int t = 0; t < threads; t++)
+    {
+        workers[t].use_rng = use_rng;
+        pthread_create(&tids[t], NULL, worker_main, &workers[t]);
+    }
+    for (int t = 0; t < threads; t++)
+        pthread_join(tids[t], NULL);
+    return (double)g_rolls * threads / (now_seconds() - start);
+}
+
+// Same seed, same first rolls on a fresh stream
+static int check_replay(void)
+{
+    double first[64], second[64];
+    rng_seed(12345);
+    for (int i = 0; i < 64; i++)
+        first[i] = rng_roll();
+    rng_seed(12345);
+    for (int i = 0; i < 64; i++)
+        second[i] = rng_roll();
+    return memcmp(first, second, sizeof(first)) == 0 ? 0 : -1;
+}
+
+int main(int argc, char *argv[])
+{
+    g_rolls = argc > 1 ? atol(argv[1]) : 2000000;
+    int max_threads = argc > 2 ? atoi(argv[2]) : 8;
+    if (g_rolls <= 0 || max_threads <= 0 || max_threads > 256)
+    {
+        fprintf(stderr, "Usage: %s [rolls_per_thread] [max_threads]\n", argv[0]);
+        return 1;
+    }
+
+    printf("=== CS2 Skin Trading - Unbox RNG Benchmark ===\n");
+    printf("rolls_per_thread=%ld\n\n", g_rolls);
+
+    if (check_replay() != 0)
+    {
+        fprintf(stderr, "Fixed seed did not replay the same rolls\n");
+        return 1;
+    }
+    printf("replay with a fixed seed: ok\n\n");
+
+    srand((unsigned int)time(NULL));
+    printf("%-8s %16s %16s %8s\n", "threads", "rand() r/s", "xoshiro r/s", "speedup");
+    for (int threads = 1; threads <= max_threads; threads *= 2)
+    {
+        double legacy = run(threads, 0);
+        double fast = run(threads, 1);
+        printf("%-8d %16.0f %16.0f %7.1fx\n", threads, legacy, fast, fast / legacy);
+    }
+    return 0;
+}
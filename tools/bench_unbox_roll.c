@@ -0,0 +1,184 @@
+// bench_unbox_roll.c - unbox_case() skin roll: per-rarity SQL queries vs precompiled alias tables
+//
+// Build (from the repository root):
+//   gcc -O2 -pthread -Isrc -o bench_unbox_roll tools/bench_unbox_roll.c
+//       src/server/database_sqlite.c src/server/pricing_catalog.c src/server/logger.c -lsqlite3
+// Usage: bench_unbox_roll [rolls_per_case]
+//
+// Creates a scratch database under /tmp. For every case it rolls a skin through a copy of the
+// previous implementation (one query per rarity, a cascade over the thresholds, one more query
+// for the pool) and through the case's alias table, compares the rarity frequencies of both
+// with the expected drop rates, and times the two.
+
+#include "../include/database.h"
+#include "../include/database_internal.h"
+#include "../include/pricing_catalog.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <time.h>
+
+static long g_rolls = 100000;
+
+// ==================== SQL roll (previous implementation) ====================
+
+static int legacy_roll(int case_id)
+{
+    SkinRarity available_rarities[7];
+    int rarity_count = 0;
+    for (SkinRarity r = RARITY_CONSUMER; r <= RARITY_CONTRABAND; r++)
+    {
+        int test_ids[100];
+        int test_count = 0;
+        if (db_get_case_skins_by_rarity(case_id, r, test_ids, &test_count) == 0 && test_count > 0)
+            available_rarities[rarity_count++] = r;
+    }
+    if (rarity_count == 0)
+        return -1;
+
+    static const SkinRarity cascade[] = {RARITY_CONTRABAND, RARITY_COVERT, RARITY_CLASSIFIED, RARITY_RESTRICTED, RARITY_MIL_SPEC};
+    static const float below[] = {0.26f, 0.90f, 4.10f, 20.08f, 101.0f};
+    float r = ((float)rand() / (float)RAND_MAX) * 100.0f;
+
+    SkinRarity rolled_rarity = available_rarities[0];
+    int found = 0;
+    for (int band = 0; band < 5 && !found; band++)
+    {
+        if (r >= below[band])
+            continue;
+        for (int i = 0; i < rarity_count; i++)
+        {
+            if (available_rarities[i] == cascade[band])
+            {
+                rolled_rarity = cascade[band];
+                found = 1;
+                break;
+            }
+        }
+    }
+
+    int definition_ids[100];
+    int skin_count = 0;
+    if (db_get_case_skins_by_rarity(case_id, rolled_rarity, definition_ids, &skin_count) != 0 || skin_count == 0)
+        return -1;
+    return definition_ids[rand() % skin_count];
+}
+
+static int catalog_roll(const CatalogCase *case_data)
+{
+    double u1 = (double)rand() / ((double)RAND_MAX + 1.0);
+    double u2 = (double)rand() / ((double)RAND_MAX + 1.0);
+    return pricing_catalog_roll_case(case_data, u1, u2);
+}
+
+// ==================== Driver ====================
+
+static double now_seconds(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+// Rolls g_rolls skins and counts them per rarity, returns rolls per second
+static double run(const PricingCatalog *catalog, int case_id, int use_catalog, long *per_rarity)
+{
+    const CatalogCase *case_data = NULL;
+    pricing_catalog_case(catalog, case_id, &case_data);
+
+    double start = now_seconds();
+    for (long i = 0; i < g_rolls; i++)
+    {
+        int definition_id = use_catalog ? catalog_roll(case_data) : legacy_roll(case_id);
+        const CatalogDefinition *def;
+        if (definition_id >= 0 && pricing_catalog_definition(catalog, definition_id, &def) == 0)
+            per_rarity[def->rarity]++;
+    }
+    return g_rolls / (now_seconds() - start);
+}
+
+// Runs on its own thread so it gets a pooled connection like a server worker
+static void *bench_thread(void *arg)
+{
+    (void)arg;
+    if (db_thread_attach(1) != 0)
+    {
+        fprintf(stderr, "Could not check out a pooled connection\n");
+        return NULL;
+    }
+
+    const PricingCatalog *catalog = pricing_catalog_get();
+    printf("%-6s %-8s %10s %10s %10s %12s %14s %8s\n",
+           "case", "rarity", "expected", "sql", "alias", "sql r/s", "alias r/s", "speedup");
+
+    for (int case_id = 1; case_id <= catalog->max_case_id; case_id++)
+    {
+        const CatalogCase *case_data;
+        if (pricing_catalog_case(catalog, case_id, &case_data) != 0 || case_data->skin_count == 0)
+            continue;
+
+        long sql_counts[CATALOG_RARITY_COUNT] = {0};
+        long alias_counts[CATALOG_RARITY_COUNT] = {0};
+        double sql_rate = run(catalog, case_id, 0, sql_counts);
+        double alias_rate = run(catalog, case_id, 1, alias_counts);
+
+        int first = 1;
+        for (int r = CATALOG_RARITY_COUNT - 1; r >= 0; r--)
+        {
+            if (case_data->rarity_weight[r] <= 0.0 && sql_counts[r] == 0 && alias_counts[r] == 0)
+                continue;
+            if (first)
+                printf("%-6d %-8d %9.3f%% %9.3f%% %9.3f%% %12.0f %14.0f %7.0fx\n", case_id, r,
+                       100.0 * case_data->rarity_weight[r], 100.0 * sql_counts[r] / g_rolls,
+                       100.0 * alias_counts[r] / g_rolls, sql_rate, alias_rate, alias_rate / sql_rate);
+            else
+                printf("%-6s %-8d %9.3f%% %9.3f%% %9.3f%%\n", "", r, 100.0 * case_data->rarity_weight[r],
+                       100.0 * sql_counts[r] / g_rolls, 100.0 * alias_counts[r] / g_rolls);
+            first = 0;
+        }
+    }
+
+    db_thread_detach();
+    return NULL;
+}
+
+int main(int argc, char *argv[])
+{
+    g_rolls = argc > 1 ? atol(argv[1]) : 100000;
+    if (g_rolls <= 0)
+    {
+        fprintf(stderr, "Usage: %s [rolls_per_case]\n", argv[0]);
+        return 1;
+    }
+
+    // db_init() opens data/database.db relative to the working directory
+    char dir[] = "/tmp/cs2_bench_XXXXXX";
+    if (!mkdtemp(dir) || chdir(dir) != 0)
+    {
+        perror("scratch directory");
+        return 1;
+    }
+
+    const PricingCatalog *catalog;
+    if (db_init() != 0 || !(catalog = pricing_catalog_get()))
+    {
+        fprintf(stderr, "Could not set up the scratch database in %s\n", dir);
+        return 1;
+    }
+    srand((unsigned int)time(NULL));
+
+    printf("=== CS2 Skin Trading - Unbox Roll Benchmark ===\n");
+    printf("rolls_per_case=%ld cases=%d\n\n", g_rolls, catalog->max_case_id);
+
+    pthread_t thread;
+    if (pthread_create(&thread, NULL, bench_thread, NULL) == 0)
+        pthread_join(thread, NULL);
+
+    db_close();
+
+    char command[64];
+    snprintf(command, sizeof(command), "rm -rf %s", dir);
+    return system(command) == 0 ? 0 : 1;
+}